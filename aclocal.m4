@@ -1955,3 +1955,4 @@ m4_include([auxdir/x_ac_ucx.m4])
 m4_include([auxdir/x_ac_uid_gid_size.m4])
 m4_include([auxdir/x_ac_x11.m4])
 m4_include([auxdir/x_ac_yaml.m4])
+m4_include([auxdir/x_ac_zstd.m4])
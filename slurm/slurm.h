@@ -3323,6 +3323,23 @@ typedef struct stats_info_request_msg {
 	uint16_t command_id;
 } stats_info_request_msg_t;
 
+/* RPC processing phases in stats_info_response_msg_t rpc_type_latency */
+enum {
+	RPC_LATENCY_TOTAL,	/* sum of all phases */
+	RPC_LATENCY_QUEUE,	/* waiting in the RPC queue */
+	RPC_LATENCY_LOCK,	/* waiting for slurmctld locks */
+	RPC_LATENCY_EXEC,	/* handler execution */
+	RPC_LATENCY_PHASE_CNT
+};
+
+/* Percentiles of each phase in stats_info_response_msg_t rpc_type_latency */
+enum {
+	RPC_LATENCY_P50,
+	RPC_LATENCY_P99,
+	RPC_LATENCY_P999,
+	RPC_LATENCY_PCTL_CNT
+};
+
 typedef struct stats_info_response_msg {
 	time_t req_time;
 	time_t req_time_start;
@@ -3381,6 +3398,11 @@ typedef struct stats_info_response_msg {
 	uint64_t *rpc_type_dropped;
 	uint16_t *rpc_type_cycle_last;
 	uint16_t *rpc_type_cycle_max;
+	/*
+	 * Latency percentiles in usec, rpc_type_size * RPC_LATENCY_PHASE_CNT *
+	 * RPC_LATENCY_PCTL_CNT entries indexed [type][phase][percentile]
+	 */
+	uint64_t *rpc_type_latency;
 
 	uint32_t rpc_user_size;
 	uint32_t *rpc_user_id;
@@ -3394,6 +3416,26 @@ typedef struct stats_info_response_msg {
 	uint32_t rpc_dump_count;
 	uint32_t *rpc_dump_types;
 	char **rpc_dump_hostlist;
+
+	uint32_t rpc_slow_count;
+	time_t *rpc_slow_time;
+	uint16_t *rpc_slow_type;
+	uint32_t *rpc_slow_uid;
+	/* usec, rpc_slow_count * RPC_LATENCY_PHASE_CNT entries */
+	uint64_t *rpc_slow_latency;
+	char **rpc_slow_lock_holder;
+
+	uint32_t rpc_lane_count; /* 0 unless SlurmctldParameters=rpc_lanes */
+	char **rpc_lane_name;
+	uint32_t *rpc_lane_active;
+	uint32_t *rpc_lane_waiting;
+	uint32_t *rpc_lane_max_active;
+	uint32_t *rpc_lane_max_waiting;
+	uint64_t *rpc_lane_admitted;
+	uint64_t *rpc_lane_waited;
+	uint64_t *rpc_lane_shed;
+	uint64_t *rpc_lane_wait_usec; /* total time waiting for the lane */
+	uint64_t *rpc_lane_wait_max_usec;
 } stats_info_response_msg_t;
 
 #define TRIGGER_FLAG_PERM		0x0001
@@ -222,6 +222,9 @@ enum cluster_fed_states {
 						    */
 #define JOBCOND_FLAG_SCRIPT           SLURM_BIT(8) /* Get batch script only */
 #define JOBCOND_FLAG_ENV              SLURM_BIT(9) /* Get job's env only */
+#define JOBCOND_FLAG_STREAM           SLURM_BIT(10) /* Send the jobs back in
+						     * parts as they are read
+						     * instead of in one list */
 
 /* Archive / Purge time flags */
 #define SLURMDB_PURGE_BASE    0x0000ffff   /* Apply to get the number
@@ -1455,9 +1458,16 @@ typedef struct {
 
 typedef struct {
 	slurmdb_rollup_stats_t *dbd_rollup_stats;
+	uint32_t mult_msg_cnt;	/* DBD_SEND_MULT_MSG batches processed */
+	uint32_t mult_msg_max;	/* most records in one batch */
+	uint64_t mult_msg_recs;	/* records processed in batches */
+	uint64_t mult_msg_time;	/* usecs spent processing batches */
 	list_t *rollup_stats;              /* List of Clusters rollup stats */
 	list_t *rpc_list;                  /* list of RPCs sent to the dbd. */
 	time_t time_start;              /* When we started collecting data */
+	uint64_t usage_cache_hits;	/* usage requests served from cache */
+	uint64_t usage_cache_misses;	/* usage requests that read the db */
+	uint64_t usage_cache_rows;	/* usage rows currently cached */
 	list_t *user_list;                 /* list of users issuing RPCs */
 } slurmdb_stats_rec_t;
 
@@ -1778,6 +1788,20 @@ extern list_t *slurmdb_job_modify(void *db_conn,
  */
 extern list_t *slurmdb_jobs_get(void *db_conn, slurmdb_job_cond_t *job_cond);
 
+/*
+ * get info from the storage a part at a time
+ * IN:  slurmdb_job_cond_t *job_cond
+ * IN:  cb - called with each list of slurmdb_job_rec_t * as it arrives, in
+ *	order of job id within each cluster. cb may take the records out of
+ *	the list, the list itself is freed after cb returns. Return non-zero
+ *	from cb to stop.
+ * IN:  arg - handed to cb
+ * RET: SLURM_SUCCESS on success else error code
+ */
+extern int slurmdb_jobs_get_stream(void *db_conn, slurmdb_job_cond_t *job_cond,
+				   int (*cb)(list_t *job_list, void *arg),
+				   void *arg);
+
 /*
  * Fix runaway jobs
  * IN: jobs, a list of all the runaway jobs
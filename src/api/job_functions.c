@@ -69,6 +69,17 @@ extern list_t *slurmdb_jobs_get(void *db_conn, slurmdb_job_cond_t *job_cond)
 	return jobacct_storage_g_get_jobs_cond(db_conn, db_api_uid, job_cond);
 }
 
+extern int slurmdb_jobs_get_stream(void *db_conn, slurmdb_job_cond_t *job_cond,
+				   int (*cb)(list_t *job_list, void *arg),
+				   void *arg)
+{
+	if (db_api_uid == -1)
+		db_api_uid = getuid();
+
+	return jobacct_storage_g_get_jobs_cond_cb(db_conn, db_api_uid,
+						  job_cond, cb, arg);
+}
+
 /*
  * Fix runaway jobs
  * IN: jobs, a list of all the runaway jobs
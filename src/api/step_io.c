@@ -83,8 +83,11 @@ static void	_handle_io_init_msg(int fd, client_io_t *cio);
 static int _read_io_init_msg(int fd, void *conn, client_io_t *cio,
 			     slurm_addr_t *host);
 static int      _wid(int n);
+static void _handle_node_init(eio_obj_t *obj, struct io_buf *msg);
 static bool     _incoming_buf_free(client_io_t *cio);
 static bool     _outgoing_buf_free(client_io_t *cio);
+static void _put_incoming_buf(client_io_t *cio, struct io_buf *msg);
+static void _put_outgoing_buf(client_io_t *cio, struct io_buf *msg);
 
 /**********************************************************************
  * Listening socket declarations
@@ -189,7 +192,7 @@ _listening_socket_readable(eio_obj_t *obj)
 	if (obj->shutdown == true) {
 		if (obj->fd != -1) {
 			if (obj->fd > STDERR_FILENO)
-				close(obj->fd);
+				eio_obj_close_fd(obj);
 			obj->fd = -1;
 		}
 		debug2("  false, shutdown");
@@ -273,7 +276,7 @@ _server_readable(eio_obj_t *obj)
 	if (obj->shutdown) {
 		if (obj->fd != -1) {
 			if (obj->fd > STDERR_FILENO)
-				close(obj->fd);
+				eio_obj_close_fd(obj);
 			obj->fd = -1;
 			s->in_eof = true;
 			s->out_eof = true;
@@ -320,11 +323,11 @@ static int _server_read(eio_obj_t *obj, list_t *objs)
 				}
 			}
 			if (obj->fd > STDERR_FILENO)
-				close(obj->fd);
+				eio_obj_close_fd(obj);
 			obj->fd = -1;
 			s->in_eof = true;
 			s->out_eof = true;
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			_put_outgoing_buf(s->cio, s->in_msg);
 			s->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
@@ -332,7 +335,7 @@ static int _server_read(eio_obj_t *obj, list_t *objs)
 			if (s->cio->sls)
 				step_launch_clear_questionable_state(
 					s->cio->sls, s->node_id);
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			_put_outgoing_buf(s->cio, s->in_msg);
 			s->in_msg = NULL;
 			s->testing_connection = false;
 			return SLURM_SUCCESS;
@@ -355,7 +358,7 @@ static int _server_read(eio_obj_t *obj, list_t *objs)
 				&& s->remote_stderr_objs == 0) {
 				obj->shutdown = true;
 			}
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			_put_outgoing_buf(s->cio, s->in_msg);
 			s->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
@@ -401,11 +404,11 @@ static int _server_read(eio_obj_t *obj, list_t *objs)
 				step_launch_notify_io_failure(
 					s->cio->sls, s->node_id);
 			if (obj->fd > STDERR_FILENO)
-				close(obj->fd);
+				eio_obj_close_fd(obj);
 			obj->fd = -1;
 			s->in_eof = true;
 			s->out_eof = true;
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			_put_outgoing_buf(s->cio, s->in_msg);
 			s->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
@@ -418,6 +421,13 @@ static int _server_read(eio_obj_t *obj, list_t *objs)
 		debug3("***** passing on eof message");
 	}
 
+	if (s->in_msg->header.type == SLURM_IO_NODE_INIT) {
+		_handle_node_init(obj, s->in_msg);
+		_put_outgoing_buf(s->cio, s->in_msg);
+		s->in_msg = NULL;
+		return SLURM_SUCCESS;
+	}
+
 	/*
 	 * Route the message to the proper output
 	 */
@@ -433,9 +443,10 @@ static int _server_read(eio_obj_t *obj, list_t *objs)
 		info = (struct file_write_info *) obj->arg;
 		if (info->eof)
 			/* this output is closed, discard message */
-			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			_put_outgoing_buf(s->cio, s->in_msg);
 		else
 			list_enqueue(info->msg_queue, s->in_msg);
+		eio_obj_touch(obj);
 
 		s->in_msg = NULL;
 	}
@@ -532,7 +543,7 @@ again:
 	s->out_msg->ref_count--;
 	if (s->out_msg->ref_count == 0) {
 		slurm_mutex_lock(&s->cio->ioservers_lock);
-		list_enqueue(s->cio->free_incoming, s->out_msg);
+		_put_incoming_buf(s->cio, s->out_msg);
 		slurm_mutex_unlock(&s->cio->ioservers_lock);
 	} else
 		debug3("  Could not free msg!!");
@@ -615,7 +626,7 @@ static int _file_write(eio_obj_t *obj, list_t *objs)
 					        info->cio->het_job_task_offset,
 					        info->cio->label,
 					        info->cio->taskid_width)) < 0) {
-			list_enqueue(info->cio->free_outgoing, info->out_msg);
+			_put_outgoing_buf(info->cio, info->out_msg);
 			info->out_msg = NULL;
 			info->eof = true;
 			return SLURM_ERROR;
@@ -631,7 +642,7 @@ static int _file_write(eio_obj_t *obj, list_t *objs)
 	 */
 	info->out_msg->ref_count--;
 	if (info->out_msg->ref_count == 0)
-		list_enqueue(info->cio->free_outgoing, info->out_msg);
+		_put_outgoing_buf(info->cio, info->out_msg);
 	info->out_msg = NULL;
 	debug2("Leaving  %s", __func__);
 
@@ -684,7 +695,7 @@ static bool _file_readable(eio_obj_t *obj)
 	if (obj->shutdown == true) {
 		debug3("  false, shutdown");
 		if (obj->fd > STDERR_FILENO)
-			close(obj->fd);
+			eio_obj_close_fd(obj);
 		obj->fd = -1;
 		read_info->eof = true;
 		return false;
@@ -730,7 +741,7 @@ again:
 			debug("_file_read returned %s",
 			      errno==EAGAIN?"EAGAIN":"EWOULDBLOCK");
 			slurm_mutex_lock(&info->cio->ioservers_lock);
-			list_enqueue(info->cio->free_incoming, msg);
+			_put_incoming_buf(info->cio, msg);
 			slurm_mutex_unlock(&info->cio->ioservers_lock);
 			return SLURM_SUCCESS;
 		}
@@ -766,16 +777,25 @@ again:
 		int i;
 		struct server_io_info *server;
 		for (i = 0; i < info->cio->num_nodes; i++) {
-			msg->ref_count++;
-			if (info->cio->ioserver[i] == NULL)
+			if (info->cio->ioserver[i] == NULL) {
 				/* client_io_handler_abort() or
 				 * client_io_handler_downnodes() called */
 				verbose("ioserver stream of node %d not yet "
 					"initialized", i);
-			else {
-				server = info->cio->ioserver[i]->arg;
-				list_enqueue(server->msg_queue, msg);
+				continue;
 			}
+			server = info->cio->ioserver[i]->arg;
+			/* Relaying stepds pass it on to their subtree */
+			if (server->node_id != i)
+				continue;
+			msg->ref_count++;
+			list_enqueue(server->msg_queue, msg);
+			eio_obj_touch(info->cio->ioserver[i]);
+		}
+		if (!msg->ref_count) {
+			slurm_mutex_lock(&info->cio->ioservers_lock);
+			_put_incoming_buf(info->cio, msg);
+			slurm_mutex_unlock(&info->cio->ioservers_lock);
 		}
 	} else if (header.type == SLURM_IO_STDIN) {
 		uint32_t nodeid;
@@ -790,6 +810,7 @@ again:
 		} else {
 			server = info->cio->ioserver[nodeid]->arg;
 			list_enqueue(server->msg_queue, msg);
+			eio_obj_touch(info->cio->ioserver[nodeid]);
 		}
 	} else {
 		fatal("Unsupported header.type");
@@ -886,6 +907,9 @@ static int _read_io_init_msg(int fd, void *conn, client_io_t *cio,
 	 */
 	eio_new_initial_obj(cio->eio, cio->ioserver[msg.nodeid]);
 	slurm_mutex_unlock(&cio->ioservers_lock);
+	/* stdin is read once every node is ready */
+	if (cio->stdin_obj)
+		eio_obj_touch(cio->stdin_obj);
 
 	if (cio->sls)
 		step_launch_clear_questionable_state(cio->sls, msg.nodeid);
@@ -902,6 +926,52 @@ static int _read_io_init_msg(int fd, void *conn, client_io_t *cio,
 }
 
 
+/*
+ * A stepd relaying the stdio of its subtree (LAUNCH_IO_TREE) announced one
+ * more node. Its stdio now flows over the relay's connection.
+ */
+static void _handle_node_init(eio_obj_t *obj, struct io_buf *msg)
+{
+	struct server_io_info *s = obj->arg;
+	client_io_t *cio = s->cio;
+	io_init_msg_t init = { 0 };
+	buf_t *buffer;
+	int rc;
+
+	buffer = create_buf(msg->data, msg->length);
+	rc = io_node_init_unpack(&init, buffer);
+	/* free the buffer structure, but not the memory to which it points */
+	buffer->head = NULL;
+	FREE_NULL_BUFFER(buffer);
+	if (rc)
+		return;
+
+	if (init.nodeid >= cio->num_nodes) {
+		error("Invalid nodeid %u relayed by node %d",
+		      init.nodeid, s->node_id);
+		return;
+	}
+	debug2("IO of node rank %u relayed by node rank %d",
+	       init.nodeid, s->node_id);
+
+	slurm_mutex_lock(&cio->ioservers_lock);
+	if (cio->ioserver[init.nodeid] != NULL)
+		error("IO: Node %u already established stream!", init.nodeid);
+	else
+		cio->ioserver[init.nodeid] = obj;
+	bit_set(cio->ioservers_ready_bits, init.nodeid);
+	cio->ioservers_ready = bit_set_count(cio->ioservers_ready_bits);
+	slurm_mutex_unlock(&cio->ioservers_lock);
+	if (cio->stdin_obj)
+		eio_obj_touch(cio->stdin_obj);
+
+	s->remote_stdout_objs += init.stdout_objs;
+	s->remote_stderr_objs += init.stderr_objs;
+
+	if (cio->sls)
+		step_launch_clear_questionable_state(cio->sls, init.nodeid);
+}
+
 static bool
 _is_fd_ready(int fd)
 {
@@ -1077,6 +1147,33 @@ _outgoing_buf_free(client_io_t *cio)
 	return false;
 }
 
+/*
+ * Return a buffer to cio->free_incoming.
+ * Callers of this function should already have locked cio->ioservers_lock
+ */
+static void _put_incoming_buf(client_io_t *cio, struct io_buf *msg)
+{
+	list_enqueue(cio->free_incoming, msg);
+
+	/* stdin stops being read while no buffer is free */
+	if ((list_count(cio->free_incoming) == 1) && cio->stdin_obj)
+		eio_obj_touch(cio->stdin_obj);
+}
+
+/* Return a buffer to cio->free_outgoing */
+static void _put_outgoing_buf(client_io_t *cio, struct io_buf *msg)
+{
+	list_enqueue(cio->free_outgoing, msg);
+
+	/* servers stop being read while no buffer is free */
+	if (list_count(cio->free_outgoing) != 1)
+		return;
+	for (int i = 0; i < cio->num_nodes; i++) {
+		if (cio->ioserver[i])
+			eio_obj_touch(cio->ioserver[i]);
+	}
+}
+
 static inline int
 _estimate_nports(int nclients, int cli_per_port)
 {
@@ -1108,6 +1205,7 @@ client_io_t *client_io_handler_create(slurm_step_io_fds_t fds, int num_tasks,
 	cio->io_key = xstrdup(io_key);
 
 	cio->eio = eio_handle_create(slurm_conf.eio_timeout);
+	eio_handle_use_epoll(cio->eio);
 
 	/* Compute number of listening sockets needed to allow
 	 * all of the slurmds to establish IO streams with srun, without
@@ -1237,6 +1335,9 @@ client_io_handler_downnodes(client_io_t *cio,
 		    && cio->ioserver[node_id] != NULL) {
 			tmp = cio->ioserver[node_id]->arg;
 			info = (struct server_io_info *)tmp;
+			/* The relaying stepd closes its streams */
+			if (info->node_id != node_id)
+				continue;
 			info->remote_stdout_objs = 0;
 			info->remote_stderr_objs = 0;
 			info->testing_connection = false;
@@ -1278,6 +1379,8 @@ client_io_handler_abort(client_io_t *cio)
 		}
 	}
 	slurm_mutex_unlock(&cio->ioservers_lock);
+
+	eio_signal_wakeup(cio->eio);
 }
 
 
@@ -1304,6 +1407,11 @@ int client_io_handler_send_test_message(client_io_t *cio, int node_id,
 	}
 	server = (struct server_io_info *)cio->ioserver[node_id]->arg;
 
+	/* The stdio of this node is relayed by another stepd (LAUNCH_IO_TREE),
+	   the answer would only vouch for the relay. */
+	if (server->node_id != node_id)
+		goto done;
+
 	/* In this case, the I/O connection has closed so can't send a test
 	   message.  This error case is handled elsewhere. */
 	if (server->out_eof) {
@@ -362,6 +362,13 @@ extern int slurm_step_launch(slurm_step_ctx_t *ctx,
 		launch.flags |= LAUNCH_BUFFERED_IO;
 	if (params->labelio)
 		launch.flags |= LAUNCH_LABEL_IO;
+	/*
+	 * Have the stepds relay the stdio of their subtree over the reverse
+	 * tree so that only its top connects back to us.
+	 */
+	if (xstrcasestr(slurm_conf.launch_params, "srun_io_tree") &&
+	    !params->pty && !conn_tls_enabled())
+		launch.flags |= LAUNCH_IO_TREE;
 
 	io_key = slurm_cred_get_signature(ctx->step_resp->cred);
 
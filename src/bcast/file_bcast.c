@@ -54,6 +54,10 @@
 # include <lz4.h>
 #endif
 
+#if HAVE_ZSTD
+# include <zstd.h>
+#endif
+
 #include "slurm/slurm_errno.h"
 #include "src/common/forward.h"
 #include "src/common/hostlist.h"
@@ -61,6 +65,7 @@
 #include "src/common/macros.h"
 #include "src/common/proc_args.h"
 #include "src/common/read_config.h"
+#include "src/common/reverse_tree.h"
 #include "src/common/run_command.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_defs.h"
@@ -81,6 +86,29 @@
 #define DEFAULT_THREADS 8
 #define MAX_THREADS     64	/* These can be huge messages, so
 				 * only run MAX_THREADS at one time */
+#define MAX_WINDOW      64	/* Blocks in flight, each one of them
+				 * is sent by its own fanout */
+
+typedef struct {
+	bool abort;		/* stop reading ahead */
+	pthread_cond_t cond;
+	int in_flight;		/* blocks being sent */
+	pthread_mutex_t mutex;
+	struct bcast_parameters *params;
+	list_t *ready;		/* blocks read ahead, in file order */
+	bool read_done;
+	int rc;			/* first error of a block sent */
+	uint64_t size_compressed;
+	uint64_t size_uncompressed;
+	file_bcast_msg_t *tmpl;	/* fields common to all blocks */
+	uint32_t time_compression;
+	uint32_t window;
+} bcast_pipe_t;
+
+typedef struct {
+	file_bcast_msg_t msg;
+	bcast_pipe_t *pipe;
+} bcast_block_t;
 
 int block_len;				/* block size */
 int fd;					/* source file descriptor */
@@ -280,10 +308,11 @@ static int _get_block_none(char **buffer, int *orig_len, bool *more,
 	}
 
 	if (remaining < 0) {
-		*buffer = xmalloc(block_len);
 		remaining = f_stat.st_size;
 		position = src;
 	}
+	if (!*buffer)
+		*buffer = xmalloc(block_len);
 
 	size = MIN(block_len, remaining);
 	memcpy(*buffer, position, size);
@@ -319,8 +348,9 @@ static int _get_block_lz4(struct bcast_parameters *params,
 	if (remaining < 0) {
 		position = src;
 		remaining = f_stat.st_size;
-		*buffer = xmalloc(block_len);
 	}
+	if (!*buffer)
+		*buffer = xmalloc(block_len);
 
 	/* intentionally limit decompressed size to 10x compressed
 	 * to avoid problems on receive size when decompressed */
@@ -344,6 +374,88 @@ static int _get_block_lz4(struct bcast_parameters *params,
 
 }
 
+#if HAVE_ZSTD
+static ZSTD_CCtx *zstd_cctx = NULL;
+#endif
+
+/* Free the zstd context once the file is done with, sent or not */
+static void _free_zstd(void)
+{
+#if HAVE_ZSTD
+	ZSTD_freeCCtx(zstd_cctx);
+	zstd_cctx = NULL;
+#endif
+}
+
+/*
+ * zstd has no equivalent of LZ4_compress_destSize(), so size each input
+ * block from the ratio achieved on the previous one to keep the compressed
+ * blocks close to block_len. The context is reused for the whole file.
+ */
+static int _get_block_zstd(struct bcast_parameters *params,
+			   char **buffer,
+			   int32_t *orig_len,
+			   bool *more, bool file_start)
+{
+#if HAVE_ZSTD
+	static int64_t remaining = -1;
+	static void *position;
+	static double ratio = 1.0;
+	size_t size, size_out, bound;
+
+	if (file_start) {
+		remaining = -1;
+		position = NULL;
+		ratio = 1.0;
+	}
+
+	if (!f_stat.st_size) {
+		*more = false;
+		return 0;
+	}
+
+	if (remaining < 0) {
+		position = src;
+		remaining = f_stat.st_size;
+	}
+
+	if (!zstd_cctx) {
+		if (!(zstd_cctx = ZSTD_createCCtx()))
+			fatal("zstd context creation error");
+		if (params->compress_level)
+			(void) ZSTD_CCtx_setParameter(
+				zstd_cctx, ZSTD_c_compressionLevel,
+				params->compress_level);
+	}
+
+	/* same 10x limit on the decompressed size as lz4 */
+	size = block_len * ratio;
+	size = MIN(size, block_len * 10);
+	size = MAX(size, block_len);
+	size = MIN(size, remaining);
+
+	bound = ZSTD_compressBound(size);
+	*buffer = xrealloc(*buffer, bound);
+	size_out = ZSTD_compress2(zstd_cctx, *buffer, bound, position, size);
+	if (ZSTD_isError(size_out))
+		fatal("zstd compression error: %s",
+		      ZSTD_getErrorName(size_out));
+	position += size;
+	remaining -= size;
+
+	if (size_out)
+		ratio = (double) size / size_out;
+
+	*orig_len = size;
+	*more = (remaining) ? true : false;
+	return size_out;
+#else
+	info("zstd compression not supported, sending uncompressed file.");
+	params->compress = 0;
+	return _get_block_none(buffer, orig_len, more, file_start);
+#endif
+}
+
 static int _next_block(struct bcast_parameters *params,
 		       char **buffer,
 		       int32_t *orig_len,
@@ -355,6 +467,9 @@ static int _next_block(struct bcast_parameters *params,
 	case COMPRESS_LZ4:
 		return _get_block_lz4(params, buffer, orig_len, more,
 				      file_start);
+	case COMPRESS_ZSTD:
+		return _get_block_zstd(params, buffer, orig_len, more,
+				       file_start);
 	}
 
 	/* compression type not recognized */
@@ -364,17 +479,170 @@ static int _next_block(struct bcast_parameters *params,
 	return _get_block_none(buffer, orig_len, more, file_start);
 }
 
-/* read and broadcast the file */
+/*
+ * Send a FILE_BCAST_SWARM block to the node at the root of its relay tree,
+ * which is rotated with the block number. slurmd relays the block down the
+ * reverse tree over the swarm_nodes and replies once all of them have it.
+ */
+static int _file_bcast_swarm(struct bcast_parameters *params,
+			     file_bcast_msg_t *bcast_msg)
+{
+	hostlist_t *hl = hostlist_create(bcast_msg->swarm_nodes);
+	int node_cnt = hostlist_count(hl), rc = SLURM_SUCCESS, timeout, width;
+	int parent, subtree_cnt, depth, max_depth;
+	char *name = hostlist_nth(hl, bcast_msg->block_no % node_cnt);
+	slurm_msg_t msg;
+
+	width = MAX(1, MIN(bcast_msg->swarm_width, node_cnt - 1));
+	reverse_tree_info(0, node_cnt, width, &parent, &subtree_cnt, &depth,
+			  &max_depth);
+	if (params->timeout > 0)
+		timeout = params->timeout;
+	else
+		timeout = slurm_conf.msg_timeout * MSEC_IN_SEC;
+	timeout *= 2 * MAX(1, max_depth);
+
+	slurm_msg_t_init(&msg);
+	slurm_msg_set_r_uid(&msg, SLURM_AUTH_UID_ANY);
+	msg.data = bcast_msg;
+	msg.flags = USE_BCAST_NETWORK;
+	msg.msg_type = REQUEST_FILE_BCAST;
+
+	if (slurm_conf_get_addr(name, &msg.address, msg.flags)) {
+		error("REQUEST_FILE_BCAST(%s): can't find address", name);
+		rc = SLURM_ERROR;
+	} else if (slurm_send_recv_rc_msg_only_one(&msg, &rc, timeout)) {
+		error("REQUEST_FILE_BCAST(%s): %m", name);
+		rc = SLURM_ERROR;
+	} else if (rc) {
+		error("REQUEST_FILE_BCAST(%s): %s", name, slurm_strerror(rc));
+	}
+
+	free(name);
+	hostlist_destroy(hl);
+
+	return rc;
+}
+
+static void _free_bcast_block(void *x)
+{
+	bcast_block_t *blk = x;
+
+	xfree(blk->msg.block);
+	xfree(blk);
+}
+
+/*
+ * Read (and compress) the blocks of the file on its own thread, staying at
+ * most pipe->window blocks ahead of the ones handed to the senders.
+ */
+static void *_read_ahead(void *arg)
+{
+	bcast_pipe_t *pipe = arg;
+	uint32_t block_no = 1;
+	uint64_t block_offset = 0;
+	bool more = true, file_start = true;
+
+	while (more) {
+		bcast_block_t *blk;
+		char *buffer = NULL;
+		int32_t orig_len = 0, block_len;
+		DEF_TIMERS;
+
+		slurm_mutex_lock(&pipe->mutex);
+		while (!pipe->abort && !pipe->rc &&
+		       (list_count(pipe->ready) >= pipe->window))
+			slurm_cond_wait(&pipe->cond, &pipe->mutex);
+		if (pipe->abort || pipe->rc) {
+			slurm_mutex_unlock(&pipe->mutex);
+			break;
+		}
+		slurm_mutex_unlock(&pipe->mutex);
+
+		START_TIMER;
+		block_len = _next_block(pipe->params, &buffer, &orig_len,
+					&more, file_start);
+		END_TIMER;
+		file_start = false;
+
+		blk = xmalloc(sizeof(*blk));
+		blk->pipe = pipe;
+		blk->msg = *pipe->tmpl;
+		blk->msg.block = buffer;
+		blk->msg.block_len = block_len;
+		blk->msg.block_no = block_no++;
+		blk->msg.block_offset = block_offset;
+		blk->msg.compress = pipe->params->compress;
+		blk->msg.uncomp_len = orig_len;
+		if (!more)
+			blk->msg.flags |= FILE_BCAST_LAST_BLOCK;
+		else if (pipe->tmpl->swarm_nodes && (blk->msg.block_no != 1))
+			blk->msg.flags |= FILE_BCAST_SWARM;
+		block_offset += orig_len;
+		debug("block %u, size %u", blk->msg.block_no,
+		      blk->msg.block_len);
+
+		slurm_mutex_lock(&pipe->mutex);
+		pipe->time_compression += DELTA_TIMER;
+		pipe->size_uncompressed += orig_len;
+		pipe->size_compressed += block_len;
+		list_append(pipe->ready, blk);
+		slurm_cond_broadcast(&pipe->cond);
+		slurm_mutex_unlock(&pipe->mutex);
+	}
+
+	slurm_mutex_lock(&pipe->mutex);
+	pipe->read_done = true;
+	slurm_cond_broadcast(&pipe->cond);
+	slurm_mutex_unlock(&pipe->mutex);
+
+	return NULL;
+}
+
+static void *_send_block(void *arg)
+{
+	bcast_block_t *blk = arg;
+	bcast_pipe_t *pipe = blk->pipe;
+	int rc;
+
+	if (blk->msg.flags & FILE_BCAST_SWARM)
+		rc = _file_bcast_swarm(pipe->params, &blk->msg);
+	else
+		rc = _file_bcast(pipe->params, &blk->msg, sbcast_cred);
+
+	slurm_mutex_lock(&pipe->mutex);
+	if (rc && !pipe->rc)
+		pipe->rc = rc;
+	pipe->in_flight--;
+	slurm_cond_broadcast(&pipe->cond);
+	slurm_mutex_unlock(&pipe->mutex);
+
+	_free_bcast_block(blk);
+
+	return NULL;
+}
+
+/*
+ * Read and broadcast the file.
+ *
+ * Blocks are read ahead on another thread and up to params->window of them
+ * are fanned out at once, each by its own thread. The first block creates
+ * the file on the nodes and the last one completes it, so these two are
+ * sent alone. The nodes write every block at its offset, so the others may
+ * arrive in any order.
+ *
+ * With BCAST_FLAG_SWARM the other blocks are sent to a single node each,
+ * which relays them to the rest (see _file_bcast_swarm()).
+ */
 static int _bcast_file(struct bcast_parameters *params)
 {
-	int rc = SLURM_SUCCESS;
 	file_bcast_msg_t bcast_msg;
-	char *buffer = NULL;
-	int32_t orig_len = 0;
-	uint64_t size_uncompressed = 0, size_compressed = 0;
-	uint32_t time_compression = 0;
-	bool more = true, file_start = true;
-	DEF_TIMERS;
+	bcast_block_t *blk;
+	bcast_pipe_t pipe = {
+		.params = params,
+		.tmpl = &bcast_msg,
+	};
+	pthread_t reader_tid;
 
 	if (params->block_size)
 		block_len = MIN(params->block_size, f_stat.st_size);
@@ -384,7 +652,6 @@ static int _bcast_file(struct bcast_parameters *params)
 	memset(&bcast_msg, 0, sizeof(file_bcast_msg_t));
 	bcast_msg.fname		= params->dst_fname;
 	bcast_msg.exe_fname = params->exe_fname;
-	bcast_msg.block_no	= 1;
 	if (params->flags & BCAST_FLAG_FORCE)
 		bcast_msg.flags |= FILE_BCAST_FORCE;
 	if (params->flags & BCAST_FLAG_SHARED_OBJECT)
@@ -408,48 +675,84 @@ static int _bcast_file(struct bcast_parameters *params)
 	else if (params->tree_width != 0xfffd)
 		params->tree_width = MIN(MAX_THREADS, params->tree_width);
 
-	while (more) {
-		START_TIMER;
-		bcast_msg.block_len = _next_block(params, &buffer, &orig_len,
-						  &more, file_start);
-		END_TIMER;
-		file_start = false;
-		time_compression += DELTA_TIMER;
-		size_uncompressed += orig_len;
-		size_compressed += bcast_msg.block_len;
-		debug("block %u, size %u", bcast_msg.block_no,
-		      bcast_msg.block_len);
-		bcast_msg.compress = params->compress;
-		bcast_msg.uncomp_len = orig_len;
-		bcast_msg.block = buffer;
-		if (!more)
-			bcast_msg.flags |= FILE_BCAST_LAST_BLOCK;
+	if (params->flags & BCAST_FLAG_SWARM) {
+		hostlist_t *hl = hostlist_create(sbcast_cred->node_list);
+
+		bcast_msg.swarm_nodes = sbcast_cred->node_list;
+		bcast_msg.swarm_width = params->tree_width;
+		/* Keep every node busy relaying a block by default */
+		if (!params->window)
+			params->window = hostlist_count(hl);
+		hostlist_destroy(hl);
+	}
 
-		rc = _file_bcast(params, &bcast_msg, sbcast_cred);
-		if (rc != SLURM_SUCCESS)
+	pipe.window = MAX(1, MIN(MAX_WINDOW, params->window));
+	pipe.ready = list_create(_free_bcast_block);
+	slurm_mutex_init(&pipe.mutex);
+	slurm_cond_init(&pipe.cond, NULL);
+
+	slurm_thread_create(&reader_tid, _read_ahead, &pipe);
+
+	slurm_mutex_lock(&pipe.mutex);
+	while (!pipe.rc) {
+		bool alone;
+
+		if (!(blk = list_pop(pipe.ready))) {
+			if (pipe.read_done)
+				break;
+			slurm_cond_wait(&pipe.cond, &pipe.mutex);
+			continue;
+		}
+		slurm_cond_broadcast(&pipe.cond);
+
+		alone = ((blk->msg.block_no == 1) ||
+			 (blk->msg.flags & FILE_BCAST_LAST_BLOCK));
+		while (!pipe.rc &&
+		       (pipe.in_flight >= (alone ? 1 : pipe.window)))
+			slurm_cond_wait(&pipe.cond, &pipe.mutex);
+		if (pipe.rc) {
+			_free_bcast_block(blk);
 			break;
-		if (bcast_msg.flags & FILE_BCAST_LAST_BLOCK)
-			break;	/* end of file */
-		bcast_msg.block_no++;
-		bcast_msg.block_offset += orig_len;
+		}
+		pipe.in_flight++;
+		slurm_mutex_unlock(&pipe.mutex);
+
+		if (alone)
+			_send_block(blk);
+		else
+			slurm_thread_create_detached(_send_block, blk);
+
+		slurm_mutex_lock(&pipe.mutex);
 	}
+	pipe.abort = true;
+	slurm_cond_broadcast(&pipe.cond);
+	while (pipe.in_flight)
+		slurm_cond_wait(&pipe.cond, &pipe.mutex);
+	slurm_mutex_unlock(&pipe.mutex);
+
+	slurm_thread_join(reader_tid);
+	_free_zstd();
+	FREE_NULL_LIST(pipe.ready);
+	slurm_mutex_destroy(&pipe.mutex);
+	slurm_cond_destroy(&pipe.cond);
 	xfree(bcast_msg.user_name);
-	xfree(buffer);
 
-	if (size_uncompressed && (params->compress != 0)) {
-		int64_t pct = (int64_t) size_uncompressed - size_compressed;
+	if (pipe.size_uncompressed && (params->compress != 0)) {
+		int64_t pct = (int64_t) pipe.size_uncompressed -
+			      pipe.size_compressed;
 		/* Dividing a negative by a positive in C99 results in
 		 * "truncation towards zero" which gives unexpected values for
 		 * pct. This construct avoids that problem.
 		 */
-		pct = (pct>=0) ? pct * 100 / size_uncompressed
-			       : - (-pct * 100 / size_uncompressed);
-		verbose("File compressed from %"PRIu64" to %"PRIu64" (%d percent) in %u usec",
-			size_uncompressed, size_compressed, (int) pct,
-			time_compression);
+		pct = (pct>=0) ? pct * 100 / pipe.size_uncompressed
+			       : - (-pct * 100 / pipe.size_uncompressed);
+		verbose("File compressed with %s from %"PRIu64" to %"PRIu64" (%d percent) in %u usec",
+			(params->compress == COMPRESS_ZSTD) ? "zstd" : "lz4",
+			pipe.size_uncompressed, pipe.size_compressed, (int) pct,
+			pipe.time_compression);
 	}
 
-	return rc;
+	return pipe.rc;
 }
 
 
@@ -478,6 +781,36 @@ static int _decompress_data_lz4(file_bcast_msg_t *req)
 #endif
 }
 
+static int _decompress_data_zstd(file_bcast_msg_t *req)
+{
+#if HAVE_ZSTD
+	char *out_buf;
+	size_t out_len;
+
+	if (!req->block_len)
+		return 0;
+
+	out_buf = xmalloc(req->uncomp_len);
+	out_len = ZSTD_decompress(out_buf, req->uncomp_len, req->block,
+				  req->block_len);
+	xfree(req->block);
+	req->block = out_buf;
+	if (ZSTD_isError(out_len)) {
+		error("zstd decompression error: %s",
+		      ZSTD_getErrorName(out_len));
+		return -1;
+	}
+	if (req->uncomp_len != out_len) {
+		error("zstd decompression error, original block length != decompressed length");
+		return -1;
+	}
+	req->block_len = out_len;
+	return 0;
+#else
+	return -1;
+#endif
+}
+
 /*
  * IN: char pointer with the filename.
  * OUT: List of shared object direct and indirect dependencies.
@@ -680,10 +1013,28 @@ fini:
 	return args.return_code;
 }
 
+/* Report the throughput of a transfer taking usec */
+static void _print_benchmark(struct bcast_parameters *params, uint64_t usec)
+{
+	hostlist_t *hl = hostlist_create(sbcast_cred->node_list);
+	int node_cnt = hostlist_count(hl);
+	double secs = MAX(usec, 1) / (double) USEC_IN_SEC;
+	double mb = f_stat.st_size / (1024.0 * 1024.0);
+
+	printf("%s: %"PRIu64" bytes to %d nodes in %.3f seconds (%s, window %u, block %d)\n",
+	       params->src_fname, (uint64_t) f_stat.st_size, node_cnt, secs,
+	       (params->flags & BCAST_FLAG_SWARM) ? "swarm" : "tree",
+	       MAX(1, MIN(MAX_WINDOW, params->window)), block_len);
+	printf("%s: %.1f MB/s per node, %.1f MB/s aggregate\n",
+	       params->src_fname, mb / secs, (mb * node_cnt) / secs);
+	hostlist_destroy(hl);
+}
+
 extern int bcast_file(struct bcast_parameters *params)
 {
 	list_t *lib_paths = NULL;
 	int rc;
+	DEF_TIMERS;
 
 	if ((rc = _file_state(params)) != SLURM_SUCCESS)
 		return rc;
@@ -711,8 +1062,13 @@ extern int bcast_file(struct bcast_parameters *params)
 	}
 
 	/* Now send files */
-	if ((rc = _bcast_file(params)) != SLURM_SUCCESS)
+	START_TIMER;
+	rc = _bcast_file(params);
+	END_TIMER;
+	if (rc != SLURM_SUCCESS)
 		return rc;
+	if (params->flags & BCAST_FLAG_BENCHMARK)
+		_print_benchmark(params, DELTA_TIMER);
 
 	/* Send libraries, if required */
 	if (lib_paths) {
@@ -731,6 +1087,8 @@ extern int bcast_decompress_data(file_bcast_msg_t *req)
 		return 0;
 	case COMPRESS_LZ4:
 		return _decompress_data_lz4(req);
+	case COMPRESS_ZSTD:
+		return _decompress_data_zstd(req);
 	}
 
 	/* compression type not recognized */
@@ -45,10 +45,13 @@
 #define BCAST_FLAG_SEND_LIBS SLURM_BIT(2)
 #define BCAST_FLAG_SHARED_OBJECT SLURM_BIT(3)
 #define BCAST_FLAG_NO_JOB SLURM_BIT(4)
+#define BCAST_FLAG_SWARM SLURM_BIT(5)
+#define BCAST_FLAG_BENCHMARK SLURM_BIT(6)
 
 struct bcast_parameters {
 	uint32_t block_size;
 	uint16_t compress;
+	int compress_level;	/* zstd level, 0 for the default */
 	char *exclude;
 	char *dst_fname;
 	char *exe_fname;
@@ -61,9 +64,11 @@ struct bcast_parameters {
 	int timeout;
 	int tree_width;
 	int verbose;
+	uint32_t window;	/* blocks in flight at once, 0 for default */
 };
 
 typedef struct file_bcast_info {
+	time_t atime;		/* atime to set once complete, 0 to keep */
 	void *data;		/* mmap of file data */
 	int fd;			/* file descriptor */
 	uint64_t file_size;	/* file size */
@@ -71,7 +76,10 @@ typedef struct file_bcast_info {
 	gid_t gid;		/* gid of owner */
 	uint32_t job_id;	/* job id */
 	uint32_t step_id;	/* step id */
+	uint32_t last_block_no;	/* block_no of the last block, 0 until seen */
 	time_t last_update;	/* transfer last block received */
+	uint32_t modes;		/* modes to set once complete */
+	time_t mtime;		/* mtime to set once complete */
 	int received_blocks;	/* number of blocks received */
 	time_t start_time;	/* transfer start time */
 	uid_t uid;		/* uid of owner */
@@ -38,12 +38,18 @@
 
 #define _GNU_SOURCE	/* For POLLRDHUP */
 
+#include "config.h"
+
 #include <errno.h>
 #include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifndef POLLRDHUP
 #define POLLRDHUP POLLHUP
 #endif
@@ -53,10 +59,12 @@
 #include "src/common/log.h"
 #include "src/common/list.h"
 #include "src/common/net.h"
+#include "src/common/read_config.h"
 #include "src/common/run_in_daemon.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
 
 #include "src/interfaces/conn.h"
 
@@ -67,16 +75,31 @@
 strong_alias(eio_handle_create,		slurm_eio_handle_create);
 strong_alias(eio_handle_destroy,	slurm_eio_handle_destroy);
 strong_alias(eio_handle_mainloop,	slurm_eio_handle_mainloop);
+strong_alias(eio_handle_use_epoll,	slurm_eio_handle_use_epoll);
 strong_alias(eio_message_socket_readable, slurm_eio_message_socket_readable);
 strong_alias(eio_message_socket_accept,	slurm_eio_message_socket_accept);
 strong_alias(eio_new_obj,		slurm_eio_new_obj);
 strong_alias(eio_new_initial_obj,	slurm_eio_new_initial_obj);
 strong_alias(eio_obj_create,		slurm_eio_obj_create);
+strong_alias(eio_obj_close_fd,		slurm_eio_obj_close_fd);
 strong_alias(eio_obj_destroy,		slurm_eio_obj_destroy);
+strong_alias(eio_obj_touch,		slurm_eio_obj_touch);
 strong_alias(eio_remove_obj,		slurm_eio_remove_obj);
 strong_alias(eio_signal_shutdown,	slurm_eio_signal_shutdown);
 strong_alias(eio_signal_wakeup,		slurm_eio_signal_wakeup);
 
+#ifdef HAVE_EPOLL
+typedef struct {
+	int epoll_fd;
+	struct epoll_event *events;
+	int events_cnt;		/* events returned by the last epoll_wait() */
+	int events_max;
+	int nobjs;		/* objects with an fd to watch */
+	list_t *ready;		/* objects to dispatch without an event */
+	list_t *touched;	/* objects to ask readable() and writable() */
+} eio_epoll_t;
+#endif
+
 /*
  * outside threads can stick new objects on the new_objs list and
  * the eio thread will move them to the main obj_list the next time
@@ -92,6 +115,11 @@ struct eio_handle_components {
 	list_t *obj_list;
 	list_t *new_objs;
 	list_t *del_objs;
+	bool use_epoll;
+#ifdef HAVE_EPOLL
+	pthread_mutex_t ep_mutex; /* protects ep and eio_obj_t.touched */
+	eio_epoll_t *ep;	/* set while the epoll mainloop runs */
+#endif
 };
 
 typedef struct {
@@ -111,6 +139,8 @@ static void _poll_dispatch(struct pollfd *pfds, unsigned int nfds,
 			   list_t *del_objs);
 static void _poll_handle_event(short revents, eio_obj_t *obj, list_t *objList,
 			       list_t *del_objs);
+static bool _is_readable(eio_obj_t *obj);
+static bool _is_writable(eio_obj_t *obj);
 
 eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
 {
@@ -131,6 +161,9 @@ eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
 	eio->del_objs = list_create(eio_obj_destroy);
 
 	slurm_mutex_init(&eio->shutdown_mutex);
+#ifdef HAVE_EPOLL
+	slurm_mutex_init(&eio->ep_mutex);
+#endif
 	eio->shutdown_wait = DEFAULT_EIO_SHUTDOWN_WAIT;
 	if (shutdown_wait > 0)
 		eio->shutdown_wait = shutdown_wait;
@@ -138,6 +171,13 @@ eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
 	return eio;
 }
 
+extern void eio_handle_use_epoll(eio_handle_t *eio)
+{
+	xassert(eio->magic == EIO_MAGIC);
+
+	eio->use_epoll = !xstrcasestr(slurm_conf.comm_params, "eio_use_poll");
+}
+
 void eio_handle_destroy(eio_handle_t *eio)
 {
 	xassert(eio != NULL);
@@ -148,6 +188,9 @@ void eio_handle_destroy(eio_handle_t *eio)
 	FREE_NULL_LIST(eio->new_objs);
 	FREE_NULL_LIST(eio->del_objs);
 	slurm_mutex_destroy(&eio->shutdown_mutex);
+#ifdef HAVE_EPOLL
+	slurm_mutex_destroy(&eio->ep_mutex);
+#endif
 
 	eio->magic = ~EIO_MAGIC;
 	xfree(eio);
@@ -161,8 +204,7 @@ bool eio_message_socket_readable(eio_obj_t *obj)
 	if (obj->shutdown == true) {
 		if (obj->fd != -1) {
 			debug2("  false, shutdown");
-			close(obj->fd);
-			obj->fd = -1;
+			eio_obj_close_fd(obj);
 		} else {
 			debug2("  false");
 		}
@@ -286,12 +328,295 @@ static int _close_eio_socket(void *x, void *key)
 		return 0;
 
 	debug4("%s closing eio->fd: %d", __func__, e->fd);
-	close(e->fd);
-	e->fd = -1;
+	eio_obj_close_fd(e);
 
 	return 1;
 }
 
+/*
+ * RET true if the IO should be abandoned after eio_signal_shutdown()
+ */
+static bool _shutdown_expired(eio_handle_t *eio)
+{
+	time_t shutdown_time;
+
+	slurm_mutex_lock(&eio->shutdown_mutex);
+	shutdown_time = eio->shutdown_time;
+	slurm_mutex_unlock(&eio->shutdown_mutex);
+	if (shutdown_time &&
+	    (difftime(time(NULL), shutdown_time) >= eio->shutdown_wait)) {
+		error("%s: Abandoning IO %d secs after job shutdown initiated",
+		      __func__, eio->shutdown_wait);
+		return true;
+	}
+
+	return false;
+}
+
+#ifdef HAVE_EPOLL
+static int _foreach_epoll_touch(void *x, void *arg)
+{
+	eio_obj_touch(x);
+	return 0;
+}
+
+static int _find_obj(void *x, void *key)
+{
+	return (x == key);
+}
+
+/* Stop watching the fd of obj, before it is closed */
+static void _epoll_unwatch(eio_epoll_t *ep, eio_obj_t *obj)
+{
+	if (obj->reg_fd < 0)
+		return;
+
+	if (!obj->reg_always &&
+	    epoll_ctl(ep->epoll_fd, EPOLL_CTL_DEL, obj->reg_fd, NULL))
+		debug("%s: epoll_ctl(%d): %m", __func__, obj->reg_fd);
+	obj->reg_fd = -1;
+	obj->reg_events = 0;
+	obj->reg_always = false;
+	ep->nobjs--;
+}
+
+/* Forget an object leaving the handle, including its pending events */
+static void _epoll_forget(eio_epoll_t *ep, eio_obj_t *obj)
+{
+	_epoll_unwatch(ep, obj);
+	list_delete_all(ep->ready, _find_obj, obj);
+	for (int i = 0; i < ep->events_cnt; i++)
+		if (ep->events[i].data.ptr == obj)
+			ep->events[i].data.ptr = NULL;
+
+	slurm_mutex_lock(&obj->eio->ep_mutex);
+	list_delete_all(ep->touched, _find_obj, obj);
+	obj->touched = false;
+	slurm_mutex_unlock(&obj->eio->ep_mutex);
+}
+
+/* Dequeue the next touched object, it may be touched again from now on */
+static eio_obj_t *_epoll_next_touched(eio_handle_t *eio)
+{
+	eio_obj_t *obj;
+
+	slurm_mutex_lock(&eio->ep_mutex);
+	if ((obj = list_dequeue(eio->ep->touched)))
+		obj->touched = false;
+	slurm_mutex_unlock(&eio->ep_mutex);
+
+	return obj;
+}
+
+/*
+ * Ask a touched object what it wants watched and update its registration.
+ * Regular files can't be watched by epoll, like poll() they are always
+ * ready and get dispatched on every loop.
+ */
+static void _epoll_update(eio_epoll_t *ep, eio_obj_t *obj)
+{
+	struct epoll_event ev = { .data.ptr = obj };
+	bool readable, writable;
+	int op;
+
+	/* same interest as _foreach_helper_setup_pollfds() */
+	writable = _is_writable(obj);
+	readable = _is_readable(obj);
+	if (writable && readable)
+		ev.events = EPOLLOUT | EPOLLIN | EPOLLHUP | EPOLLRDHUP;
+	else if (readable)
+		ev.events = EPOLLIN | EPOLLRDHUP;
+	else if (writable)
+		ev.events = EPOLLOUT | EPOLLHUP;
+
+	if (!ev.events || (obj->fd < 0) || (obj->reg_fd != obj->fd))
+		_epoll_unwatch(ep, obj);
+	if (!ev.events || (obj->fd < 0))
+		return;
+
+	if (obj->reg_always) {
+		obj->reg_events = ev.events;
+	} else if ((obj->reg_fd < 0) || (obj->reg_events != ev.events)) {
+		op = (obj->reg_fd < 0) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+		if (!epoll_ctl(ep->epoll_fd, op, obj->fd, &ev)) {
+			obj->reg_events = ev.events;
+		} else if ((op == EPOLL_CTL_ADD) && (errno == EPERM)) {
+			obj->reg_events = ev.events;
+			obj->reg_always = true;
+		} else {
+			error("%s: epoll_ctl(%d): %m", __func__, obj->fd);
+			_epoll_unwatch(ep, obj);
+			obj->shutdown = true;
+			return;
+		}
+		if (op == EPOLL_CTL_ADD) {
+			obj->reg_fd = obj->fd;
+			ep->nobjs++;
+		}
+	}
+
+	if (obj->conn)
+		obj->data_on_conn = conn_g_peek(obj->conn);
+	if (obj->reg_always || obj->data_on_conn)
+		list_append(ep->ready, obj);
+}
+
+static void _epoll_dispatch(eio_handle_t *eio, eio_obj_t *obj,
+			    uint32_t events)
+{
+	/* The handlers may change what the object wants */
+	eio_obj_touch(obj);
+	/* epoll event bits match the poll() ones on Linux */
+	_poll_handle_event(events, obj, eio->obj_list, eio->del_objs);
+}
+
+/*
+ * Same loop as the poll() one, except that fds stay registered with epoll and
+ * only the fds with events are returned by the kernel and dispatched.
+ *
+ * The readable() and writable() callbacks are only asked again for the
+ * objects that were dispatched or passed to eio_obj_touch(), and for every
+ * object after a wakeup. Readiness is level-triggered, handlers are not
+ * required to drain their fd.
+ */
+static int _epoll_mainloop(eio_handle_t *eio, eio_epoll_t *ep)
+{
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = eio };
+	int retval = 0, timeout;
+	eio_obj_t *obj;
+	time_t shutdown_time, now;
+
+	if (epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, eio->fds[0], &ev)) {
+		error("%s: epoll_ctl(%d): %m", __func__, eio->fds[0]);
+		return -1;
+	}
+
+	list_for_each(eio->obj_list, _foreach_epoll_touch, NULL);
+
+	while (1) {
+		while ((obj = _epoll_next_touched(eio)))
+			_epoll_update(ep, obj);
+
+		debug4("eio: handling events for %d objects", ep->nobjs);
+		if (ep->nobjs <= 0)
+			goto done;
+
+		if (ep->events_max < (ep->nobjs + 1)) {
+			ep->events_max = ep->nobjs + 1;
+			xrecalloc(ep->events, ep->events_max,
+				  sizeof(*ep->events));
+		}
+
+		slurm_mutex_lock(&eio->shutdown_mutex);
+		shutdown_time = eio->shutdown_time;
+		slurm_mutex_unlock(&eio->shutdown_mutex);
+
+		if (shutdown_time)
+			timeout = 1000;	/* Return every 1000 msec during shutdown */
+		else
+			timeout = 60000;
+		if (!list_is_empty(ep->ready))
+			timeout = 0;
+
+		while ((ep->events_cnt = epoll_wait(ep->epoll_fd, ep->events,
+						    ep->events_max,
+						    timeout)) < 0) {
+			if (errno == EINTR) {
+				ep->events_cnt = 0;
+				break;
+			} else if (errno != EAGAIN) {
+				error("epoll_wait: %m");
+				ep->events_cnt = 0;
+				goto error;
+			}
+		}
+
+		for (int i = 0; i < ep->events_cnt; i++) {
+			if (ep->events[i].data.ptr != eio)
+				continue;
+			ep->events[i].data.ptr = NULL;
+			_eio_wakeup_handler(eio);
+			/* other threads changed the objects or added some */
+			list_for_each(eio->obj_list, _foreach_epoll_touch,
+				      NULL);
+		}
+
+		for (int i = 0; i < ep->events_cnt; i++) {
+			if (!(obj = ep->events[i].data.ptr))
+				continue;
+			_epoll_dispatch(eio, obj, ep->events[i].events);
+			obj->data_on_conn = 0;
+		}
+		ep->events_cnt = 0;
+
+		while ((obj = list_dequeue(ep->ready))) {
+			if (obj->reg_always)
+				_epoll_dispatch(eio, obj, (obj->reg_events &
+							   (EPOLLIN |
+							    EPOLLOUT)));
+			else if (obj->data_on_conn)
+				_epoll_dispatch(eio, obj, 0);
+		}
+
+		if (_shutdown_expired(eio))
+			break;
+
+		/*
+		 * Close and remove all expired eio objects at every wakeup.
+		 */
+		now = time(NULL);
+		list_delete_all(eio->del_objs, _close_eio_socket, &now);
+	}
+
+error:
+	retval = -1;
+done:
+	now = 0;
+	list_delete_all(eio->del_objs, _close_eio_socket, &now);
+	return retval;
+}
+
+static int _foreach_epoll_reset(void *x, void *arg)
+{
+	eio_obj_t *obj = x;
+
+	obj->reg_fd = -1;
+	obj->reg_events = 0;
+	obj->reg_always = false;
+	obj->touched = false;
+	return 0;
+}
+
+static int _epoll_run(eio_handle_t *eio)
+{
+	eio_epoll_t ep = { 0 };
+	int rc;
+
+	if ((ep.epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		error("%s: epoll_create1(): %m, falling back to poll()",
+		      __func__);
+		return -2;
+	}
+	ep.ready = list_create(NULL);
+	ep.touched = list_create(NULL);
+	slurm_mutex_lock(&eio->ep_mutex);
+	eio->ep = &ep;
+	slurm_mutex_unlock(&eio->ep_mutex);
+
+	rc = _epoll_mainloop(eio, &ep);
+
+	slurm_mutex_lock(&eio->ep_mutex);
+	eio->ep = NULL;
+	slurm_mutex_unlock(&eio->ep_mutex);
+	list_for_each(eio->obj_list, _foreach_epoll_reset, NULL);
+	FREE_NULL_LIST(ep.ready);
+	FREE_NULL_LIST(ep.touched);
+	xfree(ep.events);
+	close(ep.epoll_fd);
+	return rc;
+}
+#endif
+
 int eio_handle_mainloop(eio_handle_t *eio)
 {
 	int            retval  = 0;
@@ -304,6 +629,12 @@ int eio_handle_mainloop(eio_handle_t *eio)
 	xassert (eio != NULL);
 	xassert (eio->magic == EIO_MAGIC);
 
+#ifdef HAVE_EPOLL
+	if (eio->use_epoll && ((retval = _epoll_run(eio)) != -2))
+		return retval;
+	retval = 0;
+#endif
+
 	while (1) {
 		/* Alloc memory for pfds and map if needed */
 		n = list_count(eio->obj_list);
@@ -347,15 +678,8 @@ int eio_handle_mainloop(eio_handle_t *eio)
 		_poll_dispatch(pollfds, nfds - 1, map, eio->obj_list,
 			       eio->del_objs);
 
-		slurm_mutex_lock(&eio->shutdown_mutex);
-		shutdown_time = eio->shutdown_time;
-		slurm_mutex_unlock(&eio->shutdown_mutex);
-		if (shutdown_time &&
-		    (difftime(time(NULL), shutdown_time)>=eio->shutdown_wait)) {
-			error("%s: Abandoning IO %d secs after job shutdown initiated",
-			      __func__, eio->shutdown_wait);
+		if (_shutdown_expired(eio))
 			break;
-		}
 
 		/*
 		 * Close and remove all expired eio objects at every wakeup.
@@ -579,9 +903,36 @@ eio_obj_t *eio_obj_create(int fd, struct io_operations *ops, void *arg)
 	obj->arg = arg;
 	obj->ops = _ops_copy(ops);
 	obj->shutdown = false;
+	obj->reg_fd = -1;
 	return obj;
 }
 
+extern void eio_obj_touch(eio_obj_t *obj)
+{
+#ifdef HAVE_EPOLL
+	if (!obj->eio)
+		return;
+
+	slurm_mutex_lock(&obj->eio->ep_mutex);
+	if (obj->eio->ep && !obj->touched) {
+		obj->touched = true;
+		list_append(obj->eio->ep->touched, obj);
+	}
+	slurm_mutex_unlock(&obj->eio->ep_mutex);
+#endif
+}
+
+extern void eio_obj_close_fd(eio_obj_t *obj)
+{
+#ifdef HAVE_EPOLL
+	if (obj->eio && obj->eio->ep)
+		_epoll_unwatch(obj->eio->ep, obj);
+#endif
+	if (obj->fd >= 0)
+		close(obj->fd);
+	obj->fd = -1;
+}
+
 void eio_obj_destroy(void *arg)
 {
 	eio_obj_t *obj = (eio_obj_t *)arg;
@@ -612,7 +963,10 @@ void eio_new_initial_obj(eio_handle_t *eio, eio_obj_t *obj)
 	xassert(eio != NULL);
 	xassert(eio->magic == EIO_MAGIC);
 
+	obj->eio = eio;
 	list_enqueue(eio->obj_list, obj);
+	/* srun adds its ioservers from inside a running mainloop */
+	eio_obj_touch(obj);
 }
 
 /*
@@ -624,6 +978,7 @@ void eio_new_obj(eio_handle_t *eio, eio_obj_t *obj)
 	xassert(eio != NULL);
 	xassert(eio->magic == EIO_MAGIC);
 
+	obj->eio = eio;
 	list_enqueue(eio->new_objs, obj);
 	eio_signal_wakeup(eio);
 }
@@ -632,5 +987,9 @@ extern bool eio_remove_obj(eio_obj_t *obj, list_t *objs)
 {
 	xassert(obj != NULL);
 
+#ifdef HAVE_EPOLL
+	if (obj->eio && obj->eio->ep && (objs == obj->eio->obj_list))
+		_epoll_forget(obj->eio->ep, obj);
+#endif
 	return list_delete_ptr(objs, obj);
 }
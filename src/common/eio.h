@@ -71,11 +71,28 @@ struct eio_obj {
 	struct io_operations *ops;        /* pointer to ops struct for obj   */
 	bool shutdown;
 	time_t close_time; /* time we marked this to be closed */
+	eio_handle_t *eio; /* internal, handle the obj was added to */
+	int reg_fd; /* internal, fd watched by epoll or -1 */
+	uint32_t reg_events; /* internal, events watched by epoll */
+	bool reg_always; /* internal, fd epoll can't watch, always ready */
+	bool touched; /* internal, see eio_obj_touch() */
 };
 
 eio_handle_t *eio_handle_create(uint16_t);
 void eio_handle_destroy(eio_handle_t *eio);
 
+/*
+ * Watch the objects of "eio" with epoll rather than poll(), unless
+ * CommunicationParameters=eio_use_poll is set or epoll is unavailable.
+ *
+ * The readable() and writable() functions of an object are then only called
+ * again after its handlers ran, after eio_signal_wakeup() and after
+ * eio_obj_touch(). An object whose interest is changed by the handlers of
+ * other objects must be passed to eio_obj_touch() by them, and its fd must be
+ * closed with eio_obj_close_fd().
+ */
+extern void eio_handle_use_epoll(eio_handle_t *eio);
+
 /*
  * Add an eio_obj_t "obj" to an eio_handle_t "eio"'s internal object list.
  *
@@ -120,4 +137,14 @@ int eio_signal_shutdown(eio_handle_t *eio);
 eio_obj_t *eio_obj_create(int fd, struct io_operations *ops, void *arg);
 void eio_obj_destroy(void *arg);
 
+/*
+ * Have the readable() and writable() functions of "obj" called again before
+ * the mainloop waits. Only to be called from the handlers of the mainloop,
+ * other threads use eio_signal_wakeup().
+ */
+extern void eio_obj_touch(eio_obj_t *obj);
+
+/* Stop watching the fd of "obj", then close it and set it to -1 */
+extern void eio_obj_close_fd(eio_obj_t *obj);
+
 #endif /* !_EIO_H */
@@ -53,6 +53,8 @@
 #include "src/common/slurm_protocol_defs.h"
 #include "src/common/slurm_protocol_pack.h"
 #include "src/common/slurm_protocol_socket.h"
+#include "src/common/timers.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -60,10 +62,27 @@
 #include "src/interfaces/conn.h"
 #include "src/interfaces/topology.h"
 
+/*
+ * Seconds a node that failed to answer a forwarded message is considered
+ * suspect by the adaptive forwarding logic. A suspect node is contacted
+ * directly instead of being given a subtree to relay to.
+ */
+#define FWD_SUSPECT_TIME 300
+
+typedef struct {
+	char *node_name;
+	uint32_t rtt_usec; /* moving average of leaf round trip time */
+	time_t last_fail; /* last time node failed to respond, 0 if healthy */
+} fwd_health_t;
+
 static slurm_node_alias_addrs_t *last_alias_addrs = NULL;
 static pthread_mutex_t alias_addrs_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+static xhash_t *fwd_health = NULL;
+static pthread_mutex_t fwd_health_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 typedef struct {
+	bool adaptive;
 	pthread_cond_t *notify;
 	int            *p_thr_count;
 	slurm_msg_t *orig_msg;
@@ -83,6 +102,213 @@ static void _forward_msg_internal(hostlist_t *hl, hostlist_t **sp_hl,
 				  int hl_count);
 static void _destroy_forward_struct(forward_struct_t *forward_struct);
 
+static void _fwd_health_id(void *item, const char **key, uint32_t *key_len)
+{
+	fwd_health_t *health = item;
+
+	*key = health->node_name;
+	*key_len = strlen(health->node_name);
+}
+
+static void _fwd_health_free(void *item)
+{
+	fwd_health_t *health = item;
+
+	xfree(health->node_name);
+	xfree(health);
+}
+
+/* Return true if CommunicationParameters=adaptive_fwd is configured */
+static bool _adaptive_fwd_enabled(void)
+{
+	static time_t config_update = (time_t) -1;
+	static bool adaptive_fwd = false;
+	time_t last_update = slurm_conf.last_update;
+
+	/*
+	 * Called on every forward, sometimes under a tree_mutex, so the cache
+	 * is read without a lock. Racing refreshes store the same value.
+	 */
+	if (__atomic_load_n(&config_update, __ATOMIC_ACQUIRE) != last_update) {
+		__atomic_store_n(&adaptive_fwd,
+				 (xstrcasestr(slurm_conf.comm_params,
+					      "adaptive_fwd") != NULL),
+				 __ATOMIC_RELAXED);
+		__atomic_store_n(&config_update, last_update,
+				 __ATOMIC_RELEASE);
+	}
+
+	return __atomic_load_n(&adaptive_fwd, __ATOMIC_RELAXED);
+}
+
+/*
+ * Record the outcome of sending a message to a node.
+ * IN node_name - node the message was sent to
+ * IN rtt_usec - round trip time of a leaf send, 0 if not measured
+ * IN failed - true if the node did not respond
+ */
+static void _fwd_health_update(const char *node_name, uint32_t rtt_usec,
+			       bool failed)
+{
+	fwd_health_t *health;
+
+	if (!node_name)
+		return;
+
+	slurm_mutex_lock(&fwd_health_mutex);
+	if (!fwd_health)
+		fwd_health = xhash_init(_fwd_health_id, _fwd_health_free);
+	if (!(health = xhash_get_str(fwd_health, node_name))) {
+		health = xmalloc(sizeof(*health));
+		health->node_name = xstrdup(node_name);
+		xhash_add(fwd_health, health);
+	}
+
+	if (failed) {
+		health->last_fail = time(NULL);
+	} else {
+		health->last_fail = 0;
+		if (rtt_usec && health->rtt_usec)
+			health->rtt_usec =
+				((health->rtt_usec * 7) + rtt_usec) / 8;
+		else if (rtt_usec)
+			health->rtt_usec = rtt_usec;
+	}
+	slurm_mutex_unlock(&fwd_health_mutex);
+}
+
+/*
+ * Record the outcome for every node in a list of responses.
+ * IN ret_list - list of ret_data_info_t as returned by the subtree
+ * IN head - name of the node the message was sent to directly
+ * IN rtt_usec - round trip time to head, 0 if not measured
+ */
+static void _fwd_health_update_list(list_t *ret_list, const char *head,
+				    uint32_t rtt_usec)
+{
+	list_itr_t *itr;
+	ret_data_info_t *ret_data_info;
+
+	if (!ret_list)
+		return;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		const char *node_name = ret_data_info->node_name;
+
+		if (!node_name)
+			node_name = head;
+		_fwd_health_update(node_name,
+				   xstrcmp(node_name, head) ? 0 : rtt_usec,
+				   (ret_data_info->type ==
+				    RESPONSE_FORWARD_FAILED));
+	}
+	list_iterator_destroy(itr);
+}
+
+static bool _fwd_health_suspect(const char *node_name, time_t now)
+{
+	fwd_health_t *health = xhash_get_str(fwd_health, node_name);
+
+	return (health && health->last_fail &&
+		((now - health->last_fail) < FWD_SUSPECT_TIME));
+}
+
+/*
+ * Remove nodes which recently failed to respond from hl.
+ * RET hostlist of the removed nodes or NULL if none. Caller must free.
+ */
+static hostlist_t *_fwd_health_split_suspect(hostlist_t *hl)
+{
+	hostlist_t *suspect_hl = NULL;
+	hostlist_iterator_t *itr;
+	time_t now = time(NULL);
+	char *name;
+
+	slurm_mutex_lock(&fwd_health_mutex);
+	if (!fwd_health || !xhash_count(fwd_health)) {
+		slurm_mutex_unlock(&fwd_health_mutex);
+		return NULL;
+	}
+
+	itr = hostlist_iterator_create(hl);
+	while ((name = hostlist_next(itr))) {
+		if (_fwd_health_suspect(name, now)) {
+			if (!suspect_hl)
+				suspect_hl = hostlist_create(NULL);
+			hostlist_push_host(suspect_hl, name);
+			hostlist_remove(itr);
+		}
+		free(name);
+	}
+	hostlist_iterator_destroy(itr);
+	slurm_mutex_unlock(&fwd_health_mutex);
+
+	if (suspect_hl && (slurm_conf.debug_flags & DEBUG_FLAG_ROUTE)) {
+		char *buf = hostlist_ranged_string_xmalloc(suspect_hl);
+		debug("ROUTE: adaptive forward contacting suspect nodes %s directly",
+		      buf);
+		xfree(buf);
+	}
+
+	return suspect_hl;
+}
+
+/*
+ * Move the node with the lowest known round trip time to the head of each
+ * branch, so that the node relaying to the rest of the branch is the one
+ * that has been answering fastest. Branches whose head has no measurement
+ * are left untouched to preserve the topology ordering.
+ */
+static void _fwd_health_order_branches(hostlist_t **sp_hl, int hl_count)
+{
+	slurm_mutex_lock(&fwd_health_mutex);
+	if (!fwd_health) {
+		slurm_mutex_unlock(&fwd_health_mutex);
+		return;
+	}
+
+	for (int i = 0; i < hl_count; i++) {
+		fwd_health_t *health, *best = NULL;
+		hostlist_iterator_t *itr;
+		hostlist_t *new_hl;
+		char *name;
+
+		if (hostlist_count(sp_hl[i]) < 2)
+			continue;
+
+		itr = hostlist_iterator_create(sp_hl[i]);
+		while ((name = hostlist_next(itr))) {
+			health = xhash_get_str(fwd_health, name);
+			free(name);
+			if (!best) {
+				/* Unmeasured head, keep the branch as is */
+				if (!health || !health->rtt_usec)
+					break;
+				best = health;
+			} else if (health && health->rtt_usec &&
+				   (health->rtt_usec < best->rtt_usec)) {
+				best = health;
+			}
+		}
+		hostlist_iterator_destroy(itr);
+
+		if (!best)
+			continue;
+
+		name = hostlist_nth(sp_hl[i], 0);
+		if (xstrcmp(name, best->node_name)) {
+			new_hl = hostlist_create(best->node_name);
+			hostlist_delete_host(sp_hl[i], best->node_name);
+			hostlist_push_list(new_hl, sp_hl[i]);
+			hostlist_destroy(sp_hl[i]);
+			sp_hl[i] = new_hl;
+		}
+		free(name);
+	}
+	slurm_mutex_unlock(&fwd_health_mutex);
+}
+
 void _destroy_tree_fwd(fwd_tree_t *fwd_tree)
 {
 	if (fwd_tree) {
@@ -327,6 +553,8 @@ static void *_forward_thread(void *arg)
 		}
 		break;
 	}
+	if (_adaptive_fwd_enabled())
+		_fwd_health_update_list(ret_list, name, 0);
 	slurm_mutex_lock(&fwd_struct->forward_mutex);
 	if (ret_list) {
 		while ((ret_data_info = list_pop(ret_list)) != NULL) {
@@ -400,6 +628,7 @@ static void *_fwd_tree_thread(void *arg)
 	char *name = NULL;
 	char *buf = NULL;
 	slurm_msg_t send_msg;
+	DEF_TIMERS;
 
 	slurm_msg_t_init(&send_msg);
 	send_msg.msg_type = fwd_tree->orig_msg->msg_type;
@@ -444,11 +673,19 @@ static void *_fwd_tree_thread(void *arg)
 		} else
 			debug3("Tree sending to %s", name);
 
+		START_TIMER;
 		ret_list = slurm_send_addr_recv_msgs(&send_msg, name,
 						     fwd_tree->timeout);
+		END_TIMER;
 
 		xfree(send_msg.forward.nodelist);
 
+		/* Only a leaf send measures the latency of the node itself */
+		if (fwd_tree->adaptive)
+			_fwd_health_update_list(ret_list, name,
+						(send_msg.forward.cnt ?
+						 0 : DELTA_TIMER));
+
 		if (ret_list) {
 			int ret_cnt = list_count(ret_list);
 			/* This is most common if a slurmd is running
@@ -604,7 +841,8 @@ static void _forward_msg_internal(hostlist_t *hl, hostlist_t **sp_hl,
 		       sizeof(slurm_addr_t));
 
 		fwd_msg->header.version = header->version;
-		fwd_msg->header.flags = header->flags;
+		/* Connections opened by _forward_thread() are not pooled */
+		fwd_msg->header.flags = header->flags & ~SLURM_CONN_KEEPALIVE;
 		fwd_msg->header.msg_type = header->msg_type;
 		fwd_msg->header.body_length = header->body_length;
 		fwd_msg->header.ret_list = NULL;
@@ -652,9 +890,10 @@ extern void forward_init(forward_t *forward)
  */
 extern int forward_msg(forward_struct_t *forward_struct, header_t *header)
 {
-	hostlist_t *hl = NULL;
-	hostlist_t **sp_hl;
+	hostlist_t *hl = NULL, *suspect_hl = NULL;
+	hostlist_t **sp_hl = NULL;
 	int hl_count = 0, depth;
+	bool adaptive;
 
 	if (!forward_struct->ret_list) {
 		error("didn't get a ret_list from forward_struct");
@@ -676,12 +915,20 @@ extern int forward_msg(forward_struct_t *forward_struct, header_t *header)
 
 	hostlist_uniq(hl);
 
-	if ((depth = topology_g_split_hostlist(hl, &sp_hl, &hl_count,
-					       header->forward.tree_width)) ==
-	    SLURM_ERROR) {
+	if ((adaptive = _adaptive_fwd_enabled()))
+		suspect_hl = _fwd_health_split_suspect(hl);
+
+	if (!hostlist_count(hl)) {
+		depth = 1;
+	} else if ((depth = topology_g_split_hostlist(
+			    hl, &sp_hl, &hl_count,
+			    header->forward.tree_width)) == SLURM_ERROR) {
 		error("unable to split forward hostlist");
+		FREE_NULL_HOSTLIST(suspect_hl);
 		hostlist_destroy(hl);
 		return SLURM_ERROR;
+	} else if (adaptive) {
+		_fwd_health_order_branches(sp_hl, hl_count);
 	}
 
 	/* Calculate the new timeout based on the original timeout */
@@ -694,8 +941,21 @@ extern int forward_msg(forward_struct_t *forward_struct, header_t *header)
 	log_flag(NET, "%s: forwarding messages to %u nodes with timeout of %d",
 		 __func__, forward_struct->fwd_cnt, forward_struct->timeout);
 
-	_forward_msg_internal(NULL, sp_hl, forward_struct, header,
-			      forward_struct->timeout, hl_count);
+	if (hl_count)
+		_forward_msg_internal(NULL, sp_hl, forward_struct, header,
+				      forward_struct->timeout, hl_count);
+	if (suspect_hl) {
+		/* Suspect nodes are leaves, a single hop timeout is enough */
+		header_t leaf_header = *header;
+
+		leaf_header.forward.timeout = header->forward.timeout / depth;
+		leaf_header.forward.tree_depth = 1;
+		_forward_msg_internal(suspect_hl, NULL, forward_struct,
+				      &leaf_header,
+				      leaf_header.forward.timeout,
+				      hostlist_count(suspect_hl));
+		hostlist_destroy(suspect_hl);
+	}
 
 	xfree(sp_hl);
 	hostlist_destroy(hl);
@@ -820,8 +1080,9 @@ extern list_t *start_msg_tree(hostlist_t *hl, slurm_msg_t *msg, int timeout)
 	list_t *ret_list = NULL;
 	int thr_count = 0;
 	int host_count = 0;
-	hostlist_t **sp_hl;
+	hostlist_t **sp_hl = NULL, *suspect_hl = NULL;
 	int hl_count = 0, depth;
+	bool adaptive;
 
 	xassert(hl);
 	xassert(msg);
@@ -837,7 +1098,17 @@ extern list_t *start_msg_tree(hostlist_t *hl, slurm_msg_t *msg, int timeout)
 	_get_alias_addrs(hl, msg, &host_count);
 	_get_dynamic_addrs(hl, msg);
 
-	if (running_in_slurmctld())
+	/*
+	 * Nodes which recently failed to respond are not given a subtree to
+	 * relay to, so they can't hold up the rest of the fan-out until
+	 * the (depth scaled) timeout expires.
+	 */
+	if ((adaptive = _adaptive_fwd_enabled()))
+		suspect_hl = _fwd_health_split_suspect(hl);
+
+	if (!hostlist_count(hl))
+		depth = 1;
+	else if (running_in_slurmctld())
 		depth = topology_g_split_hostlist(hl, &sp_hl, &hl_count,
 						  msg->forward.tree_width);
 	else
@@ -846,14 +1117,19 @@ extern list_t *start_msg_tree(hostlist_t *hl, slurm_msg_t *msg, int timeout)
 
 	if (depth == SLURM_ERROR) {
 		error("unable to split forward hostlist");
+		FREE_NULL_HOSTLIST(suspect_hl);
 		return NULL;
 	}
+
+	if (adaptive)
+		_fwd_health_order_branches(sp_hl, hl_count);
 	slurm_mutex_init(&tree_mutex);
 	slurm_cond_init(&notify, NULL);
 
 	ret_list = list_create(destroy_data_info);
 
 	memset(&fwd_tree, 0, sizeof(fwd_tree));
+	fwd_tree.adaptive = adaptive;
 	fwd_tree.orig_msg = msg;
 	fwd_tree.ret_list = ret_list;
 	fwd_tree.tree_depth = depth;
@@ -862,7 +1138,17 @@ extern list_t *start_msg_tree(hostlist_t *hl, slurm_msg_t *msg, int timeout)
 	fwd_tree.p_thr_count = &thr_count;
 	fwd_tree.tree_mutex = &tree_mutex;
 
-	_start_msg_tree_internal(NULL, sp_hl, &fwd_tree, hl_count);
+	if (hl_count)
+		_start_msg_tree_internal(NULL, sp_hl, &fwd_tree, hl_count);
+
+	if (suspect_hl) {
+		/* Suspect nodes are leaves, a single hop timeout is enough */
+		fwd_tree.tree_depth = 1;
+		fwd_tree.timeout = timeout;
+		_start_msg_tree_internal(suspect_hl, NULL, &fwd_tree,
+					 hostlist_count(suspect_hl));
+		hostlist_destroy(suspect_hl);
+	}
 
 	xfree(sp_hl);
 
@@ -898,6 +1184,8 @@ extern void mark_as_failed_forward(list_t **ret_list, char *node_name, int err)
 	ret_data_info_t *ret_data_info = NULL;
 
 	debug3("problems with %s", node_name);
+	if (_adaptive_fwd_enabled())
+		_fwd_health_update(node_name, 0, true);
 	if (!*ret_list)
 		*ret_list = list_create(destroy_data_info);
 
@@ -59,6 +59,26 @@ void io_hdr_pack(io_hdr_t *hdr, buf_t *buffer)
 	pack32(hdr->length, buffer);
 }
 
+void io_node_init_pack(io_init_msg_t *msg, buf_t *buffer)
+{
+	pack32(msg->nodeid, buffer);
+	pack32(msg->stdout_objs, buffer);
+	pack32(msg->stderr_objs, buffer);
+}
+
+int io_node_init_unpack(io_init_msg_t *msg, buf_t *buffer)
+{
+	safe_unpack32(&msg->nodeid, buffer);
+	safe_unpack32(&msg->stdout_objs, buffer);
+	safe_unpack32(&msg->stderr_objs, buffer);
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	error("%s: unpack error", __func__);
+	return SLURM_ERROR;
+}
+
 int io_hdr_unpack(io_hdr_t *hdr, buf_t *buffer)
 {
 	uint16_t type;
@@ -62,6 +62,11 @@
  *
  *	slurmstepd honors task_read_info.type to determine where messages sent.
  *
+ * With LAUNCH_IO_TREE a slurmstepd also relays the stdio of the nodes below
+ * it in the reverse tree. Each of those nodes is announced to srun with a
+ * SLURM_IO_NODE_INIT message (payload packed via io_node_init_pack()) before
+ * any of its output, after which its messages are forwarded unchanged.
+ *
  * Connection ends with io_hdr_t.length=0 packet with no payload
  */
 
@@ -81,6 +86,7 @@ typedef enum {
 	SLURM_IO_STDERR = 2,
 	SLURM_IO_ALLSTDIN = 3,
 	SLURM_IO_CONNECTION_TEST = 4,
+	SLURM_IO_NODE_INIT = 5,
 	SLURM_IO_INVALID_MAX
 } io_hdr_type_t;
 
@@ -122,6 +128,14 @@ void io_hdr_pack(io_hdr_t *hdr, buf_t *buffer);
 int io_hdr_unpack(io_hdr_t *hdr, buf_t *buffer);
 int io_hdr_read_fd(int fd, void *conn, io_hdr_t *hdr);
 
+/*
+ * Pack/unpack the nodeid, stdout_objs and stderr_objs of a relayed node for
+ * a SLURM_IO_NODE_INIT message, IO_NODE_INIT_BYTES long.
+ */
+#define IO_NODE_INIT_BYTES 12
+void io_node_init_pack(io_init_msg_t *msg, buf_t *buffer);
+int io_node_init_unpack(io_init_msg_t *msg, buf_t *buffer);
+
 /*
  * Validate io init msg
  */
@@ -1632,6 +1632,9 @@ uint16_t parse_compress_type(const char *arg)
 
 	if (!strcasecmp(arg, "lz4"))
 		return COMPRESS_LZ4;
+	else if (!strncasecmp(arg, "zstd", 4) &&
+		 ((arg[4] == '\0') || (arg[4] == ':')))
+		return COMPRESS_ZSTD;
 	else if (!strcasecmp(arg, "none"))
 		return COMPRESS_OFF;
 
@@ -1640,6 +1643,25 @@ uint16_t parse_compress_type(const char *arg)
 	return COMPRESS_OFF;
 }
 
+extern int parse_compress_level(const char *arg)
+{
+	char *level, *end_ptr = NULL;
+	long val;
+
+	if (!arg || !(level = xstrchr(arg, ':')))
+		return 0;
+
+	val = strtol(level + 1, &end_ptr, 10);
+	if ((end_ptr == level + 1) || (*end_ptr != '\0') || (val < -99) ||
+	    (val > 99)) {
+		error("Compression level '%s' invalid, using the default.",
+		      level + 1);
+		return 0;
+	}
+
+	return val;
+}
+
 /*
  * IN: option argument value to interpret.
  * RET: 1 if enabled, 0 if disabled, -1 if error
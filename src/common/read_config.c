@@ -4033,6 +4033,10 @@ static int _validate_and_set_defaults(slurm_conf_t *conf,
 		    (xstrcasestr(conf->job_acct_gather_params, "UsePSS") ||
 		     xstrcasestr(conf->job_acct_gather_params, "NoShared")))
 			error_in_daemon("JobAcctGatherParams UsePSS and NoShared are only compatible with jobacct_gather/linux.");
+
+		if (!xstrcasestr(conf->job_acct_gather_type, "cgroup") &&
+		    xstrcasestr(conf->job_acct_gather_params, "NoProcScan"))
+			error_in_daemon("JobAcctGatherParams NoProcScan is only compatible with jobacct_gather/cgroup.");
 	}
 
 	if (!s_p_get_string(&conf->job_comp_type, "JobCompType", hashtbl)) {
@@ -861,6 +861,7 @@ static int arg_set_compress(slurm_opt_t *opt, const char *arg)
 		return SLURM_ERROR;
 
 	opt->srun_opt->compress = parse_compress_type(arg);
+	opt->srun_opt->compress_level = parse_compress_level(arg);
 
 	return SLURM_SUCCESS;
 }
@@ -871,12 +872,20 @@ static char *arg_get_compress(slurm_opt_t *opt)
 
 	if (opt->srun_opt->compress == COMPRESS_LZ4)
 		return xstrdup("lz4");
+	if ((opt->srun_opt->compress == COMPRESS_ZSTD) &&
+	    opt->srun_opt->compress_level)
+		return xstrdup_printf("zstd:%d",
+				      opt->srun_opt->compress_level);
+	if (opt->srun_opt->compress == COMPRESS_ZSTD)
+		return xstrdup("zstd");
 	return xstrdup("none");
 }
 static void arg_reset_compress(slurm_opt_t *opt)
 {
-	if (opt->srun_opt)
+	if (opt->srun_opt) {
 		opt->srun_opt->compress = COMPRESS_OFF;
+		opt->srun_opt->compress_level = 0;
+	}
 }
 static slurm_cli_opt_t slurm_opt_compress = {
 	.name = "compress",
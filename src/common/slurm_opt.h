@@ -251,6 +251,7 @@ typedef struct {
 	bool bcast_flag;		/* --bcast, copy executable to compute nodes */
 	char *cmd_name;			/* name of command to execute	*/
 	uint16_t compress;		/* --compress (for --bcast option) */
+	int compress_level;		/* --compress=zstd:<level> */
 	bool core_spec_set;		/* core_spec explicitly set	*/
 	char *cpu_bind;			/* binding map for map/mask_cpu	*/
 	cpu_bind_type_t cpu_bind_type;	/* --cpu-bind			*/
@@ -46,6 +46,7 @@
 #include <arpa/inet.h>
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include <poll.h>
 #include <pthread.h>
 #include <stdio.h>
@@ -74,6 +75,7 @@
 #include "src/common/slurm_protocol_socket.h"
 #include "src/common/stepd_proxy.h"
 #include "src/common/strlcpy.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -102,8 +104,23 @@ strong_alias(get_unit_type, slurm_get_unit_type);
 /* EXTERNAL VARIABLES */
 
 /* #DEFINES */
+#define CONN_POOL_NODE_MAX 4 /* max idle connections kept per node */
 
 /* STATIC VARIABLES */
+typedef struct {
+	void *conn;
+	time_t last_used;
+} conn_pool_conn_t;
+
+typedef struct {
+	char *node_name;
+	conn_pool_conn_t conns[CONN_POOL_NODE_MAX];
+	int cnt;
+} conn_pool_node_t;
+
+static xhash_t *conn_pool = NULL;
+static time_t conn_pool_last_sweep = 0;
+static pthread_mutex_t conn_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* STATIC FUNCTIONS */
 static char *_global_auth_key(void);
@@ -1115,16 +1132,25 @@ endit:
 }
 
 /*
- * NOTE: memory is allocated for the returned list
- *       and must be freed at some point using the list_destroy function.
- * IN conn
- * IN steps	- how many steps down the tree we have to wait for
- * IN timeout	- how long to wait in milliseconds
- * RET List	- List containing the responses of the children (if any) we
- *		  forwarded the message to. List containing type
- *		  (ret_data_info_t).
+ * A reused connection the peer closed while idle fails either on send or
+ * when receiving the response, with an EOF, a reset or a receive error that
+ * slurm_recv_timeout() reports instead of the errno of recv(). A timeout, a
+ * partial or an invalid response mean the request was seen and must not be
+ * sent again.
  */
-extern list_t *slurm_receive_msgs(void *conn, int steps, int timeout)
+static bool _conn_pool_stale(bool send_failed, int err)
+{
+	return (send_failed ||
+		(err == SLURM_PROTOCOL_SOCKET_ZERO_BYTES_SENT) ||
+		(err == SLURM_COMMUNICATIONS_RECEIVE_ERROR) ||
+		(err == ECONNRESET) || (err == EPIPE));
+}
+
+/*
+ * See slurm_receive_msgs(). A stale pooled connection is retried by the
+ * caller, its failure is then not an error.
+ */
+static list_t *_receive_msgs(void *conn, int steps, int timeout, bool pooled)
 {
 	int fd = -1;
 	char *buf = NULL;
@@ -1288,9 +1314,14 @@ total_return:
 		if (!peer)
 			peer = fd_resolve_peer(fd);
 
-		error("%s: [%s] failed: %s",
-		      __func__, peer, slurm_strerror(rc));
-		usleep(10000);	/* Discourage brute force attack */
+		if (pooled && _conn_pool_stale(false, rc)) {
+			log_flag(NET, "%s: [%s] pooled connection failed: %s",
+				 __func__, peer, slurm_strerror(rc));
+		} else {
+			error("%s: [%s] failed: %s",
+			      __func__, peer, slurm_strerror(rc));
+			usleep(10000);	/* Discourage brute force attack */
+		}
 	} else {
 		if (!ret_list)
 			ret_list = list_create(destroy_data_info);
@@ -1308,6 +1339,21 @@ total_return:
 
 }
 
+/*
+ * NOTE: memory is allocated for the returned list
+ *       and must be freed at some point using the list_destroy function.
+ * IN conn
+ * IN steps	- how many steps down the tree we have to wait for
+ * IN timeout	- how long to wait in milliseconds
+ * RET List	- List containing the responses of the children (if any) we
+ *		  forwarded the message to. List containing type
+ *		  (ret_data_info_t).
+ */
+extern list_t *slurm_receive_msgs(void *conn, int steps, int timeout)
+{
+	return _receive_msgs(conn, steps, timeout, false);
+}
+
 extern list_t *slurm_receive_resp_msgs(void *conn, int steps, int timeout)
 {
 	int fd = -1;
@@ -1628,6 +1674,47 @@ total_return:
 	return rc;
 }
 
+extern int slurm_receive_keepalive_msg(void *conn, slurm_addr_t *addr,
+				       slurm_msg_t *msg)
+{
+	char *buf = NULL;
+	size_t buflen = 0;
+	buf_t *buffer;
+	int rc;
+
+	if (slurm_msg_recvfrom_timeout(conn, &buf, &buflen,
+				       (slurm_conf.msg_timeout *
+					MSEC_IN_SEC)) < 0) {
+		if (!(rc = errno))
+			rc = SLURM_COMMUNICATIONS_RECEIVE_ERROR;
+		return rc;
+	}
+
+	log_flag_hex(NET_RAW, buf, buflen, "%s: read", __func__);
+	buffer = create_buf(buf, buflen);
+
+	msg->conn = conn;
+	if ((rc = slurm_unpack_msg_and_forward(msg, addr, conn_g_get_fd(conn),
+					       buffer))) {
+		/* Same handling as a failed unpack in conmgr */
+		if (msg->auth_ids_set)
+			slurm_send_rc_msg(msg, rc);
+		else
+			forward_wait(msg);
+		FREE_NULL_BUFFER(buffer);
+		return rc;
+	}
+
+	msg->buffer = buffer;
+	msg->flags |= SLURM_MSG_KEEP_BUFFER;
+	set_buf_offset(msg->buffer, size_buf(msg->buffer));
+
+	log_flag(NET, "%s: Received keepalive message %s from %pA",
+		 __func__, rpc_num2string(msg->msg_type), addr);
+
+	return SLURM_SUCCESS;
+}
+
 /**********************************************************************\
  * message packing routines
 \**********************************************************************/
@@ -2561,21 +2648,166 @@ list_t *slurm_send_recv_msgs(const char *nodelist, slurm_msg_t *msg, int timeout
 	return ret_list;
 }
 
+extern int slurm_conn_pool_idle_time(void)
+{
+	static time_t config_update = (time_t) -1;
+	static int idle_time = 0;
+	char *tmp_ptr;
+	int rc;
+
+	slurm_mutex_lock(&conn_pool_mutex);
+	if (config_update == slurm_conf.last_update) {
+		rc = idle_time;
+		slurm_mutex_unlock(&conn_pool_mutex);
+		return rc;
+	}
+
+	idle_time = 0;
+	if (!running_in_slurmctld() && !running_in_slurmd()) {
+		/* Only daemons keep connections between RPCs */
+	} else if ((tmp_ptr = xstrcasestr(slurm_conf.comm_params,
+					  "conn_pool_idle_time="))) {
+		long tmp_val = strtol(tmp_ptr + 20, NULL, 10);
+
+		if ((tmp_val > 0) && (tmp_val <= INT_MAX))
+			idle_time = tmp_val;
+		else
+			error("CommunicationParameters option conn_pool_idle_time=%ld is invalid, ignored",
+			      tmp_val);
+	} else if (xstrcasestr(slurm_conf.comm_params, "conn_pool")) {
+		idle_time = DEFAULT_CONN_POOL_IDLE_TIME;
+	}
+	config_update = slurm_conf.last_update;
+	rc = idle_time;
+	slurm_mutex_unlock(&conn_pool_mutex);
+
+	return rc;
+}
+
+static void _conn_pool_node_id(void *item, const char **key,
+			       uint32_t *key_len)
+{
+	conn_pool_node_t *pool_node = item;
+
+	*key = pool_node->node_name;
+	*key_len = strlen(pool_node->node_name);
+}
+
+static void _conn_pool_node_free(void *item)
+{
+	conn_pool_node_t *pool_node = item;
+
+	for (int i = 0; i < pool_node->cnt; i++)
+		conn_g_destroy(pool_node->conns[i].conn, true);
+	xfree(pool_node->node_name);
+	xfree(pool_node);
+}
+
 /*
- *  Send a message to msg->address
- *    Then return List containing type (ret_data_info_t).
- * IN msg	  - a slurm_msg struct to be sent by the function
- * IN timeout	  - how long to wait in milliseconds
- * RET List	  - List containing the responses of the children
- *		    (if any) we forwarded the message to. List
- *		    containing type (ret_types_t).
+ * Check if an idle connection is still usable. Nothing is expected to be sent
+ * by the peer while idle, so a readable socket means the peer closed it.
  */
-list_t *slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
+static bool _conn_pool_conn_alive(void *conn)
+{
+	struct pollfd pfd = {
+		.fd = conn_g_get_fd(conn),
+		.events = POLLIN,
+	};
+
+	return !poll(&pfd, 1, 0);
+}
+
+static void _conn_pool_sweep(void *item, void *arg)
+{
+	conn_pool_node_t *pool_node = item;
+	time_t *expire = arg;
+	int i = 0;
+
+	while (i < pool_node->cnt) {
+		if (pool_node->conns[i].last_used > *expire) {
+			i++;
+			continue;
+		}
+		conn_g_destroy(pool_node->conns[i].conn, true);
+		pool_node->conns[i] = pool_node->conns[--pool_node->cnt];
+	}
+}
+
+/*
+ * Get an idle connection to node_name from the pool.
+ * RET connection or NULL if none is available
+ */
+static void *_conn_pool_get(const char *node_name, int idle_time)
+{
+	conn_pool_node_t *pool_node;
+	time_t now = time(NULL);
+	/* Evict well before the peer gives up on the connection */
+	time_t expire = now - (idle_time / 2);
+	void *conn = NULL;
+
+	slurm_mutex_lock(&conn_pool_mutex);
+	if (!conn_pool) {
+		slurm_mutex_unlock(&conn_pool_mutex);
+		return NULL;
+	}
+
+	if (conn_pool_last_sweep < expire) {
+		xhash_walk(conn_pool, _conn_pool_sweep, &expire);
+		conn_pool_last_sweep = now;
+	}
+
+	pool_node = xhash_get_str(conn_pool, node_name);
+	while (pool_node && pool_node->cnt && !conn) {
+		conn_pool_conn_t *pool_conn =
+			&pool_node->conns[--pool_node->cnt];
+
+		if ((pool_conn->last_used > expire) &&
+		    _conn_pool_conn_alive(pool_conn->conn))
+			conn = pool_conn->conn;
+		else
+			conn_g_destroy(pool_conn->conn, true);
+		pool_conn->conn = NULL;
+	}
+	slurm_mutex_unlock(&conn_pool_mutex);
+
+	if (conn)
+		log_flag(NET, "%s: reusing connection to %s",
+			 __func__, node_name);
+
+	return conn;
+}
+
+/* Return a connection to node_name to the pool, closing it if full */
+static void _conn_pool_put(const char *node_name, void *conn)
+{
+	conn_pool_node_t *pool_node;
+
+	slurm_mutex_lock(&conn_pool_mutex);
+	if (!conn_pool)
+		conn_pool = xhash_init(_conn_pool_node_id,
+				       _conn_pool_node_free);
+	if (!(pool_node = xhash_get_str(conn_pool, node_name))) {
+		pool_node = xmalloc(sizeof(*pool_node));
+		pool_node->node_name = xstrdup(node_name);
+		xhash_add(conn_pool, pool_node);
+	}
+
+	if (pool_node->cnt < CONN_POOL_NODE_MAX) {
+		pool_node->conns[pool_node->cnt].conn = conn;
+		pool_node->conns[pool_node->cnt].last_used = time(NULL);
+		pool_node->cnt++;
+		conn = NULL;
+	}
+	slurm_mutex_unlock(&conn_pool_mutex);
+
+	conn_g_destroy(conn, true);
+}
+
+static void *_open_addr_conn(slurm_msg_t *msg)
 {
 	time_t start, now;
 	uint16_t conn_timeout = MIN(slurm_conf.msg_timeout, 10);
 	void *conn = NULL;
-	list_t *ret_list = NULL;
 	bool first = true;
 
 	start = now = time(NULL);
@@ -2600,8 +2832,41 @@ list_t *slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
 		now = time(NULL);
 	}
 
-	if (!conn) {
+	return conn;
+}
+
+/*
+ *  Send a message to msg->address
+ *    Then return List containing type (ret_data_info_t).
+ * IN msg	  - a slurm_msg struct to be sent by the function
+ * IN timeout	  - how long to wait in milliseconds
+ * RET List	  - List containing the responses of the children
+ *		    (if any) we forwarded the message to. List
+ *		    containing type (ret_types_t).
+ */
+list_t *slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
+{
+	void *conn = NULL;
+	list_t *ret_list = NULL;
+	uint16_t orig_flags = msg->flags;
+	int idle_time = 0;
+	bool reused = false, send_failed;
+
+	/*
+	 * Only pool connections to slurmds known to support it. Connections
+	 * with a specific certificate are never shared.
+	 */
+	if (!msg->tls_cert &&
+	    (msg->protocol_version >= SLURM_PROTOCOL_VERSION) &&
+	    (idle_time = slurm_conn_pool_idle_time())) {
+		msg->flags |= SLURM_CONN_KEEPALIVE;
+		reused = (conn = _conn_pool_get(name, idle_time));
+	}
+
+again:
+	if (!conn && !(conn = _open_addr_conn(msg))) {
 		log_flag(NET, "Failed to connect to %pA, %m", &msg->address);
+		msg->flags = orig_flags;
 		mark_as_failed_forward(&ret_list, name,
 				       SLURM_COMMUNICATIONS_CONNECTION_ERROR);
 		errno = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
@@ -2611,9 +2876,24 @@ list_t *slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
 	msg->ret_list = NULL;
 	msg->forward_struct = NULL;
 
-	if (slurm_send_node_msg(conn, msg) >= 0)
-		ret_list = slurm_receive_msgs(conn, msg->forward.tree_depth,
-					      msg->forward.timeout);
+	if (!(send_failed = (slurm_send_node_msg(conn, msg) < 0)))
+		ret_list = _receive_msgs(conn, msg->forward.tree_depth,
+					 msg->forward.timeout, reused);
+
+	if (!ret_list && reused && _conn_pool_stale(send_failed, errno)) {
+		/*
+		 * The peer closed the idle connection while it was being
+		 * reused. Try again once over a new connection.
+		 */
+		log_flag(NET, "%s: pooled connection to %s failed, reconnecting",
+			 __func__, name);
+		conn_g_destroy(conn, true);
+		conn = NULL;
+		reused = false;
+		goto again;
+	}
+
+	msg->flags = orig_flags;
 
 	if (!ret_list) {
 		mark_as_failed_forward(&ret_list, name, errno);
@@ -2625,7 +2905,10 @@ list_t *slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
 	(void) list_for_each(
 			ret_list, _foreach_ret_list_hostname_set, name);
 
-	conn_g_destroy(conn, true);
+	if (idle_time)
+		_conn_pool_put(name, conn);
+	else
+		conn_g_destroy(conn, true);
 
 	return ret_list;
 }
@@ -251,6 +251,29 @@ extern int slurm_unpack_msg_and_forward(slurm_msg_t *msg,
 					slurm_addr_t *orig_addr, int fd,
 					buf_t *buffer);
 
+/*
+ *  Receive the next message on a connection whose peer asked for it to be kept
+ *  open (SLURM_CONN_KEEPALIVE) after the previous message was answered. The
+ *  message is forwarded to the nodes in its header as with
+ *  slurm_unpack_msg_and_forward() and the received buffer is kept in
+ *  msg->buffer.
+ *
+ * IN conn	- connection the previous message was received on
+ * IN addr	- address of the peer of the connection
+ * OUT msg	- a slurm_msg struct to be filled in by the function
+ * RET int	- returns SLURM_SUCCESS or an error. On error the connection
+ *		  must be closed by the caller.
+ */
+extern int slurm_receive_keepalive_msg(void *conn, slurm_addr_t *addr,
+				       slurm_msg_t *msg);
+
+/*
+ * Return number of seconds an idle connection is kept open between Slurm
+ * daemons when CommunicationParameters=conn_pool is configured, 0 if
+ * connection pooling is disabled.
+ */
+extern int slurm_conn_pool_idle_time(void);
+
 /**********************************************************************\
  * send message functions
 \**********************************************************************/
@@ -111,5 +111,6 @@
 #define CTLD_QUEUE_PROCESSING	SLURM_BIT(5)
 #define SLURM_NO_AUTH_CRED	SLURM_BIT(6)
 #define SLURM_PACK_ADDRS	SLURM_BIT(7)
+#define SLURM_CONN_KEEPALIVE	SLURM_BIT(8)
 
 #endif
@@ -2436,6 +2436,30 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 			xfree(msg->rpc_dump_hostlist[i]);
 		}
 		xfree(msg->rpc_dump_hostlist);
+		xfree(msg->rpc_type_latency);
+		xfree(msg->rpc_slow_time);
+		xfree(msg->rpc_slow_type);
+		xfree(msg->rpc_slow_uid);
+		xfree(msg->rpc_slow_latency);
+		if (msg->rpc_slow_lock_holder) {
+			for (i = 0; i < msg->rpc_slow_count; i++)
+				xfree(msg->rpc_slow_lock_holder[i]);
+			xfree(msg->rpc_slow_lock_holder);
+		}
+		if (msg->rpc_lane_name) {
+			for (i = 0; i < msg->rpc_lane_count; i++)
+				xfree(msg->rpc_lane_name[i]);
+			xfree(msg->rpc_lane_name);
+		}
+		xfree(msg->rpc_lane_active);
+		xfree(msg->rpc_lane_waiting);
+		xfree(msg->rpc_lane_max_active);
+		xfree(msg->rpc_lane_max_waiting);
+		xfree(msg->rpc_lane_admitted);
+		xfree(msg->rpc_lane_waited);
+		xfree(msg->rpc_lane_shed);
+		xfree(msg->rpc_lane_wait_usec);
+		xfree(msg->rpc_lane_wait_max_usec);
 		xfree(msg);
 	}
 }
@@ -4603,6 +4627,7 @@ extern void slurm_free_file_bcast_msg(file_bcast_msg_t *msg)
 		xfree(msg->fname);
 		xfree(msg->exe_fname);
 		xfree(msg->user_name);
+		xfree(msg->swarm_nodes);
 		delete_sbcast_cred(msg->cred);
 		xfree(msg);
 	}
@@ -665,6 +665,7 @@ typedef struct job_step_create_response_msg {
 #define LAUNCH_GRES_ALLOW_TASK_SHARING SLURM_BIT(9)
 #define LAUNCH_WAIT_FOR_CHILDREN SLURM_BIT(10)
 #define LAUNCH_KILL_ON_BAD_EXIT SLURM_BIT(11)
+#define LAUNCH_IO_TREE		SLURM_BIT(12)
 
 typedef struct launch_tasks_request_msg {
 	uint32_t  het_job_node_offset;	/* Hetjob node offset or NO_VAL */
@@ -1027,6 +1028,7 @@ enum compress_type {
 	COMPRESS_OFF = 0,	/* no compression */
 				/* = 1 was zlib */
 	COMPRESS_LZ4 = 2,	/* lz4 compression */
+	COMPRESS_ZSTD = 3,	/* zstd compression */
 };
 
 typedef enum {
@@ -1035,6 +1037,7 @@ typedef enum {
 	FILE_BCAST_LAST_BLOCK = 1 << 1,	/* last file block */
 	FILE_BCAST_SO = 1 << 2, 	/* shared object */
 	FILE_BCAST_EXE = 1 << 3,	/* executable ahead of shared object */
+	FILE_BCAST_SWARM = 1 << 4,	/* relay to swarm_nodes, see sbcast */
 } file_bcast_flags_t;
 
 typedef struct file_bcast_msg {
@@ -1055,6 +1058,8 @@ typedef struct file_bcast_msg {
 	uint32_t uncomp_len;	/* uncompressed length of this data block */
 	char *block;		/* data for this block */
 	uint64_t file_size;	/* file size */
+	char *swarm_nodes;	/* nodes relaying FILE_BCAST_SWARM blocks */
+	uint16_t swarm_width;	/* width of the relay tree */
 } file_bcast_msg_t;
 
 typedef struct multi_core_data {
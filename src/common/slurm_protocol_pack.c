@@ -10637,7 +10637,30 @@ static void _pack_file_bcast(const slurm_msg_t *smsg, buf_t *buffer)
 
 	grow_buf(buffer,  msg->block_len);
 
-	if (smsg->protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (smsg->protocol_version >= SLURM_26_05_PROTOCOL_VERSION) {
+		pack32(msg->block_no, buffer);
+		pack16(msg->compress, buffer);
+		pack16(msg->flags, buffer);
+		pack16(msg->modes, buffer);
+
+		pack32(msg->uid, buffer);
+		packstr(msg->user_name, buffer);
+		pack32(msg->gid, buffer);
+
+		pack_time(msg->atime, buffer);
+		pack_time(msg->mtime, buffer);
+
+		packstr(msg->fname, buffer);
+		packstr(msg->exe_fname, buffer);
+		pack32(msg->block_len, buffer);
+		pack32(msg->uncomp_len, buffer);
+		pack64(msg->block_offset, buffer);
+		pack64(msg->file_size, buffer);
+		packmem(msg->block, msg->block_len, buffer);
+		pack_sbcast_cred(msg->cred, buffer, smsg->protocol_version);
+		packstr(msg->swarm_nodes, buffer);
+		pack16(msg->swarm_width, buffer);
+	} else if (smsg->protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		pack32(msg->block_no, buffer);
 		pack16(msg->compress, buffer);
 		pack16(msg->flags, buffer);
@@ -10666,7 +10689,36 @@ static int _unpack_file_bcast(slurm_msg_t *smsg, buf_t *buffer)
 	uint32_t uint32_tmp = 0;
 	file_bcast_msg_t *msg = xmalloc(sizeof(*msg));
 
-	if (smsg->protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (smsg->protocol_version >= SLURM_26_05_PROTOCOL_VERSION) {
+		safe_unpack32(&msg->block_no, buffer);
+		safe_unpack16(&msg->compress, buffer);
+		safe_unpack16(&msg->flags, buffer);
+		safe_unpack16(&msg->modes, buffer);
+
+		safe_unpack32(&msg->uid, buffer);
+		safe_unpackstr(&msg->user_name, buffer);
+		safe_unpack32(&msg->gid, buffer);
+
+		safe_unpack_time(&msg->atime, buffer);
+		safe_unpack_time(&msg->mtime, buffer);
+
+		safe_unpackstr(&msg->fname, buffer);
+		safe_unpackstr(&msg->exe_fname, buffer);
+		safe_unpack32(&msg->block_len, buffer);
+		safe_unpack32(&msg->uncomp_len, buffer);
+		safe_unpack64(&msg->block_offset, buffer);
+		safe_unpack64(&msg->file_size, buffer);
+		safe_unpackmem_xmalloc(&msg->block, &uint32_tmp, buffer);
+		if (uint32_tmp != msg->block_len)
+			goto unpack_error;
+
+		msg->cred =
+			unpack_sbcast_cred(buffer, msg, smsg->protocol_version);
+		if (msg->cred == NULL)
+			goto unpack_error;
+		safe_unpackstr(&msg->swarm_nodes, buffer);
+		safe_unpack16(&msg->swarm_width, buffer);
+	} else if (smsg->protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpack32(&msg->block_no, buffer);
 		safe_unpack16(&msg->compress, buffer);
 		safe_unpack16(&msg->flags, buffer);
@@ -11493,6 +11545,78 @@ static int _unpack_stats_response_msg(slurm_msg_t *smsg, buf_t *buffer)
 				     buffer);
 		if (uint32_tmp != msg->rpc_dump_count)
 			goto unpack_error;
+
+		if (smsg->protocol_version >= SLURM_26_05_PROTOCOL_VERSION) {
+			safe_unpack64_array(&msg->rpc_type_latency,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != (msg->rpc_type_size *
+					   RPC_LATENCY_PHASE_CNT *
+					   RPC_LATENCY_PCTL_CNT))
+				goto unpack_error;
+
+			safe_unpack32(&msg->rpc_slow_count, buffer);
+			safe_xcalloc(msg->rpc_slow_time, msg->rpc_slow_count,
+				     sizeof(*msg->rpc_slow_time));
+			for (int i = 0; i < msg->rpc_slow_count; i++)
+				safe_unpack_time(&msg->rpc_slow_time[i],
+						 buffer);
+			safe_unpack16_array(&msg->rpc_slow_type, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_slow_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_slow_uid, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_slow_count)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_slow_latency,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != (msg->rpc_slow_count *
+					   RPC_LATENCY_PHASE_CNT))
+				goto unpack_error;
+			safe_unpackstr_array(&msg->rpc_slow_lock_holder,
+					     &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_slow_count)
+				goto unpack_error;
+
+			safe_unpackstr_array(&msg->rpc_lane_name,
+					     &msg->rpc_lane_count, buffer);
+			safe_unpack32_array(&msg->rpc_lane_active, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_lane_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_lane_waiting, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_lane_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_lane_max_active,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_lane_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_lane_max_waiting,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_lane_count)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_lane_admitted,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_lane_count)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_lane_waited, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_lane_count)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_lane_shed, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_lane_count)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_lane_wait_usec,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_lane_count)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_lane_wait_max_usec,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_lane_count)
+				goto unpack_error;
+		}
 	} else if (smsg->protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpack32(&uint32_tmp, buffer); /* was parts_packed */
 		safe_unpack_time(&msg->req_time, buffer);
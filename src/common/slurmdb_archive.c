@@ -0,0 +1,528 @@
+/****************************************************************************\
+ *  slurmdb_archive.c - columnar layout for slurmdbd archive files
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#if HAVE_LZ4
+# include <lz4.h>
+#endif
+
+#if HAVE_ZSTD
+# include <zstd.h>
+#endif
+
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurmdb_archive.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+/* How the columns of a block are compressed */
+typedef enum {
+	BLOCK_COMPRESS_NONE,
+	BLOCK_COMPRESS_LZ4,
+	BLOCK_COMPRESS_ZSTD,
+} block_compress_t;
+
+struct slurmdb_archive_writer {
+	buf_t *buffer;
+	char **cells;		/* rows * col_cnt copied strings */
+	uint32_t col_cnt;
+	int end_col;
+	uint32_t rows;
+	int start_col;
+	int uid_col;
+};
+
+typedef struct {
+	uint32_t row;
+	char *val;
+} dict_ent_t;
+
+static int _cmp_dict_ent(const void *a, const void *b)
+{
+	const dict_ent_t *ent_a = a, *ent_b = b;
+
+	if (!ent_a->val || !ent_b->val) {
+		if (ent_a->val == ent_b->val)
+			return 0;
+		return ent_a->val ? 1 : -1;
+	}
+	return strcmp(ent_a->val, ent_b->val);
+}
+
+static int _cmp_uint32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static unsigned long _atoul(char *str)
+{
+	return str ? slurm_atoul(str) : 0;
+}
+
+static void _pack_inx(uint32_t inx, uint32_t dict_cnt, buf_t *buffer)
+{
+	if (dict_cnt <= 0xff)
+		pack8(inx, buffer);
+	else if (dict_cnt <= 0xffff)
+		pack16(inx, buffer);
+	else
+		pack32(inx, buffer);
+}
+
+/* Dictionary encode one column of the pending block into buffer */
+static void _pack_column(slurmdb_archive_writer_t *writer, uint32_t col,
+			 buf_t *buffer)
+{
+	dict_ent_t *ents = xcalloc(writer->rows, sizeof(*ents));
+	uint32_t *inx = xcalloc(writer->rows, sizeof(*inx));
+	uint32_t dict_cnt = 0;
+
+	for (uint32_t r = 0; r < writer->rows; r++) {
+		ents[r].row = r;
+		ents[r].val = writer->cells[(r * writer->col_cnt) + col];
+	}
+	qsort(ents, writer->rows, sizeof(*ents), _cmp_dict_ent);
+
+	for (uint32_t r = 0; r < writer->rows; r++) {
+		if (!r || _cmp_dict_ent(&ents[r - 1], &ents[r]))
+			dict_cnt++;
+		inx[ents[r].row] = dict_cnt - 1;
+	}
+
+	pack32(dict_cnt, buffer);
+	for (uint32_t r = 0; r < writer->rows; r++)
+		if (!r || _cmp_dict_ent(&ents[r - 1], &ents[r]))
+			packstr(ents[r].val, buffer);
+	for (uint32_t r = 0; r < writer->rows; r++)
+		_pack_inx(inx[r], dict_cnt, buffer);
+
+	xfree(ents);
+	xfree(inx);
+}
+
+/*
+ * Pack the encoded columns of a block, compressed with the best codec this
+ * build has. They are stored as is if there is none or it doesn't help.
+ */
+static void _pack_columns(buf_t *cols, buf_t *buffer)
+{
+	uint32_t size = get_buf_offset(cols);
+	uint8_t compress = BLOCK_COMPRESS_NONE;
+	char *data = NULL;
+	size_t data_size = 0;
+
+#if HAVE_ZSTD
+	data_size = ZSTD_compressBound(size);
+	data = xmalloc(data_size);
+	data_size = ZSTD_compress(data, data_size, get_buf_data(cols), size,
+				  ZSTD_CLEVEL_DEFAULT);
+	if (ZSTD_isError(data_size))
+		data_size = 0;
+	compress = BLOCK_COMPRESS_ZSTD;
+#elif HAVE_LZ4
+	data_size = LZ4_compressBound(size);
+	data = xmalloc(data_size);
+	data_size = LZ4_compress_default(get_buf_data(cols), data, size,
+					 data_size);
+	compress = BLOCK_COMPRESS_LZ4;
+#endif
+
+	if (!data_size || (data_size >= size))
+		compress = BLOCK_COMPRESS_NONE;
+
+	pack8(compress, buffer);
+	pack32(size, buffer);
+	if (compress == BLOCK_COMPRESS_NONE)
+		packmem(get_buf_data(cols), size, buffer);
+	else
+		packmem(data, data_size, buffer);
+	xfree(data);
+}
+
+static void _flush_block(slurmdb_archive_writer_t *writer)
+{
+	buf_t *cols;
+	time_t start_min = 0, start_max = 0, end_min = 0, end_max = 0;
+	uint32_t *uids = NULL, uid_cnt = 0, size_offset, end_offset;
+
+	if (!writer->rows)
+		return;
+
+	for (uint32_t r = 0; r < writer->rows; r++) {
+		char **row = &writer->cells[r * writer->col_cnt];
+		time_t start, end;
+
+		if (writer->start_col >= 0) {
+			start = _atoul(row[writer->start_col]);
+			if (!r || (start < start_min))
+				start_min = start;
+			if (!r || (start > start_max))
+				start_max = start;
+		}
+		if (writer->end_col >= 0) {
+			if (!(end = _atoul(row[writer->end_col])))
+				end = INFINITE;
+			if (!r || (end < end_min))
+				end_min = end;
+			if (!r || (end > end_max))
+				end_max = end;
+		}
+		if ((writer->uid_col >= 0) && row[writer->uid_col]) {
+			if (!uids)
+				uids = xcalloc(writer->rows, sizeof(*uids));
+			uids[uid_cnt++] = slurm_atoul(row[writer->uid_col]);
+		}
+	}
+
+	if (uid_cnt) {
+		uint32_t distinct = 1;
+
+		qsort(uids, uid_cnt, sizeof(*uids), _cmp_uint32);
+		for (uint32_t i = 1; i < uid_cnt; i++)
+			if (uids[i] != uids[distinct - 1])
+				uids[distinct++] = uids[i];
+		uid_cnt = distinct;
+	}
+
+	pack32(writer->rows, writer->buffer);
+	size_offset = get_buf_offset(writer->buffer);
+	pack32(0, writer->buffer);
+
+	pack_time(start_min, writer->buffer);
+	pack_time(start_max, writer->buffer);
+	pack_time(end_min, writer->buffer);
+	pack_time(end_max, writer->buffer);
+	pack32_array(uids, uid_cnt, writer->buffer);
+
+	cols = init_buf(BUF_SIZE);
+	for (uint32_t c = 0; c < writer->col_cnt; c++)
+		_pack_column(writer, c, cols);
+	_pack_columns(cols, writer->buffer);
+	FREE_NULL_BUFFER(cols);
+
+	/* Patch in the size so readers can skip the block */
+	end_offset = get_buf_offset(writer->buffer);
+	set_buf_offset(writer->buffer, size_offset);
+	pack32(end_offset - size_offset - sizeof(uint32_t), writer->buffer);
+	set_buf_offset(writer->buffer, end_offset);
+
+	for (uint32_t i = 0; i < (writer->rows * writer->col_cnt); i++)
+		xfree(writer->cells[i]);
+	writer->rows = 0;
+	xfree(uids);
+}
+
+extern slurmdb_archive_writer_t *slurmdb_archive_writer_init(
+	buf_t *buffer, uint32_t rec_cnt, char **col_names, uint32_t col_cnt,
+	int start_col, int end_col, int uid_col)
+{
+	slurmdb_archive_writer_t *writer = xmalloc(sizeof(*writer));
+
+	writer->buffer = buffer;
+	writer->col_cnt = col_cnt;
+	writer->start_col = start_col;
+	writer->end_col = end_col;
+	writer->uid_col = uid_col;
+	writer->cells = xcalloc(SLURMDB_ARCHIVE_BLOCK_ROWS * col_cnt,
+				sizeof(char *));
+
+	pack32(SLURMDB_ARCHIVE_COLUMNAR, buffer);
+	pack32(rec_cnt, buffer);
+	pack32(col_cnt, buffer);
+	for (uint32_t c = 0; c < col_cnt; c++) {
+		char *name = xstrdup(col_names[c]);
+
+		xstrsubstituteall(name, "`", "");
+		packstr(name, buffer);
+		xfree(name);
+	}
+
+	return writer;
+}
+
+extern void slurmdb_archive_writer_add(slurmdb_archive_writer_t *writer,
+				       char **row)
+{
+	char **cells = &writer->cells[writer->rows * writer->col_cnt];
+
+	for (uint32_t c = 0; c < writer->col_cnt; c++)
+		cells[c] = xstrdup(row[c]);
+
+	if (++writer->rows == SLURMDB_ARCHIVE_BLOCK_ROWS)
+		_flush_block(writer);
+}
+
+extern void slurmdb_archive_writer_fini(slurmdb_archive_writer_t *writer)
+{
+	if (!writer)
+		return;
+
+	_flush_block(writer);
+	pack32(0, writer->buffer);
+
+	xfree(writer->cells);
+	xfree(writer);
+}
+
+extern int slurmdb_archive_unpack_header(buf_t *buffer, uint32_t *rec_cnt,
+					 char ***col_names, uint32_t *col_cnt)
+{
+	*col_names = NULL;
+	*col_cnt = 0;
+
+	safe_unpack32(rec_cnt, buffer);
+	safe_unpackstr_array(col_names, col_cnt, buffer);
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	error("%s: invalid columnar archive header", __func__);
+	return SLURM_ERROR;
+}
+
+static int _unpack_column(slurmdb_archive_block_t *block, uint32_t col,
+			  buf_t *buffer)
+{
+	char **dict = NULL;
+	uint32_t dict_cnt = 0, inx;
+	int rc = SLURM_ERROR;
+
+	safe_unpack32(&dict_cnt, buffer);
+	if (dict_cnt > block->rows)
+		goto unpack_error;
+
+	dict = xcalloc(dict_cnt, sizeof(char *));
+	for (uint32_t i = 0; i < dict_cnt; i++)
+		safe_unpackstr(&dict[i], buffer);
+
+	block->cols[col] = xcalloc(block->rows, sizeof(char *));
+	for (uint32_t r = 0; r < block->rows; r++) {
+		if (dict_cnt <= 0xff) {
+			uint8_t inx8;
+			safe_unpack8(&inx8, buffer);
+			inx = inx8;
+		} else if (dict_cnt <= 0xffff) {
+			uint16_t inx16;
+			safe_unpack16(&inx16, buffer);
+			inx = inx16;
+		} else {
+			safe_unpack32(&inx, buffer);
+		}
+
+		if (inx >= dict_cnt)
+			goto unpack_error;
+		block->cols[col][r] = xstrdup(dict[inx]);
+	}
+	rc = SLURM_SUCCESS;
+
+unpack_error:
+	for (uint32_t i = 0; dict && (i < dict_cnt); i++)
+		xfree(dict[i]);
+	xfree(dict);
+	return rc;
+}
+
+/*
+ * Unpack the columns of a block, decompressed if needed.
+ * RET buffer holding the encoded columns or NULL on error
+ */
+static buf_t *_unpack_columns(buf_t *buffer)
+{
+	uint8_t compress;
+	uint32_t size, data_size;
+	char *data, *cols;
+
+	safe_unpack8(&compress, buffer);
+	safe_unpack32(&size, buffer);
+	safe_unpackmem_ptr(&data, &data_size, buffer);
+	if (size > MAX_BUF_SIZE)
+		goto unpack_error;
+
+	switch (compress) {
+	case BLOCK_COMPRESS_NONE:
+		if (data_size != size)
+			goto unpack_error;
+		cols = xmalloc(size);
+		memcpy(cols, data, size);
+		return create_buf(cols, size);
+	case BLOCK_COMPRESS_LZ4:
+#if HAVE_LZ4
+		cols = xmalloc(size);
+		if (LZ4_decompress_safe(data, cols, data_size, size) !=
+		    (int) size) {
+			xfree(cols);
+			goto unpack_error;
+		}
+		return create_buf(cols, size);
+#else
+		error("%s: archive block is compressed with lz4, which this build does not support",
+		      __func__);
+		return NULL;
+#endif
+	case BLOCK_COMPRESS_ZSTD:
+#if HAVE_ZSTD
+		cols = xmalloc(size);
+		if (ZSTD_decompress(cols, size, data, data_size) != size) {
+			xfree(cols);
+			goto unpack_error;
+		}
+		return create_buf(cols, size);
+#else
+		error("%s: archive block is compressed with zstd, which this build does not support",
+		      __func__);
+		return NULL;
+#endif
+	}
+
+unpack_error:
+	return NULL;
+}
+
+extern int slurmdb_archive_unpack_block(
+	buf_t *buffer, uint32_t col_cnt, slurmdb_archive_block_t **block,
+	bool (*want)(slurmdb_archive_block_t *block, void *arg), void *arg)
+{
+	slurmdb_archive_block_t *object = NULL;
+	buf_t *cols = NULL;
+	uint32_t rows, size, end_offset;
+
+	*block = NULL;
+
+	while (true) {
+		safe_unpack32(&rows, buffer);
+		if (!rows)
+			return SLURM_SUCCESS;
+
+		safe_unpack32(&size, buffer);
+		if ((rows > SLURMDB_ARCHIVE_BLOCK_ROWS) ||
+		    (size > remaining_buf(buffer)))
+			goto unpack_error;
+		end_offset = get_buf_offset(buffer) + size;
+
+		object = xmalloc(sizeof(*object));
+		object->rows = rows;
+		safe_unpack_time(&object->start_min, buffer);
+		safe_unpack_time(&object->start_max, buffer);
+		safe_unpack_time(&object->end_min, buffer);
+		safe_unpack_time(&object->end_max, buffer);
+		safe_unpack32_array(&object->uids, &object->uid_cnt, buffer);
+
+		if (!want || (*want)(object, arg))
+			break;
+
+		slurmdb_archive_free_block(object);
+		object = NULL;
+		set_buf_offset(buffer, end_offset);
+	}
+
+	if (!(cols = _unpack_columns(buffer)))
+		goto unpack_error;
+
+	object->col_cnt = col_cnt;
+	object->cols = xcalloc(col_cnt, sizeof(char **));
+	for (uint32_t c = 0; c < col_cnt; c++)
+		if (_unpack_column(object, c, cols))
+			goto unpack_error;
+
+	if (remaining_buf(cols) || (get_buf_offset(buffer) != end_offset))
+		goto unpack_error;
+	FREE_NULL_BUFFER(cols);
+
+	*block = object;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	error("%s: invalid columnar archive block", __func__);
+	FREE_NULL_BUFFER(cols);
+	slurmdb_archive_free_block(object);
+	return SLURM_ERROR;
+}
+
+extern void slurmdb_archive_free_block(slurmdb_archive_block_t *block)
+{
+	if (!block)
+		return;
+
+	for (uint32_t c = 0; block->cols && (c < block->col_cnt); c++) {
+		for (uint32_t r = 0; block->cols[c] && (r < block->rows); r++)
+			xfree(block->cols[c][r]);
+		xfree(block->cols[c]);
+	}
+	xfree(block->cols);
+	xfree(block->uids);
+	xfree(block);
+}
+
+extern bool slurmdb_archive_block_has_uid(slurmdb_archive_block_t *block,
+					  uint32_t uid)
+{
+	if (!block->uid_cnt)
+		return true;
+
+	return bsearch(&uid, block->uids, block->uid_cnt, sizeof(uint32_t),
+		       _cmp_uint32);
+}
+
+static bool _name_eq(const char *a, const char *b)
+{
+	while (true) {
+		while (*a == '`')
+			a++;
+		while (*b == '`')
+			b++;
+		if (*a != *b)
+			return false;
+		if (!*a)
+			return true;
+		a++;
+		b++;
+	}
+}
+
+extern int slurmdb_archive_col_inx(char **col_names, uint32_t col_cnt,
+				   const char *name)
+{
+	for (uint32_t c = 0; c < col_cnt; c++)
+		if (col_names[c] && _name_eq(col_names[c], name))
+			return c;
+
+	return -1;
+}
@@ -0,0 +1,127 @@
+/****************************************************************************\
+ *  slurmdb_archive.h - columnar layout for slurmdbd archive files
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMDB_ARCHIVE_H
+#define _SLURMDB_ARCHIVE_H
+
+#include "src/common/pack.h"
+
+/*
+ * A columnar archive file starts with the same header as a row archive
+ * (version, time, type, cluster) followed by SLURMDB_ARCHIVE_COLUMNAR in
+ * place of the record count. After that come the real record count, the
+ * column names and a list of blocks terminated by a block of 0 rows.
+ *
+ * Every block carries its byte size and an index (submit/start and end time
+ * range plus the distinct uids) so a reader can skip it without decoding.
+ * Each column of a block is dictionary encoded: the distinct values followed
+ * by one index per row into them. The encoded columns of a block are
+ * compressed with zstd or lz4 when slurm was built with either one.
+ */
+#define SLURMDB_ARCHIVE_COLUMNAR NO_VAL
+#define SLURMDB_ARCHIVE_BLOCK_ROWS 1024
+
+typedef struct {
+	char ***cols;		/* cols[col][row], a cell may be NULL */
+	uint32_t col_cnt;
+	time_t end_max;		/* INFINITE if a row has no end time */
+	time_t end_min;
+	uint32_t rows;
+	time_t start_max;
+	time_t start_min;
+	uint32_t uid_cnt;	/* 0 if the archive type has no uid column */
+	uint32_t *uids;		/* sorted */
+} slurmdb_archive_block_t;
+
+typedef struct slurmdb_archive_writer slurmdb_archive_writer_t;
+
+/*
+ * Start writing columnar records to buffer right after the common archive
+ * header.
+ * IN buffer - buffer the archive header was packed into
+ * IN rec_cnt - total number of rows that will be added
+ * IN col_names - names of the columns of each row
+ * IN col_cnt - number of columns
+ * IN start_col - column holding the start time index, -1 if none
+ * IN end_col - column holding the end time index, -1 if none
+ * IN uid_col - column holding the uid index, -1 if none
+ * RET writer to be passed to slurmdb_archive_writer_fini()
+ */
+extern slurmdb_archive_writer_t *slurmdb_archive_writer_init(
+	buf_t *buffer, uint32_t rec_cnt, char **col_names, uint32_t col_cnt,
+	int start_col, int end_col, int uid_col);
+
+/* Add one row of col_cnt columns, the strings are copied */
+extern void slurmdb_archive_writer_add(slurmdb_archive_writer_t *writer,
+				       char **row);
+
+/* Flush the last block, terminate the archive and free the writer */
+extern void slurmdb_archive_writer_fini(slurmdb_archive_writer_t *writer);
+
+/*
+ * Unpack what follows SLURMDB_ARCHIVE_COLUMNAR in the archive header.
+ * OUT rec_cnt - total number of rows in the archive
+ * OUT col_names - xfree() each and the array
+ * OUT col_cnt - number of columns
+ */
+extern int slurmdb_archive_unpack_header(buf_t *buffer, uint32_t *rec_cnt,
+					 char ***col_names, uint32_t *col_cnt);
+
+/*
+ * Unpack the next block of a columnar archive.
+ * IN want - if set, called with the index of each block (cols not filled
+ *	in); blocks it returns false for are skipped without being decoded.
+ * OUT block - next block or NULL after the last one, free with
+ *	slurmdb_archive_free_block()
+ */
+extern int slurmdb_archive_unpack_block(
+	buf_t *buffer, uint32_t col_cnt, slurmdb_archive_block_t **block,
+	bool (*want)(slurmdb_archive_block_t *block, void *arg), void *arg);
+
+extern void slurmdb_archive_free_block(slurmdb_archive_block_t *block);
+
+/* True if the block index lists uid (or doesn't track uids at all) */
+extern bool slurmdb_archive_block_has_uid(slurmdb_archive_block_t *block,
+					  uint32_t uid);
+
+/*
+ * Find a column by name. Back quotes used to escape reserved words in SQL
+ * (`partition`) are ignored on both sides.
+ * RET index into col_names or -1
+ */
+extern int slurmdb_archive_col_inx(char **col_names, uint32_t col_cnt,
+				   const char *name);
+
+#endif
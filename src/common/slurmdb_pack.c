@@ -4838,6 +4838,16 @@ extern void slurmdb_pack_stats_msg(void *object, uint16_t protocol_version,
 		slurm_pack_list(stats_ptr->user_list,
 				slurmdb_pack_rpc_obj,
 				buffer, protocol_version);
+
+		if (protocol_version >= SLURM_26_05_PROTOCOL_VERSION) {
+			pack32(stats_ptr->mult_msg_cnt, buffer);
+			pack32(stats_ptr->mult_msg_max, buffer);
+			pack64(stats_ptr->mult_msg_recs, buffer);
+			pack64(stats_ptr->mult_msg_time, buffer);
+			pack64(stats_ptr->usage_cache_hits, buffer);
+			pack64(stats_ptr->usage_cache_misses, buffer);
+			pack64(stats_ptr->usage_cache_rows, buffer);
+		}
 	} else {
 		error("%s: protocol_version %hu not supported",
 		      __func__, protocol_version);
@@ -4880,6 +4890,16 @@ extern int slurmdb_unpack_stats_msg(void **object, uint16_t protocol_version,
 				      buffer, protocol_version)
 		    != SLURM_SUCCESS)
 			goto unpack_error;
+
+		if (protocol_version >= SLURM_26_05_PROTOCOL_VERSION) {
+			safe_unpack32(&stats_ptr->mult_msg_cnt, buffer);
+			safe_unpack32(&stats_ptr->mult_msg_max, buffer);
+			safe_unpack64(&stats_ptr->mult_msg_recs, buffer);
+			safe_unpack64(&stats_ptr->mult_msg_time, buffer);
+			safe_unpack64(&stats_ptr->usage_cache_hits, buffer);
+			safe_unpack64(&stats_ptr->usage_cache_misses, buffer);
+			safe_unpack64(&stats_ptr->usage_cache_rows, buffer);
+		}
 	} else {
 		error("%s: protocol_version %hu not supported",
 		      __func__, protocol_version);
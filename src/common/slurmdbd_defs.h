@@ -168,6 +168,8 @@ typedef enum {
 	DBD_GOT_QOS_USAGE,  	/* Response to DBD_GET_QOS_USAGE */
 	DBD_GET_ASSOC_NG_USAGE, /* Get non-grouped assoc usage
 				 * (this is used for sreport user topuser) */
+	DBD_GOT_JOBS_PART,	/* Part of a streamed response to
+				 * DBD_GET_JOBS_COND, more follow	*/
 	SLURM_DBD_MESSAGES_END = 2000, /* So that we don't overlap with any
 					* slurm_msg_type_t numbers. */
 	SLURM_PERSIST_INIT = 6500, /* So we don't use the
@@ -1356,6 +1356,7 @@ extern void slurmdbd_pack_list_msg(dbd_list_msg_t *msg, uint16_t rpc_version,
 		my_function = pack_config_key_pair;
 		break;
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_PART:
 	case DBD_FIX_RUNAWAY_JOB:
 		my_function = slurmdb_pack_job_rec;
 		break;
@@ -1456,6 +1457,7 @@ extern int slurmdbd_unpack_list_msg(dbd_list_msg_t **msg, uint16_t rpc_version,
 		my_destroy = destroy_config_key_pair;
 		break;
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_PART:
 	case DBD_FIX_RUNAWAY_JOB:
 		my_function = slurmdb_unpack_job_rec;
 		my_destroy = slurmdb_destroy_job_rec;
@@ -1573,6 +1575,7 @@ extern buf_t *pack_slurmdbd_msg(persist_msg_t *req, uint16_t rpc_version)
 	case DBD_GOT_EVENTS:
 	case DBD_GOT_FEDERATIONS:
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_PART:
 	case DBD_GOT_LIST:
 	case DBD_GOT_PROBS:
 	case DBD_GOT_RES:
@@ -1781,6 +1784,7 @@ extern int unpack_slurmdbd_msg(persist_msg_t *resp, uint16_t rpc_version,
 	case DBD_GOT_FEDERATIONS:
 	case DBD_GOT_INSTANCES:
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_PART:
 	case DBD_GOT_LIST:
 	case DBD_GOT_PROBS:
 	case DBD_ADD_QOS:
@@ -37,10 +37,11 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include <errno.h>
 #include <signal.h>
 #include <stdio.h>
-#include <errno.h>
 #include <string.h>
+#include <sys/uio.h>
 
 #include "src/common/write_labelled_message.h"
 #include "slurm/slurm_errno.h"
@@ -48,10 +49,16 @@
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
+/*
+ * Lines gathered into a single writev(), each takes up to 3 iovecs which must
+ * stay below IOV_MAX (1024 on Linux)
+ */
+#define WRITE_LINES_MAX 128
+
 static char *_build_label(int task_id, int task_id_width,
 			  uint32_t het_job_offset,
 			  uint32_t het_job_task_offset);
-static int _write_line(int fd, char *prefix, char *suffix, void *buf, int len);
+static int _write_iov(int fd, struct iovec *iov, int iov_cnt);
 
 /*
  * fd             is the file descriptor to write to
@@ -77,9 +84,12 @@ extern int write_labelled_message(int fd, void *buf, int len, int task_id,
 				  uint32_t het_job_task_offset,
 				  bool label, int task_id_width)
 {
-	void *start, *end;
+	struct iovec iov[WRITE_LINES_MAX * 3];
+	char *start, *end;
 	char *prefix = NULL, *suffix = NULL;
-	int remaining = len;
+	int prefix_len = 0;
+	int iov_cnt = 0, lines = 0;
+	int scanned = 0;
 	int written = 0;
 	int line_len;
 	int rc = -1;
@@ -87,34 +97,46 @@ extern int write_labelled_message(int fd, void *buf, int len, int task_id,
 	if (label) {
 		prefix = _build_label(task_id, task_id_width, het_job_offset,
 				      het_job_task_offset);
+		prefix_len = strlen(prefix);
 	}
 
-	while (remaining > 0) {
-		start = buf + written;
-		end = memchr(start, '\n', remaining);
+	/*
+	 * Labels and lines are gathered without copying them and written
+	 * with one writev() per WRITE_LINES_MAX lines, so whole lines are
+	 * never interleaved with output from other hetjob components.
+	 */
+	while (scanned < len) {
+		start = (char *) buf + scanned;
+		end = memchr(start, '\n', len - scanned);
 		if (end == NULL) { /* no newline found */
+			line_len = len - scanned;
 			if (label)
 				suffix = "\n";
-			rc = _write_line(fd, prefix, suffix, start, remaining);
-			if (rc <= 0) {
-				goto done;
-			} else {
-				remaining -= rc;
-				written += rc;
-			}
 		} else {
 			line_len = (int)(end - start) + 1;
-			rc = _write_line(fd, prefix, suffix, start, line_len);
-			if (rc <= 0) {
-				goto done;
-			} else {
-				remaining -= rc;
-				written += rc;
-			}
 		}
 
+		if (prefix) {
+			iov[iov_cnt].iov_base = prefix;
+			iov[iov_cnt++].iov_len = prefix_len;
+		}
+		iov[iov_cnt].iov_base = start;
+		iov[iov_cnt++].iov_len = line_len;
+		if (suffix) {
+			iov[iov_cnt].iov_base = suffix;
+			iov[iov_cnt++].iov_len = 1;
+		}
+		scanned += line_len;
+
+		if ((++lines < WRITE_LINES_MAX) && (scanned < len))
+			continue;
+
+		if ((rc = _write_iov(fd, iov, iov_cnt)) < 0)
+			break;
+		written = scanned;
+		iov_cnt = lines = 0;
 	}
-done:
+
 	xfree(prefix);
 	if (written > 0)
 		return written;
@@ -148,50 +170,36 @@ static char *_build_label(int task_id, int task_id_width,
 
 /*
  * Blocks until write is complete, regardless of the file descriptor being in
- * non-blocking mode.
- * I/O from multiple hetjob components may be present, so add prefix/suffix to
- * buffer before issuing write to avoid interleaved output from multiple
- * components.
+ * non-blocking mode. iov is modified to track partial writes.
+ * RET 0 or -1 on error
  */
-static int _write_line(int fd, char *prefix, char *suffix, void *buf, int len)
+static int _write_iov(int fd, struct iovec *iov, int iov_cnt)
 {
-	int left, n, pre = 0, post = 0;
-	void *ptr, *tmp = NULL;
-
-	if (prefix || suffix) {
-		if (prefix)
-			pre = strlen(prefix);
-		if (suffix)
-			post = strlen(suffix);
-		tmp = xmalloc(pre + len + post);
-		if (prefix)
-			memcpy(tmp, prefix, pre);
-		memcpy(tmp + pre, buf, len);
-		if (suffix)
-			memcpy(tmp + pre + len, suffix, post);
-		ptr = tmp;
-		left = pre + len + post;
-	} else {
-		ptr = buf;
-		left = len;
-	}
+	ssize_t n;
 
-	while (left > 0) {
+	while (iov_cnt > 0) {
 	again:
-		if ((n = write(fd, ptr, left)) < 0) {
+		if ((n = writev(fd, iov, iov_cnt)) < 0) {
 			if (errno == EINTR)
 				goto again;
 			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
-				debug3("  got EAGAIN in _write_line");
+				debug3("  got EAGAIN in _write_iov");
 				goto again;
 			}
-			len = -1;
-			break;
+			return -1;
+		}
+
+		/* skip what has been written */
+		while ((iov_cnt > 0) && (n >= iov->iov_len)) {
+			n -= iov->iov_len;
+			iov++;
+			iov_cnt--;
+		}
+		if (iov_cnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + n;
+			iov->iov_len -= n;
 		}
-		left -= n;
-		ptr += n;
 	}
-	xfree(tmp);
 
-	return len;
+	return 0;
 }
@@ -143,6 +143,24 @@ extern int slurm_curl_request(const char *data, const char *url,
 			      char **response_str, long *response_code,
 			      http_request_method_t request_method,
 			      bool verify_cert, bool use_mtls)
+{
+	return slurm_curl_request_len(data, (data ? strlen(data) : 0), url,
+				      username, password, mtls_ca_path,
+				      mtls_cert_path, mtls_key_path, headers,
+				      timeout, response_str, response_code,
+				      request_method, verify_cert, use_mtls);
+}
+
+extern int slurm_curl_request_len(const char *data, size_t data_len,
+				  const char *url, const char *username,
+				  const char *password,
+				  const char *mtls_ca_path,
+				  const char *mtls_cert_path,
+				  char *mtls_key_path,
+				  struct curl_slist *headers, uint32_t timeout,
+				  char **response_str, long *response_code,
+				  http_request_method_t request_method,
+				  bool verify_cert, bool use_mtls)
 {
 	CURL *c = NULL;
 	CURLcode res;
@@ -198,12 +216,16 @@ extern int slurm_curl_request(const char *data, const char *url,
 	case HTTP_REQUEST_POST:
 		CURL_SETOPT(c, CURLOPT_CUSTOMREQUEST, NULL);
 		CURL_SETOPT(c, CURLOPT_POST, 1);
+		CURL_SETOPT(c, CURLOPT_POSTFIELDSIZE_LARGE,
+			    (curl_off_t) data_len);
 		CURL_SETOPT(c, CURLOPT_POSTFIELDS, data);
 		CURL_SETOPT(c, CURLOPT_HTTPGET, 0);
 		break;
 	case HTTP_REQUEST_PATCH:
 		CURL_SETOPT(c, CURLOPT_CUSTOMREQUEST, "PATCH");
 		CURL_SETOPT(c, CURLOPT_POST, 1);
+		CURL_SETOPT(c, CURLOPT_POSTFIELDSIZE_LARGE,
+			    (curl_off_t) data_len);
 		CURL_SETOPT(c, CURLOPT_POSTFIELDS, data);
 		CURL_SETOPT(c, CURLOPT_HTTPGET, 0);
 		break;
@@ -53,12 +53,16 @@
 #include "src/common/run_command.h"
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/timers.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
 #include "src/slurmdbd/read_config.h"
 
+#define MAX_BATCH_ROWS 1000
+#define MAX_BATCH_SIZE (1024 * 1024) /* well below max_allowed_packet */
 #define MAX_DEADLOCK_ATTEMPTS 10
+#define MAX_STMT_CACHE 64
 #define PW_SCRIPT_MAX_OUTPUT 8192
 #define PW_SCRIPT_TIMEOUT_SECONDS 10
 #define PW_SCRIPT_DEFAULT_REFRESH_SECONDS 300
@@ -72,6 +76,19 @@ typedef struct {
 	bool non_unique;
 } db_key_t;
 
+typedef struct db_stmt {
+	char *query;
+	MYSQL_STMT *stmt;
+	struct db_stmt *prev; /* less recently used */
+	struct db_stmt *next; /* more recently used */
+} db_stmt_t;
+
+struct db_stmt_cache {
+	xhash_t *hash; /* db_stmt_t keyed by query */
+	db_stmt_t *head; /* least recently used */
+	db_stmt_t *tail; /* most recently used */
+};
+
 static void _check_storage_pass_script_permissions(mysql_db_info_t *db_info)
 {
 	struct stat statbuf;
@@ -366,6 +383,45 @@ end_it:
 	return rc;
 }
 
+/* NOTE: Ensure that mysql_conn->lock is set on function entry */
+static void _discard_batch(mysql_conn_t *mysql_conn)
+{
+	xfree(mysql_conn->batch_head);
+	xfree(mysql_conn->batch_query);
+	xfree(mysql_conn->batch_tail);
+	mysql_conn->batch_rows = 0;
+}
+
+/*
+ * Send the rows queued by mysql_db_insert_batch() so anything run after this
+ * sees them.
+ * NOTE: Ensure that mysql_conn->lock is set on function entry
+ */
+static int _flush_batch(mysql_conn_t *mysql_conn)
+{
+	int rc;
+
+	if (!mysql_conn->batch_rows)
+		return SLURM_SUCCESS;
+
+	if (mysql_conn->batch_tail)
+		xstrfmtcat(mysql_conn->batch_query, " %s",
+			   mysql_conn->batch_tail);
+
+	log_flag(DB_QUERY, "%d(%s:%d) sending %u batched rows",
+		 mysql_conn->conn, THIS_FILE, __LINE__, mysql_conn->batch_rows);
+
+	if ((rc = _mysql_query_internal(mysql_conn->db_conn,
+					mysql_conn->batch_query))) {
+		error("%s: lost %u batched rows", __func__,
+		      mysql_conn->batch_rows);
+		mysql_conn->batch_failed = true;
+	}
+	_discard_batch(mysql_conn);
+
+	return rc;
+}
+
 /*
  * Determine if a database server upgrade has taken place and if so, check to
  * see if the candidate table alteration query should be used to alter the table
@@ -951,6 +1007,57 @@ static int _create_db(char *db_name, mysql_db_info_t *db_info)
 	return rc;
 }
 
+static void _destroy_db_stmt(void *arg)
+{
+	db_stmt_t *db_stmt = arg;
+
+	if (db_stmt->stmt)
+		mysql_stmt_close(db_stmt->stmt);
+	xfree(db_stmt->query);
+	xfree(db_stmt);
+}
+
+static void _db_stmt_id(void *item, const char **key, uint32_t *key_len)
+{
+	db_stmt_t *db_stmt = item;
+
+	*key = db_stmt->query;
+	*key_len = strlen(db_stmt->query);
+}
+
+static void _free_stmt_cache(db_stmt_cache_t **cache)
+{
+	if (!*cache)
+		return;
+	xhash_free_ptr(&(*cache)->hash);
+	xfree(*cache);
+}
+
+/* NOTE: Ensure that mysql_conn->lock is set on function entry */
+static void _swap_replica(mysql_conn_t *mysql_conn)
+{
+	MYSQL *db_conn = mysql_conn->db_conn;
+	db_stmt_cache_t *stmt_cache = mysql_conn->stmt_cache;
+
+	mysql_conn->db_conn = mysql_conn->replica_conn;
+	mysql_conn->stmt_cache = mysql_conn->replica_stmt_cache;
+	mysql_conn->replica_conn = db_conn;
+	mysql_conn->replica_stmt_cache = stmt_cache;
+	mysql_conn->on_replica = !mysql_conn->on_replica;
+}
+
+/* NOTE: Ensure that mysql_conn->lock is set on function entry */
+static void _close_replica(mysql_conn_t *mysql_conn)
+{
+	xassert(!mysql_conn->on_replica);
+
+	_free_stmt_cache(&mysql_conn->replica_stmt_cache);
+	if (mysql_conn->replica_conn) {
+		mysql_close(mysql_conn->replica_conn);
+		mysql_conn->replica_conn = NULL;
+	}
+}
+
 extern mysql_conn_t *create_mysql_conn(int conn_num, bool rollback,
 				       char *cluster_name)
 {
@@ -970,7 +1077,13 @@ extern mysql_conn_t *create_mysql_conn(int conn_num, bool rollback,
 extern int destroy_mysql_conn(mysql_conn_t *mysql_conn)
 {
 	if (mysql_conn) {
+		mysql_db_use_replica(mysql_conn, false);
+		slurm_mutex_lock(&mysql_conn->lock);
+		_close_replica(mysql_conn);
+		slurm_mutex_unlock(&mysql_conn->lock);
 		mysql_db_close_db_connection(mysql_conn);
+		_discard_batch(mysql_conn);
+		_free_stmt_cache(&mysql_conn->stmt_cache);
 		xfree(mysql_conn->pre_commit_query);
 		xfree(mysql_conn->cluster_name);
 		slurm_mutex_destroy(&mysql_conn->lock);
@@ -1025,6 +1138,15 @@ extern mysql_db_info_t *create_mysql_db_info(slurm_mysql_plugin_type_t type)
 			xstrdup(slurm_conf.job_comp_pass_script);
 		db_info->params = xstrdup(slurm_conf.accounting_storage_params);
 		break;
+	case SLURM_MYSQL_PLUGIN_AS_REPLICA:
+		db_info->port = slurmdbd_conf->storage_replica_port;
+		db_info->host = xstrdup(slurmdbd_conf->storage_replica_host);
+		db_info->user = xstrdup(slurmdbd_conf->storage_user);
+		db_info->pass = xstrdup(slurm_conf.accounting_storage_pass);
+		db_info->pass_script =
+			xstrdup(slurmdbd_conf->storage_pass_script);
+		db_info->params = xstrdup(slurm_conf.accounting_storage_params);
+		break;
 	default:
 		xfree(db_info);
 		fatal("Unknown mysql_db_info %d", type);
@@ -1147,7 +1269,14 @@ extern int mysql_db_get_db_connection(mysql_conn_t *mysql_conn, char *db_name,
 extern int mysql_db_close_db_connection(mysql_conn_t *mysql_conn)
 {
 	slurm_mutex_lock(&mysql_conn->lock);
+	if (mysql_conn->on_replica) {
+		/* The replica went away, whatever runs next uses the primary */
+		_swap_replica(mysql_conn);
+		_close_replica(mysql_conn);
+	}
 	if (mysql_conn && mysql_conn->db_conn) {
+		/* Statements belong to the connection being closed */
+		_free_stmt_cache(&mysql_conn->stmt_cache);
 		if (mysql_thread_safe())
 			mysql_thread_end();
 		mysql_close(mysql_conn->db_conn);
@@ -1157,6 +1286,91 @@ extern int mysql_db_close_db_connection(mysql_conn_t *mysql_conn)
 	return SLURM_SUCCESS;
 }
 
+extern int mysql_db_get_replica_connection(mysql_conn_t *mysql_conn,
+					   char *db_name,
+					   mysql_db_info_t *db_info)
+{
+	int rc = SLURM_SUCCESS;
+	char *pass = NULL;
+	unsigned int my_timeout = 30;
+
+	xassert(mysql_conn);
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	xassert(!mysql_conn->on_replica);
+	if (mysql_conn->replica_conn)
+		goto end_it;
+
+	if (!(mysql_conn->replica_conn = mysql_init(NULL))) {
+		slurm_mutex_unlock(&mysql_conn->lock);
+		fatal("mysql_init failed");
+	}
+	mysql_options(mysql_conn->replica_conn, MYSQL_OPT_CONNECT_TIMEOUT,
+		      (char *)&my_timeout);
+	_set_mysql_ssl_opts(mysql_conn->replica_conn, db_info->params);
+
+	debug2("Attempting to connect to replica %s:%d", db_info->host,
+	       db_info->port);
+	pass = _current_password(db_info);
+	if (!mysql_real_connect(mysql_conn->replica_conn, db_info->host,
+				db_info->user, pass, db_name, db_info->port,
+				NULL, CLIENT_MULTI_STATEMENTS)) {
+		error("mysql_real_connect failed for replica %s: %d %s",
+		      db_info->host, mysql_errno(mysql_conn->replica_conn),
+		      mysql_error(mysql_conn->replica_conn));
+		_invalidate_db_token(db_info);
+		rc = ESLURM_DB_CONNECTION;
+	} else if (_mysql_query_internal(mysql_conn->replica_conn,
+					 "SET session sql_mode='ANSI_QUOTES,"
+					 "NO_ENGINE_SUBSTITUTION';"
+					 "SET session transaction read only;")) {
+		rc = ESLURM_DB_CONNECTION;
+	}
+
+	if (rc != SLURM_SUCCESS)
+		_close_replica(mysql_conn);
+end_it:
+	slurm_mutex_unlock(&mysql_conn->lock);
+	xfree(pass);
+	return rc;
+}
+
+extern int mysql_db_use_replica(mysql_conn_t *mysql_conn, bool use)
+{
+	int rc = SLURM_SUCCESS;
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (mysql_conn->on_replica == use)
+		goto end_it;
+
+	if (!use) {
+		_swap_replica(mysql_conn);
+		goto end_it;
+	}
+
+	if (!mysql_conn->replica_conn) {
+		rc = SLURM_ERROR;
+		goto end_it;
+	}
+
+	_clear_results(mysql_conn->replica_conn);
+	if (mysql_ping(mysql_conn->replica_conn)) {
+		error("%s: lost the replica connection: %d %s", __func__,
+		      mysql_errno(mysql_conn->replica_conn),
+		      mysql_error(mysql_conn->replica_conn));
+		_close_replica(mysql_conn);
+		rc = SLURM_ERROR;
+		goto end_it;
+	}
+
+	if (mysql_conn->db_conn)
+		_flush_batch(mysql_conn);
+	_swap_replica(mysql_conn);
+end_it:
+	slurm_mutex_unlock(&mysql_conn->lock);
+	return rc;
+}
+
 extern int mysql_db_cleanup(void)
 {
 	debug3("starting mysql cleaning up");
@@ -1179,6 +1393,7 @@ extern int mysql_db_query(mysql_conn_t *mysql_conn, char *query)
 		return 0;	/* For CLANG false positive */
 	}
 	slurm_mutex_lock(&mysql_conn->lock);
+	_flush_batch(mysql_conn);
 	rc = _mysql_query_internal(mysql_conn->db_conn, query);
 	slurm_mutex_unlock(&mysql_conn->lock);
 	return rc;
@@ -1197,6 +1412,7 @@ extern int mysql_db_delete_affected_rows(mysql_conn_t *mysql_conn, char *query)
 		return 0;	/* For CLANG false positive */
 	}
 	slurm_mutex_lock(&mysql_conn->lock);
+	_flush_batch(mysql_conn);
 	if (!(rc = _mysql_query_internal(mysql_conn->db_conn, query)))
 		rc = mysql_affected_rows(mysql_conn->db_conn);
 	slurm_mutex_unlock(&mysql_conn->lock);
@@ -1232,6 +1448,7 @@ extern int mysql_db_commit(mysql_conn_t *mysql_conn)
 		return SLURM_ERROR;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	_flush_batch(mysql_conn);
 	/* clear out the old results so we don't get a 2014 error */
 	_clear_results(mysql_conn->db_conn);
 	if (mysql_commit(mysql_conn->db_conn)) {
@@ -1253,6 +1470,8 @@ extern int mysql_db_rollback(mysql_conn_t *mysql_conn)
 		return SLURM_ERROR;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	_discard_batch(mysql_conn);
+	mysql_conn->batch_failed = false;
 	/* clear out the old results so we don't get a 2014 error */
 	_clear_results(mysql_conn->db_conn);
 	if (mysql_rollback(mysql_conn->db_conn)) {
@@ -1279,6 +1498,7 @@ extern MYSQL_RES *mysql_db_query_ret(mysql_conn_t *mysql_conn,
 	MYSQL_RES *result = NULL;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	_flush_batch(mysql_conn);
 	if (_mysql_query_internal(mysql_conn->db_conn, query) != SLURM_ERROR)  {
 		if (mysql_errno(mysql_conn->db_conn) == ER_NO_SUCH_TABLE)
 			goto fini;
@@ -1308,6 +1528,7 @@ extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query)
 	int rc = SLURM_SUCCESS;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	_flush_batch(mysql_conn);
 	if ((rc = _mysql_query_internal(
 		     mysql_conn->db_conn, query)) != SLURM_ERROR)
 		rc = _clear_results(mysql_conn->db_conn);
@@ -1320,6 +1541,7 @@ extern uint64_t mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query)
 	uint64_t new_id = 0;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	_flush_batch(mysql_conn);
 	if (_mysql_query_internal(mysql_conn->db_conn, query) != SLURM_ERROR)  {
 		new_id = mysql_insert_id(mysql_conn->db_conn);
 		if (!new_id) {
@@ -1333,6 +1555,419 @@ extern uint64_t mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query)
 
 }
 
+extern int mysql_db_insert_batch(mysql_conn_t *mysql_conn, const char *head,
+				 const char *row, const char *tail)
+{
+	int rc = SLURM_SUCCESS;
+
+	if (!mysql_conn || !mysql_conn->db_conn) {
+		fatal("You haven't inited this storage yet.");
+		return 0;	/* For CLANG false positive */
+	}
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (mysql_conn->batch_rows &&
+	    (xstrcmp(mysql_conn->batch_head, head) ||
+	     xstrcmp(mysql_conn->batch_tail, tail)))
+		_flush_batch(mysql_conn);
+
+	if (!(mysql_conn->flags & DB_CONN_FLAG_ROLLBACK)) {
+		char *query = xstrdup_printf("%s%s%s%s", head, row,
+					     tail ? " " : "", tail ? tail : "");
+		rc = _mysql_query_internal(mysql_conn->db_conn, query);
+		xfree(query);
+		slurm_mutex_unlock(&mysql_conn->lock);
+		return rc;
+	}
+
+	if (!mysql_conn->batch_rows) {
+		mysql_conn->batch_head = xstrdup(head);
+		mysql_conn->batch_tail = xstrdup(tail);
+		mysql_conn->batch_query = xstrdup(head);
+	} else {
+		xstrcatchar(mysql_conn->batch_query, ',');
+	}
+	xstrcat(mysql_conn->batch_query, row);
+	mysql_conn->batch_rows++;
+
+	if ((mysql_conn->batch_rows >= MAX_BATCH_ROWS) ||
+	    (strlen(mysql_conn->batch_query) >= MAX_BATCH_SIZE))
+		rc = _flush_batch(mysql_conn);
+	slurm_mutex_unlock(&mysql_conn->lock);
+
+	return rc;
+}
+
+static void _stmt_lru_unlink(db_stmt_cache_t *cache, db_stmt_t *db_stmt)
+{
+	if (db_stmt->prev)
+		db_stmt->prev->next = db_stmt->next;
+	else
+		cache->head = db_stmt->next;
+	if (db_stmt->next)
+		db_stmt->next->prev = db_stmt->prev;
+	else
+		cache->tail = db_stmt->prev;
+	db_stmt->prev = db_stmt->next = NULL;
+}
+
+static void _stmt_lru_append(db_stmt_cache_t *cache, db_stmt_t *db_stmt)
+{
+	db_stmt->prev = cache->tail;
+	db_stmt->next = NULL;
+	if (cache->tail)
+		cache->tail->next = db_stmt;
+	else
+		cache->head = db_stmt;
+	cache->tail = db_stmt;
+}
+
+/* Unlink db_stmt from the cache and close it */
+static void _stmt_cache_remove(db_stmt_cache_t *cache, db_stmt_t *db_stmt)
+{
+	_stmt_lru_unlink(cache, db_stmt);
+	xhash_delete_str(cache->hash, db_stmt->query);
+}
+
+/*
+ * Find the prepared statement for query, preparing it on a miss.
+ * NOTE: Ensure that mysql_conn->lock is set on function entry
+ */
+static db_stmt_t *_get_stmt(mysql_conn_t *mysql_conn, const char *query)
+{
+	db_stmt_cache_t *cache;
+	db_stmt_t *db_stmt;
+
+	if (!(cache = mysql_conn->stmt_cache)) {
+		cache = mysql_conn->stmt_cache = xmalloc(sizeof(*cache));
+		cache->hash = xhash_init(_db_stmt_id, _destroy_db_stmt);
+	}
+
+	if ((db_stmt = xhash_get_str(cache->hash, query))) {
+		_stmt_lru_unlink(cache, db_stmt);
+		_stmt_lru_append(cache, db_stmt);
+		return db_stmt;
+	}
+
+	db_stmt = xmalloc(sizeof(*db_stmt));
+	db_stmt->query = xstrdup(query);
+	if (!(db_stmt->stmt = mysql_stmt_init(mysql_conn->db_conn))) {
+		error("%s: mysql_stmt_init failed: %d %s", __func__,
+		      mysql_errno(mysql_conn->db_conn),
+		      mysql_error(mysql_conn->db_conn));
+		_destroy_db_stmt(db_stmt);
+		return NULL;
+	}
+	if (mysql_stmt_prepare(db_stmt->stmt, query, strlen(query))) {
+		error("%s: mysql_stmt_prepare failed: %d %s\n%s", __func__,
+		      mysql_stmt_errno(db_stmt->stmt),
+		      mysql_stmt_error(db_stmt->stmt), query);
+		_destroy_db_stmt(db_stmt);
+		return NULL;
+	}
+
+	if (xhash_count(cache->hash) >= MAX_STMT_CACHE)
+		_stmt_cache_remove(cache, cache->head);
+	xhash_add(cache->hash, db_stmt);
+	_stmt_lru_append(cache, db_stmt);
+
+	return db_stmt;
+}
+
+/*
+ * Bind params and execute query as a prepared statement.
+ * NOTE: Ensure that mysql_conn->lock is set on function entry
+ */
+static MYSQL_STMT *_stmt_execute(mysql_conn_t *mysql_conn, const char *query,
+				 db_param_t *params, int param_cnt)
+{
+	db_stmt_t *db_stmt;
+	MYSQL_STMT *stmt;
+	MYSQL_BIND *bind;
+	int deadlock_attempt = 0;
+
+	if (!mysql_conn->db_conn)
+		fatal("You haven't inited this storage yet.");
+
+	_flush_batch(mysql_conn);
+	/* clear out the old results so we don't get a 2014 error */
+	_clear_results(mysql_conn->db_conn);
+
+	if (!(db_stmt = _get_stmt(mysql_conn, query)))
+		return NULL;
+	stmt = db_stmt->stmt;
+
+	xassert(mysql_stmt_param_count(stmt) == (unsigned long) param_cnt);
+
+	bind = xcalloc(param_cnt, sizeof(*bind));
+	for (int i = 0; i < param_cnt; i++) {
+		switch (params[i].type) {
+		case DB_PARAM_TYPE_NULL:
+			bind[i].buffer_type = MYSQL_TYPE_NULL;
+			break;
+		case DB_PARAM_TYPE_INT:
+		case DB_PARAM_TYPE_UINT:
+			bind[i].buffer_type = MYSQL_TYPE_LONGLONG;
+			bind[i].buffer = &params[i].num;
+			bind[i].is_unsigned =
+				(params[i].type == DB_PARAM_TYPE_UINT);
+			break;
+		case DB_PARAM_TYPE_STR:
+			bind[i].buffer_type = MYSQL_TYPE_STRING;
+			bind[i].buffer = (void *) (params[i].str ?
+						   params[i].str : "");
+			bind[i].buffer_length = strlen(bind[i].buffer);
+			break;
+		}
+	}
+
+	if (mysql_stmt_bind_param(stmt, bind))
+		goto fail;
+try_again:
+	if (mysql_stmt_execute(stmt)) {
+		if ((mysql_stmt_errno(stmt) == ER_LOCK_DEADLOCK) &&
+		    (++deadlock_attempt < MAX_DEADLOCK_ATTEMPTS)) {
+			error("%s: deadlock detected attempt %u/%u: %d %s",
+			      __func__, deadlock_attempt,
+			      MAX_DEADLOCK_ATTEMPTS, mysql_stmt_errno(stmt),
+			      mysql_stmt_error(stmt));
+			goto try_again;
+		}
+		goto fail;
+	}
+	xfree(bind);
+	/*
+	 * Starting in MariaDB 10.2 many of the api commands started
+	 * setting errno erroneously.
+	 */
+	errno = 0;
+	return stmt;
+
+fail:
+	errno = mysql_stmt_errno(stmt);
+	error("%s: mysql_stmt_execute failed: %d %s\n%s", __func__,
+	      mysql_stmt_errno(stmt), mysql_stmt_error(stmt), query);
+	xfree(bind);
+	/* The statement may be unusable now, prepare it again next time */
+	_stmt_cache_remove(mysql_conn->stmt_cache, db_stmt);
+	return NULL;
+}
+
+extern char *mysql_db_stmt_str(const char *query, db_param_t *params,
+			       int param_cnt)
+{
+	char *str = NULL, *pos = NULL;
+	const char *start = query, *mark;
+	int i = 0;
+
+	while ((mark = strchr(start, '?'))) {
+		xstrncatat(str, &pos, start, mark - start);
+		if (i >= param_cnt) {
+			xstrcatat(str, &pos, "?");
+		} else if (params[i].type == DB_PARAM_TYPE_NULL) {
+			xstrcatat(str, &pos, "NULL");
+		} else if (params[i].type == DB_PARAM_TYPE_INT) {
+			xstrfmtcatat(str, &pos, "%"PRId64,
+				     (int64_t) params[i].num);
+		} else if (params[i].type == DB_PARAM_TYPE_UINT) {
+			xstrfmtcatat(str, &pos, "%"PRIu64, params[i].num);
+		} else {
+			xstrfmtcatat(str, &pos, "'%s'",
+				     params[i].str ? params[i].str : "");
+		}
+		i++;
+		start = mark + 1;
+	}
+	xstrcatat(str, &pos, start);
+
+	return str;
+}
+
+extern int mysql_db_stmt_query(mysql_conn_t *mysql_conn, const char *query,
+			       db_param_t *params, int param_cnt,
+			       uint64_t *affected_rows)
+{
+	MYSQL_STMT *stmt;
+	int rc = SLURM_SUCCESS;
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (!(stmt = _stmt_execute(mysql_conn, query, params, param_cnt)))
+		rc = SLURM_ERROR;
+	else if (affected_rows)
+		*affected_rows = mysql_stmt_affected_rows(stmt);
+	slurm_mutex_unlock(&mysql_conn->lock);
+
+	return rc;
+}
+
+extern uint64_t mysql_db_stmt_insert_ret_id(mysql_conn_t *mysql_conn,
+					    const char *query,
+					    db_param_t *params, int param_cnt,
+					    uint64_t *affected_rows)
+{
+	MYSQL_STMT *stmt;
+	uint64_t new_id = 0;
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if ((stmt = _stmt_execute(mysql_conn, query, params, param_cnt))) {
+		if (affected_rows)
+			*affected_rows = mysql_stmt_affected_rows(stmt);
+		if (!(new_id = mysql_stmt_insert_id(stmt))) {
+			/* should have new id */
+			error("%s: We should have gotten a new id: %s",
+			      __func__, mysql_stmt_error(stmt));
+		}
+	}
+	slurm_mutex_unlock(&mysql_conn->lock);
+
+	return new_id;
+}
+
+extern char *mysql_db_stmt_query_str(mysql_conn_t *mysql_conn,
+				     const char *query,
+				     db_param_t *params, int param_cnt)
+{
+	MYSQL_STMT *stmt;
+	MYSQL_BIND bind = { 0 };
+	unsigned long len = 0;
+	char *value = NULL;
+	int rc;
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (!(stmt = _stmt_execute(mysql_conn, query, params, param_cnt)))
+		goto end_it;
+
+	/* Fetch with no buffer to learn the length, then get the column */
+	bind.buffer_type = MYSQL_TYPE_STRING;
+	bind.length = &len;
+	bind.is_null = &bind.is_null_value;
+	if (mysql_stmt_bind_result(stmt, &bind) ||
+	    mysql_stmt_store_result(stmt)) {
+		error("%s: unable to get result: %d %s", __func__,
+		      mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
+		goto end_it;
+	}
+
+	rc = mysql_stmt_fetch(stmt);
+	if (((rc == 0) || (rc == MYSQL_DATA_TRUNCATED)) &&
+	    !bind.is_null_value) {
+		value = xmalloc(len + 1);
+		bind.buffer = value;
+		bind.buffer_length = len + 1;
+		if (mysql_stmt_fetch_column(stmt, &bind, 0, 0)) {
+			error("%s: unable to fetch column: %d %s", __func__,
+			      mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
+			xfree(value);
+		}
+	}
+	mysql_stmt_free_result(stmt);
+
+end_it:
+	slurm_mutex_unlock(&mysql_conn->lock);
+	return value;
+}
+
+extern db_result_t *mysql_db_stmt_query_result(mysql_conn_t *mysql_conn,
+					       const char *query,
+					       db_param_t *params,
+					       int param_cnt)
+{
+	MYSQL_STMT *stmt;
+	MYSQL_BIND *bind = NULL;
+	unsigned long *len = NULL;
+	db_result_t *result = NULL;
+	int rc;
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (!(stmt = _stmt_execute(mysql_conn, query, params, param_cnt)))
+		goto end_it;
+
+	result = xmalloc(sizeof(*result));
+	result->col_cnt = mysql_stmt_field_count(stmt);
+
+	/*
+	 * Every column is fetched as a string like the text protocol would
+	 * return it. Fetch with no buffers to learn the lengths, then get each
+	 * column into a buffer of the right size.
+	 */
+	bind = xcalloc(result->col_cnt, sizeof(*bind));
+	len = xcalloc(result->col_cnt, sizeof(*len));
+	for (int i = 0; i < result->col_cnt; i++) {
+		bind[i].buffer_type = MYSQL_TYPE_STRING;
+		bind[i].length = &len[i];
+		bind[i].is_null = &bind[i].is_null_value;
+	}
+	if (mysql_stmt_bind_result(stmt, bind) ||
+	    mysql_stmt_store_result(stmt)) {
+		error("%s: unable to get result: %d %s", __func__,
+		      mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
+		mysql_db_free_result(result);
+		result = NULL;
+		goto end_it;
+	}
+
+	result->rows = xcalloc(mysql_stmt_num_rows(stmt), sizeof(char **));
+	while (!(rc = mysql_stmt_fetch(stmt)) ||
+	       (rc == MYSQL_DATA_TRUNCATED)) {
+		char **row = xcalloc(result->col_cnt, sizeof(char *));
+
+		for (int i = 0; i < result->col_cnt; i++) {
+			if (bind[i].is_null_value)
+				continue;
+			row[i] = xmalloc(len[i] + 1);
+			bind[i].buffer = row[i];
+			bind[i].buffer_length = len[i] + 1;
+			if (mysql_stmt_fetch_column(stmt, &bind[i], i, 0))
+				error("%s: unable to fetch column %d: %d %s",
+				      __func__, i, mysql_stmt_errno(stmt),
+				      mysql_stmt_error(stmt));
+			bind[i].buffer = NULL;
+			bind[i].buffer_length = 0;
+		}
+		result->rows[result->row_cnt++] = row;
+	}
+	if (rc != MYSQL_NO_DATA)
+		error("%s: mysql_stmt_fetch failed: %d %s", __func__,
+		      mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
+	mysql_stmt_free_result(stmt);
+
+end_it:
+	slurm_mutex_unlock(&mysql_conn->lock);
+	xfree(bind);
+	xfree(len);
+	return result;
+}
+
+extern void mysql_db_free_result(db_result_t *result)
+{
+	if (!result)
+		return;
+
+	for (uint64_t i = 0; i < result->row_cnt; i++) {
+		for (int j = 0; j < result->col_cnt; j++)
+			xfree(result->rows[i][j]);
+		xfree(result->rows[i]);
+	}
+	xfree(result->rows);
+	xfree(result);
+}
+
+extern int mysql_db_flush_batch(mysql_conn_t *mysql_conn)
+{
+	int rc;
+
+	if (!mysql_conn->db_conn)
+		return SLURM_ERROR;
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	_flush_batch(mysql_conn);
+	rc = mysql_conn->batch_failed ? SLURM_ERROR : SLURM_SUCCESS;
+	mysql_conn->batch_failed = false;
+	slurm_mutex_unlock(&mysql_conn->lock);
+
+	return rc;
+}
+
 extern int mysql_db_create_table(mysql_conn_t *mysql_conn, char *table_name,
 				 storage_field_t *fields, char *ending)
 {
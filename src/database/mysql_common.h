@@ -57,8 +57,41 @@ typedef enum {
 	SLURM_MYSQL_PLUGIN_NOTSET,
 	SLURM_MYSQL_PLUGIN_AS, /* accounting_storage */
 	SLURM_MYSQL_PLUGIN_JC, /* jobcomp */
+	SLURM_MYSQL_PLUGIN_AS_REPLICA, /* accounting_storage read replica */
 } slurm_mysql_plugin_type_t;
 
+typedef enum {
+	DB_PARAM_TYPE_NULL,
+	DB_PARAM_TYPE_INT, /* signed value in num */
+	DB_PARAM_TYPE_UINT, /* unsigned value in num */
+	DB_PARAM_TYPE_STR, /* str, NULL is sent as '' */
+} db_param_type_t;
+
+/* Parameter bound to a '?' of a statement run with mysql_db_stmt_*() */
+typedef struct {
+	db_param_type_t type;
+	uint64_t num;
+	const char *str;
+} db_param_t;
+
+#define DB_PARAM_NULL() ((db_param_t) { .type = DB_PARAM_TYPE_NULL })
+#define DB_PARAM_INT(v) ((db_param_t) { .type = DB_PARAM_TYPE_INT, \
+					.num = (uint64_t) (int64_t) (v) })
+#define DB_PARAM_UINT(v) ((db_param_t) { .type = DB_PARAM_TYPE_UINT, \
+					 .num = (uint64_t) (v) })
+#define DB_PARAM_STR(v) ((db_param_t) { .type = DB_PARAM_TYPE_STR, \
+					.str = (v) })
+
+/* Prepared statements of a connection, least recently used evicted first */
+typedef struct db_stmt_cache db_stmt_cache_t;
+
+/* Rows of a select run with mysql_db_stmt_query_result() */
+typedef struct {
+	int col_cnt;
+	uint64_t row_cnt;
+	char ***rows; /* rows[row][col] as strings, NULL for a NULL value */
+} db_result_t;
+
 typedef struct {
 	char *cluster_name;
 	MYSQL *db_conn;
@@ -69,6 +102,15 @@ typedef struct {
 	int conn;
 	uint64_t wsrep_trx_fragment_size_orig;
 	char *wsrep_trx_fragment_unit_orig;
+	char *batch_head; /* "insert into ... values " of queued rows */
+	char *batch_query; /* multi-row insert being built */
+	uint32_t batch_rows; /* rows queued in batch_query */
+	char *batch_tail; /* clause appended after the queued rows */
+	bool batch_failed; /* a queued insert failed since last flush */
+	db_stmt_cache_t *stmt_cache; /* prepared statements of db_conn */
+	MYSQL *replica_conn; /* swapped with db_conn by mysql_db_use_replica() */
+	db_stmt_cache_t *replica_stmt_cache; /* swapped with stmt_cache */
+	bool on_replica; /* db_conn is the replica connection */
 } mysql_conn_t;
 
 typedef struct {
@@ -98,6 +140,22 @@ extern int destroy_mysql_db_info(mysql_db_info_t *db_info);
 extern int mysql_db_get_db_connection(mysql_conn_t *mysql_conn, char *db_name,
 				   mysql_db_info_t *db_info);
 extern int mysql_db_close_db_connection(mysql_conn_t *mysql_conn);
+
+/*
+ * Open the read replica connection of mysql_conn if it isn't already. The
+ * session is read only and the database is never created on the replica.
+ * RET SLURM_SUCCESS or ESLURM_DB_CONNECTION
+ */
+extern int mysql_db_get_replica_connection(mysql_conn_t *mysql_conn,
+					   char *db_name,
+					   mysql_db_info_t *db_info);
+
+/*
+ * Send the queries run on mysql_conn to its replica connection (use) or back
+ * to the primary. Batched inserts are flushed to the primary first. If the
+ * replica doesn't answer its connection is closed and SLURM_ERROR returned.
+ */
+extern int mysql_db_use_replica(mysql_conn_t *mysql_conn, bool use);
 extern int mysql_db_cleanup(void);
 extern int mysql_db_query(mysql_conn_t *mysql_conn, char *query);
 extern int mysql_db_delete_affected_rows(mysql_conn_t *mysql_conn, char *query);
@@ -111,6 +169,73 @@ extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query);
 
 extern uint64_t mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query);
 
+/*
+ * Run a statement with '?' placeholders through the binary protocol. The
+ * statement is prepared the first time and kept on the connection, so
+ * callers should use a fixed query string per statement.
+ *
+ * IN query - statement with param_cnt '?' placeholders
+ * IN params - values for the placeholders, see DB_PARAM_*()
+ * OUT affected_rows - if not NULL, rows changed by the statement
+ * RET SLURM_SUCCESS or SLURM_ERROR
+ */
+extern int mysql_db_stmt_query(mysql_conn_t *mysql_conn, const char *query,
+			       db_param_t *params, int param_cnt,
+			       uint64_t *affected_rows);
+
+/* Same as mysql_db_stmt_query(), RET the id of the inserted row or 0 */
+extern uint64_t mysql_db_stmt_insert_ret_id(mysql_conn_t *mysql_conn,
+					    const char *query,
+					    db_param_t *params, int param_cnt,
+					    uint64_t *affected_rows);
+
+/*
+ * Same as mysql_db_stmt_query() for a select.
+ * RET xstrdup() of the first column of the first row, NULL if there is no
+ * row, the value is NULL or the statement failed
+ */
+extern char *mysql_db_stmt_query_str(mysql_conn_t *mysql_conn,
+				     const char *query,
+				     db_param_t *params, int param_cnt);
+
+/*
+ * Same as mysql_db_stmt_query() for a select returning any number of rows.
+ * RET the rows, to be freed with mysql_db_free_result(), or NULL on error
+ */
+extern db_result_t *mysql_db_stmt_query_result(mysql_conn_t *mysql_conn,
+					       const char *query,
+					       db_param_t *params,
+					       int param_cnt);
+extern void mysql_db_free_result(db_result_t *result);
+
+/*
+ * RET xstrdup() of query with each '?' replaced by the value of the matching
+ * param, for logging only. Strings are quoted, but not escaped.
+ */
+extern char *mysql_db_stmt_str(const char *query, db_param_t *params,
+			       int param_cnt);
+
+/*
+ * Queue one row of an insert on a connection that is committed explicitly
+ * (DB_CONN_FLAG_ROLLBACK). Consecutive rows with the same head and tail are
+ * sent as a single multi-row statement before anything else runs on the
+ * connection. On connections in autocommit mode the row is inserted now.
+ *
+ * IN head - "insert into ... (cols) values "
+ * IN row - "(val, ...)"
+ * IN tail - clause after the rows, e.g. "on duplicate key update
+ *	     col=VALUES(col)", or NULL
+ * RET SLURM_SUCCESS or error of the statement that was run
+ */
+extern int mysql_db_insert_batch(mysql_conn_t *mysql_conn, const char *head,
+				 const char *row, const char *tail);
+
+/*
+ * Send any rows queued by mysql_db_insert_batch().
+ * RET SLURM_ERROR if a queued insert failed since the last call
+ */
+extern int mysql_db_flush_batch(mysql_conn_t *mysql_conn);
+
 extern int mysql_db_create_table(mysql_conn_t *mysql_conn, char *table_name,
 				 storage_field_t *fields, char *ending);
 extern int mysql_db_get_var_str(mysql_conn_t *mysql_conn,
@@ -201,6 +201,10 @@ typedef struct slurm_acct_storage_ops {
 	int  (*job_suspend)        (void *db_conn, job_record_t *job_ptr);
 	list_t *(*get_jobs_cond)   (void *db_conn, uint32_t uid,
 				    slurmdb_job_cond_t *job_cond);
+	int (*get_jobs_cond_cb)    (void *db_conn, uint32_t uid,
+				    slurmdb_job_cond_t *job_cond,
+				    int (*cb)(list_t *job_list, void *arg),
+				    void *arg);
 	int (*archive_dump)        (void *db_conn,
 				    slurmdb_archive_cond_t *arch_cond);
 	int (*archive_load)        (void *db_conn,
@@ -292,6 +296,7 @@ static const char *syms[] = {
 	"jobacct_storage_p_step_complete",
 	"jobacct_storage_p_suspend",
 	"jobacct_storage_p_get_jobs_cond",
+	"jobacct_storage_p_get_jobs_cond_cb",
 	"jobacct_storage_p_archive",
 	"jobacct_storage_p_archive_load",
 	"acct_storage_p_update_shares_used",
@@ -1262,6 +1267,20 @@ extern list_t *jobacct_storage_g_get_jobs_cond(void *db_conn, uint32_t uid,
 	return ret_list;
 }
 
+extern int jobacct_storage_g_get_jobs_cond_cb(void *db_conn, uint32_t uid,
+					      slurmdb_job_cond_t *job_cond,
+					      int (*cb)(list_t *job_list,
+							void *arg),
+					      void *arg)
+{
+	xassert(plugin_inited != PLUGIN_NOT_INITED);
+
+	if (plugin_inited == PLUGIN_NOOP)
+		return SLURM_SUCCESS;
+
+	return (*(ops.get_jobs_cond_cb))(db_conn, uid, job_cond, cb, arg);
+}
+
 /*
  * expire old info from the storage
  */
@@ -693,6 +693,17 @@ extern int jobacct_storage_g_job_suspend(void *db_conn,
 extern list_t *jobacct_storage_g_get_jobs_cond(void *db_conn, uint32_t uid,
 					       slurmdb_job_cond_t *job_cond);
 
+/*
+ * get info from the storage, handing each part of the jobs to cb as soon as
+ * it is read instead of building one list of every job.
+ * RET SLURM_SUCCESS, an error code or the first non-zero return of cb
+ */
+extern int jobacct_storage_g_get_jobs_cond_cb(void *db_conn, uint32_t uid,
+					      slurmdb_job_cond_t *job_cond,
+					      int (*cb)(list_t *job_list,
+							void *arg),
+					      void *arg);
+
 /*
  * expire old info from the storage
  */
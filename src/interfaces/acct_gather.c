@@ -33,6 +33,8 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#define _GNU_SOURCE
+
 #include <sys/stat.h>
 #include <stdlib.h>
 
@@ -41,8 +43,10 @@
 #include "acct_gather_interconnect.h"
 #include "acct_gather_filesystem.h"
 
+#include "src/common/bitstring.h"
 #include "src/common/pack.h"
 #include "src/common/parse_config.h"
+#include "src/common/xsched.h"
 #include "src/common/xstring.h"
 
 static bool acct_gather_suspended = false;
@@ -50,6 +54,9 @@ static pthread_mutex_t suspended_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t conf_mutex = PTHREAD_MUTEX_INITIALIZER;
 static buf_t *acct_gather_options_buf = NULL;
 static bool inited = 0;
+static bool low_jitter = false;
+static cpu_set_t poll_cpus;
+static int poll_cpus_cnt = 0;
 
 static int _get_int(const char *my_str)
 {
@@ -359,3 +366,66 @@ extern bool acct_gather_suspend_test(void)
 	slurm_mutex_unlock(&suspended_mutex);
 	return rc;
 }
+
+extern void acct_gather_set_low_jitter(const char *mac_cpus)
+{
+	bitstr_t *cpus;
+
+	low_jitter = true;
+	CPU_ZERO(&poll_cpus);
+	poll_cpus_cnt = 0;
+
+	if (!mac_cpus || !mac_cpus[0])
+		return;
+
+	cpus = bit_alloc(CPU_SETSIZE);
+	if (bit_unfmt(cpus, (char *) mac_cpus)) {
+		error("%s: invalid CPU list %s", __func__, mac_cpus);
+	} else {
+		for (int i = 0; i < CPU_SETSIZE; i++) {
+			if (!bit_test(cpus, i))
+				continue;
+			CPU_SET(i, &poll_cpus);
+			poll_cpus_cnt++;
+		}
+	}
+	FREE_NULL_BITMAP(cpus);
+}
+
+extern bool acct_gather_low_jitter(void)
+{
+	return low_jitter;
+}
+
+extern void acct_gather_pin_poll_thread(void)
+{
+	cpu_set_t allowed, mask;
+	int cnt = 0;
+
+	if (!poll_cpus_cnt)
+		return;
+
+	/*
+	 * The step cpuset usually leaves the specialized cores out, only use
+	 * those the stepd may still run on.
+	 */
+	if (slurm_getaffinity(0, sizeof(allowed), &allowed))
+		return;
+
+	CPU_ZERO(&mask);
+	for (int i = 0; i < CPU_SETSIZE; i++) {
+		if (CPU_ISSET(i, &poll_cpus) && CPU_ISSET(i, &allowed)) {
+			CPU_SET(i, &mask);
+			cnt++;
+		}
+	}
+
+	if (!cnt) {
+		debug("%s: specialized cores not usable by this step, polling thread left unpinned",
+		      __func__);
+		return;
+	}
+
+	/* pid 0 is the calling thread */
+	(void) slurm_setaffinity(0, sizeof(mask), &mask);
+}
@@ -64,4 +64,17 @@ extern void acct_gather_suspend_poll(void);
 extern void acct_gather_resume_poll(void);
 extern bool acct_gather_suspend_test(void);
 
+/*
+ * JobAcctGatherParams=LowJitterPoll: run the polling threads on the given
+ * machine CPUs (the CpuSpecList/CoreSpecCount cores of the node) and wake
+ * them on wall clock multiples of the frequency, so that all the steps of a
+ * node sample together instead of each at its own phase.
+ * IN mac_cpus - machine CPU ID list, NULL to only align the wake ups
+ */
+extern void acct_gather_set_low_jitter(const char *mac_cpus);
+extern bool acct_gather_low_jitter(void);
+
+/* Called by each polling thread when it starts */
+extern void acct_gather_pin_poll_thread(void);
+
 #endif
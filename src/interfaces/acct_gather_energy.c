@@ -106,6 +106,7 @@ static void *_watch_node(void *arg)
 		      __func__, "acctg_energy");
 	}
 #endif
+	acct_gather_pin_poll_thread();
 
 	while (init_run && acct_gather_profile_test()) {
 		/* Do this until shutdown is requested */
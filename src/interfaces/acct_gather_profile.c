@@ -147,11 +147,15 @@ static void *_timer_thread(void *args)
 		      __func__, "acctg_prof");
 	}
 #endif
+	acct_gather_pin_poll_thread();
 
 	/* setup timer */
 	gettimeofday(&tvnow, NULL);
 	abs.tv_sec = tvnow.tv_sec;
 	abs.tv_nsec = tvnow.tv_usec * 1000;
+	/* wake up on the second like every other stepd of the node */
+	if (acct_gather_low_jitter())
+		abs.tv_nsec = 0;
 
 	while ((plugin_inited != PLUGIN_NOT_INITED) &&
 	       acct_gather_profile_test()) {
@@ -177,8 +181,20 @@ static void *_timer_thread(void *args)
 			/* info ("%d is %d and %d", i, */
 			/*       acct_gather_profile_timer[i].freq, */
 			/*       diff); */
-			if (!acct_gather_profile_timer[i].freq
-			    || (diff < acct_gather_profile_timer[i].freq))
+			if (!acct_gather_profile_timer[i].freq)
+				continue;
+			if (acct_gather_low_jitter()) {
+				/*
+				 * Notify once per wall clock multiple of freq
+				 * (after the initial poll) so all steps sample
+				 * at the same time.
+				 */
+				if (acct_gather_profile_timer[i].last_notify &&
+				    ((now / acct_gather_profile_timer[i].freq) ==
+				     (acct_gather_profile_timer[i].last_notify /
+				      acct_gather_profile_timer[i].freq)))
+					continue;
+			} else if (diff < acct_gather_profile_timer[i].freq)
 				continue;
 			if (!acct_gather_profile_test())
 				break;	/* Shutting down */
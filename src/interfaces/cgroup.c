@@ -1064,6 +1064,8 @@ extern cgroup_acct_t *cgroup_g_task_get_acct_data(uint32_t taskid)
 
 	if (plugin_inited == PLUGIN_NOOP) {
 		cgroup_acct_t *empty_acct = xmalloc(sizeof(*empty_acct));
+		empty_acct->io_read_bytes = NO_VAL64;
+		empty_acct->io_write_bytes = NO_VAL64;
 		return empty_acct;
 	}
 
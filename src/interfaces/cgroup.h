@@ -171,6 +171,8 @@ typedef struct {
 	uint64_t total_rss;
 	uint64_t total_pgmajfault;
 	uint64_t total_vmem;
+	uint64_t io_read_bytes;	/* io.stat rbytes, NO_VAL64 if unknown */
+	uint64_t io_write_bytes; /* io.stat wbytes, NO_VAL64 if unknown */
 } cgroup_acct_t;
 
 /* Slurm cgroup plugins configuration parameters */
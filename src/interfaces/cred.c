@@ -724,11 +724,25 @@ extern sbcast_cred_t *unpack_sbcast_cred(buf_t *buffer, void *msg,
 {
 	file_bcast_msg_t *bmsg = msg;
 	bool verify = false;
+	uint32_t cred_start = get_buf_offset(buffer);
+	sbcast_cred_t *sbcast_cred;
 
 	if (bmsg && (bmsg->block_no == 1) && !(bmsg->flags & FILE_BCAST_SO))
 		verify = true;
 
-	return (*(ops.sbcast_unpack))(buffer, verify, protocol_version);
+	sbcast_cred = (*(ops.sbcast_unpack))(buffer, verify, protocol_version);
+
+	/* slurmd relays FILE_BCAST_SWARM blocks, keep the packed credential */
+	if (sbcast_cred && !sbcast_cred->buffer && bmsg &&
+	    (bmsg->flags & FILE_BCAST_SWARM)) {
+		uint32_t cred_len = get_buf_offset(buffer) - cred_start;
+		sbcast_cred->buffer = init_buf(cred_len);
+		memcpy(get_buf_data(sbcast_cred->buffer),
+		       get_buf_data(buffer) + cred_start, cred_len);
+		set_buf_offset(sbcast_cred->buffer, cred_len);
+	}
+
+	return sbcast_cred;
 }
 
 extern void print_sbcast_cred(sbcast_cred_t *sbcast_cred)
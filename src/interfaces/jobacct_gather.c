@@ -342,6 +342,7 @@ static void *_watch_tasks(void *arg)
 		error("%s: cannot set my name to %s %m", __func__, "acctg");
 	}
 #endif
+	acct_gather_pin_poll_thread();
 
 	while (_init_run_test() && !_jobacct_shutdown_test() &&
 	       acct_gather_profile_test()) {
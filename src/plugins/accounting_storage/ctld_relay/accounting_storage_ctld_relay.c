@@ -669,6 +669,15 @@ extern list_t *jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	return NULL;
 }
 
+extern int jobacct_storage_p_get_jobs_cond_cb(void *db_conn, uid_t uid,
+					      slurmdb_job_cond_t *job_cond,
+					      int (*cb)(list_t *job_list,
+							void *arg),
+					      void *arg)
+{
+	return SLURM_ERROR;
+}
+
 /*
  * Expire old info from the storage
  * Not applicable for any database
@@ -54,13 +54,16 @@
 #include "as_mysql_fix_runaway_jobs.h"
 #include "as_mysql_job.h"
 #include "as_mysql_jobacct_process.h"
+#include "as_mysql_partition.h"
 #include "as_mysql_problems.h"
+#include "as_mysql_replica.h"
 #include "as_mysql_qos.h"
 #include "as_mysql_resource.h"
 #include "as_mysql_resv.h"
 #include "as_mysql_rollup.h"
 #include "as_mysql_txn.h"
 #include "as_mysql_usage.h"
+#include "as_mysql_usage_cache.h"
 #include "as_mysql_user.h"
 #include "as_mysql_wckey.h"
 
@@ -1417,7 +1420,9 @@ extern int create_cluster_tables(mysql_conn_t *mysql_conn, char *cluster_name)
 		{ NULL, NULL}
 	};
 
-	char table_name[200];
+	char table_name[200], *ending;
+	bool partitioned = as_mysql_partition_enabled();
+	int rc;
 
 	if (create_cluster_assoc_table(mysql_conn, cluster_name)
 	    == SLURM_ERROR)
@@ -1504,33 +1509,45 @@ extern int create_cluster_tables(mysql_conn_t *mysql_conn, char *cluster_name)
 	snprintf(table_name, sizeof(table_name), "\"%s_%s\"",
 		 cluster_name, job_table);
 
+	if (as_mysql_convert_partitions_pre(mysql_conn, cluster_name,
+					    job_table) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
 	/*
 	 * sacct_def is the index for query's with state as time_start is used
 	 * in these queries. sacct_def2 is for plain sacct queries.
+	 *
+	 * A partitioned table needs the column it is partitioned on in every
+	 * unique key, the primary key included.
 	 */
-	if (mysql_db_create_table(mysql_conn, table_name, job_table_fields,
-				  ", primary key (job_db_inx), "
-				  "unique index (id_job, time_submit), "
-				  "key old_tuple (id_job, "
-				  "id_assoc, time_submit), "
-				  "key rollup (time_eligible, time_end), "
-				  "key rollup2 (time_end, time_eligible), "
-				  "key nodes_alloc (nodes_alloc), "
-				  "key wckey (id_wckey), "
-				  "key qos (id_qos), "
-				  "key association (id_assoc), "
-				  "key array_job (id_array_job), "
-				  "key het_job (het_job_id), "
-				  "key reserv (id_resv), "
-				  "key sacct_def (id_user, time_start, "
-				  "time_end), "
-				  "key sacct_def2 (id_user, time_end, "
-				  "time_eligible), "
-				  "key env_hash_inx (env_hash_inx), "
-				  "key script_hash_inx (script_hash_inx), "
-				  "key archive_delete (deleted), "
-				  "key archive_purge (time_end))")
-	    == SLURM_ERROR)
+	ending = xstrdup_printf(", primary key (job_db_inx%s), "
+				"unique index (id_job, time_submit), "
+				"key old_tuple (id_job, "
+				"id_assoc, time_submit), "
+				"key rollup (time_eligible, time_end), "
+				"key rollup2 (time_end, time_eligible), "
+				"key nodes_alloc (nodes_alloc), "
+				"key wckey (id_wckey), "
+				"key qos (id_qos), "
+				"key association (id_assoc), "
+				"key array_job (id_array_job), "
+				"key het_job (het_job_id), "
+				"key reserv (id_resv), "
+				"key sacct_def (id_user, time_start, "
+				"time_end), "
+				"key sacct_def2 (id_user, time_end, "
+				"time_eligible), "
+				"key env_hash_inx (env_hash_inx), "
+				"key script_hash_inx (script_hash_inx), "
+				"key archive_delete (deleted), "
+				"key archive_purge (time_end))",
+				partitioned ? ", time_submit" : "");
+	rc = mysql_db_create_table(mysql_conn, table_name, job_table_fields,
+				   ending);
+	xfree(ending);
+	if ((rc == SLURM_ERROR) ||
+	    (as_mysql_convert_partitions_post(mysql_conn, cluster_name,
+					      job_table) != SLURM_SUCCESS))
 		return SLURM_ERROR;
 
 	snprintf(table_name, sizeof(table_name), "\"%s_%s\"",
@@ -1612,13 +1629,21 @@ extern int create_cluster_tables(mysql_conn_t *mysql_conn, char *cluster_name)
 
 	snprintf(table_name, sizeof(table_name), "\"%s_%s\"",
 		 cluster_name, step_table);
-	if (mysql_db_create_table(mysql_conn, table_name,
-				  step_table_fields,
-				  ", primary key (job_db_inx, id_step, "
-				  "step_het_comp), "
-				  "key archive_delete (deleted), "
-				  "key archive_purge (time_end))")
-	    == SLURM_ERROR)
+	if (as_mysql_convert_partitions_pre(mysql_conn, cluster_name,
+					    step_table) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
+	ending = xstrdup_printf(", primary key (job_db_inx, id_step, "
+				"step_het_comp%s), "
+				"key archive_delete (deleted), "
+				"key archive_purge (time_end))",
+				partitioned ? ", time_start" : "");
+	rc = mysql_db_create_table(mysql_conn, table_name, step_table_fields,
+				   ending);
+	xfree(ending);
+	if ((rc == SLURM_ERROR) ||
+	    (as_mysql_convert_partitions_post(mysql_conn, cluster_name,
+					      step_table) != SLURM_SUCCESS))
 		return SLURM_ERROR;
 
 	snprintf(table_name, sizeof(table_name), "\"%s_%s\"",
@@ -2935,11 +2960,16 @@ extern int init(void)
 
 	destroy_mysql_conn(mysql_conn);
 
+	as_mysql_replica_init(mysql_db_name, mysql_db_info);
+	as_mysql_usage_cache_init();
+
 	return rc;
 }
 
 extern void fini(void)
 {
+	as_mysql_replica_fini();
+	as_mysql_usage_cache_fini();
 	slurm_rwlock_wrlock(&as_mysql_cluster_list_lock);
 	FREE_NULL_LIST(as_mysql_cluster_list);
 	FREE_NULL_LIST(as_mysql_total_cluster_list);
@@ -3053,6 +3083,7 @@ extern int _add_feds_to_update_list(mysql_conn_t *mysql_conn,
 extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 {
 	int rc = check_connection(mysql_conn);
+	int commit_rc = SLURM_SUCCESS;
 	list_t *update_list = NULL;
 
 	/* always reset this here */
@@ -3078,11 +3109,20 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 				error("rollback failed");
 		} else {
 			int rc = SLURM_SUCCESS;
+			/*
+			 * Rows queued with mysql_db_insert_batch() are only
+			 * sent now. They were already acknowledged, so if one
+			 * of those statements failed don't commit part of the
+			 * transaction and let the caller have it resent.
+			 */
+			if (mysql_db_flush_batch(mysql_conn))
+				rc = commit_rc = SLURM_ERROR;
+
 			/*
 			 * Handle anything here we were unable to do
 			 * because of rollback issues.
 			 */
-			if (mysql_conn->pre_commit_query) {
+			if (!rc && mysql_conn->pre_commit_query) {
 				DB_DEBUG(DB_ASSOC, mysql_conn->conn,
 				         "query\n%s",
 				         mysql_conn->pre_commit_query);
@@ -3094,10 +3134,13 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 			if (rc != SLURM_SUCCESS) {
 				if (mysql_db_rollback(mysql_conn))
 					error("rollback failed");
+				/* nothing was stored, don't advertise it */
+				list_flush(update_list);
 			} else {
-				if (mysql_db_commit(mysql_conn))
+				if (mysql_db_commit(mysql_conn)) {
 					error("commit failed");
-				else if (mysql_conn->flags &
+					list_flush(update_list);
+				} else if (mysql_conn->flags &
 					 DB_CONN_FLAG_FEDUPDATE)
 					_add_feds_to_update_list(mysql_conn,
 								 update_list);
@@ -3121,6 +3164,7 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 				     _send_ctld_update, update_list);
 
 		(void) assoc_mgr_update(update_list, 0);
+		as_mysql_usage_cache_update(update_list);
 
 		slurm_rwlock_wrlock(&as_mysql_cluster_list_lock);
 		itr = list_iterator_create(update_list);
@@ -3152,7 +3196,7 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 	xfree(mysql_conn->pre_commit_query);
 	FREE_NULL_LIST(update_list);
 
-	return SLURM_SUCCESS;
+	return commit_rc;
 }
 
 extern int acct_storage_p_add_users(mysql_conn_t *mysql_conn, uint32_t uid,
@@ -3396,7 +3440,16 @@ extern list_t *acct_storage_p_get_accts(mysql_conn_t *mysql_conn, uid_t uid,
 extern list_t *acct_storage_p_get_clusters(mysql_conn_t *mysql_conn, uid_t uid,
 					   slurmdb_cluster_cond_t *cluster_cond)
 {
-	return as_mysql_get_clusters(mysql_conn, uid, cluster_cond);
+	list_t *ret_list;
+	bool replica = false;
+
+	/* Only the usage reports, slurmctld must see current clusters */
+	if (cluster_cond && cluster_cond->with_usage)
+		replica = as_mysql_replica_begin(mysql_conn);
+	ret_list = as_mysql_get_clusters(mysql_conn, uid, cluster_cond);
+	as_mysql_replica_end(mysql_conn, replica);
+
+	return ret_list;
 }
 
 extern list_t *acct_storage_p_get_federations(
@@ -3417,20 +3470,44 @@ extern list_t *acct_storage_p_get_assocs(
 	mysql_conn_t *mysql_conn, uid_t uid,
 	slurmdb_assoc_cond_t *assoc_cond)
 {
-	return as_mysql_get_assocs(mysql_conn, uid, assoc_cond);
+	list_t *ret_list;
+	bool replica = false;
+
+	/*
+	 * Only the usage reports, slurmctld loads its associations through
+	 * here and must not see stale ones.
+	 */
+	if (assoc_cond && (assoc_cond->flags & ASSOC_COND_FLAG_WITH_USAGE))
+		replica = as_mysql_replica_begin(mysql_conn);
+	ret_list = as_mysql_get_assocs(mysql_conn, uid, assoc_cond);
+	as_mysql_replica_end(mysql_conn, replica);
+
+	return ret_list;
 }
 
 extern list_t *acct_storage_p_get_events(mysql_conn_t *mysql_conn, uint32_t uid,
 					 slurmdb_event_cond_t *event_cond)
 {
-	return as_mysql_get_cluster_events(mysql_conn, uid, event_cond);
+	list_t *ret_list;
+	bool replica = as_mysql_replica_begin(mysql_conn);
+
+	ret_list = as_mysql_get_cluster_events(mysql_conn, uid, event_cond);
+	as_mysql_replica_end(mysql_conn, replica);
+
+	return ret_list;
 }
 
 extern list_t *acct_storage_p_get_instances(
 	mysql_conn_t *mysql_conn, uint32_t uid,
 	slurmdb_instance_cond_t *instance_cond)
 {
-	return as_mysql_get_instances(mysql_conn, uid, instance_cond);
+	list_t *ret_list;
+	bool replica = as_mysql_replica_begin(mysql_conn);
+
+	ret_list = as_mysql_get_instances(mysql_conn, uid, instance_cond);
+	as_mysql_replica_end(mysql_conn, replica);
+
+	return ret_list;
 }
 
 extern list_t *acct_storage_p_get_problems(mysql_conn_t *mysql_conn,
@@ -3439,6 +3516,7 @@ extern list_t *acct_storage_p_get_problems(mysql_conn_t *mysql_conn,
 {
 	int rc = SLURM_SUCCESS;
 	list_t *ret_list = NULL;
+	bool replica;
 
 	if (check_connection(mysql_conn) != SLURM_SUCCESS)
 		return NULL;
@@ -3449,6 +3527,7 @@ extern list_t *acct_storage_p_get_problems(mysql_conn_t *mysql_conn,
 	}
 
 	ret_list = list_create(slurmdb_destroy_assoc_rec);
+	replica = as_mysql_replica_begin(mysql_conn);
 
 	if ((rc = as_mysql_acct_no_assocs(mysql_conn, assoc_cond, ret_list)) !=
 	    SLURM_SUCCESS)
@@ -3464,6 +3543,7 @@ extern list_t *acct_storage_p_get_problems(mysql_conn_t *mysql_conn,
 		goto end_it;
 
 end_it:
+	as_mysql_replica_end(mysql_conn, replica);
 	errno = rc;
 
 	return ret_list;
@@ -3489,27 +3569,53 @@ extern list_t *acct_storage_p_get_res(mysql_conn_t *mysql_conn, uid_t uid,
 extern list_t *acct_storage_p_get_wckeys(mysql_conn_t *mysql_conn, uid_t uid,
 					 slurmdb_wckey_cond_t *wckey_cond)
 {
-	return as_mysql_get_wckeys(mysql_conn, uid, wckey_cond);
+	list_t *ret_list;
+	bool replica = false;
+
+	if (wckey_cond && wckey_cond->with_usage)
+		replica = as_mysql_replica_begin(mysql_conn);
+	ret_list = as_mysql_get_wckeys(mysql_conn, uid, wckey_cond);
+	as_mysql_replica_end(mysql_conn, replica);
+
+	return ret_list;
 }
 
 extern list_t *acct_storage_p_get_reservations(
 	mysql_conn_t *mysql_conn, uid_t uid,
 	slurmdb_reservation_cond_t *resv_cond)
 {
-	return as_mysql_get_resvs(mysql_conn, uid, resv_cond);
+	list_t *ret_list;
+	bool replica = as_mysql_replica_begin(mysql_conn);
+
+	ret_list = as_mysql_get_resvs(mysql_conn, uid, resv_cond);
+	as_mysql_replica_end(mysql_conn, replica);
+
+	return ret_list;
 }
 
 extern list_t *acct_storage_p_get_txn(mysql_conn_t *mysql_conn, uid_t uid,
 				      slurmdb_txn_cond_t *txn_cond)
 {
-	return as_mysql_get_txn(mysql_conn, uid, txn_cond);
+	list_t *ret_list;
+	bool replica = as_mysql_replica_begin(mysql_conn);
+
+	ret_list = as_mysql_get_txn(mysql_conn, uid, txn_cond);
+	as_mysql_replica_end(mysql_conn, replica);
+
+	return ret_list;
 }
 
 extern int acct_storage_p_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 				    void *in, slurmdbd_msg_type_t type,
 				    time_t start, time_t end)
 {
-	return as_mysql_get_usage(mysql_conn, uid, in, type, start, end);
+	int rc;
+	bool replica = as_mysql_replica_begin(mysql_conn);
+
+	rc = as_mysql_get_usage(mysql_conn, uid, in, type, start, end);
+	as_mysql_replica_end(mysql_conn, replica);
+
+	return rc;
 }
 
 extern int acct_storage_p_roll_usage(mysql_conn_t *mysql_conn,
@@ -3710,15 +3816,42 @@ extern list_t *jobacct_storage_p_get_jobs_cond(mysql_conn_t *mysql_conn,
 					       slurmdb_job_cond_t *job_cond)
 {
 	list_t *job_list = NULL;
+	bool replica = false;
 
 	if (check_connection(mysql_conn) != SLURM_SUCCESS) {
 		return NULL;
 	}
+	/* Runaway jobs are fixed based on this, they need the primary */
+	if (!job_cond || !(job_cond->flags & JOBCOND_FLAG_RUNAWAY))
+		replica = as_mysql_replica_begin(mysql_conn);
 	job_list = as_mysql_jobacct_process_get_jobs(mysql_conn, uid, job_cond);
+	as_mysql_replica_end(mysql_conn, replica);
 
 	return job_list;
 }
 
+extern int jobacct_storage_p_get_jobs_cond_cb(mysql_conn_t *mysql_conn,
+					      uid_t uid,
+					      slurmdb_job_cond_t *job_cond,
+					      int (*cb)(list_t *job_list,
+							void *arg),
+					      void *arg)
+{
+	int rc;
+	bool replica = false;
+
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	if (!job_cond || !(job_cond->flags & JOBCOND_FLAG_RUNAWAY))
+		replica = as_mysql_replica_begin(mysql_conn);
+	rc = as_mysql_jobacct_process_get_jobs_cb(mysql_conn, uid, job_cond,
+						  cb, arg);
+	as_mysql_replica_end(mysql_conn, replica);
+
+	return rc;
+}
+
 /*
  * expire old info from the storage
  */
@@ -3733,6 +3866,7 @@ extern int jobacct_storage_p_archive(mysql_conn_t *mysql_conn,
 	/* Make sure only 1 archive is happening at a time. */
 	slurm_mutex_lock(&usage_rollup_lock);
 	rc = as_mysql_jobacct_process_archive(mysql_conn, arch_cond);
+	as_mysql_usage_cache_flush(NULL);
 	slurm_mutex_unlock(&usage_rollup_lock);
 
 	return rc;
@@ -3744,10 +3878,15 @@ extern int jobacct_storage_p_archive(mysql_conn_t *mysql_conn,
 extern int jobacct_storage_p_archive_load(mysql_conn_t *mysql_conn,
 					  slurmdb_archive_rec_t *arch_rec)
 {
+	int rc;
+
 	if (check_connection(mysql_conn) != SLURM_SUCCESS)
 		return ESLURM_DB_CONNECTION;
 
-	return as_mysql_jobacct_process_archive_load(mysql_conn, arch_rec);
+	rc = as_mysql_jobacct_process_archive_load(mysql_conn, arch_rec);
+	as_mysql_usage_cache_flush(NULL);
+
+	return rc;
 }
 
 extern int acct_storage_p_update_shares_used(mysql_conn_t *mysql_conn,
@@ -3773,13 +3912,19 @@ extern int acct_storage_p_reconfig(mysql_conn_t *mysql_conn, bool dbd)
 	return SLURM_SUCCESS;
 }
 
-extern int acct_storage_p_get_stats(void *db_conn, bool dbd)
+/* Add the plugin's own counters to the slurmdbd stats in *stats */
+extern int acct_storage_p_get_stats(void *db_conn, slurmdb_stats_rec_t **stats)
 {
+	if (stats && *stats)
+		as_mysql_usage_cache_stats(*stats);
+
 	return SLURM_SUCCESS;
 }
 
-extern int acct_storage_p_clear_stats(void *db_conn, bool dbd)
+extern int acct_storage_p_clear_stats(void *db_conn)
 {
+	as_mysql_usage_cache_clear_stats();
+
 	return SLURM_SUCCESS;
 }
 
@@ -149,6 +149,17 @@ typedef struct {
 #define DB_DEBUG(flag, conn, fmt, ...) \
 	log_flag(flag, "%d(%s:%d) "fmt, conn, THIS_FILE, __LINE__, ##__VA_ARGS__);
 
+/* Log a mysql_db_stmt_*() query with its params substituted for the '?' */
+#define DB_DEBUG_STMT(flag, conn, query, params, param_cnt)		\
+	do {								\
+		if (slurm_conf.debug_flags & DEBUG_FLAG_##flag) {	\
+			char *_stmt_str = mysql_db_stmt_str(		\
+				query, params, param_cnt);		\
+			DB_DEBUG(flag, conn, "query\n%s", _stmt_str);	\
+			xfree(_stmt_str);				\
+		}							\
+	} while (0)
+
 /*global functions */
 extern int check_connection(mysql_conn_t *mysql_conn);
 extern char *fix_double_quotes(char *str);
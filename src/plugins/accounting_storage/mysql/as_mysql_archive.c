@@ -42,8 +42,10 @@
 #include <unistd.h>
 
 #include "as_mysql_archive.h"
+#include "as_mysql_partition.h"
 #include "src/common/env.h"
 #include "src/common/slurm_time.h"
+#include "src/common/slurmdb_archive.h"
 #include "src/common/slurmdbd_defs.h"
 
 #define SLURM_24_05_PROTOCOL_VERSION MAKE_SLURM_VER(41)
@@ -3716,92 +3718,109 @@ static char *_load_events(uint16_t rpc_version, buf_t *buffer,
 	return insert;
 }
 
+static void _pack_job_row(MYSQL_ROW row, buf_t *buffer)
+{
+	local_job_t job;
+
+	memset(&job, 0, sizeof(local_job_t));
+
+	job.account = row[JOB_REQ_ACCOUNT];
+	job.admin_comment = row[JOB_REQ_ADMIN_COMMENT];
+	job.alloc_nodes = row[JOB_REQ_ALLOC_NODES];
+	job.associd = row[JOB_REQ_ASSOCID];
+	job.array_jobid = row[JOB_REQ_ARRAYJOBID];
+	job.array_max_tasks = row[JOB_REQ_ARRAY_MAX];
+	job.array_taskid = row[JOB_REQ_ARRAYTASKID];
+	job.array_task_pending = row[JOB_REQ_ARRAY_TASK_PENDING];
+	job.array_task_str = row[JOB_REQ_ARRAY_TASK_STR];
+	job.script_hash_inx = row[JOB_REQ_SCRIPT_HASH_INX];
+	job.blockid = row[JOB_REQ_BLOCKID];
+	job.constraints = row[JOB_REQ_CONSTRAINTS];
+	job.container = row[JOB_REQ_CONTAINER];
+	job.deleted = row[JOB_REQ_DELETED];
+	job.derived_ec = row[JOB_REQ_DERIVED_EC];
+	job.derived_es = row[JOB_REQ_DERIVED_ES];
+	job.env_hash_inx = row[JOB_REQ_ENV_HASH_INX];
+	job.exit_code = row[JOB_REQ_EXIT_CODE];
+	job.extra = row[JOB_REQ_EXTRA];
+	job.flags = row[JOB_REQ_FLAGS];
+	job.timelimit = row[JOB_REQ_TIMELIMIT];
+	job.eligible = row[JOB_REQ_ELIGIBLE];
+	job.end = row[JOB_REQ_END];
+	job.gid = row[JOB_REQ_GID];
+	job.gres_used = row[JOB_REQ_GRES_USED];
+	job.het_job_id = row[JOB_REQ_HET_JOB_ID];
+	job.het_job_offset = row[JOB_REQ_HET_JOB_OFFSET];
+	job.job_db_inx = row[JOB_REQ_DB_INX];
+	job.jobid = row[JOB_REQ_JOBID];
+	job.kill_requid = row[JOB_REQ_KILL_REQUID];
+	job.licenses = row[JOB_REQ_LICENSES];
+	job.mcs_label = row[JOB_REQ_MCS_LABEL];
+	job.mod_time = row[JOB_REQ_MOD_TIME];
+	job.name = row[JOB_REQ_NAME];
+	job.nodelist = row[JOB_REQ_NODELIST];
+	job.node_inx = row[JOB_REQ_NODE_INX];
+	job.partition = row[JOB_REQ_PARTITION];
+	job.priority = row[JOB_REQ_PRIORITY];
+	job.qos = row[JOB_REQ_QOS];
+	job.qos_req = row[JOB_REQ_QOS_REQ];
+	job.req_cpus = row[JOB_REQ_REQ_CPUS];
+	job.req_mem = row[JOB_REQ_REQ_MEM];
+	job.restart_cnt = row[JOB_REQ_RESTART_CNT];
+	job.resvid = row[JOB_REQ_RESVID];
+	job.resv_req = row[JOB_REQ_RESV_REQ];
+	job.segment_size = row[JOB_REQ_SEGMENT_SIZE];
+	job.start = row[JOB_REQ_START];
+	job.state = row[JOB_REQ_STATE];
+	job.state_reason_prev = row[JOB_REQ_STATE_REASON];
+	job.std_err = row[JOB_REQ_STDERR];
+	job.std_in = row[JOB_REQ_STDIN];
+	job.std_out = row[JOB_REQ_STDOUT];
+	job.submit = row[JOB_REQ_SUBMIT];
+	job.submit_line = row[JOB_REQ_SUBMIT_LINE];
+	job.suspended = row[JOB_REQ_SUSPENDED];
+	job.system_comment = row[JOB_REQ_SYSTEM_COMMENT];
+	job.tres_alloc_str = row[JOB_REQ_TRESA];
+	job.tres_req_str = row[JOB_REQ_TRESR];
+	job.uid = row[JOB_REQ_UID];
+	job.wckey = row[JOB_REQ_WCKEY];
+	job.wckey_id = row[JOB_REQ_WCKEYID];
+	job.work_dir = row[JOB_REQ_WORK_DIR];
+
+	_pack_local_job(&job, buffer);
+}
+
 static buf_t *_pack_archive_jobs(MYSQL_RES *result, char *cluster_name,
 				 uint32_t cnt, uint32_t usage_info,
 				 time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
-	local_job_t job;
+	slurmdb_archive_writer_t *writer = NULL;
 
 	buffer = init_buf(high_buffer_size);
 	pack16(SLURM_PROTOCOL_VERSION, buffer);
 	pack_time(time(NULL), buffer);
 	pack16(DBD_GOT_JOBS, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	if (slurmdbd_conf->flags & DBD_CONF_FLAG_ARCHIVE_COLUMNAR)
+		writer = slurmdb_archive_writer_init(buffer, cnt, job_req_inx,
+						     JOB_REQ_COUNT,
+						     JOB_REQ_SUBMIT,
+						     JOB_REQ_END, JOB_REQ_UID);
+	else
+		pack32(cnt, buffer);
 
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[JOB_REQ_SUBMIT]);
 
-		memset(&job, 0, sizeof(local_job_t));
-
-		job.account = row[JOB_REQ_ACCOUNT];
-		job.admin_comment = row[JOB_REQ_ADMIN_COMMENT];
-		job.alloc_nodes = row[JOB_REQ_ALLOC_NODES];
-		job.associd = row[JOB_REQ_ASSOCID];
-		job.array_jobid = row[JOB_REQ_ARRAYJOBID];
-		job.array_max_tasks = row[JOB_REQ_ARRAY_MAX];
-		job.array_taskid = row[JOB_REQ_ARRAYTASKID];
-		job.array_task_pending = row[JOB_REQ_ARRAY_TASK_PENDING];
-		job.array_task_str = row[JOB_REQ_ARRAY_TASK_STR];
-		job.script_hash_inx = row[JOB_REQ_SCRIPT_HASH_INX];
-		job.blockid = row[JOB_REQ_BLOCKID];
-		job.constraints = row[JOB_REQ_CONSTRAINTS];
-		job.container = row[JOB_REQ_CONTAINER];
-		job.deleted = row[JOB_REQ_DELETED];
-		job.derived_ec = row[JOB_REQ_DERIVED_EC];
-		job.derived_es = row[JOB_REQ_DERIVED_ES];
-		job.env_hash_inx = row[JOB_REQ_ENV_HASH_INX];
-		job.exit_code = row[JOB_REQ_EXIT_CODE];
-		job.extra = row[JOB_REQ_EXTRA];
-		job.flags = row[JOB_REQ_FLAGS];
-		job.timelimit = row[JOB_REQ_TIMELIMIT];
-		job.eligible = row[JOB_REQ_ELIGIBLE];
-		job.end = row[JOB_REQ_END];
-		job.gid = row[JOB_REQ_GID];
-		job.gres_used = row[JOB_REQ_GRES_USED];
-		job.het_job_id = row[JOB_REQ_HET_JOB_ID];
-		job.het_job_offset = row[JOB_REQ_HET_JOB_OFFSET];
-		job.job_db_inx = row[JOB_REQ_DB_INX];
-		job.jobid = row[JOB_REQ_JOBID];
-		job.kill_requid = row[JOB_REQ_KILL_REQUID];
-		job.licenses = row[JOB_REQ_LICENSES];
-		job.mcs_label = row[JOB_REQ_MCS_LABEL];
-		job.mod_time = row[JOB_REQ_MOD_TIME];
-		job.name = row[JOB_REQ_NAME];
-		job.nodelist = row[JOB_REQ_NODELIST];
-		job.node_inx = row[JOB_REQ_NODE_INX];
-		job.partition = row[JOB_REQ_PARTITION];
-		job.priority = row[JOB_REQ_PRIORITY];
-		job.qos = row[JOB_REQ_QOS];
-		job.qos_req = row[JOB_REQ_QOS_REQ];
-		job.req_cpus = row[JOB_REQ_REQ_CPUS];
-		job.req_mem = row[JOB_REQ_REQ_MEM];
-		job.restart_cnt = row[JOB_REQ_RESTART_CNT];
-		job.resvid = row[JOB_REQ_RESVID];
-		job.resv_req = row[JOB_REQ_RESV_REQ];
-		job.segment_size = row[JOB_REQ_SEGMENT_SIZE];
-		job.start = row[JOB_REQ_START];
-		job.state = row[JOB_REQ_STATE];
-		job.state_reason_prev = row[JOB_REQ_STATE_REASON];
-		job.std_err = row[JOB_REQ_STDERR];
-		job.std_in = row[JOB_REQ_STDIN];
-		job.std_out = row[JOB_REQ_STDOUT];
-		job.submit = row[JOB_REQ_SUBMIT];
-		job.submit_line = row[JOB_REQ_SUBMIT_LINE];
-		job.suspended = row[JOB_REQ_SUSPENDED];
-		job.system_comment = row[JOB_REQ_SYSTEM_COMMENT];
-		job.tres_alloc_str = row[JOB_REQ_TRESA];
-		job.tres_req_str = row[JOB_REQ_TRESR];
-		job.uid = row[JOB_REQ_UID];
-		job.wckey = row[JOB_REQ_WCKEY];
-		job.wckey_id = row[JOB_REQ_WCKEYID];
-		job.work_dir = row[JOB_REQ_WORK_DIR];
-
-		_pack_local_job(&job, buffer);
+		if (writer)
+			slurmdb_archive_writer_add(writer, row);
+		else
+			_pack_job_row(row, buffer);
 	}
+	slurmdb_archive_writer_fini(writer);
 
 	return buffer;
 }
@@ -4429,87 +4448,104 @@ static char *_load_resvs(uint16_t rpc_version, buf_t *buffer,
 	return insert;
 }
 
+static void _pack_step_row(MYSQL_ROW row, buf_t *buffer)
+{
+	local_step_t step;
+
+	memset(&step, 0, sizeof(local_step_t));
+
+	step.act_cpufreq = row[STEP_REQ_ACT_CPUFREQ];
+	step.deleted = row[STEP_REQ_DELETED];
+	step.consumed_energy = row[STEP_REQ_CONSUMED_ENERGY];
+	step.container = row[STEP_REQ_CONTAINER];
+	step.exit_code = row[STEP_REQ_EXIT_CODE];
+	step.job_db_inx = row[STEP_REQ_DB_INX];
+	step.kill_requid = row[STEP_REQ_KILL_REQUID];
+	step.name = row[STEP_REQ_NAME];
+	step.nodelist = row[STEP_REQ_NODELIST];
+	step.nodes = row[STEP_REQ_NODES];
+	step.node_inx = row[STEP_REQ_NODE_INX];
+	step.period_end = row[STEP_REQ_END];
+	step.period_start = row[STEP_REQ_START];
+	step.period_suspended = row[STEP_REQ_SUSPENDED];
+	step.req_cpufreq_min = row[STEP_REQ_REQ_CPUFREQ_MIN];
+	step.req_cpufreq_max = row[STEP_REQ_REQ_CPUFREQ_MAX];
+	step.req_cpufreq_gov = row[STEP_REQ_REQ_CPUFREQ_GOV];
+	step.state = row[STEP_REQ_STATE];
+	step.stepid = row[STEP_REQ_STEPID];
+	step.step_het_comp = row[STEP_REQ_STEP_HET_COMP];
+	step.cwd = row[STEP_REQ_CWD];
+	step.std_err = row[STEP_REQ_STDERR];
+	step.std_in = row[STEP_REQ_STDIN];
+	step.std_out = row[STEP_REQ_STDOUT];
+	step.submit_line = row[STEP_REQ_SUBMIT_LINE];
+	step.sys_sec = row[STEP_REQ_SYS_SEC];
+	step.sys_usec = row[STEP_REQ_SYS_USEC];
+	step.tasks = row[STEP_REQ_TASKS];
+	step.task_dist = row[STEP_REQ_TASKDIST];
+	step.timelimit = row[STEP_REQ_TIMELIMIT];
+	step.tres_alloc_str = row[STEP_REQ_TRES];
+	step.tres_usage_in_ave = row[STEP_TRES_USAGE_IN_AVE];
+	step.tres_usage_in_max = row[STEP_TRES_USAGE_IN_MAX];
+	step.tres_usage_in_max_nodeid =
+		row[STEP_TRES_USAGE_IN_MAX_NODEID];
+	step.tres_usage_in_max_taskid =
+		row[STEP_TRES_USAGE_IN_MAX_TASKID];
+	step.tres_usage_in_min = row[STEP_TRES_USAGE_IN_MIN];
+	step.tres_usage_in_min_nodeid =
+		row[STEP_TRES_USAGE_IN_MIN_NODEID];
+	step.tres_usage_in_min_taskid =
+		row[STEP_TRES_USAGE_IN_MIN_TASKID];
+	step.tres_usage_in_tot = row[STEP_TRES_USAGE_IN_TOT];
+	step.tres_usage_out_ave = row[STEP_TRES_USAGE_OUT_AVE];
+	step.tres_usage_out_max = row[STEP_TRES_USAGE_OUT_MAX];
+	step.tres_usage_out_max_nodeid =
+		row[STEP_TRES_USAGE_OUT_MAX_NODEID];
+	step.tres_usage_out_max_taskid =
+		row[STEP_TRES_USAGE_OUT_MAX_TASKID];
+	step.tres_usage_out_min = row[STEP_TRES_USAGE_OUT_MAX];
+	step.tres_usage_out_min_nodeid =
+		row[STEP_TRES_USAGE_OUT_MIN_NODEID];
+	step.tres_usage_out_min_taskid =
+		row[STEP_TRES_USAGE_OUT_MIN_TASKID];
+	step.tres_usage_out_tot = row[STEP_TRES_USAGE_OUT_TOT];
+	step.user_sec = row[STEP_REQ_USER_SEC];
+	step.user_usec = row[STEP_REQ_USER_USEC];
+
+	_pack_local_step(&step, buffer);
+}
+
 static buf_t *_pack_archive_steps(MYSQL_RES *result, char *cluster_name,
 				  uint32_t cnt, uint32_t usage_info,
 				  time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
-	local_step_t step;
+	slurmdb_archive_writer_t *writer = NULL;
 
 	buffer = init_buf(high_buffer_size);
 	pack16(SLURM_PROTOCOL_VERSION, buffer);
 	pack_time(time(NULL), buffer);
 	pack16(DBD_STEP_START, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	if (slurmdbd_conf->flags & DBD_CONF_FLAG_ARCHIVE_COLUMNAR)
+		writer = slurmdb_archive_writer_init(buffer, cnt, step_req_inx,
+						     STEP_REQ_COUNT,
+						     STEP_REQ_START,
+						     STEP_REQ_END, -1);
+	else
+		pack32(cnt, buffer);
 
 	while ((row = mysql_fetch_row(result))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[STEP_REQ_START]);
 
-		memset(&step, 0, sizeof(local_step_t));
-
-		step.act_cpufreq = row[STEP_REQ_ACT_CPUFREQ];
-		step.deleted = row[STEP_REQ_DELETED];
-		step.consumed_energy = row[STEP_REQ_CONSUMED_ENERGY];
-		step.container = row[STEP_REQ_CONTAINER];
-		step.exit_code = row[STEP_REQ_EXIT_CODE];
-		step.job_db_inx = row[STEP_REQ_DB_INX];
-		step.kill_requid = row[STEP_REQ_KILL_REQUID];
-		step.name = row[STEP_REQ_NAME];
-		step.nodelist = row[STEP_REQ_NODELIST];
-		step.nodes = row[STEP_REQ_NODES];
-		step.node_inx = row[STEP_REQ_NODE_INX];
-		step.period_end = row[STEP_REQ_END];
-		step.period_start = row[STEP_REQ_START];
-		step.period_suspended = row[STEP_REQ_SUSPENDED];
-		step.req_cpufreq_min = row[STEP_REQ_REQ_CPUFREQ_MIN];
-		step.req_cpufreq_max = row[STEP_REQ_REQ_CPUFREQ_MAX];
-		step.req_cpufreq_gov = row[STEP_REQ_REQ_CPUFREQ_GOV];
-		step.state = row[STEP_REQ_STATE];
-		step.stepid = row[STEP_REQ_STEPID];
-		step.step_het_comp = row[STEP_REQ_STEP_HET_COMP];
-		step.cwd = row[STEP_REQ_CWD];
-		step.std_err = row[STEP_REQ_STDERR];
-		step.std_in = row[STEP_REQ_STDIN];
-		step.std_out = row[STEP_REQ_STDOUT];
-		step.submit_line = row[STEP_REQ_SUBMIT_LINE];
-		step.sys_sec = row[STEP_REQ_SYS_SEC];
-		step.sys_usec = row[STEP_REQ_SYS_USEC];
-		step.tasks = row[STEP_REQ_TASKS];
-		step.task_dist = row[STEP_REQ_TASKDIST];
-		step.timelimit = row[STEP_REQ_TIMELIMIT];
-		step.tres_alloc_str = row[STEP_REQ_TRES];
-		step.tres_usage_in_ave = row[STEP_TRES_USAGE_IN_AVE];
-		step.tres_usage_in_max = row[STEP_TRES_USAGE_IN_MAX];
-		step.tres_usage_in_max_nodeid =
-			row[STEP_TRES_USAGE_IN_MAX_NODEID];
-		step.tres_usage_in_max_taskid =
-			row[STEP_TRES_USAGE_IN_MAX_TASKID];
-		step.tres_usage_in_min = row[STEP_TRES_USAGE_IN_MIN];
-		step.tres_usage_in_min_nodeid =
-			row[STEP_TRES_USAGE_IN_MIN_NODEID];
-		step.tres_usage_in_min_taskid =
-			row[STEP_TRES_USAGE_IN_MIN_TASKID];
-		step.tres_usage_in_tot = row[STEP_TRES_USAGE_IN_TOT];
-		step.tres_usage_out_ave = row[STEP_TRES_USAGE_OUT_AVE];
-		step.tres_usage_out_max = row[STEP_TRES_USAGE_OUT_MAX];
-		step.tres_usage_out_max_nodeid =
-			row[STEP_TRES_USAGE_OUT_MAX_NODEID];
-		step.tres_usage_out_max_taskid =
-			row[STEP_TRES_USAGE_OUT_MAX_TASKID];
-		step.tres_usage_out_min = row[STEP_TRES_USAGE_OUT_MAX];
-		step.tres_usage_out_min_nodeid =
-			row[STEP_TRES_USAGE_OUT_MIN_NODEID];
-		step.tres_usage_out_min_taskid =
-			row[STEP_TRES_USAGE_OUT_MIN_TASKID];
-		step.tres_usage_out_tot = row[STEP_TRES_USAGE_OUT_TOT];
-		step.user_sec = row[STEP_REQ_USER_SEC];
-		step.user_usec = row[STEP_REQ_USER_USEC];
-
-		_pack_local_step(&step, buffer);
+		if (writer)
+			slurmdb_archive_writer_add(writer, row);
+		else
+			_pack_step_row(row, buffer);
 	}
+	slurmdb_archive_writer_fini(writer);
 
 	return buffer;
 }
@@ -5584,6 +5620,17 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 		break;
 	}
 
+	/*
+	 * Whole partitions can go at once when nothing needs to be archived,
+	 * what is left over is purged row by row below.
+	 */
+	if (as_mysql_partition_enabled() &&
+	    ((purge_type == PURGE_JOB) || (purge_type == PURGE_STEP)) &&
+	    !SLURMDB_PURGE_ARCHIVE_SET(purge_attr) &&
+	    (rc = as_mysql_partition_purge(mysql_conn, cluster_name,
+					   sql_table, curr_end, false)))
+		goto end_it;
+
 	/* continue archive/purge until no records in the period are found */
 	while (1) {
 		rc = _get_oldest_record(mysql_conn, cluster_name, sql_table,
@@ -5693,6 +5740,13 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 			break;
 		}
 	}
+
+	/* Drop the partitions archiving has emptied */
+	if ((rc == SLURM_SUCCESS) && as_mysql_partition_enabled() &&
+	    ((purge_type == PURGE_JOB) || (purge_type == PURGE_STEP)) &&
+	    SLURMDB_PURGE_ARCHIVE_SET(purge_attr))
+		rc = as_mysql_partition_purge(mysql_conn, cluster_name,
+					      sql_table, curr_end, true);
 end_it:
 	xfree(purge_query);
 
@@ -5852,6 +5906,90 @@ static int _load_data(char **data, mysql_conn_t *mysql_conn)
 	return rc;
 }
 
+/*
+ * Load a columnar job or step archive a block at a time. The rows of each
+ * block are packed back into records so the row loaders can build the
+ * inserts, columns are matched by name so files written with a different
+ * set of columns still load.
+ */
+static int _load_columnar_data(buf_t *buffer, uint16_t type,
+			       char *cluster_name, mysql_conn_t *mysql_conn)
+{
+	char **col_names = NULL, **row_names = NULL, **row = NULL;
+	int *col_map = NULL, row_cnt = 0;
+	uint32_t col_cnt = 0, rec_cnt = 0, loaded = 0;
+	slurmdb_archive_block_t *block = NULL;
+	void (*pack_row)(MYSQL_ROW row, buf_t *buffer);
+	int rc;
+
+	switch (type) {
+	case DBD_GOT_JOBS:
+		row_names = job_req_inx;
+		row_cnt = JOB_REQ_COUNT;
+		pack_row = _pack_job_row;
+		break;
+	case DBD_STEP_START:
+		row_names = step_req_inx;
+		row_cnt = STEP_REQ_COUNT;
+		pack_row = _pack_step_row;
+		break;
+	default:
+		error("Columnar archives of type '%s' are not supported",
+		      slurmdbd_msg_type_2_str(type, 0));
+		return SLURM_ERROR;
+	}
+
+	if ((rc = slurmdb_archive_unpack_header(buffer, &rec_cnt, &col_names,
+						&col_cnt)))
+		return rc;
+
+	col_map = xcalloc(row_cnt, sizeof(int));
+	row = xcalloc(row_cnt, sizeof(char *));
+	for (int i = 0; i < row_cnt; i++)
+		col_map[i] = slurmdb_archive_col_inx(col_names, col_cnt,
+						     row_names[i]);
+
+	while (!(rc = slurmdb_archive_unpack_block(buffer, col_cnt, &block,
+						   NULL, NULL)) && block) {
+		buf_t *rows_buf = init_buf(high_buffer_size);
+		char *data = NULL;
+
+		for (uint32_t r = 0; r < block->rows; r++) {
+			for (int i = 0; i < row_cnt; i++)
+				row[i] = (col_map[i] < 0) ?
+					NULL : block->cols[col_map[i]][r];
+			(*pack_row)(row, rows_buf);
+		}
+		set_buf_offset(rows_buf, 0);
+
+		if (type == DBD_GOT_JOBS)
+			data = _load_jobs(SLURM_PROTOCOL_VERSION, rows_buf,
+					  cluster_name, block->rows);
+		else
+			data = _load_steps(SLURM_PROTOCOL_VERSION, rows_buf,
+					   cluster_name, block->rows);
+		loaded += block->rows;
+		FREE_NULL_BUFFER(rows_buf);
+		slurmdb_archive_free_block(block);
+		block = NULL;
+
+		DB_DEBUG(DB_ARCHIVE, mysql_conn->conn,
+			 "%s: loaded %u/%u columnar records",
+			 __func__, loaded, rec_cnt);
+
+		if ((rc = _load_data(&data, mysql_conn)))
+			break;
+	}
+
+	for (uint32_t i = 0; i < col_cnt; i++)
+		xfree(col_names[i]);
+	xfree(col_names);
+	xfree(col_map);
+	xfree(row);
+
+	return rc;
+}
+
 static int _process_archive_data(char **data_in, uint32_t data_size,
 				 mysql_conn_t *mysql_conn)
 {
@@ -5888,6 +6026,12 @@ static int _process_archive_data(char **data_in, uint32_t data_size,
 	safe_unpackstr(&cluster_name, buffer);
 	safe_unpack32(&rec_cnt, buffer);
 
+	if (rec_cnt == SLURMDB_ARCHIVE_COLUMNAR) {
+		error_code = _load_columnar_data(buffer, type, cluster_name,
+						 mysql_conn);
+		goto cleanup;
+	}
+
 	if (!rec_cnt) {
 		error("we didn't get any records from this file of type '%s'",
 		      slurmdbd_msg_type_2_str(type, 0));
@@ -36,6 +36,7 @@
 
 #include "as_mysql_cluster.h"
 #include "as_mysql_convert.h"
+#include "as_mysql_partition.h"
 #include "as_mysql_tres.h"
 #include "src/interfaces/jobacct_gather.h"
 
@@ -349,6 +350,86 @@ extern int as_mysql_convert_non_cluster_tables_post_create(
 	return rc;
 }
 
+extern int as_mysql_convert_partitions_pre(mysql_conn_t *mysql_conn,
+					   char *cluster_name, char *table)
+{
+	list_t *part_list;
+	char *query;
+	int rc;
+
+	if (as_mysql_partition_enabled())
+		return SLURM_SUCCESS;
+
+	if (!(part_list = as_mysql_partition_get(mysql_conn, cluster_name,
+						 table)))
+		return SLURM_ERROR;
+	rc = list_count(part_list);
+	FREE_NULL_LIST(part_list);
+	if (!rc)
+		return SLURM_SUCCESS;
+
+	info("Removing the partitions of %s_%s, this may take some time, do not stop slurmdbd.",
+	     cluster_name, table);
+	query = xstrdup_printf("alter table \"%s_%s\" remove partitioning;",
+			       cluster_name, table);
+	DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+	if ((rc = as_mysql_convert_alter_query(mysql_conn, query)) !=
+	    SLURM_SUCCESS)
+		error("Can't remove the partitions of %s_%s",
+		      cluster_name, table);
+	xfree(query);
+
+	return rc;
+}
+
+extern int as_mysql_convert_partitions_post(mysql_conn_t *mysql_conn,
+					    char *cluster_name, char *table)
+{
+	MYSQL_RES *result;
+	MYSQL_ROW row;
+	list_t *part_list;
+	char *query, *defs, *col = as_mysql_partition_column(table);
+	time_t start = time(NULL);
+	int rc;
+
+	if (!as_mysql_partition_enabled() || !col)
+		return SLURM_SUCCESS;
+
+	if (!(part_list = as_mysql_partition_get(mysql_conn, cluster_name,
+						 table)))
+		return SLURM_ERROR;
+	rc = list_count(part_list);
+	FREE_NULL_LIST(part_list);
+	if (rc)
+		return SLURM_SUCCESS;
+
+	query = xstrdup_printf("select min(%s) from \"%s_%s\" where %s > 0",
+			       col, cluster_name, table, col);
+	DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+	result = mysql_db_query_ret(mysql_conn, query, 0);
+	xfree(query);
+	if (!result)
+		return SLURM_ERROR;
+	if ((row = mysql_fetch_row(result)) && row[0])
+		start = slurm_atoul(row[0]);
+	mysql_free_result(result);
+
+	info("Partitioning %s_%s by month, this may take some time, do not stop slurmdbd.",
+	     cluster_name, table);
+	defs = as_mysql_partition_defs(start);
+	query = xstrdup_printf("alter table \"%s_%s\" partition by range (%s) "
+			       "(%s);",
+			       cluster_name, table, col, defs);
+	xfree(defs);
+	DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+	if ((rc = as_mysql_convert_alter_query(mysql_conn, query)) !=
+	    SLURM_SUCCESS)
+		error("Can't partition %s_%s", cluster_name, table);
+	xfree(query);
+
+	return rc;
+}
+
 /*
  * Only use this when running "ALTER TABLE" during an upgrade.  This is to get
  * around that mysql cannot rollback an "ALTER TABLE", but its possible that the
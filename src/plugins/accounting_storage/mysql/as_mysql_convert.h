@@ -56,6 +56,21 @@ extern int as_mysql_convert_tables_post_create(mysql_conn_t *mysql_conn);
 extern int as_mysql_convert_non_cluster_tables_post_create(
 	mysql_conn_t *mysql_conn);
 
+/*
+ * Remove the partitioning of a cluster's job or step table before it is
+ * created if Parameters=partition_job_tables is no longer set, so the keys can
+ * go back to the unpartitioned ones.
+ */
+extern int as_mysql_convert_partitions_pre(mysql_conn_t *mysql_conn,
+					   char *cluster_name, char *table);
+
+/*
+ * Partition a cluster's job or step table by month after it is created if
+ * Parameters=partition_job_tables is set and it isn't partitioned yet.
+ */
+extern int as_mysql_convert_partitions_post(mysql_conn_t *mysql_conn,
+					    char *cluster_name, char *table);
+
 /*
  * Only use this when running "ALTER TABLE" during an upgrade.  This is to get
  * around that mysql cannot rollback an "ALTER TABLE", but its possible that the
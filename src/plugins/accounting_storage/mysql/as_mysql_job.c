@@ -100,23 +100,22 @@ static char *_average_tres_usage(uint32_t *tres_ids, uint64_t *tres_cnts,
 static uint64_t _get_db_index(mysql_conn_t *mysql_conn,
 			      time_t submit, uint32_t jobid)
 {
-	MYSQL_RES *result = NULL;
-	MYSQL_ROW row;
 	uint64_t db_index = 0;
+	char *db_index_str;
 	char *query = xstrdup_printf("select job_db_inx from \"%s_%s\" where "
-				     "time_submit=%d and id_job=%u",
-				     mysql_conn->cluster_name, job_table,
-				     (int)submit, jobid);
-
-	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
-		xfree(query);
-		return 0;
-	}
+				     "time_submit=? and id_job=?",
+				     mysql_conn->cluster_name, job_table);
+	db_param_t params[] = {
+		DB_PARAM_INT(submit),
+		DB_PARAM_UINT(jobid),
+	};
+
+	DB_DEBUG_STMT(DB_JOB, mysql_conn->conn, query, params,
+		      ARRAY_SIZE(params));
+	db_index_str = mysql_db_stmt_query_str(mysql_conn, query, params,
+					       ARRAY_SIZE(params));
 	xfree(query);
-
-	row = mysql_fetch_row(result);
-	if (!row) {
-		mysql_free_result(result);
+	if (!db_index_str) {
 		debug4("We can't get a db_index for this combo, "
 		       "time_submit=%d and id_job=%u.  "
 		       "We must not have heard about the start yet, "
@@ -124,8 +123,8 @@ static uint64_t _get_db_index(mysql_conn_t *mysql_conn,
 		       (int)submit, jobid);
 		return 0;
 	}
-	db_index = slurm_atoull(row[0]);
-	mysql_free_result(result);
+	db_index = slurm_atoull(db_index_str);
+	xfree(db_index_str);
 
 	return db_index;
 }
@@ -135,8 +134,7 @@ static char *_get_user_from_associd(mysql_conn_t *mysql_conn,
 {
 	char *user = NULL;
 	char *query = NULL;
-	MYSQL_RES *result = NULL;
-	MYSQL_ROW row;
+	db_param_t params[] = { DB_PARAM_UINT(associd) };
 
 	/* Just so we don't have to keep a
 	   cache of the associations around we
@@ -145,22 +143,17 @@ static char *_get_user_from_associd(mysql_conn_t *mysql_conn,
 	   this should sort of be a rare case
 	   this isn't too bad.
 	*/
-	query = xstrdup_printf("select user from \"%s_%s\" where id_assoc=%u",
-			       cluster, assoc_table, associd);
+	query = xstrdup_printf("select user from \"%s_%s\" where id_assoc=?",
+			       cluster, assoc_table);
 
-	debug4("%d(%s:%d) query\n%s",
-	       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	if (!(result =
-	      mysql_db_query_ret(mysql_conn, query, 0))) {
-		xfree(query);
-		return NULL;
-	}
+	DB_DEBUG_STMT(DB_ASSOC, mysql_conn->conn, query, params,
+		      ARRAY_SIZE(params));
+	user = mysql_db_stmt_query_str(mysql_conn, query, params,
+				       ARRAY_SIZE(params));
 	xfree(query);
 
-	if ((row = mysql_fetch_row(result)) && row[0][0])
-		user = xstrdup(row[0]);
-
-	mysql_free_result(result);
+	if (user && !user[0])
+		xfree(user);
 
 	return user;
 }
@@ -287,9 +280,8 @@ static uint64_t _get_hash_inx(mysql_conn_t *mysql_conn,
 {
 	char *query, *hash;
 	char *hash_col = NULL, *type_table = NULL;
-	MYSQL_RES *result = NULL;
-	uint64_t hash_inx = 0;
-	int num_affected = 0;
+	db_param_t params[1];
+	uint64_t hash_inx = 0, num_affected = 0;
 
 	switch (flag) {
 	case JOB_SEND_ENV:
@@ -312,14 +304,17 @@ static uint64_t _get_hash_inx(mysql_conn_t *mysql_conn,
 		return 0;
 
 	query = xstrdup_printf(
-		"insert into \"%s_%s\" (%s) values ('%s') "
+		"insert into \"%s_%s\" (%s) values (?) "
 		"on duplicate key update last_used=VALUES(last_used), "
 		"hash_inx=LAST_INSERT_ID(hash_inx);",
-		mysql_conn->cluster_name, type_table,
-		hash_col, hash);
-
-	hash_inx = mysql_db_insert_ret_id(mysql_conn, query);
-	num_affected = mysql_affected_rows(mysql_conn->db_conn);
+		mysql_conn->cluster_name, type_table, hash_col);
+	params[0] = DB_PARAM_STR(hash);
+
+	DB_DEBUG_STMT(DB_JOB, mysql_conn->conn, query, params,
+		      ARRAY_SIZE(params));
+	hash_inx = mysql_db_stmt_insert_ret_id(mysql_conn, query, params,
+					       ARRAY_SIZE(params),
+					       &num_affected);
 	if (!hash_inx)
 		hash_inx = NO_VAL64;
 	else if (num_affected == 1) { /* 1 means insert, we need it sent */
@@ -332,8 +327,6 @@ static uint64_t _get_hash_inx(mysql_conn_t *mysql_conn,
 
 	xfree(query);
 
-	mysql_free_result(result);
-
 	return hash_inx;
 
 }
@@ -1356,7 +1349,7 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 	char *node_list = NULL;
 	char *node_inx = NULL;
 	time_t start_time, submit_time;
-	char *query = NULL;
+	char *head = NULL, *row = NULL, *tail = NULL;
 
 	if (!step_ptr->job_ptr->db_index
 	    && ((!step_ptr->job_ptr->details
@@ -1454,82 +1447,89 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 		}
 	}
 
-	/* we want to print a -1 for the requid so leave it a
-	   %d */
-	/* The stepid could be negative so use %d not %u */
-	query = xstrdup_printf(
+	/*
+	 * Steps are queued with mysql_db_insert_batch() so a backlog of step
+	 * starts from the slurmctld goes out as multi-row inserts. The
+	 * optional columns are part of the head, so rows are only grouped
+	 * with others that set the same ones.
+	 */
+	head = xstrdup_printf(
 		"insert into \"%s_%s\" (job_db_inx, id_step, step_het_comp, "
 		"time_start, timelimit, step_name, state, tres_alloc, "
 		"nodes_alloc, task_cnt, nodelist, node_inx, "
 		"task_dist, req_cpufreq, req_cpufreq_min, req_cpufreq_gov",
 		mysql_conn->cluster_name, step_table);
+	tail = xstrdup("on duplicate key update "
+		       "nodes_alloc=VALUES(nodes_alloc), "
+		       "task_cnt=VALUES(task_cnt), time_end=0, "
+		       "timelimit=VALUES(timelimit), state=VALUES(state), "
+		       "nodelist=VALUES(nodelist), node_inx=VALUES(node_inx), "
+		       "task_dist=VALUES(task_dist), "
+		       "req_cpufreq=VALUES(req_cpufreq), "
+		       "req_cpufreq_min=VALUES(req_cpufreq_min), "
+		       "req_cpufreq_gov=VALUES(req_cpufreq_gov), "
+		       "tres_alloc=VALUES(tres_alloc)");
+
+	if (step_ptr->cwd) {
+		xstrcat(head, ", cwd");
+		xstrcat(tail, ", cwd=VALUES(cwd)");
+	}
+	if (step_ptr->std_err) {
+		xstrcat(head, ", std_err");
+		xstrcat(tail, ", std_err=VALUES(std_err)");
+	}
+	if (step_ptr->std_in) {
+		xstrcat(head, ", std_in");
+		xstrcat(tail, ", std_in=VALUES(std_in)");
+	}
+	if (step_ptr->std_out) {
+		xstrcat(head, ", std_out");
+		xstrcat(tail, ", std_out=VALUES(std_out)");
+	}
+	if (step_ptr->submit_line) {
+		xstrcat(head, ", submit_line");
+		xstrcat(tail, ", submit_line=VALUES(submit_line)");
+	}
+	if (step_ptr->container) {
+		xstrcat(head, ", container");
+		xstrcat(tail, ", container=VALUES(container)");
+	}
+	xstrcat(head, ") values ");
 
-	if (step_ptr->cwd)
-		xstrcat(query, ", cwd");
-	if (step_ptr->std_err)
-		xstrcat(query, ", std_err");
-	if (step_ptr->std_in)
-		xstrcat(query, ", std_in");
-	if (step_ptr->std_out)
-		xstrcat(query, ", std_out");
-	if (step_ptr->submit_line)
-		xstrcat(query, ", submit_line");
-	if (step_ptr->container)
-		xstrcat(query, ", container");
-
-	xstrfmtcat(query,
-		   ") values (%"PRIu64", %d, %u, %d, %u, '%s', %d, '%s', %d, "
-		   "%d, '%s', '%s', %d, %u, %u, %u",
-		   step_ptr->job_ptr->db_index,
-		   step_ptr->step_id.step_id,
-		   step_ptr->step_id.step_het_comp,
-		   (int)start_time, step_ptr->time_limit, step_ptr->name,
-		   JOB_RUNNING, step_ptr->tres_alloc_str,
-		   nodes, tasks, node_list, node_inx, task_dist,
-		   step_ptr->cpu_freq_max, step_ptr->cpu_freq_min,
-		   step_ptr->cpu_freq_gov);
-
-	if (step_ptr->cwd)
-		xstrfmtcat(query, ", '%s'", step_ptr->cwd);
-	if (step_ptr->std_err)
-		xstrfmtcat(query, ", '%s'", step_ptr->std_err);
-	if (step_ptr->std_in)
-		xstrfmtcat(query, ", '%s'", step_ptr->std_in);
-	if (step_ptr->std_out)
-		xstrfmtcat(query, ", '%s'", step_ptr->std_out);
-	if (step_ptr->submit_line)
-		xstrfmtcat(query, ", '%s'", step_ptr->submit_line);
-	if (step_ptr->container)
-		xstrfmtcat(query, ", '%s'", step_ptr->container);
-
-	xstrfmtcat(query,
-		   ") on duplicate key update "
-		   "nodes_alloc=%d, task_cnt=%d, time_end=0, timelimit=%u, "
-		   "state=%d, nodelist='%s', node_inx='%s', task_dist=%d, "
-		   "req_cpufreq=%u, req_cpufreq_min=%u, req_cpufreq_gov=%u,"
-		   "tres_alloc='%s'",
-		   nodes, tasks, step_ptr->time_limit, JOB_RUNNING,
-		   node_list, node_inx, task_dist, step_ptr->cpu_freq_max,
-		   step_ptr->cpu_freq_min, step_ptr->cpu_freq_gov,
-		   step_ptr->tres_alloc_str);
+	/* we want to print a -1 for the requid so leave it a
+	   %d */
+	/* The stepid could be negative so use %d not %u */
+	row = xstrdup_printf(
+		"(%"PRIu64", %d, %u, %d, %u, '%s', %d, '%s', %d, "
+		"%d, '%s', '%s', %d, %u, %u, %u",
+		step_ptr->job_ptr->db_index,
+		step_ptr->step_id.step_id,
+		step_ptr->step_id.step_het_comp,
+		(int)start_time, step_ptr->time_limit, step_ptr->name,
+		JOB_RUNNING, step_ptr->tres_alloc_str,
+		nodes, tasks, node_list, node_inx, task_dist,
+		step_ptr->cpu_freq_max, step_ptr->cpu_freq_min,
+		step_ptr->cpu_freq_gov);
 
 	if (step_ptr->cwd)
-		xstrfmtcat(query, ", cwd='%s'", step_ptr->cwd);
+		xstrfmtcat(row, ", '%s'", step_ptr->cwd);
 	if (step_ptr->std_err)
-		xstrfmtcat(query, ", std_err='%s'", step_ptr->std_err);
+		xstrfmtcat(row, ", '%s'", step_ptr->std_err);
 	if (step_ptr->std_in)
-		xstrfmtcat(query, ", std_in='%s'", step_ptr->std_in);
+		xstrfmtcat(row, ", '%s'", step_ptr->std_in);
 	if (step_ptr->std_out)
-		xstrfmtcat(query, ", std_out='%s'", step_ptr->std_out);
+		xstrfmtcat(row, ", '%s'", step_ptr->std_out);
 	if (step_ptr->submit_line)
-		xstrfmtcat(query, ", submit_line='%s'", step_ptr->submit_line);
-
+		xstrfmtcat(row, ", '%s'", step_ptr->submit_line);
 	if (step_ptr->container)
-		xstrfmtcat(query, ", container='%s'", step_ptr->container);
+		xstrfmtcat(row, ", '%s'", step_ptr->container);
+	xstrcatchar(row, ')');
 
-	DB_DEBUG(DB_STEP, mysql_conn->conn, "query\n%s", query);
-	rc = mysql_db_query(mysql_conn, query);
-	xfree(query);
+	DB_DEBUG(DB_STEP, mysql_conn->conn, "query\n%s%s %s", head, row, tail);
+	rc = mysql_db_insert_batch(mysql_conn, head, row, tail);
+	xfree(head);
+	xfree(row);
+	xfree(tail);
 
 	return rc;
 }
@@ -1542,6 +1542,9 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 	int tasks = 0;
 	struct jobacctinfo *jobacct = (struct jobacctinfo *)step_ptr->jobacct;
 	char *query = NULL;
+	db_param_t params[29];
+	int param_cnt = 0;
+	slurmdb_stats_t stats = { 0 };
 	int rc = SLURM_SUCCESS;
 	uint32_t exit_code = 0;
 	time_t submit_time;
@@ -1627,23 +1630,25 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 	}
 
 	/* The stepid could be negative so use %d not %u */
+	/*
+	 * This runs for every step, so it is sent as a prepared statement.
+	 * There are only two forms of it (with and without jobacct), each is
+	 * prepared once per connection.
+	 */
 	query = xstrdup_printf(
-		"update \"%s_%s\" set time_end=%d, state=%u, exit_code=%d, ",
-		mysql_conn->cluster_name, step_table, (int)now,
-		comp_status,
-		exit_code);
-
+		"update \"%s_%s\" set time_end=?, state=?, exit_code=?, "
+		"kill_requid=?",
+		mysql_conn->cluster_name, step_table);
+	params[param_cnt++] = DB_PARAM_INT(now);
+	params[param_cnt++] = DB_PARAM_UINT(comp_status);
+	params[param_cnt++] = DB_PARAM_INT((int32_t) exit_code);
 	if (step_ptr->requid == (uid_t) -1)
-		xstrfmtcat(query, "kill_requid=null");
+		params[param_cnt++] = DB_PARAM_NULL();
 	else
-		xstrfmtcat(query, "kill_requid=%u", step_ptr->requid);
+		params[param_cnt++] = DB_PARAM_UINT(step_ptr->requid);
 
 
 	if (jobacct) {
-		slurmdb_stats_t stats;
-
-		memset(&stats, 0, sizeof(slurmdb_stats_t));
-
 		/* figure out the ave of the totals sent */
 		if (tasks > 0) {
 			stats.tres_usage_in_ave =
@@ -1720,66 +1725,68 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 			jobacct->tres_usage_out_tot,
 			jobacct->tres_count, 1);
 
-		xstrfmtcat(query,
-			   ", user_sec=%"PRIu64", user_usec=%u, "
-			   "sys_sec=%"PRIu64", sys_usec=%u, "
-			   "act_cpufreq=%u, consumed_energy=%"PRIu64", "
-			   "tres_usage_in_ave='%s', "
-			   "tres_usage_out_ave='%s', "
-			   "tres_usage_in_max='%s', "
-			   "tres_usage_in_max_taskid='%s', "
-			   "tres_usage_in_max_nodeid='%s', "
-			   "tres_usage_in_min='%s', "
-			   "tres_usage_in_min_taskid='%s', "
-			   "tres_usage_in_min_nodeid='%s', "
-			   "tres_usage_in_tot='%s', "
-			   "tres_usage_out_max='%s', "
-			   "tres_usage_out_max_taskid='%s', "
-			   "tres_usage_out_max_nodeid='%s', "
-			   "tres_usage_out_min='%s', "
-			   "tres_usage_out_min_taskid='%s', "
-			   "tres_usage_out_min_nodeid='%s', "
-			   "tres_usage_out_tot='%s'",
-			   /* user seconds */
-			   jobacct->user_cpu_sec,
-			   /* user microseconds */
-			   jobacct->user_cpu_usec,
-			   /* system seconds */
-			   jobacct->sys_cpu_sec,
-			   /* system microsecs */
-			   jobacct->sys_cpu_usec,
-			   jobacct->act_cpufreq,
-			   jobacct->energy.consumed_energy,
-			   stats.tres_usage_in_ave,
-			   stats.tres_usage_out_ave,
-			   stats.tres_usage_in_max,
-			   stats.tres_usage_in_max_taskid,
-			   stats.tres_usage_in_max_nodeid,
-			   stats.tres_usage_in_min,
-			   stats.tres_usage_in_min_taskid,
-			   stats.tres_usage_in_min_nodeid,
-			   stats.tres_usage_in_tot,
-			   stats.tres_usage_out_max,
-			   stats.tres_usage_out_max_taskid,
-			   stats.tres_usage_out_max_nodeid,
-			   stats.tres_usage_out_min,
-			   stats.tres_usage_out_min_taskid,
-			   stats.tres_usage_out_min_nodeid,
-			   stats.tres_usage_out_tot);
-
-		slurmdb_free_slurmdb_stats_members(&stats);
+		xstrcat(query,
+			", user_sec=?, user_usec=?, sys_sec=?, sys_usec=?, "
+			"act_cpufreq=?, consumed_energy=?, "
+			"tres_usage_in_ave=?, tres_usage_out_ave=?, "
+			"tres_usage_in_max=?, tres_usage_in_max_taskid=?, "
+			"tres_usage_in_max_nodeid=?, tres_usage_in_min=?, "
+			"tres_usage_in_min_taskid=?, "
+			"tres_usage_in_min_nodeid=?, tres_usage_in_tot=?, "
+			"tres_usage_out_max=?, tres_usage_out_max_taskid=?, "
+			"tres_usage_out_max_nodeid=?, tres_usage_out_min=?, "
+			"tres_usage_out_min_taskid=?, "
+			"tres_usage_out_min_nodeid=?, tres_usage_out_tot=?");
+		/* user seconds */
+		params[param_cnt++] = DB_PARAM_UINT(jobacct->user_cpu_sec);
+		/* user microseconds */
+		params[param_cnt++] = DB_PARAM_UINT(jobacct->user_cpu_usec);
+		/* system seconds */
+		params[param_cnt++] = DB_PARAM_UINT(jobacct->sys_cpu_sec);
+		/* system microsecs */
+		params[param_cnt++] = DB_PARAM_UINT(jobacct->sys_cpu_usec);
+		params[param_cnt++] = DB_PARAM_UINT(jobacct->act_cpufreq);
+		params[param_cnt++] =
+			DB_PARAM_UINT(jobacct->energy.consumed_energy);
+		params[param_cnt++] = DB_PARAM_STR(stats.tres_usage_in_ave);
+		params[param_cnt++] = DB_PARAM_STR(stats.tres_usage_out_ave);
+		params[param_cnt++] = DB_PARAM_STR(stats.tres_usage_in_max);
+		params[param_cnt++] =
+			DB_PARAM_STR(stats.tres_usage_in_max_taskid);
+		params[param_cnt++] =
+			DB_PARAM_STR(stats.tres_usage_in_max_nodeid);
+		params[param_cnt++] = DB_PARAM_STR(stats.tres_usage_in_min);
+		params[param_cnt++] =
+			DB_PARAM_STR(stats.tres_usage_in_min_taskid);
+		params[param_cnt++] =
+			DB_PARAM_STR(stats.tres_usage_in_min_nodeid);
+		params[param_cnt++] = DB_PARAM_STR(stats.tres_usage_in_tot);
+		params[param_cnt++] = DB_PARAM_STR(stats.tres_usage_out_max);
+		params[param_cnt++] =
+			DB_PARAM_STR(stats.tres_usage_out_max_taskid);
+		params[param_cnt++] =
+			DB_PARAM_STR(stats.tres_usage_out_max_nodeid);
+		params[param_cnt++] = DB_PARAM_STR(stats.tres_usage_out_min);
+		params[param_cnt++] =
+			DB_PARAM_STR(stats.tres_usage_out_min_taskid);
+		params[param_cnt++] =
+			DB_PARAM_STR(stats.tres_usage_out_min_nodeid);
+		params[param_cnt++] = DB_PARAM_STR(stats.tres_usage_out_tot);
 	}
 
-	/* id_step has to be %d here to handle the negative values for the batch
-	   and extern steps.  Don't change it to a %u.
+	/* id_step has to be signed here to handle the negative values for the
+	   batch and extern steps.  Don't change it to unsigned.
 	*/
-	xstrfmtcat(query,
-		   " where job_db_inx=%"PRIu64" and id_step=%d and step_het_comp=%u",
-		   step_ptr->job_ptr->db_index, step_ptr->step_id.step_id,
-		   step_ptr->step_id.step_het_comp);
-	DB_DEBUG(DB_STEP, mysql_conn->conn, "query\n%s", query);
-	rc = mysql_db_query(mysql_conn, query);
+	xstrcat(query, " where job_db_inx=? and id_step=? and step_het_comp=?");
+	params[param_cnt++] = DB_PARAM_UINT(step_ptr->job_ptr->db_index);
+	params[param_cnt++] = DB_PARAM_INT(step_ptr->step_id.step_id);
+	params[param_cnt++] = DB_PARAM_UINT(step_ptr->step_id.step_het_comp);
+	xassert(param_cnt <= ARRAY_SIZE(params));
+
+	DB_DEBUG_STMT(DB_STEP, mysql_conn->conn, query, params, param_cnt);
+	rc = mysql_db_stmt_query(mysql_conn, query, params, param_cnt, NULL);
 	xfree(query);
+	slurmdb_free_slurmdb_stats_members(&stats);
 
 	/* set the energy for the entire job. */
 	if (step_ptr->job_ptr->tres_alloc_str) {
@@ -42,6 +42,10 @@
 \*****************************************************************************/
 
 #include "as_mysql_jobacct_process.h"
+#include "as_mysql_partition.h"
+
+/* Max job records read at a time when streaming jobs back */
+#define JOB_PART_SIZE 1000
 
 typedef struct {
 	hostlist_t *hl;
@@ -497,23 +501,29 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 			     char *cluster_name,
 			     char *job_fields, char *step_fields,
 			     char *sent_extra,
-			     bool is_admin, int only_pending, list_t *sent_list)
+			     bool is_admin, int only_pending, list_t *sent_list,
+			     uint32_t part_size, uint32_t *part_job_id,
+			     time_t *part_submit, bool *more)
 {
 	char *query = NULL;
 	char *extra = xstrdup(sent_extra);
 	slurm_selected_step_t *selected_step = NULL;
-	MYSQL_RES *result = NULL, *step_result = NULL;
+	MYSQL_RES *result = NULL;
+	db_result_t *step_result = NULL;
+	db_param_t step_params[3];
+	uint32_t *step_ids = NULL;
+	int step_id_cnt = 0;
 	MYSQL_ROW row, step_row;
 	slurmdb_job_rec_t *job = NULL;
 	time_t now = time(NULL);
 	list_t *job_list = list_create(slurmdb_destroy_job_rec);
 	list_itr_t *itr = NULL, *itr2 = NULL;
 	list_t *local_cluster_list = NULL;
-	int set = 0;
 	char *prefix="t2";
 	int rc = SLURM_SUCCESS;
 	int last_id = -1, curr_id = -1;
 	int comb_id = 0;
+	uint32_t stop_id = 0;
 	local_cluster_t *curr_cluster = NULL;
 	bool jobid_filtered = false;
 
@@ -586,6 +596,12 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 			xstrcat(extra, " where (t1.time_end=0)");
 	}
 
+	/* Continue after the last record read in the previous part */
+	if (part_size && *part_job_id)
+		xstrfmtcat(extra, "%s((t1.id_job, t1.time_submit) < (%u, %ld))",
+			   extra ? " && " : " where ", *part_job_id,
+			   *part_submit);
+
 	if (extra) {
 		xstrcat(query, extra);
 		xfree(extra);
@@ -597,7 +613,20 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	   easy to look for duplicates, it is also easy to sort the
 	   resized jobs.
 	*/
-	xstrcat(query, " order by id_job, time_submit desc");
+	if (part_size) {
+		/*
+		 * Parts are split on (id_job, time_submit), which is unique,
+		 * so records of one job id spread over parts are all read.
+		 * Both go the same way so each part is a backward scan of
+		 * that index instead of sorting all the remaining jobs.
+		 */
+		xstrfmtcat(query, " order by t1.id_job desc, "
+			   "t1.time_submit desc limit %u", part_size);
+		/* Records of the last job id of the previous part */
+		if (*part_job_id)
+			last_id = *part_job_id;
+	} else
+		xstrcat(query, " order by id_job, time_submit desc");
 
 	DB_DEBUG(DB_JOB, mysql_conn->conn, "query\n%s", query);
 	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
@@ -607,6 +636,24 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	}
 	xfree(query);
 
+	*more = false;
+	if (part_size && (mysql_num_rows(result) >= part_size)) {
+		uint32_t first_id;
+
+		/*
+		 * Leave the records of the last job id for the next part so
+		 * duplicates are not split, unless that is all there is.
+		 */
+		*more = true;
+		row = mysql_fetch_row(result);
+		first_id = slurm_atoul(row[JOB_REQ_JOBID]);
+		mysql_data_seek(result, mysql_num_rows(result) - 1);
+		row = mysql_fetch_row(result);
+		if (first_id != slurm_atoul(row[JOB_REQ_JOBID]))
+			stop_id = slurm_atoul(row[JOB_REQ_JOBID]);
+		mysql_data_seek(result, 0);
+	}
+
 
 	/* Here we set up environment to check used nodes of jobs.
 	   Since we store the bitmap of the entire cluster we can use
@@ -632,6 +679,12 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 		int hetjob = slurm_atoul(row[JOB_REQ_HET_JOB_ID]);
 
 		curr_id = slurm_atoul(row[JOB_REQ_JOBID]);
+		if (stop_id && (curr_id == stop_id))
+			break;
+		if (part_size) {
+			*part_job_id = curr_id;
+			*part_submit = slurm_atoul(row[JOB_REQ_SUBMIT]);
+		}
 		if (job_cond && !(job_cond->flags & JOBCOND_FLAG_DUP)) {
 			if ((curr_id == last_id) &&
 			    (slurm_atoul(row[JOB_REQ_STATE]) != JOB_RESIZING))
@@ -912,9 +965,13 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 					 JOBCOND_FLAG_RUNAWAY))))
 			continue;
 
+		step_id_cnt = 0;
 		if (job_cond && job_cond->step_list
 		    && list_count(job_cond->step_list)) {
-			set = 0;
+			if (!step_ids)
+				step_ids = xcalloc(
+					list_count(job_cond->step_list),
+					sizeof(*step_ids));
 			itr = list_iterator_create(job_cond->step_list);
 			while ((selected_step = list_next(itr))) {
 				if ((selected_step->step_id.job_id !=
@@ -937,46 +994,38 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 				} else if (selected_step->step_id.step_id ==
 					   NO_VAL) {
 					job->show_full = 1;
+					step_id_cnt = 0;
 					break;
 				}
-				if (set)
-					xstrcat(extra, " || ");
-				else
-					xstrcat(extra, " && (");
-
-				/*
-				 * The stepid could be negative so use
-				 * %d not %u
-				 */
-				xstrfmtcat(extra, "t1.id_step=%d",
-					   selected_step->step_id.step_id);
-
-				set = 1;
+				step_ids[step_id_cnt++] =
+					selected_step->step_id.step_id;
 				job->show_full = 0;
 			}
 			list_iterator_destroy(itr);
-			if (set)
-				xstrcat(extra, ")");
 		}
 
+		/*
+		 * This runs once per job with the same text, so it goes
+		 * through a prepared statement. Steps selected in step_list
+		 * are picked from the rows below rather than added to the
+		 * query so that every job uses the same statement.
+		 */
 		query =	xstrdup_printf("select %s from \"%s_%s\" as t1 "
-				       "where t1.job_db_inx=%s && "
-				       "t1.time_start <= %ld && "
-				       "(!t1.time_end || t1.time_end >= %ld)",
+				       "where t1.job_db_inx=? && "
+				       "t1.time_start <= ? && "
+				       "(!t1.time_end || t1.time_end >= ?)",
 				       step_fields, cluster_name,
-				       step_table, db_inx_char,
-				       job_cond->usage_end,
-				       job_cond->usage_start);
+				       step_table);
+		step_params[0] = DB_PARAM_UINT(slurm_atoull(db_inx_char));
+		step_params[1] = DB_PARAM_INT(job_cond->usage_end);
+		step_params[2] = DB_PARAM_INT(job_cond->usage_start);
 
-		if (extra) {
-			xstrcat(query, extra);
-			xfree(extra);
-		}
+		DB_DEBUG_STMT(DB_STEP, mysql_conn->conn, query, step_params,
+			      ARRAY_SIZE(step_params));
 
-		DB_DEBUG(DB_STEP, mysql_conn->conn, "query\n%s", query);
-
-		if (!(step_result = mysql_db_query_ret(
-			      mysql_conn, query, 0))) {
+		if (!(step_result = mysql_db_stmt_query_result(
+			      mysql_conn, query, step_params,
+			      ARRAY_SIZE(step_params)))) {
 			xfree(query);
 			rc = SLURM_ERROR;
 			mysql_free_result(result);
@@ -988,8 +1037,21 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 		   doing only 1 query and then matching the steps up
 		   later with the job.
 		*/
-		while ((step_row = mysql_fetch_row(step_result))) {
+		for (uint64_t i = 0; i < step_result->row_cnt; i++) {
 			slurmdb_step_rec_t *step = NULL;
+
+			step_row = step_result->rows[i];
+			if (step_id_cnt) {
+				uint32_t step_id = slurm_atoul(
+					step_row[STEP_REQ_STEPID]);
+				int j;
+
+				for (j = 0; j < step_id_cnt; j++)
+					if (step_ids[j] == step_id)
+						break;
+				if (j == step_id_cnt)
+					continue;
+			}
 			/* check the bitmap to see if this is one of the steps
 			   we are looking for */
 			if (!good_nodes_from_inx(local_cluster_list,
@@ -1163,11 +1225,12 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 				step->tres_alloc_str =
 					xstrdup(step_row[STEP_REQ_TRES]);
 		}
-		mysql_free_result(step_result);
+		mysql_db_free_result(step_result);
 	}
 	mysql_free_result(result);
 
 end_it:
+	xfree(step_ids);
 	if (itr2)
 		list_iterator_destroy(itr2);
 
@@ -1410,6 +1473,19 @@ no_resv:
 		xstrcat(*extra, ")");
 	}
 
+	/*
+	 * Prune partitions when setup_job_cond_limits() limited the query to
+	 * the jobs of a time window.
+	 */
+	if (as_mysql_partition_enabled() &&
+	    !(job_cond->flags & JOBCOND_FLAG_RUNAWAY) &&
+	    (job_cond->usage_start || job_cond->usage_end) &&
+	    ((job_cond->state_list && list_count(job_cond->state_list)) ||
+	     !job_cond->step_list || !list_count(job_cond->step_list) ||
+	     !(job_cond->flags & JOBCOND_FLAG_NO_DEFAULT_USAGE)))
+		as_mysql_partition_job_cond(mysql_conn, cluster_name, job_cond,
+					    extra);
+
 	/* Don't show revoked sibling federated jobs w/out -D */
 	if (!(job_cond->flags & JOBCOND_FLAG_DUP))
 		xstrfmtcat(*extra, " %s (t1.state != %"PRIu64")",
@@ -1742,16 +1818,20 @@ extern int setup_job_cond_limits(slurmdb_job_cond_t *job_cond,
 	return set;
 }
 
-extern list_t *as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
-					         uid_t uid,
-					         slurmdb_job_cond_t *job_cond)
+/*
+ * Fill job_list with the jobs matching job_cond. If cb is set the jobs are
+ * read at most JOB_PART_SIZE at a time and job_list is handed to cb and
+ * emptied after each part.
+ */
+static int _get_jobs(mysql_conn_t *mysql_conn, uid_t uid,
+		     slurmdb_job_cond_t *job_cond, list_t *job_list,
+		     int (*cb)(list_t *job_list, void *arg), void *arg)
 {
 	char *extra = NULL;
 	char *tmp = NULL, *tmp2 = NULL;
 	list_itr_t *itr = NULL;
 	int is_admin=1;
-	int i;
-	list_t *job_list = NULL;
+	int i, rc = SLURM_SUCCESS;
 	slurmdb_user_rec_t user;
 	int only_pending = 0;
 	list_t *use_cluster_list = NULL;
@@ -1782,7 +1862,7 @@ extern list_t *as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 		if (!is_admin && !user.name) {
 			debug("User %u has no associations, and is not admin, "
 			      "so not returning any jobs.", user.uid);
-			return NULL;
+			return SLURM_ERROR;
 		}
 	}
 
@@ -1804,7 +1884,7 @@ extern list_t *as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 		if (reason) {
 			error("User %u is requesting %s, but no job requested, this is not allowed",
 			      user.uid, reason);
-			return NULL;
+			return SLURM_ERROR;
 		}
 	}
 
@@ -1832,7 +1912,12 @@ extern list_t *as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 	if (job_cond
 	    && job_cond->cluster_list && list_count(job_cond->cluster_list))
 		use_cluster_list = job_cond->cluster_list;
-	else {
+	else if (cb) {
+		/* Don't hold the lock while cb sends the parts */
+		slurm_rwlock_rdlock(&as_mysql_cluster_list_lock);
+		use_cluster_list = slurm_copy_char_list(as_mysql_cluster_list);
+		slurm_rwlock_unlock(&as_mysql_cluster_list_lock);
+	} else {
 		slurm_rwlock_rdlock(&as_mysql_cluster_list_lock);
 		use_cluster_list = list_shallow_copy(as_mysql_cluster_list);
 		locked = true;
@@ -1840,17 +1925,34 @@ extern list_t *as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 
 	assoc_mgr_lock(&locks);
 
-	job_list = list_create(slurmdb_destroy_job_rec);
 	itr = list_iterator_create(use_cluster_list);
-	while ((cluster_name = list_next(itr))) {
-		int rc;
+	while (!rc && (cluster_name = list_next(itr))) {
+		uint32_t part_job_id = 0;
+		time_t part_submit = 0;
+		bool more = false;
+
 		_setup_job_cond_selected_steps(job_cond, cluster_name, &extra);
-		if ((rc = _cluster_get_jobs(mysql_conn, &user, job_cond,
-					    cluster_name, tmp, tmp2, extra,
-					    is_admin, only_pending, job_list))
-		    != SLURM_SUCCESS)
-			error("Problem getting jobs for cluster %s",
-			      cluster_name);
+		do {
+			if (_cluster_get_jobs(mysql_conn, &user, job_cond,
+					      cluster_name, tmp, tmp2, extra,
+					      is_admin, only_pending, job_list,
+					      cb ? JOB_PART_SIZE : 0,
+					      &part_job_id, &part_submit,
+					      &more)
+			    != SLURM_SUCCESS) {
+				error("Problem getting jobs for cluster %s",
+				      cluster_name);
+				break;
+			}
+			if (!cb || !list_count(job_list))
+				continue;
+
+			/* Don't hold up writers while cb sends the part */
+			assoc_mgr_unlock(&locks);
+			rc = (*cb)(job_list, arg);
+			list_flush(job_list);
+			assoc_mgr_lock(&locks);
+		} while (!rc && more);
 	}
 	list_iterator_destroy(itr);
 
@@ -1859,11 +1961,43 @@ extern list_t *as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 	if (locked) {
 		FREE_NULL_LIST(use_cluster_list);
 		slurm_rwlock_unlock(&as_mysql_cluster_list_lock);
-	}
+	} else if (use_cluster_list != job_cond->cluster_list)
+		FREE_NULL_LIST(use_cluster_list);
 
 	xfree(tmp);
 	xfree(tmp2);
 	xfree(extra);
 
+	return rc;
+}
+
+extern list_t *as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
+					         uid_t uid,
+					         slurmdb_job_cond_t *job_cond)
+{
+	list_t *job_list = list_create(slurmdb_destroy_job_rec);
+
+	if (_get_jobs(mysql_conn, uid, job_cond, job_list, NULL, NULL))
+		FREE_NULL_LIST(job_list);
+
 	return job_list;
 }
+
+extern int as_mysql_jobacct_process_get_jobs_cb(mysql_conn_t *mysql_conn,
+						uid_t uid,
+						slurmdb_job_cond_t *job_cond,
+						int (*cb)(list_t *job_list,
+							  void *arg),
+						void *arg)
+{
+	list_t *job_list = list_create(slurmdb_destroy_job_rec);
+	int rc = _get_jobs(mysql_conn, uid, job_cond, job_list, cb, arg);
+
+	FREE_NULL_LIST(job_list);
+
+	/* Nothing is returned to users not allowed to see the jobs */
+	if (rc == SLURM_ERROR)
+		rc = SLURM_SUCCESS;
+
+	return rc;
+}
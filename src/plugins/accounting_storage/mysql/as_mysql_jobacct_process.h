@@ -61,4 +61,15 @@ extern list_t *as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 						 uid_t uid,
 						 slurmdb_job_cond_t *job_cond);
 
+/*
+ * Same as as_mysql_jobacct_process_get_jobs() but hands the jobs to cb a part
+ * at a time, ordered by job id within each cluster.
+ */
+extern int as_mysql_jobacct_process_get_jobs_cb(mysql_conn_t *mysql_conn,
+						uid_t uid,
+						slurmdb_job_cond_t *job_cond,
+						int (*cb)(list_t *job_list,
+							  void *arg),
+						void *arg);
+
 #endif
@@ -0,0 +1,386 @@
+/*****************************************************************************\
+ *  as_mysql_partition.c - functions dealing with partitioned job tables.
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "as_mysql_partition.h"
+#include "src/common/slurm_time.h"
+
+/* Months after the current one that always have a partition */
+#define PARTITION_MONTHS_AHEAD 2
+
+static void _destroy_part(void *object)
+{
+	as_mysql_part_t *part = object;
+
+	if (part) {
+		xfree(part->name);
+		xfree(part);
+	}
+}
+
+/* Start of the month of when, moved by add months */
+static time_t _month_start(time_t when, int add)
+{
+	struct tm tm;
+
+	localtime_r(&when, &tm);
+	tm.tm_sec = 0;
+	tm.tm_min = 0;
+	tm.tm_hour = 0;
+	tm.tm_mday = 1;
+	tm.tm_mon += add;
+	tm.tm_isdst = -1;
+
+	return slurm_mktime(&tm);
+}
+
+/* RET 1 if query returns a row, 0 if not, or SLURM_ERROR */
+static int _probe(mysql_conn_t *mysql_conn, char *query)
+{
+	MYSQL_RES *result;
+	int found;
+
+	DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+	if (!(result = mysql_db_query_ret(mysql_conn, query, 0)))
+		return SLURM_ERROR;
+	found = mysql_num_rows(result) ? 1 : 0;
+	mysql_free_result(result);
+
+	return found;
+}
+
+extern bool as_mysql_partition_enabled(void)
+{
+	return (slurmdbd_conf->flags & DBD_CONF_FLAG_PARTITION_JOBS);
+}
+
+extern char *as_mysql_partition_column(char *table)
+{
+	if (table == job_table)
+		return "time_submit";
+	if (table == step_table)
+		return "time_start";
+	return NULL;
+}
+
+extern list_t *as_mysql_partition_get(mysql_conn_t *mysql_conn,
+				      char *cluster_name, char *table)
+{
+	MYSQL_RES *result;
+	MYSQL_ROW row;
+	list_t *part_list;
+	char *query = xstrdup_printf(
+		"select partition_name, partition_description from "
+		"information_schema.partitions where "
+		"table_schema=database() && table_name='%s_%s' && "
+		"partition_name is not null "
+		"order by partition_ordinal_position",
+		cluster_name, table);
+
+	DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+	result = mysql_db_query_ret(mysql_conn, query, 0);
+	xfree(query);
+	if (!result)
+		return NULL;
+
+	part_list = list_create(_destroy_part);
+	while ((row = mysql_fetch_row(result))) {
+		as_mysql_part_t *part = xmalloc(sizeof(*part));
+
+		part->name = xstrdup(row[0]);
+		if (row[1] && xstrcasecmp(row[1], "MAXVALUE"))
+			part->end = slurm_atoul(row[1]);
+		list_append(part_list, part);
+	}
+	mysql_free_result(result);
+
+	return part_list;
+}
+
+extern char *as_mysql_partition_defs(time_t start)
+{
+	time_t last = _month_start(time(NULL), PARTITION_MONTHS_AHEAD + 1);
+	time_t month = _month_start(start, 0);
+	char *defs = NULL;
+
+	while (month < last) {
+		time_t next = _month_start(month, 1);
+		struct tm tm;
+
+		localtime_r(&month, &tm);
+		xstrfmtcat(defs, "partition p%04d%02d values less than (%ld), ",
+			   tm.tm_year + 1900, tm.tm_mon + 1, next);
+		month = next;
+	}
+	xstrcat(defs, "partition pmax values less than maxvalue");
+
+	return defs;
+}
+
+extern int as_mysql_partition_maintain(mysql_conn_t *mysql_conn,
+				       char *cluster_name)
+{
+	char *tables[] = { job_table, step_table, NULL };
+	time_t target = _month_start(time(NULL), PARTITION_MONTHS_AHEAD + 1);
+	int rc = SLURM_SUCCESS;
+
+	for (int i = 0; tables[i]; i++) {
+		list_t *part_list;
+		as_mysql_part_t *part;
+		time_t last = 0;
+		bool has_max = false;
+		list_itr_t *itr;
+		char *defs, *query;
+
+		if (!(part_list = as_mysql_partition_get(mysql_conn,
+							 cluster_name,
+							 tables[i]))) {
+			rc = SLURM_ERROR;
+			continue;
+		}
+
+		itr = list_iterator_create(part_list);
+		while ((part = list_next(itr))) {
+			if (!part->end)
+				has_max = true;
+			else
+				last = part->end;
+		}
+		list_iterator_destroy(itr);
+		FREE_NULL_LIST(part_list);
+
+		/* Not partitioned, or partitioned by hand */
+		if (!last || !has_max || (last >= target))
+			continue;
+
+		defs = as_mysql_partition_defs(last);
+		query = xstrdup_printf("alter table \"%s_%s\" reorganize "
+				       "partition pmax into (%s)",
+				       cluster_name, tables[i], defs);
+		xfree(defs);
+
+		DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+		if (mysql_db_query(mysql_conn, query) != SLURM_SUCCESS) {
+			error("Couldn't add partitions to %s_%s",
+			      cluster_name, tables[i]);
+			rc = SLURM_ERROR;
+		}
+		xfree(query);
+	}
+
+	return rc;
+}
+
+extern void as_mysql_partition_job_cond(mysql_conn_t *mysql_conn,
+					char *cluster_name,
+					slurmdb_job_cond_t *job_cond,
+					char **extra)
+{
+	list_t *part_list;
+	list_itr_t *itr;
+	as_mysql_part_t *part;
+	time_t lower = 0;
+
+	/* Every job of the window was submitted before it ended */
+	if (job_cond->usage_end)
+		xstrfmtcat(*extra, "%s(t1.time_submit <= %ld)",
+			   *extra ? " && " : " where ", job_cond->usage_end);
+
+	if (!job_cond->usage_start ||
+	    !(part_list = as_mysql_partition_get(mysql_conn, cluster_name,
+						 job_table)))
+		return;
+
+	/*
+	 * Jobs of the window ended after its start or haven't ended. Skip
+	 * the oldest partitions that don't hold any such job, each check is
+	 * a lookup in the time_end index of one partition.
+	 */
+	itr = list_iterator_create(part_list);
+	while ((part = list_next(itr)) && part->end &&
+	       (lower < job_cond->usage_start)) {
+		char *query = xstrdup_printf(
+			"select 1 from \"%s_%s\" where "
+			"time_submit >= %ld && time_submit < %ld && "
+			"(time_end >= %ld || time_end = 0) limit 1",
+			cluster_name, job_table, lower, part->end,
+			job_cond->usage_start);
+		int found = _probe(mysql_conn, query);
+
+		xfree(query);
+		if (found == SLURM_ERROR) {
+			lower = 0;
+			break;
+		} else if (found) {
+			break;
+		}
+		lower = part->end;
+	}
+	list_iterator_destroy(itr);
+	FREE_NULL_LIST(part_list);
+
+	if (lower)
+		xstrfmtcat(*extra, "%s(t1.time_submit >= %ld)",
+			   *extra ? " && " : " where ", lower);
+}
+
+/* Mark the env and script hashes of the jobs of a partition for purging */
+static int _mark_job_hashes(mysql_conn_t *mysql_conn, char *cluster_name,
+			    char *part_name)
+{
+	char *query = NULL;
+	int rc;
+
+	xstrfmtcat(query,
+		   "update \"%s_%s\" e inner join (select distinct "
+		   "env_hash_inx from \"%s_%s\" partition (%s)) as j "
+		   "on e.hash_inx = j.env_hash_inx set e.deleted = 1;",
+		   cluster_name, job_env_table, cluster_name, job_table,
+		   part_name);
+	xstrfmtcat(query,
+		   "update \"%s_%s\" e inner join (select distinct "
+		   "script_hash_inx from \"%s_%s\" partition (%s)) as j "
+		   "on e.hash_inx = j.script_hash_inx set e.deleted = 1;",
+		   cluster_name, job_script_table, cluster_name, job_table,
+		   part_name);
+
+	DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+	if (!(rc = mysql_db_query(mysql_conn, query)))
+		rc = mysql_db_commit(mysql_conn);
+	xfree(query);
+
+	return rc;
+}
+
+static int _purge_job_hashes(mysql_conn_t *mysql_conn, char *cluster_name)
+{
+	char *tables[] = { job_env_table, job_script_table, NULL };
+	int rc = SLURM_SUCCESS;
+
+	for (int i = 0; tables[i] && (rc == SLURM_SUCCESS); i++) {
+		char *query = xstrdup_printf(
+			"delete from \"%s_%s\" where deleted=1 LIMIT %d",
+			cluster_name, tables[i],
+			slurmdbd_conf->max_purge_limit);
+
+		while ((rc = mysql_db_delete_affected_rows(mysql_conn,
+							   query)) > 0) {
+			if ((rc = mysql_db_commit(mysql_conn)))
+				break;
+		}
+		xfree(query);
+		if (rc < 0)
+			rc = SLURM_ERROR;
+	}
+
+	return rc;
+}
+
+extern int as_mysql_partition_purge(mysql_conn_t *mysql_conn,
+				    char *cluster_name, char *table,
+				    time_t purge_end, bool require_empty)
+{
+	list_t *part_list;
+	list_itr_t *itr;
+	as_mysql_part_t *part;
+	int rc = SLURM_SUCCESS, dropped = 0;
+
+	if (!as_mysql_partition_column(table))
+		return SLURM_SUCCESS;
+
+	if (!(part_list = as_mysql_partition_get(mysql_conn, cluster_name,
+						 table)))
+		return SLURM_ERROR;
+
+	/*
+	 * A partition only holds records that started (or were submitted)
+	 * before its end, so it can go once none of them ended after
+	 * purge_end or is still going.
+	 */
+	itr = list_iterator_create(part_list);
+	while ((part = list_next(itr)) && part->end &&
+	       (part->end <= purge_end)) {
+		char *query;
+		int found;
+
+		if (require_empty)
+			query = xstrdup_printf(
+				"select 1 from \"%s_%s\" partition (%s) "
+				"limit 1",
+				cluster_name, table, part->name);
+		else
+			query = xstrdup_printf(
+				"select 1 from \"%s_%s\" partition (%s) "
+				"where time_end = 0 || time_end > %ld limit 1",
+				cluster_name, table, part->name, purge_end);
+		found = _probe(mysql_conn, query);
+		xfree(query);
+
+		if (found == SLURM_ERROR) {
+			rc = SLURM_ERROR;
+			break;
+		} else if (found) {
+			continue;
+		}
+
+		if ((table == job_table) && !require_empty &&
+		    (rc = _mark_job_hashes(mysql_conn, cluster_name,
+					   part->name)))
+			break;
+
+		query = xstrdup_printf("alter table \"%s_%s\" "
+				       "drop partition %s",
+				       cluster_name, table, part->name);
+		DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+		if (rc != SLURM_SUCCESS) {
+			error("Couldn't drop partition %s of %s_%s",
+			      part->name, cluster_name, table);
+			break;
+		}
+
+		log_flag(DB_ARCHIVE, "Dropped partition %s of %s_%s",
+			 part->name, cluster_name, table);
+		dropped++;
+	}
+	list_iterator_destroy(itr);
+	FREE_NULL_LIST(part_list);
+
+	if (dropped && (table == job_table) && !require_empty &&
+	    (rc == SLURM_SUCCESS))
+		rc = _purge_job_hashes(mysql_conn, cluster_name);
+
+	return rc;
+}
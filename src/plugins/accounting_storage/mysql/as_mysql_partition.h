@@ -0,0 +1,90 @@
+/*****************************************************************************\
+ *  as_mysql_partition.h - functions dealing with partitioned job tables.
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_MYSQL_PARTITION_H
+#define _HAVE_MYSQL_PARTITION_H
+
+#include "accounting_storage_mysql.h"
+
+typedef struct {
+	time_t end;		/* values less than, 0 for MAXVALUE */
+	char *name;
+} as_mysql_part_t;
+
+/* True if Parameters=partition_job_tables is set in slurmdbd.conf */
+extern bool as_mysql_partition_enabled(void);
+
+/* Column a cluster table is partitioned on, NULL if it isn't partitioned */
+extern char *as_mysql_partition_column(char *table);
+
+/*
+ * Get the range partitions of a cluster table, oldest first.
+ * RET list of as_mysql_part_t, empty if the table isn't partitioned, or NULL
+ * on error.
+ */
+extern list_t *as_mysql_partition_get(mysql_conn_t *mysql_conn,
+				      char *cluster_name, char *table);
+
+/*
+ * Build the definitions of monthly partitions starting with the month of
+ * start and ending a couple of months after the current one, followed by a
+ * MAXVALUE partition.
+ */
+extern char *as_mysql_partition_defs(time_t start);
+
+/* Add the monthly partitions of the coming months to a cluster's tables */
+extern int as_mysql_partition_maintain(mysql_conn_t *mysql_conn,
+				       char *cluster_name);
+
+/*
+ * Add time_submit limits to a job query so MySQL only looks at the
+ * partitions that can hold jobs of the job_cond time window.
+ */
+extern void as_mysql_partition_job_cond(mysql_conn_t *mysql_conn,
+					char *cluster_name,
+					slurmdb_job_cond_t *job_cond,
+					char **extra);
+
+/*
+ * Drop the partitions of table that only hold records that ended before
+ * purge_end.
+ * IN require_empty - only drop partitions that are already empty, used after
+ *	the records have been archived and deleted.
+ */
+extern int as_mysql_partition_purge(mysql_conn_t *mysql_conn,
+				    char *cluster_name, char *table,
+				    time_t purge_end, bool require_empty);
+
+#endif
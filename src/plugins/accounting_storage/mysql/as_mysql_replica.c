@@ -0,0 +1,256 @@
+/*****************************************************************************\
+ *  as_mysql_replica.c - functions dealing with the read replica.
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "as_mysql_replica.h"
+
+/* How often the primary's heartbeat is written and the replica checked */
+#define REPLICA_HEARTBEAT_SECS 5
+
+static char *replica_heartbeat_table = "replica_heartbeat_table";
+
+static char *db_name = NULL;
+static mysql_db_info_t *primary_info = NULL;
+static mysql_db_info_t *replica_info = NULL;
+
+static pthread_t heartbeat_tid = 0;
+static pthread_mutex_t heartbeat_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t heartbeat_cond = PTHREAD_COND_INITIALIZER;
+static bool heartbeat_stop = false;
+
+static pthread_mutex_t check_lock = PTHREAD_MUTEX_INITIALIZER;
+static time_t check_time = 0;
+static bool checking = false; /* a thread is measuring the lag */
+static bool replica_ok = false;
+
+/*
+ * Write the current time to the primary every REPLICA_HEARTBEAT_SECS. What
+ * the replica has of it tells how far behind it is, within that many seconds,
+ * whether or not anything else is written in the meantime.
+ */
+static void *_heartbeat(void *arg)
+{
+	storage_field_t heartbeat_fields[] = {
+		{ "id", "tinyint unsigned not null" },
+		{ "beat", "bigint unsigned not null" },
+		{ NULL, NULL}
+	};
+	mysql_conn_t *mysql_conn = create_mysql_conn(0, false, NULL);
+	bool created = false;
+	struct timespec ts = {0, 0};
+
+	slurm_mutex_lock(&heartbeat_lock);
+	while (!heartbeat_stop) {
+		char *query;
+
+		slurm_mutex_unlock(&heartbeat_lock);
+
+		if (!mysql_conn->db_conn &&
+		    (mysql_db_get_db_connection(mysql_conn, db_name,
+						primary_info) != SLURM_SUCCESS))
+			goto next;
+
+		if (!created &&
+		    (mysql_db_create_table(mysql_conn, replica_heartbeat_table,
+					   heartbeat_fields,
+					   ", primary key (id))") ==
+		     SLURM_ERROR))
+			goto next;
+		created = true;
+
+		query = xstrdup_printf("insert into %s (id, beat) values (1, %ld) on duplicate key update beat=VALUES(beat);",
+				       replica_heartbeat_table,
+				       (long) time(NULL));
+		DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+		if (mysql_db_query(mysql_conn, query) != SLURM_SUCCESS)
+			mysql_db_close_db_connection(mysql_conn);
+		xfree(query);
+next:
+		slurm_mutex_lock(&heartbeat_lock);
+		if (heartbeat_stop)
+			break;
+		ts.tv_sec = time(NULL) + REPLICA_HEARTBEAT_SECS;
+		slurm_cond_timedwait(&heartbeat_cond, &heartbeat_lock, &ts);
+	}
+	slurm_mutex_unlock(&heartbeat_lock);
+
+	destroy_mysql_conn(mysql_conn);
+
+	return NULL;
+}
+
+/*
+ * Measure how far behind the primary the replica is.
+ * NOTE: mysql_conn must be on the replica.
+ * RET seconds or INFINITE if it couldn't be told
+ */
+static uint32_t _replica_lag(mysql_conn_t *mysql_conn)
+{
+	MYSQL_RES *result;
+	MYSQL_ROW row;
+	char *query;
+	time_t now = time(NULL), beat = 0;
+
+	query = xstrdup_printf("select beat from %s where id=1",
+			       replica_heartbeat_table);
+	DB_DEBUG(DB_QUERY, mysql_conn->conn, "query\n%s", query);
+	result = mysql_db_query_ret(mysql_conn, query, 0);
+	xfree(query);
+	if (!result)
+		return INFINITE;
+
+	if ((row = mysql_fetch_row(result)) && row[0])
+		beat = slurm_atoul(row[0]);
+	mysql_free_result(result);
+
+	if (!beat)
+		return INFINITE;
+	if (beat >= now)
+		return 0;
+	return now - beat;
+}
+
+/* Remember how the replica did until the next check is due */
+static void _set_replica_ok(bool ok, uint32_t lag)
+{
+	if (ok && !replica_ok)
+		info("Using read replica %s for queries", replica_info->host);
+	else if (!ok && replica_ok) {
+		if (lag == INFINITE)
+			info("Read replica %s is unavailable, queries go to the primary",
+			     replica_info->host);
+		else
+			info("Read replica %s is %u seconds behind, queries go to the primary",
+			     replica_info->host, lag);
+	}
+
+	replica_ok = ok;
+	check_time = time(NULL);
+}
+
+extern void as_mysql_replica_init(char *name, mysql_db_info_t *primary_db_info)
+{
+	if (!slurmdbd_conf->storage_replica_host)
+		return;
+
+	db_name = xstrdup(name);
+	primary_info = primary_db_info;
+	replica_info = create_mysql_db_info(SLURM_MYSQL_PLUGIN_AS_REPLICA);
+
+	if (slurmdbd_conf->storage_replica_max_lag < REPLICA_HEARTBEAT_SECS)
+		info("StorageReplicaMaxLag is below the %d second heartbeat, the replica will rarely be used",
+		     REPLICA_HEARTBEAT_SECS);
+
+	heartbeat_stop = false;
+	slurm_thread_create(&heartbeat_tid, _heartbeat, NULL);
+}
+
+extern void as_mysql_replica_fini(void)
+{
+	if (!replica_info)
+		return;
+
+	slurm_mutex_lock(&heartbeat_lock);
+	heartbeat_stop = true;
+	slurm_cond_signal(&heartbeat_cond);
+	slurm_mutex_unlock(&heartbeat_lock);
+	slurm_thread_join(heartbeat_tid);
+
+	destroy_mysql_db_info(replica_info);
+	replica_info = NULL;
+	primary_info = NULL;
+	xfree(db_name);
+}
+
+extern bool as_mysql_replica_begin(mysql_conn_t *mysql_conn)
+{
+	bool ok, check = false;
+
+	if (!replica_info || !mysql_conn)
+		return false;
+
+	slurm_mutex_lock(&check_lock);
+	if (!replica_ok &&
+	    ((time(NULL) - check_time) < REPLICA_HEARTBEAT_SECS)) {
+		slurm_mutex_unlock(&check_lock);
+		return false;
+	}
+	slurm_mutex_unlock(&check_lock);
+
+	if ((mysql_db_get_replica_connection(mysql_conn, db_name,
+					     replica_info) != SLURM_SUCCESS) ||
+	    (mysql_db_use_replica(mysql_conn, true) != SLURM_SUCCESS)) {
+		slurm_mutex_lock(&check_lock);
+		_set_replica_ok(false, INFINITE);
+		slurm_mutex_unlock(&check_lock);
+		return false;
+	}
+
+	/*
+	 * One thread measures the lag once it is due, without the lock held.
+	 * The others go by the last measure meanwhile.
+	 */
+	slurm_mutex_lock(&check_lock);
+	if (!checking &&
+	    ((time(NULL) - check_time) >= REPLICA_HEARTBEAT_SECS))
+		checking = check = true;
+	ok = replica_ok;
+	slurm_mutex_unlock(&check_lock);
+
+	if (check) {
+		uint32_t lag = _replica_lag(mysql_conn);
+
+		slurm_mutex_lock(&check_lock);
+		_set_replica_ok(
+			(lag <= slurmdbd_conf->storage_replica_max_lag), lag);
+		checking = false;
+		ok = replica_ok;
+		slurm_mutex_unlock(&check_lock);
+	}
+
+	if (!ok)
+		mysql_db_use_replica(mysql_conn, false);
+
+	return ok;
+}
+
+extern void as_mysql_replica_end(mysql_conn_t *mysql_conn, bool replica)
+{
+	int save_errno = errno;
+
+	if (replica)
+		mysql_db_use_replica(mysql_conn, false);
+
+	errno = save_errno;
+}
@@ -0,0 +1,58 @@
+/*****************************************************************************\
+ *  as_mysql_replica.h - functions dealing with the read replica.
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_MYSQL_REPLICA_H
+#define _HAVE_MYSQL_REPLICA_H
+
+#include "accounting_storage_mysql.h"
+
+/*
+ * Start writing the heartbeat the replica lag is measured with if
+ * StorageReplicaHost is set in slurmdbd.conf.
+ */
+extern void as_mysql_replica_init(char *name,
+				  mysql_db_info_t *primary_db_info);
+extern void as_mysql_replica_fini(void);
+
+/*
+ * Send the queries of a read only request to the replica if it is up and not
+ * lagging more than StorageReplicaMaxLag behind the primary.
+ * RET true if the queries now go to the replica, pass to
+ *	as_mysql_replica_end() once the request is done.
+ */
+extern bool as_mysql_replica_begin(mysql_conn_t *mysql_conn);
+extern void as_mysql_replica_end(mysql_conn_t *mysql_conn, bool replica);
+
+#endif
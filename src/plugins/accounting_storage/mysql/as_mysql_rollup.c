@@ -94,6 +94,21 @@ typedef struct {
 	double unused_wall;
 } local_resv_usage_t;
 
+typedef struct {
+	pthread_cond_t cond;
+	pthread_mutex_t lock;
+	int running;
+} hour_rollup_t;
+
+typedef struct {
+	char *cluster_name;
+	int conn;
+	time_t end;
+	int rc;
+	hour_rollup_t *rollup;
+	time_t start;
+} hour_range_t;
+
 static void _destroy_local_tres_usage(void *object)
 {
 	local_tres_usage_t *a_usage = (local_tres_usage_t *)object;
@@ -1301,10 +1316,11 @@ static local_id_usage_t *_check_q_usage(list_t *qos_usage_list,
 	return curr_q_usage;
 }
 
-extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
-				  char *cluster_name,
-				  time_t start, time_t end,
-				  uint16_t archive_data)
+/*
+ * Roll up the hours in [start, end) of a cluster. Nothing is committed here.
+ */
+static int _hourly_rollup_range(mysql_conn_t *mysql_conn, char *cluster_name,
+				time_t start, time_t end)
 {
 	int rc = SLURM_SUCCESS;
 	int add_sec = 3600;
@@ -1992,20 +2008,163 @@ end_it:
 /* 	info("stop start %s", slurm_ctime2(&curr_start)); */
 /* 	info("stop end %s", slurm_ctime2(&curr_end)); */
 
-	/* go check to see if we archive and purge */
+	return rc;
+}
 
+/*
+ * Commit a range as soon as it is rolled up. Nothing waits for other ranges
+ * with the transaction still open, and last_ran is left to the caller.
+ */
+static int _commit_hour_range(mysql_conn_t *mysql_conn, hour_range_t *range,
+			      int rc)
+{
 	if (rc == SLURM_SUCCESS) {
 		if (mysql_db_commit(mysql_conn)) {
 			char start[25], end[25];
 			error("Couldn't commit cluster (%s) "
 			      "hour rollup for %s - %s",
-			      cluster_name, slurm_ctime2_r(&curr_start, start),
-			      slurm_ctime2_r(&curr_end, end));
+			      range->cluster_name,
+			      slurm_ctime2_r(&range->start, start),
+			      slurm_ctime2_r(&range->end, end));
 			rc = SLURM_ERROR;
-		} else
-			rc = _process_purge(mysql_conn, cluster_name,
-					    archive_data, SLURMDB_PURGE_HOURS);
+		}
 	}
+	if ((rc != SLURM_SUCCESS) && mysql_db_rollback(mysql_conn))
+		error("rollback failed");
+
+	return rc;
+}
+
+static void *_hourly_rollup_worker(void *arg)
+{
+	hour_range_t *range = arg;
+	hour_rollup_t *rollup = range->rollup;
+	mysql_conn_t mysql_conn;
+	int rc;
+
+	memset(&mysql_conn, 0, sizeof(mysql_conn_t));
+	mysql_conn.flags |= DB_CONN_FLAG_ROLLBACK;
+	mysql_conn.conn = range->conn;
+	slurm_mutex_init(&mysql_conn.lock);
+
+	/* Each thread needs it's own connection */
+	if ((rc = check_connection(&mysql_conn)) == SLURM_SUCCESS)
+		rc = _hourly_rollup_range(&mysql_conn, range->cluster_name,
+					  range->start, range->end);
+	rc = _commit_hour_range(&mysql_conn, range, rc);
+
+	mysql_db_close_db_connection(&mysql_conn);
+	slurm_mutex_destroy(&mysql_conn.lock);
+
+	slurm_mutex_lock(&rollup->lock);
+	range->rc = rc;
+	rollup->running--;
+	slurm_cond_broadcast(&rollup->cond);
+	slurm_mutex_unlock(&rollup->lock);
+
+	return NULL;
+}
+
+extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
+				  char *cluster_name,
+				  time_t start, time_t end,
+				  uint16_t archive_data,
+				  bool save_last_ran)
+{
+	int rc = SLURM_SUCCESS;
+	int hours = (end - start + 3599) / 3600;
+	int workers = 1, per_worker;
+	hour_rollup_t rollup = { 0 };
+	hour_range_t *ranges;
+	time_t done = start;
+	char *query = NULL;
+
+	if (slurmdbd_conf && (slurmdbd_conf->rollup_workers > 1))
+		workers = MIN(slurmdbd_conf->rollup_workers, hours);
+
+	if (workers <= 1) {
+		/*
+		 * Everything stays in the caller's transaction, committed
+		 * here as a whole before purging.
+		 */
+		rc = _hourly_rollup_range(mysql_conn, cluster_name, start, end);
+		if ((rc == SLURM_SUCCESS) && mysql_db_commit(mysql_conn)) {
+			char start_str[25], end_str[25];
+			error("Couldn't commit cluster (%s) "
+			      "hour rollup for %s - %s",
+			      cluster_name, slurm_ctime2_r(&start, start_str),
+			      slurm_ctime2_r(&end, end_str));
+			rc = SLURM_ERROR;
+		}
+		goto purge;
+	}
+
+	/*
+	 * Hours are independent of each other, so hand each worker a
+	 * contiguous range of them to roll up on its own connection. Each
+	 * range commits on its own, see _commit_hour_range().
+	 */
+	per_worker = (hours + workers - 1) / workers;
+	workers = (hours + per_worker - 1) / per_worker;
+	ranges = xcalloc(workers, sizeof(*ranges));
+	slurm_mutex_init(&rollup.lock);
+	slurm_cond_init(&rollup.cond, NULL);
+	rollup.running = workers;
+	for (int i = 0; i < workers; i++) {
+		ranges[i].cluster_name = cluster_name;
+		ranges[i].conn = mysql_conn->conn;
+		ranges[i].rollup = &rollup;
+		ranges[i].start = start + (time_t) i * per_worker * 3600;
+		ranges[i].end = MIN(ranges[i].start +
+				    (time_t) per_worker * 3600, end);
+		slurm_thread_create_detached(_hourly_rollup_worker,
+					     &ranges[i]);
+	}
+
+	slurm_mutex_lock(&rollup.lock);
+	while (rollup.running)
+		slurm_cond_wait(&rollup.cond, &rollup.lock);
+	slurm_mutex_unlock(&rollup.lock);
+
+	for (int i = 0; i < workers; i++) {
+		if (ranges[i].rc != SLURM_SUCCESS) {
+			rc = ranges[i].rc;
+			break;
+		}
+		done = ranges[i].end;
+	}
+	xfree(ranges);
+
+	/*
+	 * The workers leave last_ran alone, so move it here past the ranges
+	 * committed without a gap. Ranges committed past a failed one are
+	 * rolled up again next time, which just overwrites them.
+	 */
+	if (save_last_ran && (done > start)) {
+		int rc2;
+
+		query = xstrdup_printf("update \"%s_%s\" set hourly_rollup=%ld",
+				       cluster_name, last_ran_table, done);
+		DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s", query);
+		rc2 = mysql_db_query(mysql_conn, query);
+		xfree(query);
+		if ((rc2 == SLURM_SUCCESS) && mysql_db_commit(mysql_conn))
+			rc2 = SLURM_ERROR;
+		if (rc2 != SLURM_SUCCESS) {
+			error("Couldn't save cluster (%s) hour rollup progress",
+			      cluster_name);
+			rc = rc2;
+		}
+	}
+
+	slurm_mutex_destroy(&rollup.lock);
+	slurm_cond_destroy(&rollup.cond);
+
+purge:
+	/* go check to see if we archive and purge */
+	if (rc == SLURM_SUCCESS)
+		rc = _process_purge(mysql_conn, cluster_name,
+				    archive_data, SLURMDB_PURGE_HOURS);
 
 	return rc;
 }
@@ -37,7 +37,9 @@
 \*****************************************************************************/
 
 #include "as_mysql_cluster.h"
+#include "as_mysql_partition.h"
 #include "as_mysql_usage.h"
+#include "as_mysql_usage_cache.h"
 #include "as_mysql_rollup.h"
 #include "src/common/macros.h"
 #include "src/common/slurm_time.h"
@@ -81,6 +83,7 @@ static void *_cluster_rollup_usage(void *arg)
 	time_t day_end;
 	time_t month_start;
 	time_t month_end;
+	time_t cache_start = 0;
 	DEF_TIMERS;
 
 	char *update_req_inx[] = {
@@ -107,6 +110,11 @@ static void *_cluster_rollup_usage(void *arg)
 	if (rc != SLURM_SUCCESS)
 		goto end_it;
 
+	/* Keep partitions ahead of the jobs about to be added */
+	if (as_mysql_partition_enabled())
+		(void) as_mysql_partition_maintain(&mysql_conn,
+						   local_rollup->cluster_name);
+
 	if (!local_rollup->sent_start) {
 		char *tmp = NULL, *sep = "";
 		for (i = 0; i < DBD_ROLLUP_COUNT; i++) {
@@ -179,6 +187,13 @@ static void *_cluster_rollup_usage(void *arg)
 			DB_DEBUG(DB_USAGE, mysql_conn.conn, "query\n%s", query);
 			rc = mysql_db_query(&mysql_conn, query);
 			xfree(query);
+			/*
+			 * Commit the row now so the parallel hourly rollup
+			 * doesn't find it locked by this transaction.
+			 */
+			if ((rc == SLURM_SUCCESS) &&
+			    mysql_db_commit(&mysql_conn))
+				rc = SLURM_ERROR;
 			if (rc != SLURM_SUCCESS) {
 				rc = SLURM_ERROR;
 				goto end_it;
@@ -294,13 +309,18 @@ static void *_cluster_rollup_usage(void *arg)
 /* 	info("month end %s", slurm_ctime2(&month_end)); */
 /* 	info("diff is %d", month_end-month_start); */
 
+	/* Cached usage from here on is about to change */
+	cache_start = MIN(hour_start, MIN(day_start, month_start));
+	as_mysql_usage_cache_rolled(local_rollup->cluster_name, cache_start);
+
 	if ((hour_end - hour_start) > 0) {
 		START_TIMER;
 		rc = as_mysql_hourly_rollup(&mysql_conn,
 					    local_rollup->cluster_name,
 					    hour_start,
 					    hour_end,
-					    local_rollup->archive_data);
+					    local_rollup->archive_data,
+					    !local_rollup->sent_end);
 		snprintf(timer_str, sizeof(timer_str),
 			 "hourly_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
@@ -395,6 +415,14 @@ end_it:
 			error("rollback failed");
 	}
 
+	/* Drop what was read while the rollup was in progress */
+	if (cache_start)
+		as_mysql_usage_cache_rolled(local_rollup->cluster_name,
+					    cache_start);
+	/* Old usage may have been purged */
+	if (local_rollup->archive_data)
+		as_mysql_usage_cache_flush(local_rollup->cluster_name);
+
 	mysql_db_close_db_connection(&mysql_conn);
 	slurm_mutex_destroy(&mysql_conn.lock);
 
@@ -573,6 +601,11 @@ static int _get_cluster_usage(mysql_conn_t *mysql_conn, uid_t uid,
 		return SLURM_ERROR;
 	}
 
+	if (as_mysql_usage_cache_get_cluster(mysql_conn, cluster_rec,
+					     my_usage_table, start, end)
+	    == SLURM_SUCCESS)
+		return SLURM_SUCCESS;
+
 	xfree(tmp);
 	i=0;
 	xstrfmtcat(tmp, "%s", cluster_req_inx[i]);
@@ -649,6 +682,8 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 	slurmdb_assoc_rec_t *assoc = NULL;
 	slurmdb_wckey_rec_t *wckey = NULL;
 	slurmdb_accounting_rec_t *accounting_rec = NULL;
+	uint32_t *ids = NULL, *qos_ids = NULL;
+	int id_cnt = 0, qos_cnt = 0;
 
 	if (!object_list) {
 		error("We need an object to set data for getting usage");
@@ -662,8 +697,10 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 	case DBD_GET_ASSOC_NG_USAGE:
 	case DBD_GET_ASSOC_USAGE:
 		name_char = "t3.id_assoc";
+		ids = xcalloc(list_count(object_list), sizeof(*ids));
 		itr = list_iterator_create(object_list);
 		while ((assoc = list_next(itr))) {
+			ids[id_cnt++] = assoc->id;
 			if (id_str)
 				xstrfmtcat(id_str, ",%u", assoc->id);
 			else
@@ -676,8 +713,11 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 	case DBD_GET_QOS_USAGE:
 		if (qos_usage->qos_list) {
 			first = true;
+			qos_ids = xcalloc(list_count(qos_usage->qos_list),
+					  sizeof(*qos_ids));
 			itr = list_iterator_create(qos_usage->qos_list);
 			while ((name_char = list_next(itr))) {
+				qos_ids[qos_cnt++] = slurm_atoul(name_char);
 				if (!first)
 					xstrfmtcatat(id_str, &pos, ",%s",
 						     name_char);
@@ -692,8 +732,10 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 		}
 		my_usage_table = qos_day_table;
 		first = true;
+		ids = xcalloc(list_count(qos_usage->assoc_list), sizeof(*ids));
 		itr = list_iterator_create(qos_usage->assoc_list);
 		while ((assoc = list_next(itr))) {
+			ids[id_cnt++] = assoc->id;
 			if (!first)
 				xstrfmtcat(id_str, ",%u", assoc->id);
 			else {
@@ -708,8 +750,10 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 		break;
 	case DBD_GET_WCKEY_USAGE:
 		name_char = "id";
+		ids = xcalloc(list_count(object_list), sizeof(*ids));
 		itr = list_iterator_create(object_list);
 		while ((wckey = list_next(itr))) {
+			ids[id_cnt++] = wckey->id;
 			if (id_str)
 				xstrfmtcat(id_str, ",%u", wckey->id);
 			else
@@ -731,17 +775,27 @@ extern int get_usage_for_list(mysql_conn_t *mysql_conn,
 	if (set_usage_information(&my_usage_table, type, &start, &end)
 	    != SLURM_SUCCESS) {
 		xfree(id_str);
+		xfree(ids);
+		xfree(qos_ids);
 		return SLURM_ERROR;
 	}
 
-	if (_get_object_usage(mysql_conn, type, my_usage_table, cluster_name,
-			      id_str, start, end, &usage_list)
-	    != SLURM_SUCCESS) {
+	if ((as_mysql_usage_cache_get(mysql_conn, type, my_usage_table,
+				      cluster_name, ids, id_cnt, qos_ids,
+				      qos_cnt, start, end, &usage_list)
+	     != SLURM_SUCCESS) &&
+	    (_get_object_usage(mysql_conn, type, my_usage_table, cluster_name,
+			       id_str, start, end, &usage_list)
+	     != SLURM_SUCCESS)) {
 		xfree(id_str);
+		xfree(ids);
+		xfree(qos_ids);
 		return SLURM_ERROR;
 	}
 
 	xfree(id_str);
+	xfree(ids);
+	xfree(qos_ids);
 
 	if (!usage_list) {
 		error("No usage given back?  This should never happen");
@@ -826,6 +880,8 @@ extern int as_mysql_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 	list_t **my_list = NULL;
 	char *cluster_name = NULL;
 	char *id_str = NULL, *id_str_pos = NULL;
+	uint32_t id = 0, *qos_ids = NULL;
+	int qos_cnt = 0;
 
 	if (check_connection(mysql_conn) != SLURM_SUCCESS)
 		return ESLURM_DB_CONNECTION;
@@ -840,6 +896,7 @@ extern int as_mysql_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 		}
 		xstrfmtcatat(id_str, &id_str_pos, "t3.id_assoc=%u",
 			     slurmdb_assoc->id);
+		id = slurmdb_assoc->id;
 		my_usage_table = assoc_day_table;
 		if (slurmdb_assoc->qos_list &&
 		    list_count(slurmdb_assoc->qos_list)) {
@@ -847,7 +904,10 @@ extern int as_mysql_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 				slurmdb_assoc->qos_list);
 			char *qos_id;
 			bool first = true;
+			qos_ids = xcalloc(list_count(slurmdb_assoc->qos_list),
+					  sizeof(*qos_ids));
 			while ((qos_id = list_next(itr))) {
+				qos_ids[qos_cnt++] = slurm_atoul(qos_id);
 				if (!first) {
 					xstrfmtcatat(id_str, &id_str_pos,
 						     ",%s", qos_id);
@@ -874,6 +934,7 @@ extern int as_mysql_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 			return SLURM_ERROR;
 		}
 		id_str = xstrdup_printf("id=%d", slurmdb_wckey->id);
+		id = slurmdb_wckey->id;
 		cluster_name = slurmdb_wckey->cluster;
 		username = slurmdb_wckey->user;
 		my_list = &slurmdb_wckey->accounting_list;
@@ -893,6 +954,7 @@ extern int as_mysql_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 	if (!cluster_name) {
 		error("We need a cluster_name to set data for getting usage");
 		xfree(id_str);
+		xfree(qos_ids);
 		return SLURM_ERROR;
 	}
 
@@ -948,6 +1010,7 @@ extern int as_mysql_get_usage(mysql_conn_t *mysql_conn, uid_t uid,
 		bad_user:
 			errno = ESLURM_ACCESS_DENIED;
 			xfree(id_str);
+			xfree(qos_ids);
 			return SLURM_ERROR;
 		}
 	}
@@ -956,12 +1019,17 @@ is_user:
 	if (set_usage_information(&my_usage_table, type, &start, &end)
 	    != SLURM_SUCCESS) {
 		xfree(id_str);
+		xfree(qos_ids);
 		return SLURM_ERROR;
 	}
 
-	_get_object_usage(mysql_conn, type, my_usage_table, cluster_name,
-			  id_str, start, end, my_list);
+	if (as_mysql_usage_cache_get(mysql_conn, type, my_usage_table,
+				     cluster_name, &id, 1, qos_ids, qos_cnt,
+				     start, end, my_list) != SLURM_SUCCESS)
+		_get_object_usage(mysql_conn, type, my_usage_table,
+				  cluster_name, id_str, start, end, my_list);
 	xfree(id_str);
+	xfree(qos_ids);
 
 	return rc;
 }
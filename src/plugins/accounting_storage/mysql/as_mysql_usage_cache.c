@@ -0,0 +1,974 @@
+/*****************************************************************************\
+ *  as_mysql_usage_cache.c - in memory copy of the usage tables.
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "as_mysql_usage_cache.h"
+
+/* Times a request is retried when the cache changed while loading */
+#define USAGE_CACHE_TRIES 3
+
+typedef struct {
+	uint32_t id;		/* association or wckey */
+	uint32_t id_alt;	/* QOS in the qos usage tables */
+	uint32_t id_tres;
+	time_t time_start;
+	uint64_t alloc_secs;
+} usage_row_t;
+
+typedef struct {
+	uint64_t alloc_secs;
+	uint64_t count;
+	uint64_t down_secs;
+	uint32_t id_tres;
+	uint64_t idle_secs;
+	uint64_t over_secs;
+	uint64_t pdown_secs;
+	uint64_t plan_secs;
+	time_t time_start;
+} cluster_row_t;
+
+typedef struct {
+	uint32_t id;
+	char *lineage;
+} lineage_t;
+
+typedef struct {
+	bool cluster_table;	/* rows are cluster_row_t, else usage_row_t */
+	time_t end;		/* rows with start <= time_start < end are here */
+	time_t last_used;
+	char *name;
+	uint32_t row_cnt;
+	void *rows;		/* sorted by id (if any) and time_start */
+	time_t start;
+} usage_table_t;
+
+typedef struct {
+	uint64_t gen;		/* changes whenever anything is dropped */
+	lineage_t *lineage;	/* every association, sorted by lineage */
+	lineage_t **lineage_by_id;
+	uint32_t lineage_cnt;
+	bool lineage_loaded;
+	char *name;
+	list_t *tables;		/* list of usage_table_t */
+} usage_cluster_t;
+
+typedef void (*fill_func_t)(usage_cluster_t *ucluster, usage_table_t *utable,
+			    void *arg);
+
+typedef struct {
+	time_t end;
+	uint32_t *ids;		/* sorted */
+	int id_cnt;
+	uint32_t *qos_ids;
+	int qos_cnt;
+	time_t start;
+	slurmdbd_msg_type_t type;
+	list_t *usage_list;
+} object_fill_t;
+
+typedef struct {
+	slurmdb_cluster_rec_t *cluster_rec;
+	time_t end;
+	time_t start;
+} cluster_fill_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static list_t *cache_clusters = NULL;
+static uint64_t cache_bytes = 0;
+static uint64_t cache_gen = 0;
+static uint64_t cache_hits = 0;
+static uint64_t cache_max_bytes = 0;
+static uint64_t cache_misses = 0;
+static uint64_t cache_rows = 0;
+
+static size_t _row_size(bool cluster_table)
+{
+	return cluster_table ? sizeof(cluster_row_t) : sizeof(usage_row_t);
+}
+
+/* NOTE: Ensure that cache_lock is set on function entry */
+static void _empty_table(usage_table_t *utable)
+{
+	cache_bytes -= (uint64_t) utable->row_cnt *
+		_row_size(utable->cluster_table);
+	cache_rows -= utable->row_cnt;
+	xfree(utable->rows);
+	utable->row_cnt = 0;
+	utable->start = utable->end = 0;
+}
+
+static void _destroy_table(void *object)
+{
+	usage_table_t *utable = object;
+
+	if (utable) {
+		_empty_table(utable);
+		xfree(utable->name);
+		xfree(utable);
+	}
+}
+
+static void _free_lineage_array(lineage_t *lineage, uint32_t cnt)
+{
+	for (int i = 0; i < cnt; i++)
+		xfree(lineage[i].lineage);
+	xfree(lineage);
+}
+
+/* NOTE: Ensure that cache_lock is set on function entry */
+static void _free_lineage(usage_cluster_t *ucluster)
+{
+	for (int i = 0; i < ucluster->lineage_cnt; i++)
+		cache_bytes -= sizeof(lineage_t) + sizeof(lineage_t *) +
+			strlen(ucluster->lineage[i].lineage);
+	_free_lineage_array(ucluster->lineage, ucluster->lineage_cnt);
+	ucluster->lineage = NULL;
+	xfree(ucluster->lineage_by_id);
+	ucluster->lineage_cnt = 0;
+	ucluster->lineage_loaded = false;
+}
+
+static void _destroy_cluster(void *object)
+{
+	usage_cluster_t *ucluster = object;
+
+	if (ucluster) {
+		FREE_NULL_LIST(ucluster->tables);
+		_free_lineage(ucluster);
+		xfree(ucluster->name);
+		xfree(ucluster);
+	}
+}
+
+static int _find_cluster(void *x, void *key)
+{
+	usage_cluster_t *ucluster = x;
+
+	return !xstrcmp(ucluster->name, key);
+}
+
+static int _find_table(void *x, void *key)
+{
+	usage_table_t *utable = x;
+
+	return !xstrcmp(utable->name, key);
+}
+
+/* NOTE: Ensure that cache_lock is set on function entry */
+static usage_cluster_t *_get_cluster(char *cluster_name)
+{
+	usage_cluster_t *ucluster;
+
+	if (!(ucluster = list_find_first(cache_clusters, _find_cluster,
+					 cluster_name))) {
+		ucluster = xmalloc(sizeof(*ucluster));
+		ucluster->gen = ++cache_gen;
+		ucluster->name = xstrdup(cluster_name);
+		ucluster->tables = list_create(_destroy_table);
+		list_append(cache_clusters, ucluster);
+	}
+
+	return ucluster;
+}
+
+/* NOTE: Ensure that cache_lock is set on function entry */
+static usage_table_t *_get_table(usage_cluster_t *ucluster, char *table,
+				 bool cluster_table)
+{
+	usage_table_t *utable;
+
+	if (!(utable = list_find_first(ucluster->tables, _find_table,
+				       table))) {
+		utable = xmalloc(sizeof(*utable));
+		utable->cluster_table = cluster_table;
+		utable->name = xstrdup(table);
+		list_append(ucluster->tables, utable);
+	}
+
+	return utable;
+}
+
+static int _cmp_usage_row(const void *a, const void *b)
+{
+	const usage_row_t *row_a = a, *row_b = b;
+
+	if (row_a->id != row_b->id)
+		return (row_a->id < row_b->id) ? -1 : 1;
+	if (row_a->time_start != row_b->time_start)
+		return (row_a->time_start < row_b->time_start) ? -1 : 1;
+	return 0;
+}
+
+static int _cmp_cluster_row(const void *a, const void *b)
+{
+	const cluster_row_t *row_a = a, *row_b = b;
+
+	if (row_a->time_start != row_b->time_start)
+		return (row_a->time_start < row_b->time_start) ? -1 : 1;
+	return 0;
+}
+
+static int _cmp_lineage(const void *a, const void *b)
+{
+	const lineage_t *lin_a = a, *lin_b = b;
+
+	return strcmp(lin_a->lineage, lin_b->lineage);
+}
+
+static int _cmp_lineage_id(const void *a, const void *b)
+{
+	const lineage_t *lin_a = *(lineage_t **) a, *lin_b = *(lineage_t **) b;
+
+	if (lin_a->id != lin_b->id)
+		return (lin_a->id < lin_b->id) ? -1 : 1;
+	return 0;
+}
+
+static int _cmp_uint32(const void *a, const void *b)
+{
+	uint32_t val_a = *(uint32_t *) a, val_b = *(uint32_t *) b;
+
+	if (val_a != val_b)
+		return (val_a < val_b) ? -1 : 1;
+	return 0;
+}
+
+static int _sort_period_start(void *x, void *y)
+{
+	slurmdb_accounting_rec_t *rec_a = *(slurmdb_accounting_rec_t **) x;
+	slurmdb_accounting_rec_t *rec_b = *(slurmdb_accounting_rec_t **) y;
+
+	if (rec_a->period_start != rec_b->period_start)
+		return (rec_a->period_start < rec_b->period_start) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Run a select on the primary even if mysql_conn was sent to the replica,
+ * which may not have the latest rollup yet.
+ */
+static MYSQL_RES *_query_primary(mysql_conn_t *mysql_conn, char *query)
+{
+	MYSQL_RES *result;
+	bool replica = mysql_conn->on_replica;
+
+	if (replica)
+		mysql_db_use_replica(mysql_conn, false);
+	result = mysql_db_query_ret(mysql_conn, query, 0);
+	if (replica)
+		mysql_db_use_replica(mysql_conn, true);
+
+	return result;
+}
+
+/*
+ * Read the rows of a usage table from start to end, leaving out what is
+ * already cached from cached_start to cached_end.
+ */
+static int _load_rows(mysql_conn_t *mysql_conn, char *cluster_name,
+		      char *table, bool cluster_table, time_t start,
+		      time_t cached_start, time_t cached_end, time_t end,
+		      void **rows_out, uint32_t *row_cnt)
+{
+	MYSQL_RES *result;
+	MYSQL_ROW row;
+	char *query, *where;
+	uint32_t cnt, i = 0;
+	void *rows = NULL;
+
+	if (cached_start == cached_end)
+		where = xstrdup_printf("time_start >= %ld && time_start < %ld",
+				       start, end);
+	else
+		where = xstrdup_printf("(time_start >= %ld && time_start < %ld) || (time_start >= %ld && time_start < %ld)",
+				       start, cached_start, cached_end, end);
+
+	if (cluster_table)
+		query = xstrdup_printf("select id_tres, alloc_secs, down_secs, pdown_secs, idle_secs, plan_secs, over_secs, count, time_start from \"%s_%s\" where %s",
+				       cluster_name, table, where);
+	else
+		query = xstrdup_printf("select id, id_alt, id_tres, time_start, alloc_secs from \"%s_%s\" where %s",
+				       cluster_name, table, where);
+	xfree(where);
+
+	DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s", query);
+	result = _query_primary(mysql_conn, query);
+	xfree(query);
+	if (!result)
+		return SLURM_ERROR;
+
+	if ((cnt = mysql_num_rows(result)))
+		rows = xcalloc(cnt, _row_size(cluster_table));
+
+	while ((i < cnt) && (row = mysql_fetch_row(result))) {
+		if (cluster_table) {
+			cluster_row_t *crow = (cluster_row_t *) rows + i;
+
+			crow->id_tres = slurm_atoul(row[0]);
+			crow->alloc_secs = slurm_atoull(row[1]);
+			crow->down_secs = slurm_atoull(row[2]);
+			crow->pdown_secs = slurm_atoull(row[3]);
+			crow->idle_secs = slurm_atoull(row[4]);
+			crow->plan_secs = slurm_atoull(row[5]);
+			crow->over_secs = slurm_atoull(row[6]);
+			crow->count = slurm_atoull(row[7]);
+			crow->time_start = slurm_atoul(row[8]);
+		} else {
+			usage_row_t *urow = (usage_row_t *) rows + i;
+
+			urow->id = slurm_atoul(row[0]);
+			urow->id_alt = slurm_atoul(row[1]);
+			urow->id_tres = slurm_atoul(row[2]);
+			urow->time_start = slurm_atoul(row[3]);
+			urow->alloc_secs = slurm_atoull(row[4]);
+		}
+		i++;
+	}
+	mysql_free_result(result);
+
+	*rows_out = rows;
+	*row_cnt = i;
+
+	return SLURM_SUCCESS;
+}
+
+/* Read the lineage of every association of a cluster */
+static int _load_lineage(mysql_conn_t *mysql_conn, char *cluster_name,
+			 lineage_t **lineage_out, uint32_t *lineage_cnt)
+{
+	MYSQL_RES *result;
+	MYSQL_ROW row;
+	char *query;
+	lineage_t *lineage = NULL;
+	uint32_t cnt, i = 0;
+
+	query = xstrdup_printf("select id_assoc, lineage from \"%s_%s\" where lineage is not null",
+			       cluster_name, assoc_table);
+	DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s", query);
+	result = _query_primary(mysql_conn, query);
+	xfree(query);
+	if (!result)
+		return SLURM_ERROR;
+
+	if ((cnt = mysql_num_rows(result)))
+		lineage = xcalloc(cnt, sizeof(*lineage));
+	while ((i < cnt) && (row = mysql_fetch_row(result))) {
+		lineage[i].id = slurm_atoul(row[0]);
+		lineage[i].lineage = xstrdup(row[1]);
+		i++;
+	}
+	mysql_free_result(result);
+
+	*lineage_out = lineage;
+	*lineage_cnt = i;
+
+	return SLURM_SUCCESS;
+}
+
+/* NOTE: Ensure that cache_lock is set on function entry */
+static void _add_table_rows(usage_table_t *utable, void *rows,
+			    uint32_t row_cnt, time_t start, time_t end)
+{
+	size_t size = _row_size(utable->cluster_table);
+
+	if (row_cnt) {
+		if (!utable->row_cnt) {
+			utable->rows = rows;
+			rows = NULL;
+		} else {
+			xrecalloc(utable->rows, utable->row_cnt + row_cnt,
+				  size);
+			memcpy((char *) utable->rows + (utable->row_cnt * size),
+			       rows, row_cnt * size);
+		}
+		utable->row_cnt += row_cnt;
+		qsort(utable->rows, utable->row_cnt, size,
+		      utable->cluster_table ? _cmp_cluster_row :
+		      _cmp_usage_row);
+		cache_bytes += (uint64_t) row_cnt * size;
+		cache_rows += row_cnt;
+	}
+	xfree(rows);
+
+	utable->start = start;
+	utable->end = end;
+}
+
+/* NOTE: Ensure that cache_lock is set on function entry */
+static void _set_lineage(usage_cluster_t *ucluster, lineage_t *lineage,
+			 uint32_t lineage_cnt)
+{
+	if (lineage_cnt)
+		qsort(lineage, lineage_cnt, sizeof(*lineage), _cmp_lineage);
+	ucluster->lineage = lineage;
+	ucluster->lineage_cnt = lineage_cnt;
+	ucluster->lineage_by_id = xcalloc(lineage_cnt + 1,
+					  sizeof(lineage_t *));
+	for (int i = 0; i < lineage_cnt; i++) {
+		ucluster->lineage_by_id[i] = &lineage[i];
+		cache_bytes += sizeof(lineage_t) + sizeof(lineage_t *) +
+			strlen(lineage[i].lineage);
+	}
+	if (lineage_cnt)
+		qsort(ucluster->lineage_by_id, lineage_cnt,
+		      sizeof(lineage_t *), _cmp_lineage_id);
+	ucluster->lineage_loaded = true;
+}
+
+/* NOTE: Ensure that cache_lock is set on function entry */
+static void _truncate_table(usage_table_t *utable, time_t start)
+{
+	uint32_t kept = 0;
+
+	if ((utable->start == utable->end) || (start >= utable->end))
+		return;
+	if (start <= utable->start) {
+		_empty_table(utable);
+		return;
+	}
+
+	for (int i = 0; i < utable->row_cnt; i++) {
+		if (utable->cluster_table) {
+			cluster_row_t *rows = utable->rows;
+
+			if (rows[i].time_start < start)
+				rows[kept++] = rows[i];
+		} else {
+			usage_row_t *rows = utable->rows;
+
+			if (rows[i].time_start < start)
+				rows[kept++] = rows[i];
+		}
+	}
+	cache_bytes -= (uint64_t) (utable->row_cnt - kept) *
+		_row_size(utable->cluster_table);
+	cache_rows -= utable->row_cnt - kept;
+	utable->row_cnt = kept;
+	if (!kept)
+		xfree(utable->rows);
+	utable->end = start;
+}
+
+/*
+ * Drop the least recently used tables until the cache fits in its memory
+ * limit again, keep last if possible.
+ * NOTE: Ensure that cache_lock is set on function entry
+ */
+static void _evict(usage_table_t *keep)
+{
+	while (cache_bytes > cache_max_bytes) {
+		usage_table_t *lru = NULL, *utable;
+		usage_cluster_t *ucluster;
+		list_itr_t *itr = list_iterator_create(cache_clusters);
+
+		while ((ucluster = list_next(itr))) {
+			list_itr_t *t_itr =
+				list_iterator_create(ucluster->tables);
+
+			while ((utable = list_next(t_itr)))
+				if (utable->row_cnt && (utable != keep) &&
+				    (!lru || (utable->last_used <
+					      lru->last_used)))
+					lru = utable;
+			list_iterator_destroy(t_itr);
+		}
+		list_iterator_destroy(itr);
+
+		if (!lru) {
+			debug("%s: %s needs more than the usage cache can hold",
+			      __func__, keep->name);
+			_empty_table(keep);
+			break;
+		}
+		log_flag(DB_USAGE, "%s: dropping %u rows of %s",
+			 __func__, lru->row_cnt, lru->name);
+		_empty_table(lru);
+	}
+}
+
+/*
+ * Serve a request from the cache, loading what it doesn't have yet.
+ * RET SLURM_SUCCESS if fill was called or SLURM_ERROR
+ */
+static int _cache_get(mysql_conn_t *mysql_conn, char *cluster_name,
+		      char *table, bool cluster_table, bool need_lineage,
+		      time_t start, time_t end, fill_func_t fill, void *arg)
+{
+	bool missed = false;
+
+	for (int tries = 0; tries < USAGE_CACHE_TRIES; tries++) {
+		usage_cluster_t *ucluster;
+		usage_table_t *utable;
+		lineage_t *lineage = NULL;
+		void *rows = NULL;
+		uint32_t lineage_cnt = 0, row_cnt = 0;
+		bool load_lineage, load_rows;
+		time_t cached_start, cached_end, load_start, load_end;
+		uint64_t gen;
+
+		slurm_mutex_lock(&cache_lock);
+		if (!cache_clusters) {
+			slurm_mutex_unlock(&cache_lock);
+			return SLURM_ERROR;
+		}
+		ucluster = _get_cluster(cluster_name);
+		utable = _get_table(ucluster, table, cluster_table);
+		load_lineage = need_lineage && !ucluster->lineage_loaded;
+		load_rows = (utable->start == utable->end) ||
+			(start < utable->start) || (end > utable->end);
+		if (!load_rows && !load_lineage) {
+			if (!missed)
+				cache_hits++;
+			(*fill)(ucluster, utable, arg);
+			utable->last_used = time(NULL);
+			slurm_mutex_unlock(&cache_lock);
+			return SLURM_SUCCESS;
+		}
+		if (!missed) {
+			cache_misses++;
+			missed = true;
+		}
+
+		/* Keep the cached time range contiguous */
+		gen = ucluster->gen;
+		cached_start = utable->start;
+		cached_end = utable->end;
+		if (cached_start == cached_end) {
+			load_start = start;
+			load_end = end;
+		} else {
+			load_start = MIN(start, cached_start);
+			load_end = MAX(end, cached_end);
+		}
+		slurm_mutex_unlock(&cache_lock);
+
+		if (load_rows &&
+		    _load_rows(mysql_conn, cluster_name, table, cluster_table,
+			       load_start, cached_start, cached_end, load_end,
+			       &rows, &row_cnt))
+			return SLURM_ERROR;
+		if (load_lineage &&
+		    _load_lineage(mysql_conn, cluster_name, &lineage,
+				  &lineage_cnt)) {
+			xfree(rows);
+			return SLURM_ERROR;
+		}
+
+		slurm_mutex_lock(&cache_lock);
+		if (!cache_clusters) {
+			slurm_mutex_unlock(&cache_lock);
+			xfree(rows);
+			_free_lineage_array(lineage, lineage_cnt);
+			return SLURM_ERROR;
+		}
+		ucluster = _get_cluster(cluster_name);
+		utable = _get_table(ucluster, table, cluster_table);
+		if ((ucluster->gen != gen) ||
+		    (load_rows && ((utable->start != cached_start) ||
+				   (utable->end != cached_end)))) {
+			/* Rolled up or loaded by someone else meanwhile */
+			slurm_mutex_unlock(&cache_lock);
+			xfree(rows);
+			_free_lineage_array(lineage, lineage_cnt);
+			continue;
+		}
+
+		if (load_rows)
+			_add_table_rows(utable, rows, row_cnt, load_start,
+					load_end);
+		if (load_lineage && !ucluster->lineage_loaded)
+			_set_lineage(ucluster, lineage, lineage_cnt);
+		else
+			_free_lineage_array(lineage, lineage_cnt);
+
+		(*fill)(ucluster, utable, arg);
+		utable->last_used = time(NULL);
+		_evict(utable);
+		slurm_mutex_unlock(&cache_lock);
+		return SLURM_SUCCESS;
+	}
+
+	return SLURM_ERROR;
+}
+
+static lineage_t *_find_assoc(usage_cluster_t *ucluster, uint32_t id)
+{
+	lineage_t key = { .id = id }, *key_ptr = &key, **found;
+
+	if (!ucluster->lineage_cnt)
+		return NULL;
+
+	found = bsearch(&key_ptr, ucluster->lineage_by_id,
+			ucluster->lineage_cnt, sizeof(lineage_t *),
+			_cmp_lineage_id);
+
+	return found ? *found : NULL;
+}
+
+static bool _want_qos(object_fill_t *args, uint32_t qos_id)
+{
+	if (!args->qos_cnt)
+		return true;
+	for (int i = 0; i < args->qos_cnt; i++)
+		if (args->qos_ids[i] == qos_id)
+			return true;
+	return false;
+}
+
+/*
+ * Add the rows of association or wckey id to recs as usage of report_id.
+ * NOTE: Ensure that the assoc_mgr tres read lock is set on function entry.
+ */
+static void _add_rows(usage_table_t *utable, uint32_t id, uint32_t report_id,
+		      object_fill_t *args, list_t *recs)
+{
+	usage_row_t *rows = utable->rows;
+	int lo = 0, hi = utable->row_cnt;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (rows[mid].id < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for (int i = lo; (i < utable->row_cnt) && (rows[i].id == id); i++) {
+		slurmdb_accounting_rec_t *accounting_rec;
+		slurmdb_tres_rec_t *tres_rec;
+
+		if ((rows[i].time_start < args->start) ||
+		    (rows[i].time_start >= args->end) ||
+		    !_want_qos(args, rows[i].id_alt))
+			continue;
+
+		accounting_rec = xmalloc(sizeof(*accounting_rec));
+		accounting_rec->tres_rec.id = rows[i].id_tres;
+		if ((tres_rec = list_find_first(
+			     assoc_mgr_tres_list, slurmdb_find_tres_in_list,
+			     &accounting_rec->tres_rec.id))) {
+			accounting_rec->tres_rec.name =
+				xstrdup(tres_rec->name);
+			accounting_rec->tres_rec.type =
+				xstrdup(tres_rec->type);
+		}
+		accounting_rec->id = report_id;
+		accounting_rec->id_alt = rows[i].id_alt;
+		accounting_rec->period_start = rows[i].time_start;
+		accounting_rec->alloc_secs = rows[i].alloc_secs;
+		list_append(recs, accounting_rec);
+	}
+}
+
+/*
+ * Association usage includes the usage of all the associations below it,
+ * unless it was asked for without them (DBD_GET_ASSOC_NG_USAGE).
+ */
+static void _fill_objects(usage_cluster_t *ucluster, usage_table_t *utable,
+			  void *arg)
+{
+	object_fill_t *args = arg;
+	bool tree = (args->type == DBD_GET_ASSOC_USAGE) ||
+		(args->type == DBD_GET_QOS_USAGE);
+	assoc_mgr_lock_t locks = {
+		.tres = READ_LOCK,
+	};
+
+	assoc_mgr_lock(&locks);
+	for (int i = 0; i < args->id_cnt; i++) {
+		list_t *recs;
+		lineage_t *assoc;
+
+		if (i && (args->ids[i] == args->ids[i - 1]))
+			continue;
+
+		recs = list_create(slurmdb_destroy_accounting_rec);
+		if (!tree) {
+			_add_rows(utable, args->ids[i], args->ids[i], args,
+				  recs);
+		} else if ((assoc = _find_assoc(ucluster, args->ids[i]))) {
+			size_t len = strlen(assoc->lineage);
+			int lo = 0, hi = ucluster->lineage_cnt;
+
+			while (lo < hi) {
+				int mid = (lo + hi) / 2;
+
+				if (strcmp(ucluster->lineage[mid].lineage,
+					   assoc->lineage) < 0)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			for (int j = lo; (j < ucluster->lineage_cnt) &&
+				     !strncmp(ucluster->lineage[j].lineage,
+					      assoc->lineage, len); j++)
+				_add_rows(utable, ucluster->lineage[j].id,
+					  args->ids[i], args, recs);
+		}
+		list_sort(recs, _sort_period_start);
+		list_transfer(args->usage_list, recs);
+		FREE_NULL_LIST(recs);
+	}
+	assoc_mgr_unlock(&locks);
+}
+
+static void _fill_cluster(usage_cluster_t *ucluster, usage_table_t *utable,
+			  void *arg)
+{
+	cluster_fill_t *args = arg;
+	cluster_row_t *rows = utable->rows;
+	slurmdb_cluster_rec_t *cluster_rec = args->cluster_rec;
+	assoc_mgr_lock_t locks = {
+		.tres = READ_LOCK,
+	};
+
+	if (!cluster_rec->accounting_list)
+		cluster_rec->accounting_list =
+			list_create(slurmdb_destroy_cluster_accounting_rec);
+
+	assoc_mgr_lock(&locks);
+	for (int i = 0; i < utable->row_cnt; i++) {
+		slurmdb_tres_rec_t *tres_rec;
+		slurmdb_cluster_accounting_rec_t *accounting_rec;
+
+		if ((rows[i].time_start < args->start) ||
+		    (rows[i].time_start >= args->end))
+			continue;
+
+		accounting_rec = xmalloc(sizeof(*accounting_rec));
+		accounting_rec->tres_rec.id = rows[i].id_tres;
+		accounting_rec->tres_rec.count = rows[i].count;
+		if ((tres_rec = list_find_first(
+			     assoc_mgr_tres_list, slurmdb_find_tres_in_list,
+			     &accounting_rec->tres_rec.id))) {
+			accounting_rec->tres_rec.name =
+				xstrdup(tres_rec->name);
+			accounting_rec->tres_rec.type =
+				xstrdup(tres_rec->type);
+		}
+		accounting_rec->alloc_secs = rows[i].alloc_secs;
+		accounting_rec->down_secs = rows[i].down_secs;
+		accounting_rec->pdown_secs = rows[i].pdown_secs;
+		accounting_rec->idle_secs = rows[i].idle_secs;
+		accounting_rec->over_secs = rows[i].over_secs;
+		accounting_rec->plan_secs = rows[i].plan_secs;
+		accounting_rec->period_start = rows[i].time_start;
+		list_append(cluster_rec->accounting_list, accounting_rec);
+	}
+	assoc_mgr_unlock(&locks);
+}
+
+extern void as_mysql_usage_cache_init(void)
+{
+	if (!slurmdbd_conf->usage_cache_mb)
+		return;
+
+	slurm_mutex_lock(&cache_lock);
+	cache_max_bytes = (uint64_t) slurmdbd_conf->usage_cache_mb *
+		1024 * 1024;
+	if (!cache_clusters)
+		cache_clusters = list_create(_destroy_cluster);
+	slurm_mutex_unlock(&cache_lock);
+
+	debug("%s: caching up to %u MB of usage", __func__,
+	      slurmdbd_conf->usage_cache_mb);
+}
+
+extern void as_mysql_usage_cache_fini(void)
+{
+	slurm_mutex_lock(&cache_lock);
+	FREE_NULL_LIST(cache_clusters);
+	cache_max_bytes = 0;
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern void as_mysql_usage_cache_rolled(char *cluster_name, time_t start)
+{
+	usage_cluster_t *ucluster;
+
+	slurm_mutex_lock(&cache_lock);
+	if (cache_clusters &&
+	    (ucluster = list_find_first(cache_clusters, _find_cluster,
+					cluster_name))) {
+		list_itr_t *itr = list_iterator_create(ucluster->tables);
+		usage_table_t *utable;
+
+		while ((utable = list_next(itr)))
+			_truncate_table(utable, start);
+		list_iterator_destroy(itr);
+		ucluster->gen = ++cache_gen;
+	}
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern void as_mysql_usage_cache_flush(char *cluster_name)
+{
+	slurm_mutex_lock(&cache_lock);
+	if (cache_clusters) {
+		if (cluster_name)
+			list_delete_first(cache_clusters, _find_cluster,
+					  cluster_name);
+		else
+			list_flush(cache_clusters);
+	}
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern void as_mysql_usage_cache_update(list_t *update_list)
+{
+	list_itr_t *itr;
+	slurmdb_update_object_t *object;
+	bool assocs = false, clusters = false;
+
+	if (!cache_max_bytes)
+		return;
+
+	itr = list_iterator_create(update_list);
+	while ((object = list_next(itr))) {
+		switch (object->type) {
+		case SLURMDB_ADD_ASSOC:
+		case SLURMDB_MODIFY_ASSOC:
+		case SLURMDB_REMOVE_ASSOC:
+			assocs = true;
+			break;
+		case SLURMDB_ADD_CLUSTER:
+		case SLURMDB_REMOVE_CLUSTER:
+			clusters = true;
+			break;
+		default:
+			break;
+		}
+	}
+	list_iterator_destroy(itr);
+
+	if (clusters) {
+		as_mysql_usage_cache_flush(NULL);
+		return;
+	}
+
+	if (assocs) {
+		usage_cluster_t *ucluster;
+
+		slurm_mutex_lock(&cache_lock);
+		if (cache_clusters) {
+			itr = list_iterator_create(cache_clusters);
+			while ((ucluster = list_next(itr))) {
+				_free_lineage(ucluster);
+				ucluster->gen = ++cache_gen;
+			}
+			list_iterator_destroy(itr);
+		}
+		slurm_mutex_unlock(&cache_lock);
+	}
+}
+
+extern int as_mysql_usage_cache_get(mysql_conn_t *mysql_conn,
+				    slurmdbd_msg_type_t type,
+				    char *usage_table, char *cluster_name,
+				    uint32_t *ids, int id_cnt,
+				    uint32_t *qos_ids, int qos_cnt,
+				    time_t start, time_t end,
+				    list_t **usage_list)
+{
+	object_fill_t args = {
+		.end = end,
+		.ids = ids,
+		.id_cnt = id_cnt,
+		.qos_ids = qos_ids,
+		.qos_cnt = qos_cnt,
+		.start = start,
+		.type = type,
+	};
+	bool need_lineage;
+
+	if (!cache_max_bytes || !cluster_name || !id_cnt)
+		return SLURM_ERROR;
+
+	switch (type) {
+	case DBD_GET_ASSOC_USAGE:
+	case DBD_GET_QOS_USAGE:
+		need_lineage = true;
+		break;
+	case DBD_GET_ASSOC_NG_USAGE:
+	case DBD_GET_WCKEY_USAGE:
+		need_lineage = false;
+		break;
+	default:
+		return SLURM_ERROR;
+	}
+
+	qsort(ids, id_cnt, sizeof(*ids), _cmp_uint32);
+	if (!*usage_list)
+		*usage_list = list_create(slurmdb_destroy_accounting_rec);
+	args.usage_list = *usage_list;
+
+	return _cache_get(mysql_conn, cluster_name, usage_table, false,
+			  need_lineage, start, end, _fill_objects, &args);
+}
+
+extern int as_mysql_usage_cache_get_cluster(mysql_conn_t *mysql_conn,
+					    slurmdb_cluster_rec_t *cluster_rec,
+					    char *usage_table,
+					    time_t start, time_t end)
+{
+	cluster_fill_t args = {
+		.cluster_rec = cluster_rec,
+		.end = end,
+		.start = start,
+	};
+
+	if (!cache_max_bytes)
+		return SLURM_ERROR;
+
+	return _cache_get(mysql_conn, cluster_rec->name, usage_table, true,
+			  false, start, end, _fill_cluster, &args);
+}
+
+extern void as_mysql_usage_cache_stats(slurmdb_stats_rec_t *stats)
+{
+	slurm_mutex_lock(&cache_lock);
+	stats->usage_cache_hits = cache_hits;
+	stats->usage_cache_misses = cache_misses;
+	stats->usage_cache_rows = cache_rows;
+	slurm_mutex_unlock(&cache_lock);
+}
+
+extern void as_mysql_usage_cache_clear_stats(void)
+{
+	slurm_mutex_lock(&cache_lock);
+	cache_hits = 0;
+	cache_misses = 0;
+	slurm_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,88 @@
+/*****************************************************************************\
+ *  as_mysql_usage_cache.h - in memory copy of the usage tables.
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_MYSQL_USAGE_CACHE_H
+#define _HAVE_MYSQL_USAGE_CACHE_H
+
+#include "accounting_storage_mysql.h"
+
+/*
+ * Rows of the hour, day and month usage tables read for usage requests are
+ * kept in memory per cluster and table, along with the lineage of each
+ * association, so asking again for the same or an earlier part of a time
+ * window is answered without querying the database. Enabled with
+ * Parameters=usage_cache=<MB> in slurmdbd.conf.
+ */
+extern void as_mysql_usage_cache_init(void);
+extern void as_mysql_usage_cache_fini(void);
+
+/*
+ * The usage of a cluster from start on is being rolled up. Called before and
+ * after the rollup so nothing read in between stays.
+ */
+extern void as_mysql_usage_cache_rolled(char *cluster_name, time_t start);
+
+/* Forget everything about a cluster, or all clusters if NULL */
+extern void as_mysql_usage_cache_flush(char *cluster_name);
+
+/* Forget association lineages if a committed update changed them */
+extern void as_mysql_usage_cache_update(list_t *update_list);
+
+/*
+ * Same as _get_object_usage() in as_mysql_usage.c for the associations or
+ * wckeys in ids.
+ * IN qos_ids - only the usage of these QOS (DBD_GET_QOS_USAGE), NULL for all
+ * RET SLURM_SUCCESS if usage_list was filled in, SLURM_ERROR if the caller
+ *	needs to query the database.
+ */
+extern int as_mysql_usage_cache_get(mysql_conn_t *mysql_conn,
+				    slurmdbd_msg_type_t type,
+				    char *usage_table, char *cluster_name,
+				    uint32_t *ids, int id_cnt,
+				    uint32_t *qos_ids, int qos_cnt,
+				    time_t start, time_t end,
+				    list_t **usage_list);
+
+/* Same as as_mysql_usage_cache_get() for the usage of a whole cluster */
+extern int as_mysql_usage_cache_get_cluster(mysql_conn_t *mysql_conn,
+					    slurmdb_cluster_rec_t *cluster_rec,
+					    char *usage_table,
+					    time_t start, time_t end);
+
+/* Fill in the usage_cache_* counters of stats */
+extern void as_mysql_usage_cache_stats(slurmdb_stats_rec_t *stats);
+extern void as_mysql_usage_cache_clear_stats(void);
+
+#endif
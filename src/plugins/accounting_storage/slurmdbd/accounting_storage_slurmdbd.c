@@ -53,6 +53,7 @@
 #include "src/common/persist_conn.h"
 #include "src/common/read_config.h"
 #include "src/common/slurmdbd_defs.h"
+#include "src/common/slurmdbd_pack.h"
 #include "src/common/uid.h"
 #include "src/common/xstring.h"
 
@@ -2916,6 +2917,106 @@ extern list_t *jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	return my_job_list;
 }
 
+extern int jobacct_storage_p_get_jobs_cond_cb(void *db_conn, uid_t uid,
+					      slurmdb_job_cond_t *job_cond,
+					      int (*cb)(list_t *job_list,
+							void *arg),
+					      void *arg)
+{
+	persist_conn_t *pcon = db_conn;
+	persist_msg_t req = {0}, resp = {0};
+	dbd_cond_msg_t get_msg;
+	dbd_list_msg_t *got_msg;
+	uint32_t orig_flags = job_cond->flags;
+	buf_t *buffer;
+	bool more = false;
+	int rc, cb_rc = SLURM_SUCCESS;
+
+	/* The agent in the slurmctld only deals with a single reply */
+	if (running_in_slurmctld() || !pcon) {
+		list_t *job_list = jobacct_storage_p_get_jobs_cond(
+			db_conn, uid, job_cond);
+
+		if (!job_list)
+			return errno ? errno : SLURM_ERROR;
+		rc = (*cb)(job_list, arg);
+		FREE_NULL_LIST(job_list);
+		return rc;
+	}
+
+	memset(&get_msg, 0, sizeof(dbd_cond_msg_t));
+
+	get_msg.cond = job_cond;
+
+	req.msg_type = DBD_GET_JOBS_COND;
+	req.pcon = pcon;
+	req.data = &get_msg;
+
+	/* An older slurmdbd ignores the flag and replies with one list */
+	job_cond->flags |= JOBCOND_FLAG_STREAM;
+	rc = dbd_conn_send_recv_direct(SLURM_PROTOCOL_VERSION, &req, &resp);
+	job_cond->flags = orig_flags;
+
+	while (rc == SLURM_SUCCESS) {
+		if (resp.msg_type == PERSIST_RC) {
+			persist_rc_msg_t *msg = resp.data;
+			if (msg->rc == SLURM_SUCCESS) {
+				info("%s", msg->comment);
+			} else {
+				rc = msg->rc;
+				error("%s", msg->comment);
+			}
+			slurm_persist_free_rc_msg(msg);
+			more = false;
+			break;
+		} else if ((resp.msg_type != DBD_GOT_JOBS) &&
+			   (resp.msg_type != DBD_GOT_JOBS_PART)) {
+			error("response type not DBD_GOT_JOBS: %u",
+			      resp.msg_type);
+			slurmdbd_free_msg(&resp);
+			rc = SLURM_ERROR;
+			break;
+		}
+
+		got_msg = resp.data;
+		more = (resp.msg_type == DBD_GOT_JOBS_PART);
+		if (!got_msg->my_list) {
+			rc = got_msg->return_code;
+			error("%s", slurm_strerror(got_msg->return_code));
+		} else if (cb_rc == SLURM_SUCCESS) {
+			cb_rc = (*cb)(got_msg->my_list, arg);
+		}
+		slurmdbd_free_list_msg(got_msg);
+
+		if (!more)
+			break;
+
+		/*
+		 * Keep reading the parts after cb asked to stop so the
+		 * connection stays in step with the slurmdbd.
+		 */
+		memset(&resp, 0, sizeof(resp));
+		if (!(buffer = slurm_persist_recv_msg(pcon))) {
+			error("Getting response to message type: %s",
+			      slurmdbd_msg_type_2_str(DBD_GET_JOBS_COND, 1));
+			rc = SLURM_ERROR;
+			break;
+		}
+		rc = unpack_slurmdbd_msg(&resp, SLURM_PROTOCOL_VERSION, buffer);
+		FREE_NULL_BUFFER(buffer);
+	}
+
+	if (rc != SLURM_SUCCESS) {
+		error("DBD_GET_JOBS_COND failure: %s", slurm_strerror(rc));
+		/* Don't leave parts of the reply behind on the connection */
+		if (more)
+			slurm_persist_conn_close(pcon);
+		return rc;
+	}
+
+	return cb_rc;
+}
+
 /*
  * Expire old info from the storage
  * Not applicable for any database
@@ -39,17 +39,35 @@
 
 #include "src/common/slurm_xlator.h"
 
+#if HAVE_LZ4
+# include <lz4.h>
+#endif
+
 #include "src/common/fd.h"
 #include "src/common/slurmdbd_pack.h"
+#include "src/common/xhash.h"
 #include "src/common/xstring.h"
 
 #include "slurmdbd_agent.h"
 
 enum {
 	MAX_DBD_ACTION_DISCARD,
-	MAX_DBD_ACTION_EXIT
+	MAX_DBD_ACTION_EXIT,
+	MAX_DBD_ACTION_SPOOL
+};
+
+enum {
+	DBD_SPOOL_COMP_NONE,
+	DBD_SPOOL_COMP_LZ4
 };
 
+/* A queued message newer ones are folded into */
+typedef struct {
+	buf_t *buffer;
+	char *key;
+	persist_msg_t msg;
+} coalesce_t;
+
 typedef struct {
 	uint32_t msg_size;
 	list_t *my_list;
@@ -59,6 +77,12 @@ persist_conn_t *slurmdbd_conn = NULL;
 
 
 #define DBD_MAGIC		0xDEAD3219
+#define DBD_SPOOL_MAGIC		0xDEAD3220
+#define DBD_SPOOL_HDR_SIZE	22	/* magic, version, offset, counts */
+#define DBD_SPOOL_BLK_HDR_SIZE	20	/* magic, version, comp, count, sizes */
+#define DBD_SPOOL_BLOCK_RECS	5000
+#define DBD_AGENT_MAX_RPCS	1000
+#define DBD_AGENT_BACKLOG_RPCS	5000
 #define DEBUG_PRINT_MAX_MSG_TYPES 10
 #define MAX_DBD_DEFAULT_ACTION MAX_DBD_ACTION_DISCARD
 
@@ -71,6 +95,25 @@ static pthread_t agent_tid      = 0;
 static bool      halt_agent          = 0;
 static time_t    slurmdbd_shutdown   = 0;
 static bool      agent_running       = 0;
+static uint32_t  agent_in_flight     = 0; /* head of agent_list being sent */
+static uint32_t  coalesce_cnt        = 0; /* agent_list size after last pass */
+static uint32_t  coalescing          = 0; /* records taken out to coalesce */
+
+/*
+ * The spool holds the oldest part of the backlog on disk, agent_list the
+ * newest. Records loaded back from the spool stay in it until they have
+ * been sent, spool_loaded of them are at the head of agent_list.
+ */
+static int       spool_fd            = -1;
+static uint32_t  spool_cnt           = 0; /* records after spool_read_off */
+static uint32_t  spool_loaded        = 0;
+static uint32_t  spool_next_cnt      = 0; /* records in the loaded block */
+static uint32_t  spool_next_sent     = 0; /* of them already sent */
+static off_t     spool_next_off      = 0;
+static off_t     spool_read_off      = 0;
+static uint32_t  spool_writing       = 0; /* records taken out to spool */
+static bool      spool_failed        = false;
+static bool      spool_sync          = false; /* header needs writing */
 
 static pthread_mutex_t slurmdbd_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  slurmdbd_cond = PTHREAD_COND_INITIALIZER;
@@ -83,6 +126,7 @@ typedef struct {
 } rc_msg_t;
 
 extern int jobacct_storage_p_job_heavy(void *db_conn, job_record_t *job_ptr);
+static void _dequeue_sent(void);
 
 static int _sending_script_env(void *x, void *arg)
 {
@@ -237,18 +281,16 @@ static int _get_return_codes(void *x, void *arg)
 {
 	buf_t *out_buf = x;
 	rc_msg_t *rc_msg = arg;
-	buf_t *b;
 
 	if ((rc_msg->rc = _unpack_return_code(
 		     slurmdbd_conn->version, out_buf, rc_msg)) !=
 	    SLURM_SUCCESS)
 		return -1;
 
-	if ((b = list_dequeue(agent_list))) {
-		FREE_NULL_BUFFER(b);
-	} else {
+	if (list_count(agent_list))
+		_dequeue_sent();
+	else
 		error("DBD_GOT_MULT_MSG unpack message error");
-	}
 
 	return 0;
 }
@@ -383,6 +425,28 @@ static buf_t *_load_dbd_rec(int fd)
 	return buffer;
 }
 
+/*
+ * Unpack and repack a record saved by an older version with the current
+ * protocol version just so we keep things up to date.
+ * RET repacked record or NULL, buffer is consumed
+ */
+static buf_t *_repack_dbd_rec(buf_t *buffer, uint16_t rpc_version)
+{
+	persist_msg_t msg = {0};
+	int rc;
+
+	set_buf_offset(buffer, 0);
+	rc = unpack_slurmdbd_msg(&msg, rpc_version, buffer);
+	FREE_NULL_BUFFER(buffer);
+	if (rc != SLURM_SUCCESS)
+		return NULL;
+
+	buffer = pack_slurmdbd_msg(&msg, SLURM_PROTOCOL_VERSION);
+	slurmdbd_free_msg(&msg);
+
+	return buffer;
+}
+
 static void _load_dbd_state(void)
 {
 	char *dbd_fname = NULL;
@@ -429,23 +493,8 @@ static void _load_dbd_state(void)
 				buffer = _load_dbd_rec(fd);
 			if (buffer == NULL)
 				break;
-			if (rpc_version != SLURM_PROTOCOL_VERSION) {
-				/* unpack and repack with new
-				 * PROTOCOL_VERSION just so we keep
-				 * things up to date.
-				 */
-				persist_msg_t msg = {0};
-				int rc;
-				set_buf_offset(buffer, 0);
-				rc = unpack_slurmdbd_msg(
-					&msg, rpc_version, buffer);
-				FREE_NULL_BUFFER(buffer);
-				if (rc == SLURM_SUCCESS)
-					buffer = pack_slurmdbd_msg(
-						&msg, SLURM_PROTOCOL_VERSION);
-				else
-					buffer = NULL;
-			}
+			if (rpc_version != SLURM_PROTOCOL_VERSION)
+				buffer = _repack_dbd_rec(buffer, rpc_version);
 			if (!buffer) {
 				error("no buffer given");
 				continue;
@@ -524,6 +573,12 @@ static void _save_dbd_state(void)
 		if (rc != SLURM_SUCCESS)
 			goto end_it;
 
+		/* Records loaded from the spool are still in it */
+		for (; spool_loaded; spool_loaded--) {
+			buffer = list_dequeue(agent_list);
+			FREE_NULL_BUFFER(buffer);
+		}
+
 		while ((buffer = list_dequeue(agent_list))) {
 			/*
 			 * We do not want to store registration messages. If an
@@ -562,6 +617,619 @@ end_it:
 	xfree(dbd_fname);
 }
 
+static int _peek_msg_type(buf_t *buffer, uint16_t *msg_type)
+{
+	uint32_t offset = get_buf_offset(buffer);
+
+	if (offset < 2)
+		return SLURM_ERROR;
+	set_buf_offset(buffer, 0);
+	(void) unpack16(msg_type, buffer);	/* checked by offset */
+	set_buf_offset(buffer, offset);
+
+	return SLURM_SUCCESS;
+}
+
+static void _coalesce_id(void *item, const char **key, uint32_t *key_len)
+{
+	coalesce_t *entry = item;
+
+	*key = entry->key;
+	*key_len = strlen(entry->key);
+}
+
+static void _coalesce_free(void *item)
+{
+	coalesce_t *entry = item;
+
+	slurmdbd_free_msg(&entry->msg);
+	xfree(entry->key);
+	xfree(entry);
+}
+
+/* Down messages without TRES are handled as up messages by the slurmdbd */
+static uint16_t _node_state(dbd_node_state_msg_t *node_msg)
+{
+	if (!node_msg->tres_str &&
+	    (node_msg->new_state != DBD_NODE_STATE_UPDATE))
+		return DBD_NODE_STATE_UP;
+	return node_msg->new_state;
+}
+
+/* Exchange the messages two queued buffers hold */
+static void _swap_buf(buf_t *a, buf_t *b)
+{
+	buf_t tmp = *a;
+
+	*a = *b;
+	*b = tmp;
+}
+
+/*
+ * Fold a message into an older queued message of the same job or node.
+ * RET true if buffer is no longer needed
+ */
+static bool _coalesce_msg(xhash_t *hash, buf_t *buffer, persist_msg_t *msg,
+			  uint16_t rpc_version)
+{
+	coalesce_t *entry;
+	char *key = NULL;
+
+	switch (msg->msg_type) {
+	case DBD_JOB_START:
+	{
+		dbd_job_start_msg_t *start = msg->data, *old;
+
+		key = xstrdup_printf("job:%u", start->job_id);
+		if (!(entry = xhash_get_str(hash, key)))
+			break;
+		old = entry->msg.data;
+		if ((old->submit_time != start->submit_time) ||
+		    (old->db_index != start->db_index)) {
+			xhash_delete_str(hash, key);
+			break;
+		}
+
+		/*
+		 * Every job start carries the whole job record so the
+		 * newest one takes the place of the oldest.
+		 */
+		_swap_buf(entry->buffer, buffer);
+		slurmdbd_free_msg(&entry->msg);
+		entry->msg = *msg;
+		xfree(key);
+		return true;
+	}
+	case DBD_JOB_COMPLETE:
+	{
+		dbd_job_comp_msg_t *comp = msg->data;
+
+		/* Don't fold job starts across the end of the job */
+		key = xstrdup_printf("job:%u", comp->job_id);
+		xhash_delete_str(hash, key);
+		xfree(key);
+		slurmdbd_free_msg(msg);
+		return false;
+	}
+	case DBD_NODE_STATE:
+	{
+		dbd_node_state_msg_t *node_msg = msg->data, *old;
+		uint16_t state = _node_state(node_msg);
+		buf_t *new_buf;
+
+		key = xstrdup_printf("node:%s", node_msg->hostlist);
+		if (!(entry = xhash_get_str(hash, key)))
+			break;
+		old = entry->msg.data;
+		if (_node_state(old) != state) {
+			xhash_delete_str(hash, key);
+			break;
+		}
+
+		if (state == DBD_NODE_STATE_UP) {
+			/* The first one already closed the down event */
+			slurmdbd_free_msg(msg);
+			xfree(key);
+			return true;
+		} else if (state == DBD_NODE_STATE_DOWN) {
+			/* Keep the time the node went down, not the reason */
+			node_msg->event_time = old->event_time;
+			if (!(new_buf = pack_slurmdbd_msg(msg, rpc_version))) {
+				xhash_delete_str(hash, key);
+				break;
+			}
+			_swap_buf(entry->buffer, new_buf);
+			FREE_NULL_BUFFER(new_buf);
+		} else {
+			_swap_buf(entry->buffer, buffer);
+		}
+		slurmdbd_free_msg(&entry->msg);
+		entry->msg = *msg;
+		xfree(key);
+		return true;
+	}
+	default:
+		slurmdbd_free_msg(msg);
+		return false;
+	}
+
+	entry = xmalloc(sizeof(*entry));
+	entry->buffer = buffer;
+	entry->key = key;
+	entry->msg = *msg;
+	xhash_add(hash, entry);
+
+	return false;
+}
+
+/* Move the records of agent_list after the first skip to the end of list */
+static void _take_agent_list_tail(list_t *list, uint32_t skip)
+{
+	list_itr_t *itr = list_iterator_create(agent_list);
+
+	while (list_next(itr)) {
+		if (skip) {
+			skip--;
+			continue;
+		}
+		list_append(list, list_remove(itr));
+	}
+	list_iterator_destroy(itr);
+}
+
+/*
+ * Fold superseded messages queued in agent_list into older ones: repeated
+ * job starts of the same job until it ends and repeated node state changes
+ * of the same kind. Records loaded from the spool are left alone, even once
+ * part of them is sent. Called by the agent thread with agent_lock held,
+ * which is released while the messages are unpacked so that
+ * slurmdbd_agent_send() doesn't wait on it.
+ */
+static void _coalesce_agent_list(void)
+{
+	uint16_t rpc_version = slurmdbd_conn ?
+		slurmdbd_conn->version : SLURM_PROTOCOL_VERSION;
+	xhash_t *hash;
+	list_t *work_list;
+	list_itr_t *itr;
+	buf_t *buffer;
+	int removed = 0;
+	DEF_TIMERS;
+
+	xassert(!agent_in_flight);
+
+	work_list = list_create(slurmdbd_free_buffer);
+	_take_agent_list_tail(work_list, spool_loaded);
+	coalescing = list_count(work_list);
+	slurm_mutex_unlock(&agent_lock);
+
+	START_TIMER;
+	hash = xhash_init(_coalesce_id, _coalesce_free);
+	itr = list_iterator_create(work_list);
+	while ((buffer = list_next(itr))) {
+		persist_msg_t msg = {0};
+		uint32_t offset = get_buf_offset(buffer);
+		uint16_t msg_type;
+		int rc;
+
+		if (_peek_msg_type(buffer, &msg_type) ||
+		    ((msg_type != DBD_JOB_START) &&
+		     (msg_type != DBD_JOB_COMPLETE) &&
+		     (msg_type != DBD_NODE_STATE)))
+			continue;
+
+		set_buf_offset(buffer, 0);
+		rc = unpack_slurmdbd_msg(&msg, rpc_version, buffer);
+		set_buf_offset(buffer, offset);
+		if (rc != SLURM_SUCCESS)
+			continue;
+
+		if (_coalesce_msg(hash, buffer, &msg, rpc_version)) {
+			list_delete_item(itr);
+			removed++;
+		}
+	}
+	list_iterator_destroy(itr);
+	xhash_free_ptr(&hash);
+	END_TIMER2(__func__);
+
+	slurm_mutex_lock(&agent_lock);
+	/* Whatever was queued meanwhile is newer */
+	_take_agent_list_tail(work_list, spool_loaded);
+	list_transfer(agent_list, work_list);
+	FREE_NULL_LIST(work_list);
+	coalescing = 0;
+	coalesce_cnt = list_count(agent_list);
+
+	log_flag(DBD_AGENT, "coalesced %d of %d pending RPCs in %s",
+		 removed, coalesce_cnt + removed, TIME_STR);
+}
+
+static int _spool_write_hdr(void)
+{
+	buf_t *buffer = init_buf(DBD_SPOOL_HDR_SIZE);
+
+	pack32(DBD_SPOOL_MAGIC, buffer);
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack64(spool_read_off, buffer);
+	pack32(spool_cnt, buffer);
+	pack32(spool_next_sent, buffer);
+
+	if (lseek(spool_fd, 0, SEEK_SET) < 0)
+		goto rwfail;
+	safe_write(spool_fd, get_buf_data(buffer), get_buf_offset(buffer));
+	FREE_NULL_BUFFER(buffer);
+	return SLURM_SUCCESS;
+
+rwfail:
+	error("%s: state save error: %m", __func__);
+	FREE_NULL_BUFFER(buffer);
+	return SLURM_ERROR;
+}
+
+/* Forget everything in the spool */
+static void _spool_reset(void)
+{
+	spool_read_off = spool_next_off = DBD_SPOOL_HDR_SIZE;
+	spool_cnt = spool_next_cnt = spool_next_sent = 0;
+	if (ftruncate(spool_fd, DBD_SPOOL_HDR_SIZE))
+		error("%s: ftruncate: %m", __func__);
+	(void) _spool_write_hdr();
+}
+
+/* Open the spool file, only create it if asked to */
+static int _spool_open(bool create)
+{
+	char *fname = NULL, hdr[DBD_SPOOL_HDR_SIZE];
+	struct stat st;
+	buf_t *buffer = NULL;
+	uint32_t magic;
+	uint16_t version;
+	uint64_t read_off;
+
+	if (spool_fd >= 0)
+		return SLURM_SUCCESS;
+
+	xstrfmtcat(fname, "%s/dbd.spool", slurm_conf.state_save_location);
+	if ((spool_fd = open(fname, O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0),
+			     0600)) < 0) {
+		if (create || (errno != ENOENT))
+			error("Opening spool file %s: %m", fname);
+		xfree(fname);
+		return SLURM_ERROR;
+	}
+
+	if (fstat(spool_fd, &st) || (st.st_size < DBD_SPOOL_HDR_SIZE)) {
+		_spool_reset();
+		xfree(fname);
+		return SLURM_SUCCESS;
+	}
+
+	safe_read(spool_fd, hdr, sizeof(hdr));
+	buffer = create_shadow_buf(hdr, sizeof(hdr));
+	safe_unpack32(&magic, buffer);
+	safe_unpack16(&version, buffer);
+	safe_unpack64(&read_off, buffer);
+	safe_unpack32(&spool_cnt, buffer);
+	safe_unpack32(&spool_next_sent, buffer);
+	if ((magic != DBD_SPOOL_MAGIC) || (read_off < DBD_SPOOL_HDR_SIZE) ||
+	    (read_off > st.st_size))
+		goto unpack_error;
+	spool_read_off = spool_next_off = read_off;
+	FREE_NULL_BUFFER(buffer);
+
+	if (spool_cnt)
+		verbose("%u pending RPCs spooled in %s", spool_cnt, fname);
+	xfree(fname);
+	return SLURM_SUCCESS;
+
+rwfail:
+unpack_error:
+	error("Invalid spool file %s, discarding it", fname);
+	FREE_NULL_BUFFER(buffer);
+	_spool_reset();
+	xfree(fname);
+	return SLURM_SUCCESS;
+}
+
+static void _spool_close(void)
+{
+	if (spool_fd < 0)
+		return;
+	(void) fsync_and_close(spool_fd, "dbd.spool");
+	spool_fd = -1;
+	spool_cnt = spool_loaded = 0;
+}
+
+/*
+ * Write the header once the agent has sent records of the spool. Only the
+ * agent thread touches the spool file, so this is done without agent_lock.
+ */
+static void _spool_sync_hdr(void)
+{
+	if (!spool_sync || (spool_fd < 0))
+		return;
+	spool_sync = false;
+
+	if (!spool_cnt && ftruncate(spool_fd, DBD_SPOOL_HDR_SIZE))
+		error("%s: ftruncate: %m", __func__);
+	if (_spool_write_hdr() || fsync(spool_fd))
+		error("%s: state save error: %m", __func__);
+}
+
+/*
+ * Write up to DBD_SPOOL_BLOCK_RECS records from the head of list
+ * OUT written - number of records removed from list
+ */
+static int _spool_write_block(list_t *list, uint32_t *written)
+{
+	buf_t *raw = init_buf(BUF_SIZE), *hdr = init_buf(DBD_SPOOL_BLK_HDR_SIZE);
+	buf_t *buffer;
+	list_itr_t *itr = list_iterator_create(list);
+	char *data, *comp_data = NULL;
+	uint32_t cnt = 0, data_len;
+	uint16_t comp = DBD_SPOOL_COMP_NONE, msg_type;
+	off_t end;
+	int rc = SLURM_ERROR;
+
+	while ((cnt < DBD_SPOOL_BLOCK_RECS) && (buffer = list_next(itr))) {
+		/* See _save_dbd_state() for why registrations are skipped */
+		if (!_peek_msg_type(buffer, &msg_type) &&
+		    (msg_type != DBD_REGISTER_CTLD))
+			packmem(get_buf_data(buffer), get_buf_offset(buffer),
+				raw);
+		cnt++;
+	}
+	list_iterator_destroy(itr);
+
+	data = get_buf_data(raw);
+	data_len = get_buf_offset(raw);
+#if HAVE_LZ4
+	if (data_len) {
+		int bound = LZ4_compressBound(data_len), comp_len;
+
+		comp_data = xmalloc(bound);
+		if ((comp_len = LZ4_compress_default(data, comp_data, data_len,
+						     bound)) > 0) {
+			data = comp_data;
+			data_len = comp_len;
+			comp = DBD_SPOOL_COMP_LZ4;
+		}
+	}
+#endif
+
+	pack32(DBD_SPOOL_MAGIC, hdr);
+	pack16(SLURM_PROTOCOL_VERSION, hdr);
+	pack16(comp, hdr);
+	pack32(cnt, hdr);
+	pack32(get_buf_offset(raw), hdr);
+	pack32(data_len, hdr);
+
+	if ((end = lseek(spool_fd, 0, SEEK_END)) < 0)
+		goto rwfail;
+	safe_write(spool_fd, get_buf_data(hdr), get_buf_offset(hdr));
+	safe_write(spool_fd, data, data_len);
+
+	/* The records are on disk now */
+	for (uint32_t i = 0; i < cnt; i++) {
+		buffer = list_dequeue(list);
+		FREE_NULL_BUFFER(buffer);
+	}
+	*written = cnt;
+	rc = SLURM_SUCCESS;
+
+rwfail:
+	if (rc) {
+		error("%s: state save error: %m", __func__);
+		/* Don't leave a partial block behind */
+		if ((end >= 0) && ftruncate(spool_fd, end))
+			error("%s: ftruncate: %m", __func__);
+	}
+	xfree(comp_data);
+	FREE_NULL_BUFFER(raw);
+	FREE_NULL_BUFFER(hdr);
+	return rc;
+}
+
+/*
+ * Move agent_list to the end of the spool so it doesn't have to be kept in
+ * memory. Nothing may be in flight. Called by the agent thread with
+ * agent_lock held, which is released while the spool is written so that
+ * slurmdbd_agent_send() never waits on the disk.
+ */
+static void _spool_agent_list(void)
+{
+	buf_t *buffer;
+	list_t *spool_list;
+	uint32_t cnt, spooled = 0;
+	bool failed = false;
+
+	xassert(!agent_in_flight);
+
+	if (_spool_open(true)) {
+		spool_failed = true;
+		return;
+	}
+
+	/* What was loaded is still at the head of the spool */
+	for (; spool_loaded; spool_loaded--) {
+		buffer = list_dequeue(agent_list);
+		FREE_NULL_BUFFER(buffer);
+	}
+
+	spool_list = list_create(slurmdbd_free_buffer);
+	list_transfer(spool_list, agent_list);
+	spool_writing = list_count(spool_list);
+	slurm_mutex_unlock(&agent_lock);
+
+	/* A block sent since the last pass may have emptied the spool */
+	_spool_sync_hdr();
+	while (list_count(spool_list)) {
+		if (_spool_write_block(spool_list, &cnt)) {
+			failed = true;
+			break;
+		}
+		slurm_mutex_lock(&agent_lock);
+		spool_cnt += cnt;
+		spool_writing -= cnt;
+		slurm_mutex_unlock(&agent_lock);
+		spooled += cnt;
+	}
+
+	if (_spool_write_hdr() || fsync(spool_fd))
+		error("%s: state save error: %m", __func__);
+
+	slurm_mutex_lock(&agent_lock);
+	/* Whatever couldn't be written is older than what came in meanwhile */
+	spool_writing = 0;
+	spool_failed = failed;
+	list_transfer(spool_list, agent_list);
+	list_transfer(agent_list, spool_list);
+	FREE_NULL_LIST(spool_list);
+	coalesce_cnt = list_count(agent_list);
+
+	info("spooled %u pending RPCs, %u in spool", spooled, spool_cnt);
+}
+
+/*
+ * The block loaded from the spool has been sent, move past it. The header is
+ * written by _spool_sync_hdr() once agent_lock is released.
+ */
+static void _spool_commit(void)
+{
+	spool_read_off = spool_next_off;
+	spool_cnt -= MIN(spool_cnt, spool_next_cnt);
+	spool_next_cnt = spool_next_sent = 0;
+
+	if (!spool_cnt)
+		spool_read_off = spool_next_off = DBD_SPOOL_HDR_SIZE;
+	spool_sync = true;
+}
+
+/* Put the oldest block of the spool at the head of agent_list */
+static void _spool_load(void)
+{
+	char hdr_data[DBD_SPOOL_BLK_HDR_SIZE], *data = NULL;
+	buf_t *hdr = NULL, *raw = NULL, *buffer;
+	list_t *loaded = NULL;
+	uint32_t magic, cnt, raw_len, data_len, skip = spool_next_sent;
+	uint16_t version, comp;
+
+	if ((spool_fd < 0) || !spool_cnt || spool_loaded)
+		return;
+
+	if (lseek(spool_fd, spool_read_off, SEEK_SET) < 0)
+		goto rwfail;
+	safe_read(spool_fd, hdr_data, sizeof(hdr_data));
+	hdr = create_shadow_buf(hdr_data, sizeof(hdr_data));
+	safe_unpack32(&magic, hdr);
+	safe_unpack16(&version, hdr);
+	safe_unpack16(&comp, hdr);
+	safe_unpack32(&cnt, hdr);
+	safe_unpack32(&raw_len, hdr);
+	safe_unpack32(&data_len, hdr);
+	if ((magic != DBD_SPOOL_MAGIC) || (raw_len > MAX_BUF_SIZE) ||
+	    (data_len > MAX_BUF_SIZE))
+		goto unpack_error;
+
+	spool_next_off = spool_read_off + DBD_SPOOL_BLK_HDR_SIZE + data_len;
+	spool_next_cnt = cnt;
+
+	data = xmalloc(data_len);
+	if (data_len)
+		safe_read(spool_fd, data, data_len);
+
+	if (comp == DBD_SPOOL_COMP_LZ4) {
+#if HAVE_LZ4
+		char *raw_data = xmalloc(raw_len);
+
+		if (LZ4_decompress_safe(data, raw_data, data_len, raw_len) !=
+		    (int) raw_len) {
+			xfree(raw_data);
+			goto unpack_error;
+		}
+		xfree(data);
+		data = raw_data;
+		data_len = raw_len;
+#else
+		error("%s: spool was compressed with lz4, which isn't available",
+		      __func__);
+		goto unpack_error;
+#endif
+	} else if (comp != DBD_SPOOL_COMP_NONE) {
+		goto unpack_error;
+	}
+
+	raw = create_buf(data, data_len);
+	data = NULL;
+	loaded = list_create(slurmdbd_free_buffer);
+	while (remaining_buf(raw)) {
+		char *msg;
+		uint32_t msg_size;
+
+		safe_unpackmem_ptr(&msg, &msg_size, raw);
+		buffer = init_buf(msg_size);
+		memcpy(get_buf_data(buffer), msg, msg_size);
+		set_buf_offset(buffer, msg_size);
+		if ((version != SLURM_PROTOCOL_VERSION) &&
+		    !(buffer = _repack_dbd_rec(buffer, version)))
+			continue;
+		/* Sent before a restart, see _dequeue_sent() */
+		if (skip) {
+			skip--;
+			FREE_NULL_BUFFER(buffer);
+			continue;
+		}
+		list_append(loaded, buffer);
+	}
+
+	log_flag(DBD_AGENT, "loaded %d of %u spooled RPCs",
+		 list_count(loaded), spool_cnt);
+
+	/* Older than anything in agent_list */
+	spool_loaded = list_count(loaded);
+	list_transfer(loaded, agent_list);
+	list_transfer(agent_list, loaded);
+	if (!spool_loaded)
+		_spool_commit();
+
+	FREE_NULL_LIST(loaded);
+	FREE_NULL_BUFFER(raw);
+	FREE_NULL_BUFFER(hdr);
+	return;
+
+rwfail:
+unpack_error:
+	error("Invalid block in spool file, discarding %u spooled RPCs",
+	      spool_cnt);
+	FREE_NULL_LIST(loaded);
+	xfree(data);
+	FREE_NULL_BUFFER(raw);
+	FREE_NULL_BUFFER(hdr);
+	_spool_reset();
+}
+
+/*
+ * Remove a record that was sent from the head of agent_list. Records sent
+ * out of a spool block are counted in the spool header, so a block cut
+ * short by a restart resumes after them. Only what was sent since the
+ * header was last written is sent again.
+ */
+static void _dequeue_sent(void)
+{
+	buf_t *buffer = list_dequeue(agent_list);
+
+	FREE_NULL_BUFFER(buffer);
+	if (!spool_loaded)
+		return;
+	if (!--spool_loaded) {
+		_spool_commit();
+	} else {
+		spool_next_sent++;
+		spool_sync = true;
+	}
+}
+
 /*
  * Purge queued records from the agent queue
  */
@@ -596,9 +1264,20 @@ static int _purge_agent_list_req(void *x, void *arg)
 	return 0;
 }
 
+/* Most records agent_list may hold */
+static uint32_t _max_queued(void)
+{
+	/* Leave room for what comes in while the agent writes the spool */
+	if ((max_dbd_msg_action == MAX_DBD_ACTION_SPOOL) && !spool_failed)
+		return slurm_conf.max_dbd_msgs * 2;
+
+	return slurm_conf.max_dbd_msgs;
+}
+
 static void _max_dbd_msg_action(uint32_t *msg_cnt)
 {
 	int purged = 0;
+
 	if (max_dbd_msg_action == MAX_DBD_ACTION_EXIT) {
 		if (*msg_cnt < slurm_conf.max_dbd_msgs)
 			return;
@@ -608,8 +1287,14 @@ static void _max_dbd_msg_action(uint32_t *msg_cnt)
 		      *msg_cnt);
 	}
 
-	/* MAX_DBD_ACTION_DISCARD */
-	if (*msg_cnt >= (slurm_conf.max_dbd_msgs - 1)) {
+	if (max_dbd_msg_action == MAX_DBD_ACTION_SPOOL) {
+		/* The agent thread moves the backlog to the spool */
+		if (*msg_cnt >= (slurm_conf.max_dbd_msgs - 1))
+			slurm_cond_broadcast(&agent_cond);
+	}
+
+	/* MAX_DBD_ACTION_DISCARD, or the spool can't keep up */
+	if (*msg_cnt >= (_max_queued() - 1)) {
 		uint16_t purge_type = DBD_STEP_START;
 		purged = list_delete_all(agent_list, _purge_agent_list_req,
 					 &purge_type);
@@ -702,6 +1387,20 @@ static void *_agent(void *x)
 		 slurmdbd_msg_type_2_str(list_req.msg_type, 1));
 
 	while (*slurmdbd_conn->shutdown == 0) {
+		slurm_mutex_lock(&agent_lock);
+		/* Look for messages to fold once enough new ones came in */
+		cnt = list_count(agent_list);
+		if (cnt < coalesce_cnt)
+			coalesce_cnt = cnt;
+		if ((cnt >= (slurm_conf.max_dbd_msgs / 2)) &&
+		    ((cnt - coalesce_cnt) >= (slurm_conf.max_dbd_msgs / 10)))
+			_coalesce_agent_list();
+		if ((max_dbd_msg_action == MAX_DBD_ACTION_SPOOL) &&
+		    (list_count(agent_list) >= (slurm_conf.max_dbd_msgs - 1)))
+			_spool_agent_list();
+		slurm_mutex_unlock(&agent_lock);
+		_spool_sync_hdr();
+
 		slurm_mutex_lock(&slurmdbd_lock);
 		if (halt_agent) {
 			log_flag(DBD_AGENT, "slurmdbd agent halt with agent_count=%d",
@@ -724,6 +1423,10 @@ static void *_agent(void *x)
 		}
 
 		slurm_mutex_lock(&agent_lock);
+		/* Replay the spool oldest first, a block at a time */
+		if (slurmdbd_conn->conn && spool_cnt && !spool_loaded &&
+		    (list_count(agent_list) < (slurm_conf.max_dbd_msgs / 2)))
+			_spool_load();
 		cnt = list_count(agent_list);
 		if ((cnt == 0) || !slurmdbd_conn->conn ||
 		    (fail_time && (difftime(time(NULL), fail_time) < 10))) {
@@ -748,7 +1451,10 @@ static void *_agent(void *x)
 		/* Leave item on the queue until processing complete */
 		if (agent_list) {
 			if (cnt > 1) {
-				int max_rpcs = 1000;
+				/* Catch up on a backlog in larger batches */
+				int max_rpcs = (cnt > DBD_AGENT_BACKLOG_RPCS) ?
+					DBD_AGENT_BACKLOG_RPCS :
+					DBD_AGENT_MAX_RPCS;
 				foreach_get_my_list_t args = {
 					.msg_size = sizeof(list_req),
 					.my_list = list_create(NULL),
@@ -758,10 +1464,13 @@ static void *_agent(void *x)
 
 				list_for_each_max(agent_list, &max_rpcs,
 						  _get_my_list, &args, 1, true);
+				agent_in_flight = list_count(args.my_list);
 				buffer = pack_slurmdbd_msg(
 					&list_req, SLURM_PROTOCOL_VERSION);
-			} else
+			} else {
 				buffer = list_peek(agent_list);
+				agent_in_flight = 1;
+			}
 		} else
 			buffer = NULL;
 		slurm_mutex_unlock(&agent_lock);
@@ -816,6 +1525,7 @@ static void *_agent(void *x)
 		slurm_mutex_unlock(&assoc_cache_mutex);
 
 		slurm_mutex_lock(&agent_lock);
+		agent_in_flight = 0;
 		if (agent_list && (rc == SLURM_SUCCESS)) {
 			/*
 			 * If we sent a mult_msg we just need to free buffer,
@@ -826,10 +1536,11 @@ static void *_agent(void *x)
 				if (list_msg.my_list != agent_list)
 					FREE_NULL_LIST(list_msg.my_list);
 				list_msg.my_list = NULL;
-			} else
-				buffer = list_dequeue(agent_list);
+				FREE_NULL_BUFFER(buffer);
+			} else {
+				_dequeue_sent();
+			}
 
-			FREE_NULL_BUFFER(buffer);
 			fail_time = 0;
 		} else {
 			/* We need to free a mult_msg even on failure */
@@ -853,7 +1564,10 @@ static void *_agent(void *x)
 	}
 
 	slurm_mutex_lock(&agent_lock);
+	agent_in_flight = 0;
 	_save_dbd_state();
+	_spool_sync_hdr();
+	_spool_close();
 
 	log_flag(AGENT, "slurmdbd agent ending with agent_count=%d",
 		 list_count(agent_list));
@@ -876,6 +1590,7 @@ static void _create_agent(void)
 	if (agent_list == NULL) {
 		agent_list = list_create(slurmdbd_free_buffer);
 		_load_dbd_state();
+		(void) _spool_open(false);
 	}
 
 	if (agent_tid == 0) {
@@ -1005,7 +1720,7 @@ extern int slurmdbd_agent_send(uint16_t rpc_version, persist_msg_t *req)
 			return SLURM_ERROR;
 		}
 	}
-	cnt = list_count(agent_list);
+	cnt = list_count(agent_list) + coalescing;
 	if ((cnt >= (slurm_conf.max_dbd_msgs / 2)) &&
 	    (difftime(time(NULL), syslog_time) > 120)) {
 		/* Record critical error every 120 seconds */
@@ -1019,7 +1734,7 @@ extern int slurmdbd_agent_send(uint16_t rpc_version, persist_msg_t *req)
 	/* Handle action */
 	_max_dbd_msg_action(&cnt);
 
-	if (cnt < slurm_conf.max_dbd_msgs) {
+	if (cnt < _max_queued()) {
 		list_enqueue(agent_list, buffer);
 	} else {
 		error("agent queue is full (%u), discarding %s:%u request",
@@ -1047,7 +1762,14 @@ extern bool slurmdbd_conn_active(void)
 
 extern int slurmdbd_agent_queue_count(void)
 {
-	return list_count(agent_list);
+	int cnt;
+
+	slurm_mutex_lock(&agent_lock);
+	cnt = list_count(agent_list) + coalescing + spool_cnt -
+		spool_next_sent - spool_loaded + spool_writing;
+	slurm_mutex_unlock(&agent_lock);
+
+	return cnt;
 }
 
 extern void slurmdbd_agent_config_setup(void)
@@ -1074,6 +1796,8 @@ extern void slurmdbd_agent_config_setup(void)
 			max_dbd_msg_action = MAX_DBD_ACTION_DISCARD;
 		else if (!xstrcasecmp(type, "exit"))
 			max_dbd_msg_action = MAX_DBD_ACTION_EXIT;
+		else if (!xstrcasecmp(type, "spool"))
+			max_dbd_msg_action = MAX_DBD_ACTION_SPOOL;
 		else
 			fatal("Unknown SlurmctldParameters option for max_dbd_msg_action '%s'",
 			      type);
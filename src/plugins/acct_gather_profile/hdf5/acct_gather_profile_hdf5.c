@@ -71,7 +71,6 @@
 /* Compression level, a value of 0 through 9. Level 0 is faster but offers the
  * least compression; level 9 is slower but offers maximum compression.
  * A setting of -1 indicates that no compression is desired. */
-/* TODO: Make this configurable with a parameter */
 #define HDF5_COMPRESS 0
 
 /* Required Slurm plugin symbols: */
@@ -80,13 +79,25 @@ const char plugin_type[] = "acct_gather_profile/hdf5";
 const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 
 typedef struct {
+	uint32_t chunk_size;
+	bool columnar;
+	int compress;
 	char *dir;
 	uint32_t def;
 } slurm_hdf5_conf_t;
 
 typedef struct {
-	hid_t  table_id;
+	hid_t  table_id;	/* packet table or columnar group */
 	size_t type_size;
+
+	/* columnar layout only, records are buffered up to a whole chunk */
+	int col_cnt;
+	hid_t *cols;
+	size_t *col_offsets;
+	hid_t *col_types;
+	uint8_t *rows;
+	hsize_t rows_cnt;
+	hsize_t rows_written;
 } table_t;
 
 // Global HDF5 Variables
@@ -114,6 +125,9 @@ static size_t   tables_cur_len = 0;
 static void _reset_slurm_profile_conf(void)
 {
 	xfree(hdf5_conf.dir);
+	hdf5_conf.chunk_size = HDF5_CHUNK_SIZE;
+	hdf5_conf.columnar = false;
+	hdf5_conf.compress = HDF5_COMPRESS;
 	hdf5_conf.def = ACCT_GATHER_PROFILE_NONE;
 }
 
@@ -198,6 +212,159 @@ static void _create_directories(void)
 	/* Do not xfree() hdf5_dir_rel (interior pointer to freed data). */
 }
 
+/*
+ * Create a group holding one extendable, chunked and compressed dataset per
+ * field, in field order. Records are buffered in the table and written a
+ * chunk at a time by _flush_columnar().
+ */
+static hid_t _create_columnar(hid_t parent, const char *name,
+			      acct_gather_profile_dataset_t *dataset,
+			      table_t *table)
+{
+	hsize_t dims = 0, max_dims = H5S_UNLIMITED;
+	hsize_t chunk = hdf5_conf.chunk_size;
+	hid_t gcpl_id, dcpl_id, space_id, gid;
+	const char *col_name;
+	size_t offset = 0;
+	int i, col_cnt = 2; /* time fields */
+
+	for (acct_gather_profile_dataset_t *d = dataset;
+	     d && (d->type != PROFILE_FIELD_NOT_SET); d++)
+		col_cnt++;
+
+	gcpl_id = H5Pcreate(H5P_GROUP_CREATE);
+	H5Pset_link_creation_order(gcpl_id, H5P_CRT_ORDER_TRACKED |
+					    H5P_CRT_ORDER_INDEXED);
+	gid = H5Gcreate(parent, name, H5P_DEFAULT, gcpl_id, H5P_DEFAULT);
+	H5Pclose(gcpl_id);
+	if (gid < 0)
+		return -1;
+	put_string_attribute(gid, ATTR_LAYOUT, LAYOUT_COLUMNAR);
+
+	dcpl_id = H5Pcreate(H5P_DATASET_CREATE);
+	H5Pset_chunk(dcpl_id, 1, &chunk);
+	if (hdf5_conf.compress >= 0) {
+		H5Pset_shuffle(dcpl_id);
+		H5Pset_deflate(dcpl_id, hdf5_conf.compress);
+	}
+	space_id = H5Screate_simple(1, &dims, &max_dims);
+
+	table->col_cnt = col_cnt;
+	table->cols = xcalloc(col_cnt, sizeof(hid_t));
+	table->col_offsets = xcalloc(col_cnt, sizeof(size_t));
+	table->col_types = xcalloc(col_cnt, sizeof(hid_t));
+
+	for (i = 0; i < col_cnt; i++) {
+		if (i == 0) {
+			col_name = "ElapsedTime";
+			table->col_types[i] = H5T_NATIVE_UINT64;
+		} else if (i == 1) {
+			col_name = "EpochTime";
+			table->col_types[i] = H5T_NATIVE_UINT64;
+		} else {
+			col_name = dataset[i - 2].name;
+			if (dataset[i - 2].type == PROFILE_FIELD_DOUBLE)
+				table->col_types[i] = H5T_NATIVE_DOUBLE;
+			else
+				table->col_types[i] = H5T_NATIVE_UINT64;
+		}
+		table->col_offsets[i] = offset;
+		offset += sizeof(uint64_t);
+
+		table->cols[i] = H5Dcreate(gid, col_name, table->col_types[i],
+					   space_id, H5P_DEFAULT, dcpl_id,
+					   H5P_DEFAULT);
+		if (table->cols[i] < 0) {
+			error("PROFILE: Impossible to create the column %s of table %s",
+			      col_name, name);
+			table->col_cnt = i;
+			break;
+		}
+	}
+
+	H5Sclose(space_id);
+	H5Pclose(dcpl_id);
+
+	if (table->col_cnt != col_cnt) {
+		for (i = 0; i < table->col_cnt; i++)
+			H5Dclose(table->cols[i]);
+		xfree(table->cols);
+		xfree(table->col_offsets);
+		xfree(table->col_types);
+		H5Gclose(gid);
+		return -1;
+	}
+
+	table->rows = xcalloc(chunk, offset);
+
+	return gid;
+}
+
+/* Append the records buffered in a columnar table to its datasets */
+static int _flush_columnar(table_t *table)
+{
+	hsize_t start = table->rows_written, count = table->rows_cnt;
+	hsize_t dims = start + count;
+	hid_t mem_space, file_space;
+	uint64_t *col;
+	int rc = SLURM_SUCCESS;
+
+	if (!count)
+		return SLURM_SUCCESS;
+
+	mem_space = H5Screate_simple(1, &count, NULL);
+	col = xcalloc(count, sizeof(uint64_t)); /* all fields are 64 bits */
+
+	for (int i = 0; i < table->col_cnt; i++) {
+		for (hsize_t r = 0; r < count; r++)
+			memcpy(&col[r], table->rows + (r * table->type_size) +
+			       table->col_offsets[i], sizeof(uint64_t));
+
+		if ((H5Dset_extent(table->cols[i], &dims) < 0) ||
+		    ((file_space = H5Dget_space(table->cols[i])) < 0)) {
+			rc = SLURM_ERROR;
+			break;
+		}
+		if ((H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &start,
+					 NULL, &count, NULL) < 0) ||
+		    (H5Dwrite(table->cols[i], table->col_types[i], mem_space,
+			      file_space, H5P_DEFAULT, col) < 0))
+			rc = SLURM_ERROR;
+		H5Sclose(file_space);
+		if (rc != SLURM_SUCCESS)
+			break;
+	}
+
+	xfree(col);
+	H5Sclose(mem_space);
+
+	if (rc != SLURM_SUCCESS)
+		error("PROFILE: Impossible to write %"PRIu64" records to a columnar table",
+		      (uint64_t) count);
+
+	table->rows_written = dims;
+	table->rows_cnt = 0;
+
+	return rc;
+}
+
+static void _close_table(table_t *table)
+{
+	if (!table->col_cnt) {
+		H5PTclose(table->table_id);
+		return;
+	}
+
+	_flush_columnar(table);
+	for (int i = 0; i < table->col_cnt; i++)
+		H5Dclose(table->cols[i]);
+	H5Gclose(table->table_id);
+	xfree(table->cols);
+	xfree(table->col_offsets);
+	xfree(table->col_types);
+	xfree(table->rows);
+}
+
 extern int init(void)
 {
 	if (!running_in_slurmstepd())
@@ -223,6 +390,9 @@ extern void acct_gather_profile_p_conf_options(s_p_options_t **full_options,
 	s_p_options_t options[] = {
 		{"ProfileHDF5Dir", S_P_STRING},
 		{"ProfileHDF5Default", S_P_STRING},
+		{"ProfileHDF5ChunkSize", S_P_UINT32},
+		{"ProfileHDF5Compress", S_P_LONG},
+		{"ProfileHDF5Layout", S_P_STRING},
 		{NULL} };
 
 	transfer_s_p_options(full_options, options, full_options_cnt);
@@ -232,6 +402,7 @@ extern void acct_gather_profile_p_conf_options(s_p_options_t **full_options,
 extern void acct_gather_profile_p_conf_set(s_p_hashtbl_t *tbl)
 {
 	char *tmp = NULL;
+	long compress;
 	_reset_slurm_profile_conf();
 	if (tbl) {
 		s_p_get_string(&hdf5_conf.dir, "ProfileHDF5Dir", tbl);
@@ -245,6 +416,27 @@ extern void acct_gather_profile_p_conf_set(s_p_hashtbl_t *tbl)
 			}
 			xfree(tmp);
 		}
+
+		s_p_get_uint32(&hdf5_conf.chunk_size, "ProfileHDF5ChunkSize",
+			       tbl);
+		if (!hdf5_conf.chunk_size)
+			fatal("ProfileHDF5ChunkSize must be greater than 0");
+
+		if (s_p_get_long(&compress, "ProfileHDF5Compress", tbl)) {
+			if ((compress < -1) || (compress > 9))
+				fatal("ProfileHDF5Compress=%ld is invalid, it must be between -1 and 9",
+				      compress);
+			hdf5_conf.compress = compress;
+		}
+
+		if (s_p_get_string(&tmp, "ProfileHDF5Layout", tbl)) {
+			if (!xstrcasecmp(tmp, "Columnar"))
+				hdf5_conf.columnar = true;
+			else if (xstrcasecmp(tmp, "Row"))
+				fatal("ProfileHDF5Layout=%s is invalid, it must be Row or Columnar",
+				      tmp);
+			xfree(tmp);
+		}
 	}
 
 	if (!hdf5_conf.dir)
@@ -405,7 +597,7 @@ extern int acct_gather_profile_p_node_step_end(void)
 
 	/* close tables */
 	for (i = 0; i < tables_cur_len; ++i) {
-		H5PTclose(tables[i].table_id);
+		_close_table(&tables[i]);
 	}
 	/* close groups */
 	for (i = 0; i < groups_len; ++i) {
@@ -475,6 +667,7 @@ extern int acct_gather_profile_p_create_dataset(
 	hid_t dtype_id;
 	hid_t field_id;
 	hid_t table_id;
+	table_t table = { 0 };
 	acct_gather_profile_dataset_t *dataset_loc = dataset;
 
 	if (g_profile_running <= ACCT_GATHER_PROFILE_NONE)
@@ -541,8 +734,12 @@ extern int acct_gather_profile_p_create_dataset(
 	/* create the table */
 	if (parent < 0)
 		parent = gid_node; /* default parent is the node group */
-	table_id = H5PTcreate_fl(parent, name, dtype_id, HDF5_CHUNK_SIZE,
-	                         HDF5_COMPRESS);
+	if (hdf5_conf.columnar)
+		table_id = _create_columnar(parent, name, dataset, &table);
+	else
+		table_id = H5PTcreate_fl(parent, name, dtype_id,
+					 hdf5_conf.chunk_size,
+					 hdf5_conf.compress);
 	if (table_id < 0) {
 		error("PROFILE: Impossible to create the table %s", name);
 		H5Tclose(dtype_id);
@@ -559,8 +756,9 @@ extern int acct_gather_profile_p_create_dataset(
 	}
 
 	/* reserve a new table */
-	tables[tables_cur_len].table_id  = table_id;
-	tables[tables_cur_len].type_size = type_size;
+	table.table_id  = table_id;
+	table.type_size = type_size;
+	tables[tables_cur_len] = table;
 	++tables_cur_len;
 
 	return tables_cur_len - 1;
@@ -601,6 +799,15 @@ extern int acct_gather_profile_p_add_sample_data(int table_id, void *data,
 
 	memcpy(send_data + header_size, data, ds->type_size - header_size);
 
+	if (ds->col_cnt) {
+		/* buffer the record until a whole chunk can be written */
+		memcpy(ds->rows + (ds->rows_cnt * ds->type_size), send_data,
+		       ds->type_size);
+		if (++ds->rows_cnt < hdf5_conf.chunk_size)
+			return SLURM_SUCCESS;
+		return _flush_columnar(ds);
+	}
+
 	/* append the record to the table */
 	if (H5PTappend(ds->table_id, 1, send_data) < 0) {
 		error("PROFILE: Impossible to add data to the table %d; "
@@ -616,6 +823,11 @@ extern void acct_gather_profile_p_conf_values(list_t **data)
 	add_key_pair(*data, "ProfileHDF5Dir", "%s", hdf5_conf.dir);
 	add_key_pair(*data, "ProfileHDF5Default", "%s",
 		     acct_gather_profile_to_string(hdf5_conf.def));
+	add_key_pair(*data, "ProfileHDF5ChunkSize", "%u",
+		     hdf5_conf.chunk_size);
+	add_key_pair(*data, "ProfileHDF5Compress", "%d", hdf5_conf.compress);
+	add_key_pair(*data, "ProfileHDF5Layout", "%s",
+		     hdf5_conf.columnar ? "Columnar" : "Row");
 }
 
 extern bool acct_gather_profile_p_is_active(uint32_t type)
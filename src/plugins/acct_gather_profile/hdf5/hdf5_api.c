@@ -205,3 +205,253 @@ extern void put_int_attribute(hid_t parent, char *name, int value)
 
 	return;
 }
+
+/* Number of records read at once from each dataset of a columnar table */
+#define COLUMNAR_READ_ROWS 1024
+
+struct profile_table {
+	hid_t pt_id;		/* packet table, -1 for a columnar table */
+	hid_t type_id;		/* compound type of a record */
+	hsize_t nrecords;
+	hsize_t next;		/* next record returned by get_next */
+
+	/* columnar layout only */
+	int col_cnt;
+	hid_t *cols;
+	char **col_names;
+	hid_t *col_types;	/* native type of each column */
+	size_t *col_offsets;	/* offset of each column in a native record */
+	size_t *col_sizes;
+	uint8_t **col_bufs;	/* COLUMNAR_READ_ROWS values of each column */
+	hsize_t buf_start;	/* first record held in col_bufs */
+	hsize_t buf_rows;
+};
+
+static void _close_columns(profile_table_t *table)
+{
+	for (int i = 0; i < table->col_cnt; i++) {
+		H5Dclose(table->cols[i]);
+		H5Tclose(table->col_types[i]);
+		xfree(table->col_names[i]);
+		xfree(table->col_bufs[i]);
+	}
+	xfree(table->cols);
+	xfree(table->col_names);
+	xfree(table->col_types);
+	xfree(table->col_offsets);
+	xfree(table->col_sizes);
+	xfree(table->col_bufs);
+	table->col_cnt = 0;
+}
+
+static herr_t _add_column(hid_t g_id, const char *name,
+			  const H5L_info_t *link_info, void *op_data)
+{
+	profile_table_t *table = op_data;
+	hid_t did, tid, n_tid;
+	int i = table->col_cnt;
+
+	if ((did = H5Dopen(g_id, name, H5P_DEFAULT)) < 0) {
+		debug3("PROFILE: failed to open column %s", name);
+		return -1;
+	}
+	if ((tid = H5Dget_type(did)) < 0) {
+		H5Dclose(did);
+		return -1;
+	}
+	n_tid = H5Tget_native_type(tid, H5T_DIR_DEFAULT);
+	H5Tclose(tid);
+	if (n_tid < 0) {
+		H5Dclose(did);
+		return -1;
+	}
+
+	xrecalloc(table->cols, i + 1, sizeof(hid_t));
+	xrecalloc(table->col_names, i + 1, sizeof(char *));
+	xrecalloc(table->col_types, i + 1, sizeof(hid_t));
+	xrecalloc(table->col_offsets, i + 1, sizeof(size_t));
+	xrecalloc(table->col_sizes, i + 1, sizeof(size_t));
+	xrecalloc(table->col_bufs, i + 1, sizeof(uint8_t *));
+
+	table->cols[i] = did;
+	table->col_names[i] = xstrdup(name);
+	table->col_types[i] = n_tid;
+	table->col_sizes[i] = H5Tget_size(n_tid);
+	table->col_bufs[i] = xmalloc(COLUMNAR_READ_ROWS * table->col_sizes[i]);
+	table->col_cnt++;
+
+	return 0;
+}
+
+static int _open_columnar(profile_table_t *table, hid_t gid)
+{
+	hid_t space, n_tid;
+	hsize_t dims;
+	size_t offset = 0;
+	int i;
+
+	/* Columns are created in field order, ElapsedTime first */
+	if (H5Literate(gid, H5_INDEX_CRT_ORDER, H5_ITER_INC, NULL,
+		       _add_column, table) < 0) {
+		/* creation order not tracked, fall back on name order */
+		_close_columns(table);
+		if (H5Literate(gid, H5_INDEX_NAME, H5_ITER_INC, NULL,
+			       _add_column, table) < 0)
+			return -1;
+	}
+	if (!table->col_cnt)
+		return -1;
+
+	for (i = 0; i < table->col_cnt; i++)
+		offset += table->col_sizes[i];
+	if ((table->type_id = H5Tcreate(H5T_COMPOUND, offset)) < 0)
+		return -1;
+
+	offset = 0;
+	table->nrecords = UINT64_MAX;
+	for (i = 0; i < table->col_cnt; i++) {
+		if (H5Tinsert(table->type_id, table->col_names[i], offset,
+			      table->col_types[i]) < 0)
+			return -1;
+		offset += table->col_sizes[i];
+
+		/* a partial flush leaves columns of different lengths */
+		if ((space = H5Dget_space(table->cols[i])) < 0)
+			return -1;
+		if (H5Sget_simple_extent_dims(space, &dims, NULL) != 1) {
+			H5Sclose(space);
+			return -1;
+		}
+		H5Sclose(space);
+		table->nrecords = MIN(table->nrecords, dims);
+	}
+
+	/* records are handed out in the layout of the native type */
+	if ((n_tid = H5Tget_native_type(table->type_id, H5T_DIR_DEFAULT)) < 0)
+		return -1;
+	for (i = 0; i < table->col_cnt; i++)
+		table->col_offsets[i] = H5Tget_member_offset(n_tid, i);
+	H5Tclose(n_tid);
+
+	return 0;
+}
+
+extern bool is_columnar_table(hid_t object)
+{
+	return (H5Aexists(object, ATTR_LAYOUT) > 0);
+}
+
+extern profile_table_t *profile_table_open(hid_t parent, const char *path)
+{
+	profile_table_t *table;
+	hid_t oid;
+	int rc = -1;
+
+	if ((oid = H5Oopen(parent, path, H5P_DEFAULT)) < 0) {
+		debug3("PROFILE: failed to open table %s", path);
+		return NULL;
+	}
+
+	table = xmalloc(sizeof(*table));
+	table->pt_id = -1;
+	table->type_id = -1;
+
+	if ((H5Iget_type(oid) == H5I_GROUP) && is_columnar_table(oid)) {
+		rc = _open_columnar(table, oid);
+	} else if (H5Iget_type(oid) == H5I_DATASET) {
+		if (((table->type_id = H5Dget_type(oid)) >= 0) &&
+		    ((table->pt_id = H5PTopen(parent, path)) >= 0) &&
+		    (H5PTget_num_packets(table->pt_id, &table->nrecords) >= 0))
+			rc = 0;
+	}
+	H5Oclose(oid);
+
+	if (rc) {
+		debug3("PROFILE: failed to read table %s", path);
+		profile_table_close(table);
+		return NULL;
+	}
+
+	return table;
+}
+
+extern hid_t profile_table_get_type(profile_table_t *table)
+{
+	return H5Tcopy(table->type_id);
+}
+
+extern hsize_t profile_table_get_num_records(profile_table_t *table)
+{
+	return table->nrecords;
+}
+
+static int _read_columns(profile_table_t *table)
+{
+	hsize_t start = table->next;
+	hsize_t count = MIN(COLUMNAR_READ_ROWS, table->nrecords - start);
+	hid_t mem_space, file_space;
+	herr_t err = 0;
+
+	if ((mem_space = H5Screate_simple(1, &count, NULL)) < 0)
+		return -1;
+
+	for (int i = 0; (err >= 0) && (i < table->col_cnt); i++) {
+		if ((file_space = H5Dget_space(table->cols[i])) < 0) {
+			err = -1;
+			break;
+		}
+		err = H5Sselect_hyperslab(file_space, H5S_SELECT_SET, &start,
+					  NULL, &count, NULL);
+		if (err >= 0)
+			err = H5Dread(table->cols[i], table->col_types[i],
+				      mem_space, file_space, H5P_DEFAULT,
+				      table->col_bufs[i]);
+		H5Sclose(file_space);
+	}
+	H5Sclose(mem_space);
+
+	if (err < 0)
+		return -1;
+
+	table->buf_start = start;
+	table->buf_rows = count;
+
+	return 0;
+}
+
+extern int profile_table_get_next(profile_table_t *table, void *data)
+{
+	hsize_t row;
+
+	if (table->pt_id >= 0)
+		return (H5PTget_next(table->pt_id, 1, data) < 0) ? -1 : 0;
+
+	if (table->next >= table->nrecords)
+		return -1;
+
+	if ((table->next >= (table->buf_start + table->buf_rows)) &&
+	    _read_columns(table))
+		return -1;
+
+	row = table->next - table->buf_start;
+	for (int i = 0; i < table->col_cnt; i++)
+		memcpy((uint8_t *) data + table->col_offsets[i],
+		       table->col_bufs[i] + (row * table->col_sizes[i]),
+		       table->col_sizes[i]);
+	table->next++;
+
+	return 0;
+}
+
+extern void profile_table_close(profile_table_t *table)
+{
+	if (!table)
+		return;
+
+	if (table->pt_id >= 0)
+		H5PTclose(table->pt_id);
+	if (table->type_id >= 0)
+		H5Tclose(table->type_id);
+	_close_columns(table);
+	xfree(table);
+}
@@ -43,6 +43,7 @@
 #define __ACCT_GATHER_HDF5_API_H__
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdlib.h>
 
 #include <hdf5.h>
@@ -58,6 +59,9 @@
 #define ATTR_NTASKS "Number of Tasks"
 #define ATTR_CPUPERTASK "CPUs per Task"
 #define ATTR_STARTTIME "Start Time"
+#define ATTR_LAYOUT "Layout"
+
+#define LAYOUT_COLUMNAR "Columnar"
 
 #define GRP_ENERGY "Energy"
 #define GRP_FILESYSTEM "Filesystem"
@@ -124,4 +128,57 @@ void put_string_attribute(hid_t parent, char* name, char* value);
  */
 void put_int_attribute(hid_t parent, char* name, int value);
 
+/*
+ * A table of samples is stored either as a packet table (one dataset of
+ * compound records) or, with ProfileHDF5Layout=Columnar, as a group tagged
+ * with ATTR_LAYOUT holding one extendable dataset per field, created in field
+ * order. profile_table_*() read both the same way.
+ */
+typedef struct profile_table profile_table_t;
+
+/*
+ * Tell if an object is a table stored with the columnar layout
+ *
+ * Parameters
+ *	object	- handle to a group or dataset
+ */
+bool is_columnar_table(hid_t object);
+
+/*
+ * Open a table for reading
+ *
+ * Parameters
+ *	parent	- handle to parent group.
+ *	path	- path of the table relative to parent
+ *
+ * Returns - table (or NULL on error), close with profile_table_close()
+ */
+profile_table_t *profile_table_open(hid_t parent, const char *path);
+
+/*
+ * Get the compound type of the records of a table, field offsets are only
+ * valid once converted with H5Tget_native_type().
+ *
+ * Returns - handle for the type (or -1 on error), caller must close
+ */
+hid_t profile_table_get_type(profile_table_t *table);
+
+/*
+ * Get the number of records of a table
+ */
+hsize_t profile_table_get_num_records(profile_table_t *table);
+
+/*
+ * Read the next record of a table
+ *
+ * Parameters
+ *	table	- table to read from
+ *	data	- buffer the size of the native type of the table
+ *
+ * Returns - 0 on success, -1 on error or past the last record
+ */
+int profile_table_get_next(profile_table_t *table, void *data);
+
+void profile_table_close(profile_table_t *table);
+
 #endif /*__ACCT_GATHER_HDF5_API_H__*/
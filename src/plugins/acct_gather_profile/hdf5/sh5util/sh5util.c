@@ -52,12 +52,16 @@
 #include <float.h>
 #include <getopt.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include "src/common/macros.h"
 #include "src/common/uid.h"
 #include "src/common/read_config.h"
 #include "src/common/proc_args.h"
@@ -134,11 +138,26 @@ typedef struct table {
 
 typedef struct {
 	char *file_name;
+	void *image;		/* file content read ahead by _prefetch() */
+	size_t image_size;
 	int job_id;
+	bool loaded;
 	char *node_name;
 	int step_id;
 } sh5util_file_t;
 
+/* Node-step files read ahead of the merge with --parallel */
+typedef struct {
+	pthread_cond_t cond;
+	char *dir;
+	sh5util_file_t **files;
+	int files_cnt;
+	int merged;		/* files merged so far */
+	pthread_mutex_t mutex;
+	int next;		/* next file to read */
+	int window;		/* max files read ahead of the merge */
+} prefetch_t;
+
 static FILE* output_file;
 static bool group_mode = false;
 static const char *current_step;
@@ -185,6 +204,8 @@ static void _help_msg(void)
 	       " -o, --output         Path to a file into which to write.\n"
 	       "                      Default for merge is ./job_$jobid.h5\n"
 	       "                      Default for extract is ./extract_$jobid.csv\n"
+	       " -P, --parallel       Number of node-step files read at once when merging\n"
+	       "                      or of processes extracting series (default 1)\n"
 	       " -p, --profiledir     Profile directory location where node-step files exist\n"
 	       "		               default is what is set in acct_gather.conf\n"
 	       " -S, --savefiles      Don't remove node-step files after merging them \n"
@@ -255,6 +276,7 @@ static void _destroy_sh5util_file(void *arg)
 	object = (sh5util_file_t *)arg;
 
 	xfree(object->file_name);
+	xfree(object->image);
 	xfree(object->node_name);
 	xfree(object);
 }
@@ -331,6 +353,7 @@ static void _init_opts(void)
 	memset(&params, 0, sizeof(sh5util_opts_t));
 	params.job_id = -1;
 	params.mode = SH5UTIL_MODE_MERGE;
+	params.parallel = 1;
 	params.step_id = -1;
 }
 
@@ -353,6 +376,7 @@ static int _set_options(const int argc, char **argv)
 		{"list", no_argument, 0, 'L'},
 		{"node", required_argument, 0, 'N'},
 		{"output", required_argument, 0, 'o'},
+		{"parallel", required_argument, 0, 'P'},
 		{"profiledir", required_argument, 0, 'p'},
 		{"series", required_argument, 0, 's'},
 		{"savefiles", no_argument, 0, 'S'},
@@ -375,7 +399,7 @@ static int _set_options(const int argc, char **argv)
 
 	_init_opts();
 
-	while ((cc = getopt_long(argc, argv, "d:Ehi:Ij:l:LN:o:p:s:Su:UvV",
+	while ((cc = getopt_long(argc, argv, "d:Ehi:Ij:l:LN:o:p:P:s:Su:UvV",
 	                         long_options, &option_index)) != EOF) {
 		switch (cc) {
 		case 'd':
@@ -423,6 +447,14 @@ static int _set_options(const int argc, char **argv)
 			xfree(params.dir);
 			params.dir = xstrdup(optarg);
 			break;
+		case 'P':
+			params.parallel = strtol(optarg, &next_str, 10);
+			if ((params.parallel < 1) || (next_str[0] != '\0')) {
+				error("Bad value for --parallel=\"%s\"",
+				      optarg);
+				return -1;
+			}
+			break;
 		case 's':
 			xfree(params.series);
 			if (xstrcmp(optarg, GRP_ENERGY)
@@ -549,7 +581,13 @@ static int _merge_node_step_data(char* file_name, hid_t jgid_nodes,
 	char *group_name = NULL;
 	int rc = SLURM_SUCCESS;
 
-	fid_nodestep = H5Fopen(file_name, H5F_ACC_RDONLY, H5P_DEFAULT);
+	if (sh5util_file->image)
+		fid_nodestep = H5LTopen_file_image(
+			sh5util_file->image, sh5util_file->image_size,
+			H5LT_FILE_IMAGE_DONT_COPY |
+			H5LT_FILE_IMAGE_DONT_RELEASE);
+	else
+		fid_nodestep = H5Fopen(file_name, H5F_ACC_RDONLY, H5P_DEFAULT);
 	if (fid_nodestep < 0) {
 		error("Failed to open %s",file_name);
 		return SLURM_ERROR;
@@ -575,10 +613,92 @@ static int _merge_node_step_data(char* file_name, hid_t jgid_nodes,
 endit:
 	xfree(group_name);
 	H5Fclose(fid_nodestep);
+	xfree(sh5util_file->image);
 
 	return rc;
 }
 
+/* Read a whole node-step file into memory */
+static void *_read_file(const char *path, size_t *size)
+{
+	struct stat st;
+	ssize_t len;
+	size_t off = 0;
+	char *buf;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return NULL;
+	if ((fstat(fd, &st) < 0) || !st.st_size) {
+		close(fd);
+		return NULL;
+	}
+
+	buf = xmalloc(st.st_size);
+	while (off < st.st_size) {
+		len = read(fd, buf + off, st.st_size - off);
+		if (len < 0 && ((errno == EINTR) || (errno == EAGAIN)))
+			continue;
+		if (len <= 0)
+			break;
+		off += len;
+	}
+	close(fd);
+
+	if (off < st.st_size) {
+		debug("%s: short read of %s, it will be opened directly",
+		      __func__, path);
+		xfree(buf);
+		return NULL;
+	}
+
+	*size = off;
+	return buf;
+}
+
+/*
+ * Read node-step files into memory ahead of the merge. Opening and reading
+ * thousands of small files from a shared file system dominates the merge, so
+ * this is done by params.parallel threads while the main thread copies the
+ * in-memory files into the job file. HDF5 itself is only called from the main
+ * thread as it is not thread safe.
+ */
+static void *_prefetch(void *arg)
+{
+	prefetch_t *prefetch = arg;
+	sh5util_file_t *file;
+	char *path;
+	void *image;
+	size_t size = 0;
+
+	while (true) {
+		slurm_mutex_lock(&prefetch->mutex);
+		while ((prefetch->next < prefetch->files_cnt) &&
+		       (prefetch->next >= (prefetch->merged +
+					   prefetch->window)))
+			slurm_cond_wait(&prefetch->cond, &prefetch->mutex);
+		if (prefetch->next >= prefetch->files_cnt) {
+			slurm_mutex_unlock(&prefetch->mutex);
+			break;
+		}
+		file = prefetch->files[prefetch->next++];
+		slurm_mutex_unlock(&prefetch->mutex);
+
+		path = xstrdup_printf("%s/%s", prefetch->dir, file->file_name);
+		image = _read_file(path, &size);
+		xfree(path);
+
+		slurm_mutex_lock(&prefetch->mutex);
+		file->image = image;
+		file->image_size = size;
+		file->loaded = true;
+		slurm_cond_broadcast(&prefetch->cond);
+		slurm_mutex_unlock(&prefetch->mutex);
+	}
+
+	return NULL;
+}
+
 /* Look for step and node files and merge them together into one job file */
 static int _merge_step_files(void)
 {
@@ -603,6 +723,12 @@ static int _merge_step_files(void)
 	list_itr_t *itr;
 	list_t *file_list = NULL;
 	sh5util_file_t *sh5util_file = NULL;
+	prefetch_t prefetch = {
+		.cond = PTHREAD_COND_INITIALIZER,
+		.mutex = PTHREAD_MUTEX_INITIALIZER,
+	};
+	pthread_t *threads = NULL;
+	int threads_cnt = 0;
 
 	step_dir = xstrdup_printf("%s/%s", params.dir, params.user);
 
@@ -684,11 +810,40 @@ static int _merge_step_files(void)
 	/* sort the files so they are in step order */
 	list_sort(file_list, (ListCmpF) _sh5util_sort_files_dec);
 
+	if (params.parallel > 1) {
+		prefetch.dir = step_dir;
+		prefetch.files_cnt = list_count(file_list);
+		prefetch.files = xcalloc(prefetch.files_cnt,
+					 sizeof(sh5util_file_t *));
+		prefetch.window = params.parallel * 2;
+		itr = list_iterator_create(file_list);
+		while ((sh5util_file = list_next(itr)))
+			prefetch.files[prefetch.next++] = sh5util_file;
+		list_iterator_destroy(itr);
+		prefetch.next = 0;
+
+		threads_cnt = MIN(params.parallel, prefetch.files_cnt);
+		threads = xcalloc(threads_cnt, sizeof(pthread_t));
+		for (int i = 0; i < threads_cnt; i++)
+			slurm_thread_create(&threads[i], _prefetch, &prefetch);
+	}
+
 	node_cnt = 0;
 	itr = list_iterator_create(file_list);
 	while ((sh5util_file = list_next(itr))) {
 		//info("got file of %s", sh5util_file->file_name);
 
+		if (threads_cnt) {
+			slurm_mutex_lock(&prefetch.mutex);
+			while (!sh5util_file->loaded)
+				slurm_cond_wait(&prefetch.cond,
+						&prefetch.mutex);
+			/* let the next file be read in */
+			prefetch.merged++;
+			slurm_cond_broadcast(&prefetch.cond);
+			slurm_mutex_unlock(&prefetch.mutex);
+		}
+
 		/* make a group for each step */
 		if (sh5util_file->step_id != last_step) {
 			last_step = sh5util_file->step_id;
@@ -742,7 +897,6 @@ static int _merge_step_files(void)
 		rc = _merge_node_step_data(
 			step_path, jgid_nodes, sh5util_file);
 		xfree(step_path);
-
 	}
 	list_iterator_destroy(itr);
 
@@ -750,6 +904,10 @@ static int _merge_step_files(void)
 
 
 endit:
+	for (int i = 0; i < threads_cnt; i++)
+		slurm_thread_join(threads[i]);
+	xfree(threads);
+	xfree(prefetch.files);
 	FREE_NULL_LIST(file_list);
 	xfree(file_name);
 	xfree(step_dir);
@@ -792,14 +950,14 @@ static herr_t _collect_tables_group(hid_t g_id, const char *name,
                                     const H5L_info_t *link_info, void *op_data)
 {
 	list_t *tables = op_data;
-	hid_t table_id = -1;
+	profile_table_t *table;
 
-	/* open the dataset. */
-	if ((table_id = H5Dopen(g_id, name, H5P_DEFAULT)) < 0) {
+	/* open the table. */
+	if (!(table = profile_table_open(g_id, name))) {
 		error("Failed to open the dataset %s", name);
 		return -1;
 	}
-	H5Dclose(table_id);
+	profile_table_close(table);
 
 	group_mode = true;
 
@@ -836,7 +994,8 @@ static herr_t _collect_tables_node(hid_t g_id, const char *name,
 		return -1;
 	}
 
-	if (H5Iget_type(object_id) == H5I_DATASET) {
+	if ((H5Iget_type(object_id) == H5I_DATASET) ||
+	    is_columnar_table(object_id)) {
 		table_t *t = xmalloc(sizeof(table_t));
 		t->step  = xstrdup(current_step);
 		t->node  = xstrdup(name);
@@ -921,13 +1080,13 @@ static int _tables_list(hid_t fid_job, list_t *tables)
  * @param offsets   Offset of each field
  * @param types     Type of each field
  * @param type_size Size of of a record in the dataset
- * @param table_id  ID of the table to extract from
+ * @param table_id  Table to extract from
  * @param state     State of the current extraction
  * @param node_name Name of the node containing this table
  * @param output    output file
  */
 static void _extract_totals(size_t nb_fields, size_t *offsets, hid_t *types,
-                            hsize_t type_size, hid_t table_id,
+                            hsize_t type_size, profile_table_t *table_id,
                             table_t *table, FILE *output)
 {
 	hsize_t nrecords;
@@ -942,11 +1101,11 @@ static void _extract_totals(size_t nb_fields, size_t *offsets, hid_t *types,
 	data = xmalloc(type_size);
 	agg_i = xmalloc(nb_fields * 4 * sizeof(uint64_t));
 	agg_d = (double *)agg_i;
-	H5PTget_num_packets(table_id, &nrecords);
+	nrecords = profile_table_get_num_records(table_id);
 
 	/* compute min/max/sum */
 	for (i = 0; i < nrecords; ++i) {
-		H5PTget_next(table_id, 1, data);
+		profile_table_get_next(table_id, data);
 		for (j = 0; j < nb_fields; ++j) {
 			if (H5Tequal(types[j], H5T_NATIVE_UINT64)) {
 				uint64_t v = *(uint64_t *)(data + offsets[j]);
@@ -1025,12 +1184,11 @@ static int _extract_series_table(hid_t fid_job, table_t *table, list_t *fields,
 	size_t offsets[max_fields];
 	hid_t types[max_fields];
 
-	hid_t did = -1;    /* dataset id */
 	hid_t tid = -1;    /* file type ID */
 	hid_t n_tid = -1;  /* native type ID */
 	hid_t m_tid = -1;  /* member type ID */
 	hid_t nm_tid = -1; /* native member ID */
-	hid_t table_id = -1;
+	profile_table_t *table_id = NULL;
 	hsize_t nmembers;
 	hsize_t type_size;
 	hsize_t nrecords;
@@ -1039,14 +1197,14 @@ static int _extract_series_table(hid_t fid_job, table_t *table, list_t *fields,
 	_table_path(table, path);
 	debug("Extracting from table %s", path);
 
-	/* open the dataset. */
-	if ((did = H5Dopen(fid_job, path, H5P_DEFAULT)) < 0) {
+	/* open the table */
+	if (!(table_id = profile_table_open(fid_job, path))) {
 		error("Failed to open the table %s", path);
 		goto error;
 	}
 
 	/* get the datatype */
-	if ((tid = H5Dget_type(did)) < 0)
+	if ((tid = profile_table_get_type(table_id)) < 0)
 		goto error;
 	if ((n_tid = H5Tget_native_type(tid, H5T_DIR_DEFAULT)) < 0)
 		goto error;
@@ -1083,25 +1241,18 @@ static int _extract_series_table(hid_t fid_job, table_t *table, list_t *fields,
 
 	H5Tclose(n_tid);
 	H5Tclose(tid);
-	H5Dclose(did);
-
-	/* open the table */
-	if ((table_id = H5PTopen(fid_job, path)) < 0) {
-		error("Failed to open the series %s", params.input);
-		goto error;
-	}
 
 	if (level_total) {
 		_extract_totals(nb_fields, offsets, types, type_size,
 		                table_id, table, output);
 	} else {
 		/* Timeseries level */
-		H5PTget_num_packets(table_id, &nrecords);
+		nrecords = profile_table_get_num_records(table_id);
 		uint8_t data[type_size];
 
 		/* print the expected fields of all the records */
 		for (i = 0; i < nrecords; ++i) {
-			H5PTget_next(table_id, 1, data);
+			profile_table_get_next(table_id, data);
 			fprintf(output, "%s,%s", table->step, table->node);
 			if (group_mode)
 				fprintf(output, ",%s", table->name);
@@ -1123,7 +1274,7 @@ static int _extract_series_table(hid_t fid_job, table_t *table, list_t *fields,
 		}
 	}
 
-	H5PTclose(table_id);
+	profile_table_close(table_id);
 
 	return SLURM_SUCCESS;
 
@@ -1132,11 +1283,96 @@ error:
 	if (m_tid >= 0) H5Dclose(m_tid);
 	if (n_tid >= 0) H5Dclose(n_tid);
 	if (tid >= 0) H5Dclose(tid);
-	if (did >= 0) H5PTclose(did);
-	if (table_id >= 0) H5PTclose(table_id);
+	profile_table_close(table_id);
 	return SLURM_ERROR;
 }
 
+/*
+ * Extract the tables from params.parallel forked processes, each one working
+ * on a contiguous slice of the tables and writing into a temporary file. The
+ * temporary files are then appended to output in order. Processes are used
+ * rather than threads as HDF5 is not thread safe.
+ */
+static int _extract_series_parallel(list_t *tables, list_t *fields,
+				    FILE *output, bool level_total)
+{
+	int nb_tables = list_count(tables);
+	int nb_workers = MIN(params.parallel, nb_tables);
+	table_t *table_array[nb_tables];
+	FILE *parts[nb_workers];
+	pid_t pids[nb_workers];
+	int i, j, status, started, rc = SLURM_SUCCESS;
+	list_itr_t *it;
+	table_t *t;
+	char buf[BUFSIZ];
+	size_t len;
+
+	i = 0;
+	it = list_iterator_create(tables);
+	while ((t = list_next(it)))
+		table_array[i++] = t;
+	list_iterator_destroy(it);
+
+	/* do not let the workers inherit buffered output */
+	fflush(output);
+
+	for (i = 0; i < nb_workers; i++) {
+		if (!(parts[i] = tmpfile())) {
+			error("%s: tmpfile(): %m", __func__);
+			rc = SLURM_ERROR;
+			break;
+		}
+
+		if ((pids[i] = fork()) < 0) {
+			error("%s: fork(): %m", __func__);
+			fclose(parts[i]);
+			rc = SLURM_ERROR;
+			break;
+		} else if (pids[i] == 0) {
+			int first = (i * nb_tables) / nb_workers;
+			int last = ((i + 1) * nb_tables) / nb_workers;
+			hid_t fid_job = H5Fopen(params.input, H5F_ACC_RDONLY,
+						H5P_DEFAULT);
+
+			if (fid_job < 0) {
+				error("Failed to open %s", params.input);
+				_exit(1);
+			}
+			for (j = first; j < last; j++) {
+				if (_extract_series_table(fid_job,
+							  table_array[j],
+							  fields, parts[i],
+							  level_total) < 0)
+					_exit(1);
+			}
+			H5Fclose(fid_job);
+			if (fflush(parts[i]))
+				_exit(1);
+			_exit(0);
+		}
+	}
+	started = i;
+
+	for (i = 0; i < started; i++) {
+		if ((waitpid(pids[i], &status, 0) < 0) ||
+		    !WIFEXITED(status) || WEXITSTATUS(status)) {
+			error("Extraction worker %d failed", i);
+			rc = SLURM_ERROR;
+		}
+	}
+
+	for (i = 0; i < started; i++) {
+		if (rc == SLURM_SUCCESS) {
+			rewind(parts[i]);
+			while ((len = fread(buf, 1, sizeof(buf), parts[i])))
+				fwrite(buf, 1, len, output);
+		}
+		fclose(parts[i]);
+	}
+
+	return rc;
+}
+
 /* _extract_series()
  */
 static int _extract_series(void)
@@ -1207,18 +1443,31 @@ static int _extract_series(void)
 	list_iterator_destroy(it);
 
 	/* Extract from every table */
-	it = list_iterator_create(tables);
-	while ((t = list_next(it))) {
-		if (_extract_series_table(fid_job, t, fields,
-		                          output, level_total) < 0) {
+	if ((params.parallel > 1) && (list_count(tables) > 1)) {
+		/* workers open the job file themselves */
+		H5Fclose(fid_job);
+		fid_job = -1;
+		if (_extract_series_parallel(tables, fields, output,
+					     level_total) != SLURM_SUCCESS) {
 			error("Failed to extract series");
+			rc = SLURM_ERROR;
 			goto error;
 		}
+	} else {
+		it = list_iterator_create(tables);
+		while ((t = list_next(it))) {
+			if (_extract_series_table(fid_job, t, fields,
+			                          output, level_total) < 0) {
+				error("Failed to extract series");
+				goto error;
+			}
+		}
 	}
 
 	FREE_NULL_LIST(tables);
 	FREE_NULL_LIST(fields);
-	H5Fclose(fid_job);
+	if (fid_job >= 0)
+		H5Fclose(fid_job);
 	fclose(output);
 	return SLURM_SUCCESS;
 
@@ -1241,7 +1490,7 @@ error:
  * tables.
  *
  * @param nb_tables  Number of table to analyze
- * @param tables     IDs of all the tables to analyze
+ * @param tables     All the tables to analyze
  * @param nb_records Number of records in each table
  * @param buf_size   Size of the largest record of the tables
  * @param offsets    Offset of the item analyzed in each table
@@ -1249,7 +1498,7 @@ error:
  * @param nodes      Name of the node for each table
  * @param step_name  Name of the current step
  */
-static void _item_analysis_uint(hsize_t nb_tables, hid_t *tables,
+static void _item_analysis_uint(hsize_t nb_tables, profile_table_t **tables,
 				hsize_t *nb_records, size_t buf_size,
 				size_t *offsets,
 				const char *names[], const char *nodes[],
@@ -1282,7 +1531,7 @@ static void _item_analysis_uint(hsize_t nb_tables, hid_t *tables,
 			--nb_records[i];
 			++nb_series_in_smp;
 			/* read the value of the item in the series i */
-			H5PTget_next(tables[i], 1, (void *)buffer);
+			profile_table_get_next(tables[i], buffer);
 			v = *(uint64_t *)(buffer + offsets[i]);
 			values[i] = v;
 			/* compute the sum, min and max */
@@ -1350,7 +1599,8 @@ static void _item_analysis_uint(hsize_t nb_tables, hid_t *tables,
  * tables.
  * See _item_analysis_uint for parameters description.
  */
-static void _item_analysis_double(hsize_t nb_tables, hid_t *tables,
+static void _item_analysis_double(hsize_t nb_tables,
+				  profile_table_t **tables,
 				  hsize_t *nb_records, size_t buf_size,
 				  size_t *offsets,
 				  const char *names[], const char *nodes[],
@@ -1383,7 +1633,7 @@ static void _item_analysis_double(hsize_t nb_tables, hid_t *tables,
 			--nb_records[i];
 			++nb_series_in_smp;
 			/* read the value of the item in the series i */
-			H5PTget_next(tables[i], 1, (void *)buffer);
+			profile_table_get_next(tables[i], buffer);
 			v = *(double *)(buffer + offsets[i]);
 			values[i] = v;
 			/* compute the sum, min and max */
@@ -1447,7 +1697,6 @@ static herr_t _extract_item_step(hid_t g_id, const char *step_name,
 	char *m_name;
 
 	hid_t fid_job = *((hid_t *)op_data);
-	hid_t did = -1;    /* dataset id */
 	hid_t tid = -1;    /* file type ID */
 	hid_t n_tid = -1;  /* native type ID */
 	hid_t m_tid = -1;  /* member type ID */
@@ -1480,14 +1729,14 @@ static herr_t _extract_item_step(hid_t g_id, const char *step_name,
 	}
 
 	size_t nb_tables = list_count(tables);
-	hid_t tables_id[nb_tables];
+	profile_table_t *tables_id[nb_tables];
 	size_t offsets[nb_tables];
 	hsize_t nb_records[nb_tables];
 	const char *names[nb_tables];
 	const char *nodes[nb_tables];
 
 	for (i = 0; i < nb_tables; ++i) {
-		tables_id[i] = -1;
+		tables_id[i] = NULL;
 		nb_records[i] = 0;
 	}
 
@@ -1497,15 +1746,16 @@ static herr_t _extract_item_step(hid_t g_id, const char *step_name,
 		names[i] = t->name;
 		nodes[i] = t->node;
 
-		/* open the dataset. */
+		/* open the table */
 		_table_path(t, path);
-		if ((did = H5Dopen(fid_job, path, H5P_DEFAULT)) < 0) {
+		if (!(tables_id[i] = profile_table_open(fid_job, path))) {
 			error("Failed to open the series %s", path);
 			goto error;
 		}
+		nb_records[i] = profile_table_get_num_records(tables_id[i]);
 
 		/* get the datatype */
-		if ((tid = H5Dget_type(did)) < 0)
+		if ((tid = profile_table_get_type(tables_id[i])) < 0)
 			goto error;
 		if ((n_tid = H5Tget_native_type(tid, H5T_DIR_DEFAULT)) < 0)
 			goto error;
@@ -1555,14 +1805,6 @@ static herr_t _extract_item_step(hid_t g_id, const char *step_name,
 
 		H5Tclose(n_tid);
 		H5Tclose(tid);
-		H5Dclose(did);
-
-		/* open the table */
-		if ((tables_id[i] = H5PTopen(fid_job, path)) < 0) {
-			error("Failed to open the series %s", path);
-			goto error;
-		}
-		H5PTget_num_packets(tables_id[i], &nb_records[i]);
 
 		++i;
 	}
@@ -1597,23 +1839,20 @@ static herr_t _extract_item_step(hid_t g_id, const char *step_name,
 
 	/* clean up */
 	for (i = 0; i < nb_tables; ++i) {
-		H5PTclose(tables_id[i]);
+		profile_table_close(tables_id[i]);
 	}
 	FREE_NULL_LIST(tables);
 
 	return 0;
 
 error:
-	if (did >= 0) H5Dclose(did);
 	if (tid >= 0) H5Tclose(tid);
 	if (n_tid >= 0) H5Tclose(n_tid);
 	if (m_tid >= 0) H5Tclose(m_tid);
 	if (nm_tid >= 0) H5Tclose(nm_tid);
 	FREE_NULL_LIST(tables);
-	for (i = 0; i < nb_tables; ++i) {
-		if (tables_id[i] >= 0)
-			H5PTclose(tables_id[i]);
-	}
+	for (i = 0; i < nb_tables; ++i)
+		profile_table_close(tables_id[i]);
 	return -1;
 }
 
@@ -1657,7 +1896,7 @@ static int _extract_item(void)
 
 static int _fields_intersection(hid_t fid_job, list_t *tables, list_t *fields)
 {
-	hid_t jgid_table = -1;
+	profile_table_t *jgid_table = NULL;
 	hid_t tid = -1;
 	hssize_t nb_fields;
 	size_t i;
@@ -1674,13 +1913,13 @@ static int _fields_intersection(hid_t fid_job, list_t *tables, list_t *fields)
 	it1 = list_iterator_create(tables);
 	while ((t = (table_t *)list_next(it1))) {
 		_table_path(t, path);
-		jgid_table = H5Dopen(fid_job, path, H5P_DEFAULT);
-		if (jgid_table < 0) {
+		jgid_table = profile_table_open(fid_job, path);
+		if (!jgid_table) {
 			error("Failed to open table %s", path);
 			return SLURM_ERROR;
 		}
 
-		tid = H5Dget_type(jgid_table);
+		tid = profile_table_get_type(jgid_table);
 		nb_fields = H5Tget_nmembers(tid);
 
 		if (first) {
@@ -1718,7 +1957,7 @@ static int _fields_intersection(hid_t fid_job, list_t *tables, list_t *fields)
 		}
 
 		H5Tclose(tid);
-		H5Dclose(jgid_table);
+		profile_table_close(jgid_table);
 	}
 	list_iterator_destroy(it1);
 
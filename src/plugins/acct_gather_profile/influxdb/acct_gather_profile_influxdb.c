@@ -47,6 +47,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/file.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <sys/stat.h>
@@ -68,8 +69,15 @@
 #include "src/curl/slurm_curl.h"
 #include "src/interfaces/proctrack.h"
 
+#if HAVE_ZLIB
+# include <zlib.h>
+#endif
+
 #define DEFAULT_INFLUXDB_FREQUENCY 30
 #define DEFAULT_INFLUXDB_TIMEOUT 10
+#define DEFAULT_INFLUXDB_SPOOL_SIZE 64	/* MB */
+#define SPOOL_FILE "influxdb.spool"
+#define SPOOL_SEND_SIZE (1024 * 1024)	/* bytes posted per spool request */
 
 /* Required Slurm plugin symbols: */
 const char plugin_name[] = "AcctGatherProfile influxdb plugin";
@@ -77,12 +85,16 @@ const char plugin_type[] = "acct_gather_profile/influxdb";
 const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 
 typedef struct {
+	uint32_t buffer_size;
+	bool compress;
 	char *host;
 	char *database;
 	uint32_t def;
 	char *password;
 	char *rt_policy;
 	uint32_t frequency;
+	char *spool_dir;
+	uint32_t spool_size;
 	uint32_t timeout;
 	char *username;
 } slurm_influxdb_conf_t;
@@ -149,12 +161,246 @@ static uint32_t _determine_profile(void)
 	return profile;
 }
 
+#if HAVE_ZLIB
+/* RET gzip stream of data, xfree() it */
+static char *_gzip(const char *data, size_t len, size_t *out_len)
+{
+	z_stream zs = { 0 };
+	char *out;
+	uLong bound;
+
+	if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+			 Z_DEFAULT_STRATEGY) != Z_OK)
+		return NULL;
+
+	bound = deflateBound(&zs, len);
+	out = xmalloc(bound);
+	zs.next_in = (Bytef *) data;
+	zs.avail_in = len;
+	zs.next_out = (Bytef *) out;
+	zs.avail_out = bound;
+
+	if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+		deflateEnd(&zs);
+		xfree(out);
+		return NULL;
+	}
+	*out_len = zs.total_out;
+	deflateEnd(&zs);
+
+	return out;
+}
+#endif
+
+/* POST len bytes of line protocol to influxdb */
+static int _post_data(const char *data, size_t len)
+{
+	int rc = SLURM_SUCCESS;
+	long response_code = 0;
+	char *url = NULL, *response_str = NULL, *body = NULL;
+	size_t body_len = len;
+	struct curl_slist *headers = NULL;
+
+#if HAVE_ZLIB
+	/* influxdb accepts gzip bodies, the line protocol is very redundant */
+	if (influxdb_conf.compress &&
+	    (body = _gzip(data, len, &body_len))) {
+		headers = curl_slist_append(headers,
+					    "Content-Encoding: gzip");
+		log_flag(PROFILE, "%s %s: compressed %zu bytes to %zu",
+			 plugin_type, __func__, len, body_len);
+	} else
+		body_len = len;
+#endif
+
+	xstrfmtcat(url, "%s/write?db=%s&rp=%s&precision=s", influxdb_conf.host,
+		   influxdb_conf.database, influxdb_conf.rt_policy);
+	rc = slurm_curl_request_len((body ? body : data), body_len, url,
+				    influxdb_conf.username,
+				    influxdb_conf.password, NULL, NULL, NULL,
+				    headers, influxdb_conf.timeout,
+				    &response_str, &response_code,
+				    HTTP_REQUEST_POST, true, false);
+	xfree(url);
+	xfree(body);
+	if (headers)
+		curl_slist_free_all(headers);
+
+	/* In general, status codes of the form 2xx indicate success,
+	 * 4xx indicate that InfluxDB could not understand the request, and
+	 * 5xx indicate that the system is overloaded or significantly impaired.
+	 * Errors are returned in JSON.
+	 * https://docs.influxdata.com/influxdb/v0.13/concepts/api/
+	 */
+	if (rc != SLURM_SUCCESS) {
+		error("send data failed");
+	} else if ((response_code >= 200) && (response_code <= 205)) {
+		debug2("%s %s: data write success", plugin_type, __func__);
+	} else {
+		rc = SLURM_ERROR;
+		debug2("%s %s: data write failed, response code: %ld",
+		       plugin_type, __func__, response_code);
+		if ((slurm_conf.debug_flags & DEBUG_FLAG_PROFILE) &&
+		    response_str) {
+			/* Strip any trailing newlines. */
+			while (response_str[0] &&
+			       (response_str[strlen(response_str) - 1] == '\n'))
+				response_str[strlen(response_str) - 1] = '\0';
+			info("%s %s: JSON response body: %s", plugin_type,
+			     __func__, response_str);
+		}
+	}
+
+	xfree(response_str);
+
+	return rc;
+}
+
+/*
+ * Keep data that couldn't be sent in the node's spool file, shared by all
+ * the steps, until it grows past ProfileInfluxDBSpoolSize.
+ */
+static void _spool_data(const char *data, size_t len)
+{
+	char *path = NULL;
+	struct stat st;
+	int fd;
+
+	if (!influxdb_conf.spool_dir || !len)
+		return;
+
+	xstrfmtcat(path, "%s/%s", influxdb_conf.spool_dir, SPOOL_FILE);
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+		       0600)) < 0) {
+		error("%s: open(%s): %m", __func__, path);
+		xfree(path);
+		return;
+	}
+
+	if (flock(fd, LOCK_EX) || fstat(fd, &st)) {
+		error("%s: %s: %m", __func__, path);
+	} else if ((st.st_size + len) >
+		   ((uint64_t) influxdb_conf.spool_size * 1024 * 1024)) {
+		error("%s: %s is full, dropping %zu bytes of profile data",
+		      __func__, path, len);
+	} else {
+		safe_write(fd, data, len);
+		log_flag(PROFILE, "%s %s: %zu bytes spooled to %s",
+			 plugin_type, __func__, len, path);
+	}
+
+rwfail:
+	close(fd);
+	xfree(path);
+}
+
+/*
+ * Move the spool into the sending file, locked only for as long as it takes
+ * to copy it so that _spool_data() never waits on the network.
+ * RET bytes now in the sending file, read into buf
+ */
+static size_t _spool_take(int send_fd, char **buf)
+{
+	char *path = NULL;
+	struct stat st;
+	size_t len = 0;
+	int fd;
+
+	xstrfmtcat(path, "%s/%s", influxdb_conf.spool_dir, SPOOL_FILE);
+	fd = open(path, O_RDWR | O_CLOEXEC);
+	xfree(path);
+	if (fd < 0)
+		return 0;
+
+	if (flock(fd, LOCK_EX) || fstat(fd, &st) || !st.st_size)
+		goto end;
+
+	*buf = xmalloc(st.st_size + 1);
+	safe_read(fd, *buf, st.st_size);
+	safe_write(send_fd, *buf, st.st_size);
+	if (ftruncate(fd, 0))
+		error("%s: truncating spool: %m", __func__);
+	len = st.st_size;
+	goto end;
+
+rwfail:
+	error("%s: moving spool: %m", __func__);
+	/* The spool is left as it was */
+	if (ftruncate(send_fd, 0))
+		error("%s: truncating sending file: %m", __func__);
+	xfree(*buf);
+end:
+	close(fd);
+	return len;
+}
+
+/*
+ * Send the spooled data once influxdb is reachable again. What the last
+ * flush couldn't send is left in the sending file and goes first.
+ */
+static void _spool_flush(void)
+{
+	char *path = NULL, *buf = NULL;
+	struct stat st;
+	size_t len, sent = 0;
+	int fd;
+
+	if (!influxdb_conf.spool_dir)
+		return;
+
+	xstrfmtcat(path, "%s/%s.sending", influxdb_conf.spool_dir, SPOOL_FILE);
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	xfree(path);
+	if (fd < 0)
+		return;
+
+	/* Another step is already sending it */
+	if (flock(fd, LOCK_EX | LOCK_NB) || fstat(fd, &st))
+		goto end;
+
+	if ((len = st.st_size)) {
+		buf = xmalloc(len + 1);
+		safe_read(fd, buf, len);
+	} else if (!(len = _spool_take(fd, &buf))) {
+		goto end;
+	}
+
+	/* Send in pieces that end on a line */
+	while (sent < len) {
+		size_t piece = MIN(len - sent, SPOOL_SEND_SIZE);
+		size_t i = piece;
+
+		if ((sent + piece) < len) {
+			while (i && (buf[sent + i - 1] != '\n'))
+				i--;
+			if (i)
+				piece = i;
+		}
+		if (_post_data(buf + sent, piece) != SLURM_SUCCESS)
+			break;
+		sent += piece;
+	}
+
+	if (sent) {
+		log_flag(PROFILE, "%s %s: sent %zu of %zu spooled bytes",
+			 plugin_type, __func__, sent, len);
+		/* Keep what is left for the next flush */
+		if (ftruncate(fd, 0) || (lseek(fd, 0, SEEK_SET) < 0))
+			error("%s: truncating spool: %m", __func__);
+		else if (sent < len)
+			safe_write(fd, buf + sent, (len - sent));
+	}
+
+rwfail:
+end:
+	xfree(buf);
+	close(fd);
+}
+
 /* Try to send data to influxdb */
 static int _send_data(const char *data)
 {
 	int rc = SLURM_SUCCESS;
-	long response_code = 0;
-	char *url = NULL, *response_str = NULL;
 	size_t length;
 	time_t now = time(NULL);
 	bool send_now = false;
@@ -178,7 +424,8 @@ static int _send_data(const char *data)
 	 * try to open the connection and send this buffer, instead of opening
 	 * one per sample.
 	 */
-	if ((!send_now) && ((datastrlen + strlen(data)) <= BUF_SIZE)) {
+	if ((!send_now) &&
+	    ((datastrlen + strlen(data)) <= influxdb_conf.buffer_size)) {
 		xstrcat(datastr, data);
 		length = strlen(data);
 		datastrlen += length;
@@ -187,39 +434,13 @@ static int _send_data(const char *data)
 		return rc;
 	}
 
-	xstrfmtcat(url, "%s/write?db=%s&rp=%s&precision=s", influxdb_conf.host,
-		   influxdb_conf.database, influxdb_conf.rt_policy);
-	rc = slurm_curl_request(datastr, url, influxdb_conf.username,
-				influxdb_conf.password, NULL, NULL, NULL, false,
-				influxdb_conf.timeout, &response_str,
-				&response_code, HTTP_REQUEST_POST, true, false);
-	xfree(url);
-
-	/* In general, status codes of the form 2xx indicate success,
-	 * 4xx indicate that InfluxDB could not understand the request, and
-	 * 5xx indicate that the system is overloaded or significantly impaired.
-	 * Errors are returned in JSON.
-	 * https://docs.influxdata.com/influxdb/v0.13/concepts/api/
-	 */
-	if (rc != SLURM_SUCCESS) {
-		error("send data failed");
-	} else if ((response_code >= 200) && (response_code <= 205)) {
-		debug2("%s %s: data write success", plugin_type, __func__);
-	} else {
-		rc = SLURM_ERROR;
-		debug2("%s %s: data write failed, response code: %ld",
-		       plugin_type, __func__, response_code);
-		if (slurm_conf.debug_flags & DEBUG_FLAG_PROFILE) {
-			/* Strip any trailing newlines. */
-			while (response_str[strlen(response_str) - 1] == '\n')
-				response_str[strlen(response_str) - 1] = '\0';
-			info("%s %s: JSON response body: %s", plugin_type,
-			     __func__, response_str);
-		}
+	if (datastrlen) {
+		if ((rc = _post_data(datastr, datastrlen)) != SLURM_SUCCESS)
+			_spool_data(datastr, datastrlen);
+		else
+			_spool_flush();
 	}
 
-	xfree(response_str);
-
 	datastr[0] = '\0';
 	if (data)
 		xstrcat(datastr, data);
@@ -257,6 +478,7 @@ extern void fini(void)
 	xfree(influxdb_conf.database);
 	xfree(influxdb_conf.password);
 	xfree(influxdb_conf.rt_policy);
+	xfree(influxdb_conf.spool_dir);
 	xfree(influxdb_conf.username);
 }
 
@@ -266,12 +488,16 @@ extern void acct_gather_profile_p_conf_options(s_p_options_t **full_options,
 	debug3("%s %s called", plugin_type, __func__);
 
 	s_p_options_t options[] = {
+		{"ProfileInfluxDBBufferSize", S_P_UINT32},
+		{"ProfileInfluxDBCompress", S_P_BOOLEAN},
 		{"ProfileInfluxDBDatabase", S_P_STRING},
 		{"ProfileInfluxDBDefault", S_P_STRING},
 		{"ProfileInfluxDBFrequency", S_P_UINT32},
 		{"ProfileInfluxDBHost", S_P_STRING},
 		{"ProfileInfluxDBPass", S_P_STRING},
 		{"ProfileInfluxDBRTPolicy", S_P_STRING},
+		{"ProfileInfluxDBSpoolDir", S_P_STRING},
+		{"ProfileInfluxDBSpoolSize", S_P_UINT32},
 		{"ProfileInfluxDBTimeout", S_P_UINT32},
 		{"ProfileInfluxDBUser", S_P_STRING},
 		{NULL} };
@@ -287,7 +513,13 @@ extern void acct_gather_profile_p_conf_set(s_p_hashtbl_t *tbl)
 	debug3("%s %s called", plugin_type, __func__);
 
 	influxdb_conf.def = ACCT_GATHER_PROFILE_ALL;
+	influxdb_conf.buffer_size = BUF_SIZE;
+	influxdb_conf.spool_size = DEFAULT_INFLUXDB_SPOOL_SIZE;
 	if (tbl) {
+		s_p_get_uint32(&influxdb_conf.buffer_size,
+			       "ProfileInfluxDBBufferSize", tbl);
+		s_p_get_boolean(&influxdb_conf.compress,
+				"ProfileInfluxDBCompress", tbl);
 		if (s_p_get_string(&tmp, "ProfileInfluxDBDefault", tbl)) {
 			influxdb_conf.def =
 				acct_gather_profile_from_string(tmp);
@@ -306,6 +538,10 @@ extern void acct_gather_profile_p_conf_set(s_p_hashtbl_t *tbl)
 			       "ProfileInfluxDBPass", tbl);
 		s_p_get_string(&influxdb_conf.rt_policy,
 			       "ProfileInfluxDBRTPolicy", tbl);
+		s_p_get_string(&influxdb_conf.spool_dir,
+			       "ProfileInfluxDBSpoolDir", tbl);
+		s_p_get_uint32(&influxdb_conf.spool_size,
+			       "ProfileInfluxDBSpoolSize", tbl);
 		if (!s_p_get_uint32(&influxdb_conf.timeout,
 				    "ProfileInfluxDBTimeout", tbl))
 			influxdb_conf.timeout = DEFAULT_INFLUXDB_TIMEOUT;
@@ -329,6 +565,14 @@ extern void acct_gather_profile_p_conf_set(s_p_hashtbl_t *tbl)
 		fatal("No ProfileInfluxDBRTPolicy in your acct_gather.conf file. This is required to use the %s plugin",
 		      plugin_type);
 
+#if !HAVE_ZLIB
+	if (influxdb_conf.compress) {
+		info("%s: zlib not available, ProfileInfluxDBCompress ignored",
+		     plugin_type);
+		influxdb_conf.compress = false;
+	}
+#endif
+
 	debug("%s loaded", plugin_name);
 }
 
@@ -516,6 +760,12 @@ extern int acct_gather_profile_p_add_sample_data(int table_id, void *data,
 
 extern void acct_gather_profile_p_conf_values(list_t **data)
 {
+	add_key_pair(*data, "ProfileInfluxDBBufferSize", "%u",
+		     influxdb_conf.buffer_size);
+
+	add_key_pair_bool(*data, "ProfileInfluxDBCompress",
+			  influxdb_conf.compress);
+
 	add_key_pair(*data, "ProfileInfluxDBDatabase", "%s",
 		     influxdb_conf.database);
 
@@ -533,6 +783,12 @@ extern void acct_gather_profile_p_conf_values(list_t **data)
 	add_key_pair(*data, "ProfileInfluxDBRTPolicy", "%s",
 		     influxdb_conf.rt_policy);
 
+	add_key_pair(*data, "ProfileInfluxDBSpoolDir", "%s",
+		     influxdb_conf.spool_dir);
+
+	add_key_pair(*data, "ProfileInfluxDBSpoolSize", "%u",
+		     influxdb_conf.spool_size);
+
 	add_key_pair(*data, "ProfileInfluxDBTimeout", "%u",
 		     influxdb_conf.timeout);
 
@@ -1594,6 +1594,8 @@ extern cgroup_acct_t *cgroup_p_task_get_acct_data(uint32_t taskid)
 	stats->total_pgmajfault = NO_VAL64;
 	stats->total_vmem = NO_VAL64;
 	stats->memory_peak = INFINITE64; /* As required in common_jag.c */
+	stats->io_read_bytes = NO_VAL64;
+	stats->io_write_bytes = NO_VAL64;
 
 	if (common_cgroup_get_param(task_cpuacct_cg, "cpuacct.stat", &cpu_time,
 				    &cpu_time_sz) == SLURM_SUCCESS) {
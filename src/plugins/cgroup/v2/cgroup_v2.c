@@ -2746,12 +2746,13 @@ extern int cgroup_p_task_addto(cgroup_ctl_type_t ctl, stepd_step_rec_t *step,
 extern cgroup_acct_t *cgroup_p_task_get_acct_data(uint32_t task_id)
 {
 	char *cpu_stat = NULL, *memory_stat = NULL, *memory_current = NULL;
-	char *memory_peak = NULL;
+	char *memory_peak = NULL, *io_stat = NULL;
 	char *ptr;
 	size_t tmp_sz = 0;
 	cgroup_acct_t *stats = NULL;
 	task_cg_info_t *task_cg_info;
 	static bool interfaces_checked = false, memory_peak_interface = false;
+	static bool io_stat_interface = true;
 
 	if (!(task_cg_info = list_find_first(task_list, _find_task_cg_info,
 					     &task_id))) {
@@ -2824,6 +2825,17 @@ extern cgroup_acct_t *cgroup_p_task_get_acct_data(uint32_t task_id)
 		}
 	}
 
+	/*
+	 * io.stat is only there when the io controller is enabled for the
+	 * task cgroups, stop trying after the first failure.
+	 */
+	if (io_stat_interface &&
+	    (common_cgroup_get_param(&task_cg_info->task_cg, "io.stat",
+				     &io_stat, &tmp_sz) != SLURM_SUCCESS)) {
+		log_flag(CGROUP, "Cannot read io.stat interface, is the io controller enabled?");
+		io_stat_interface = false;
+	}
+
 	/*
 	 * Initialize values. A NO_VAL64 will indicate the caller that something
 	 * happened here. Values that aren't set here are returned as 0.
@@ -2834,6 +2846,8 @@ extern cgroup_acct_t *cgroup_p_task_get_acct_data(uint32_t task_id)
 	stats->total_rss = NO_VAL64;
 	stats->total_pgmajfault = NO_VAL64;
 	stats->memory_peak = INFINITE64; /* As required in common_jag.c */
+	stats->io_read_bytes = NO_VAL64;
+	stats->io_write_bytes = NO_VAL64;
 
 	if (cpu_stat) {
 		ptr = xstrstr(cpu_stat, "user_usec");
@@ -2876,6 +2890,27 @@ extern cgroup_acct_t *cgroup_p_task_get_acct_data(uint32_t task_id)
 		xfree(memory_peak);
 	}
 
+	/* io.stat has one "MAJ:MIN rbytes=N wbytes=N ..." line per device */
+	if (io_stat) {
+		uint64_t bytes;
+
+		stats->io_read_bytes = 0;
+		stats->io_write_bytes = 0;
+		ptr = io_stat;
+		while ((ptr = xstrstr(ptr, "rbytes="))) {
+			if (sscanf(ptr, "rbytes=%"PRIu64, &bytes) == 1)
+				stats->io_read_bytes += bytes;
+			ptr++;
+		}
+		ptr = io_stat;
+		while ((ptr = xstrstr(ptr, "wbytes="))) {
+			if (sscanf(ptr, "wbytes=%"PRIu64, &bytes) == 1)
+				stats->io_write_bytes += bytes;
+			ptr++;
+		}
+		xfree(io_stat);
+	}
+
 	return stats;
 }
 
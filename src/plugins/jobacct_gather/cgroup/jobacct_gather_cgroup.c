@@ -58,6 +58,7 @@ const char plugin_type[] = "jobacct_gather/cgroup";
 const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 
 static bool is_first_task = true;
+static bool no_proc_scan = false;
 
 static void _prec_extra(jag_prec_t *prec, uint32_t taskid)
 {
@@ -127,10 +128,54 @@ static void _prec_extra(jag_prec_t *prec, uint32_t taskid)
 			cgroup_acct_data->memory_peak;
 	}
 
+	/*
+	 * Without /proc/<pid>/io the disk usage comes from io.stat, which
+	 * counts the bytes that reached block devices instead of the bytes
+	 * passed to read()/write().
+	 */
+	if (no_proc_scan && (cgroup_acct_data->io_read_bytes != NO_VAL64)) {
+		prec->tres_data[TRES_ARRAY_FS_DISK].size_read =
+			cgroup_acct_data->io_read_bytes;
+		prec->tres_data[TRES_ARRAY_FS_DISK].size_write =
+			cgroup_acct_data->io_write_bytes;
+	}
+
 	xfree(cgroup_acct_data);
 	return;
 }
 
+/*
+ * JobAcctGatherParams=NoProcScan: keep one record per task pid instead of
+ * reading /proc for every process of the step. All of the usage then comes
+ * from the task cgroup in _prec_extra(), which already covers the whole
+ * process tree of the task.
+ */
+static list_t *_get_precs(list_t *task_list, uint64_t cont_id,
+			  jag_callbacks_t *callbacks)
+{
+	list_itr_t *itr;
+	struct jobacctinfo *jobacct;
+
+	if (!task_list)
+		return NULL;
+
+	itr = list_iterator_create(task_list);
+	while ((jobacct = list_next(itr))) {
+		if (jobacct->pid)
+			(void) jag_common_get_prec(jobacct->pid,
+						   jobacct->tres_count);
+	}
+	list_iterator_destroy(itr);
+
+	return NULL;
+}
+
+static void _get_offspring_data(list_t *prec_list, jag_prec_t *ancestor,
+				pid_t pid, jag_prec_t *permanent_ancestor)
+{
+	/* The task cgroup already aggregates the offspring */
+}
+
 extern int init(void)
 {
 	if (running_in_slurmd() &&
@@ -143,6 +188,10 @@ extern int init(void)
 	if (running_in_slurmstepd()) {
 		jag_common_init(cgroup_g_get_acct_units());
 
+		if (xstrcasestr(slurm_conf.job_acct_gather_params,
+				"NoProcScan"))
+			no_proc_scan = true;
+
 		/* Initialize the controllers which we want accounting for. */
 		if (cgroup_g_initialize(CG_MEMORY) != SLURM_SUCCESS) {
 			return SLURM_ERROR;
@@ -199,6 +248,10 @@ extern void jobacct_gather_p_poll_data(list_t *task_list, uint64_t cont_id,
 		memset(&callbacks, 0, sizeof(jag_callbacks_t));
 		first = 0;
 		callbacks.prec_extra = _prec_extra;
+		if (no_proc_scan) {
+			callbacks.get_precs = _get_precs;
+			callbacks.get_offspring_data = _get_offspring_data;
+		}
 	}
 
 	jag_common_poll_data(task_list, cont_id, &callbacks, profile);
@@ -52,6 +52,7 @@
 #include "src/interfaces/acct_gather_energy.h"
 #include "src/interfaces/acct_gather_filesystem.h"
 #include "src/interfaces/acct_gather_interconnect.h"
+#include "src/common/timers.h"
 #include "src/common/xstring.h"
 #include "src/interfaces/proctrack.h"
 
@@ -638,6 +639,24 @@ bail_out:
 	return;
 }
 
+extern jag_prec_t *jag_common_get_prec(pid_t pid, int tres_count)
+{
+	jag_prec_t *prec;
+
+	if ((prec = list_find_first(prec_list, _find_prec, &pid)))
+		return prec;
+
+	prec = xmalloc(sizeof(*prec));
+	prec->pid = pid;
+	prec->tres_count = tres_count;
+	prec->tres_data = xcalloc(prec->tres_count,
+				  sizeof(acct_gather_data_t));
+	(void)_init_tres(prec, NULL);
+	list_append(prec_list, prec);
+
+	return prec;
+}
+
 static int _mark_as_completed(void *x, void *empty)
 {
 	jag_prec_t *prec = (jag_prec_t *) x;
@@ -1056,6 +1075,7 @@ extern void jag_common_poll_data(list_t *task_list, uint64_t cont_id,
 	int energy_counted = 0;
 	time_t ct;
 	int i = 0;
+	DEF_TIMERS;
 
 	xassert(callbacks);
 
@@ -1078,8 +1098,12 @@ extern void jag_common_poll_data(list_t *task_list, uint64_t cont_id,
 
 	ct = time(NULL);
 
+	START_TIMER;
 	(void)list_for_each(prec_list, (ListForF)_init_tres, NULL);
 	(*(callbacks->get_precs))(task_list, cont_id, callbacks);
+	END_TIMER;
+	log_flag(JAG, "gathered %d process records in %s",
+		 list_count(prec_list), TIME_STR);
 
 	if (!list_count(prec_list) || !task_list || !list_count(task_list))
 		goto finished;	/* We have no business being here! */
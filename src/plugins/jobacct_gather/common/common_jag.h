@@ -67,6 +67,13 @@ extern void jag_common_init(long in_hertz);
 extern void jag_common_fini(void);
 extern void destroy_jag_prec(void *object);
 
+/*
+ * Return the process record of pid from the records kept between polls,
+ * adding an empty one if there is none yet. For get_precs callbacks that
+ * don't read /proc.
+ */
+extern jag_prec_t *jag_common_get_prec(pid_t pid, int tres_count);
+
 extern void jag_common_poll_data(list_t *task_list, uint64_t cont_id,
 				 jag_callbacks_t *callbacks, bool profile);
 
@@ -42,6 +42,7 @@
 
 #include "src/common/list.h"
 #include "src/common/log.h"
+#include "src/common/slurm_protocol_defs.h"
 #include "src/common/xassert.h"
 #include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
@@ -629,6 +630,28 @@ extern metric_set_t *metrics_p_parse_ua_metrics(users_accts_stats_t *stats)
 	return set;
 }
 
+static void _rpc_latency_to_metric(metric_set_t *set, rpc_latency_stats_t *r)
+{
+	uint64_t (*l)[RPC_LATENCY_PCTL_CNT] = r->latency;
+	char *rpc = (char *) rpc_num2string(r->msg_type);
+
+	// clang-format off
+	ADD_METRIC_KEYVAL(set, UINT32, r->cnt, rpc_cnt, "Number of RPCs processed", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_TOTAL][RPC_LATENCY_P50], rpc_latency_p50, "Median RPC latency in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_TOTAL][RPC_LATENCY_P99], rpc_latency_p99, "99th percentile RPC latency in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_TOTAL][RPC_LATENCY_P999], rpc_latency_p999, "99.9th percentile RPC latency in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_QUEUE][RPC_LATENCY_P50], rpc_queue_wait_p50, "Median RPC queue wait in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_QUEUE][RPC_LATENCY_P99], rpc_queue_wait_p99, "99th percentile RPC queue wait in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_QUEUE][RPC_LATENCY_P999], rpc_queue_wait_p999, "99.9th percentile RPC queue wait in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_LOCK][RPC_LATENCY_P50], rpc_lock_wait_p50, "Median RPC lock wait in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_LOCK][RPC_LATENCY_P99], rpc_lock_wait_p99, "99th percentile RPC lock wait in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_LOCK][RPC_LATENCY_P999], rpc_lock_wait_p999, "99.9th percentile RPC lock wait in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_EXEC][RPC_LATENCY_P50], rpc_exec_p50, "Median RPC handler execution time in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_EXEC][RPC_LATENCY_P99], rpc_exec_p99, "99th percentile RPC handler execution time in usec", GAUGE, "rpc", rpc);
+	ADD_METRIC_KEYVAL(set, UINT64, l[RPC_LATENCY_EXEC][RPC_LATENCY_P999], rpc_exec_p999, "99.9th percentile RPC handler execution time in usec", GAUGE, "rpc", rpc);
+	// clang-format on
+}
+
 extern metric_set_t *metrics_p_parse_sched_metrics(scheduling_stats_t *s)
 {
 	metric_set_t *set = _metrics_new_set();
@@ -694,5 +717,8 @@ extern metric_set_t *metrics_p_parse_sched_metrics(scheduling_stats_t *s)
 	ADD_METRIC(set, TIMESTAMP, s->time, sched_stats_timestamp, "Statistics snapshot timestamp", GAUGE);
 	// clang-format on
 
+	for (int i = 0; i < s->rpc_latency_cnt; i++)
+		_rpc_latency_to_metric(set, &s->rpc_latency[i]);
+
 	return set;
 }
@@ -0,0 +1,442 @@
+/*****************************************************************************\
+ *  archive.c - read columnar job archive files for sacct
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include "src/common/pack.h"
+#include "src/common/slurmdb_archive.h"
+#include "src/common/slurmdbd_defs.h"
+#include "src/common/uid.h"
+#include "src/common/xstring.h"
+#include "archive.h"
+
+/* Columns of a columnar job archive used by sacct */
+typedef enum {
+	ARCH_ACCOUNT,
+	ARCH_ADMIN_COMMENT,
+	ARCH_ALLOC_NODES,
+	ARCH_ARRAY_JOB,
+	ARCH_ARRAY_MAX,
+	ARCH_ARRAY_TASK,
+	ARCH_ARRAY_TASK_STR,
+	ARCH_ASSOC,
+	ARCH_CONSTRAINTS,
+	ARCH_CONTAINER,
+	ARCH_DB_INX,
+	ARCH_DERIVED_EC,
+	ARCH_DERIVED_ES,
+	ARCH_ELIGIBLE,
+	ARCH_END,
+	ARCH_EXIT_CODE,
+	ARCH_EXTRA,
+	ARCH_FLAGS,
+	ARCH_GID,
+	ARCH_HET_JOB_ID,
+	ARCH_HET_JOB_OFFSET,
+	ARCH_JOB,
+	ARCH_KILL_REQUID,
+	ARCH_LICENSES,
+	ARCH_MCS_LABEL,
+	ARCH_NAME,
+	ARCH_NODELIST,
+	ARCH_PARTITION,
+	ARCH_PRIORITY,
+	ARCH_QOS,
+	ARCH_QOS_REQ,
+	ARCH_REQ_CPUS,
+	ARCH_REQ_MEM,
+	ARCH_RESTART_CNT,
+	ARCH_RESV,
+	ARCH_RESV_REQ,
+	ARCH_SEGMENT_SIZE,
+	ARCH_START,
+	ARCH_STATE,
+	ARCH_STATE_REASON,
+	ARCH_STDERR,
+	ARCH_STDIN,
+	ARCH_STDOUT,
+	ARCH_SUBMIT,
+	ARCH_SUBMIT_LINE,
+	ARCH_SUSPENDED,
+	ARCH_SYSTEM_COMMENT,
+	ARCH_TIMELIMIT,
+	ARCH_TRES_ALLOC,
+	ARCH_TRES_REQ,
+	ARCH_UID,
+	ARCH_WCKEY,
+	ARCH_WCKEYID,
+	ARCH_WORK_DIR,
+	ARCH_COUNT
+} arch_col_t;
+
+static const char *arch_col_names[] = {
+	[ARCH_ACCOUNT] = "account",
+	[ARCH_ADMIN_COMMENT] = "admin_comment",
+	[ARCH_ALLOC_NODES] = "nodes_alloc",
+	[ARCH_ARRAY_JOB] = "id_array_job",
+	[ARCH_ARRAY_MAX] = "array_max_tasks",
+	[ARCH_ARRAY_TASK] = "id_array_task",
+	[ARCH_ARRAY_TASK_STR] = "array_task_str",
+	[ARCH_ASSOC] = "id_assoc",
+	[ARCH_CONSTRAINTS] = "constraints",
+	[ARCH_CONTAINER] = "container",
+	[ARCH_DB_INX] = "job_db_inx",
+	[ARCH_DERIVED_EC] = "derived_ec",
+	[ARCH_DERIVED_ES] = "derived_es",
+	[ARCH_ELIGIBLE] = "time_eligible",
+	[ARCH_END] = "time_end",
+	[ARCH_EXIT_CODE] = "exit_code",
+	[ARCH_EXTRA] = "extra",
+	[ARCH_FLAGS] = "flags",
+	[ARCH_GID] = "id_group",
+	[ARCH_HET_JOB_ID] = "het_job_id",
+	[ARCH_HET_JOB_OFFSET] = "het_job_offset",
+	[ARCH_JOB] = "id_job",
+	[ARCH_KILL_REQUID] = "kill_requid",
+	[ARCH_LICENSES] = "licenses",
+	[ARCH_MCS_LABEL] = "mcs_label",
+	[ARCH_NAME] = "job_name",
+	[ARCH_NODELIST] = "nodelist",
+	[ARCH_PARTITION] = "partition",
+	[ARCH_PRIORITY] = "priority",
+	[ARCH_QOS] = "id_qos",
+	[ARCH_QOS_REQ] = "qos_req",
+	[ARCH_REQ_CPUS] = "cpus_req",
+	[ARCH_REQ_MEM] = "mem_req",
+	[ARCH_RESTART_CNT] = "restart_cnt",
+	[ARCH_RESV] = "id_resv",
+	[ARCH_RESV_REQ] = "resv_req",
+	[ARCH_SEGMENT_SIZE] = "segment_size",
+	[ARCH_START] = "time_start",
+	[ARCH_STATE] = "state",
+	[ARCH_STATE_REASON] = "state_reason_prev",
+	[ARCH_STDERR] = "std_err",
+	[ARCH_STDIN] = "std_in",
+	[ARCH_STDOUT] = "std_out",
+	[ARCH_SUBMIT] = "time_submit",
+	[ARCH_SUBMIT_LINE] = "submit_line",
+	[ARCH_SUSPENDED] = "time_suspended",
+	[ARCH_SYSTEM_COMMENT] = "system_comment",
+	[ARCH_TIMELIMIT] = "timelimit",
+	[ARCH_TRES_ALLOC] = "tres_alloc",
+	[ARCH_TRES_REQ] = "tres_req",
+	[ARCH_UID] = "id_user",
+	[ARCH_WCKEY] = "wckey",
+	[ARCH_WCKEYID] = "id_wckey",
+	[ARCH_WORK_DIR] = "work_dir",
+};
+
+typedef struct {
+	char **cells;		/* one row, indexed by arch_col_t */
+	slurmdb_job_cond_t *job_cond;
+} arch_filter_t;
+
+static uint64_t _arch_num(char **cells, arch_col_t col)
+{
+	return cells[col] ? strtoull(cells[col], NULL, 10) : 0;
+}
+
+static bool _arch_in_list(list_t *char_list, char *value)
+{
+	if (!char_list || !list_count(char_list))
+		return true;
+	if (!value)
+		return false;
+	return list_find_first(char_list, slurm_find_char_exact_in_list,
+			       value);
+}
+
+/* Skip blocks outside of the time window or without any requested user */
+static bool _arch_want_block(slurmdb_archive_block_t *block, void *arg)
+{
+	arch_filter_t *filter = arg;
+	slurmdb_job_cond_t *job_cond = filter->job_cond;
+	list_itr_t *itr;
+	char *uid;
+	bool found = false;
+
+	if (job_cond->usage_end && (block->start_min > job_cond->usage_end))
+		return false;
+	if (job_cond->usage_start && (block->end_max < job_cond->usage_start))
+		return false;
+
+	if (!job_cond->userid_list || !list_count(job_cond->userid_list))
+		return true;
+
+	itr = list_iterator_create(job_cond->userid_list);
+	while (!found && (uid = list_next(itr)))
+		found = slurmdb_archive_block_has_uid(block,
+						      strtoul(uid, NULL, 10));
+	list_iterator_destroy(itr);
+
+	return found;
+}
+
+static bool _arch_want_row(arch_filter_t *filter)
+{
+	slurmdb_job_cond_t *job_cond = filter->job_cond;
+	char **cells = filter->cells;
+	time_t end = _arch_num(cells, ARCH_END);
+	char state[16];
+
+	if (job_cond->usage_end &&
+	    (_arch_num(cells, ARCH_SUBMIT) > job_cond->usage_end))
+		return false;
+	if (job_cond->usage_start && end && (end < job_cond->usage_start))
+		return false;
+
+	snprintf(state, sizeof(state), "%u",
+		 (uint32_t) (_arch_num(cells, ARCH_STATE) & JOB_STATE_BASE));
+
+	if (!_arch_in_list(job_cond->userid_list, cells[ARCH_UID]) ||
+	    !_arch_in_list(job_cond->groupid_list, cells[ARCH_GID]) ||
+	    !_arch_in_list(job_cond->acct_list, cells[ARCH_ACCOUNT]) ||
+	    !_arch_in_list(job_cond->partition_list, cells[ARCH_PARTITION]) ||
+	    !_arch_in_list(job_cond->jobname_list, cells[ARCH_NAME]) ||
+	    !_arch_in_list(job_cond->state_list, state))
+		return false;
+
+	if (job_cond->step_list && list_count(job_cond->step_list)) {
+		slurm_selected_step_t *selected_step;
+		list_itr_t *itr = list_iterator_create(job_cond->step_list);
+		uint32_t job_id = _arch_num(cells, ARCH_JOB);
+		uint32_t array_job_id = _arch_num(cells, ARCH_ARRAY_JOB);
+		uint32_t het_job_id = _arch_num(cells, ARCH_HET_JOB_ID);
+		bool found = false;
+
+		while (!found && (selected_step = list_next(itr)))
+			found = ((selected_step->step_id.job_id == job_id) ||
+				 (selected_step->step_id.job_id ==
+				  array_job_id) ||
+				 (selected_step->step_id.job_id ==
+				  het_job_id));
+		list_iterator_destroy(itr);
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+static slurmdb_job_rec_t *_arch_job_rec(char **cells, char *cluster_name)
+{
+	slurmdb_job_rec_t *job = slurmdb_create_job_rec();
+	time_t now = time(NULL);
+
+	job->account = xstrdup(cells[ARCH_ACCOUNT]);
+	job->admin_comment = xstrdup(cells[ARCH_ADMIN_COMMENT]);
+	job->alloc_nodes = _arch_num(cells, ARCH_ALLOC_NODES);
+	job->array_job_id = _arch_num(cells, ARCH_ARRAY_JOB);
+	job->array_max_tasks = _arch_num(cells, ARCH_ARRAY_MAX);
+	job->array_task_id = _arch_num(cells, ARCH_ARRAY_TASK);
+	if (!job->array_job_id && !job->array_task_id)
+		job->array_task_id = NO_VAL;
+	if (cells[ARCH_ARRAY_TASK_STR] && cells[ARCH_ARRAY_TASK_STR][0])
+		job->array_task_str = xstrdup(cells[ARCH_ARRAY_TASK_STR]);
+	job->associd = _arch_num(cells, ARCH_ASSOC);
+	job->cluster = xstrdup(cluster_name);
+	job->constraints = xstrdup(cells[ARCH_CONSTRAINTS]);
+	job->container = xstrdup(cells[ARCH_CONTAINER]);
+	job->db_index = _arch_num(cells, ARCH_DB_INX);
+	job->derived_ec = _arch_num(cells, ARCH_DERIVED_EC);
+	job->derived_es = xstrdup(cells[ARCH_DERIVED_ES]);
+	job->eligible = _arch_num(cells, ARCH_ELIGIBLE);
+	job->end = _arch_num(cells, ARCH_END);
+	job->exitcode = _arch_num(cells, ARCH_EXIT_CODE);
+	job->extra = xstrdup(cells[ARCH_EXTRA]);
+	job->flags = _arch_num(cells, ARCH_FLAGS);
+	job->gid = _arch_num(cells, ARCH_GID);
+	job->het_job_id = _arch_num(cells, ARCH_HET_JOB_ID);
+	job->het_job_offset = _arch_num(cells, ARCH_HET_JOB_OFFSET);
+	if (!job->het_job_id && !job->het_job_offset)
+		job->het_job_offset = NO_VAL;
+	job->jobid = _arch_num(cells, ARCH_JOB);
+	job->jobname = xstrdup(cells[ARCH_NAME]);
+	job->licenses = xstrdup(cells[ARCH_LICENSES]);
+	job->mcs_label = xstrdup(cells[ARCH_MCS_LABEL] ?
+				 cells[ARCH_MCS_LABEL] : "");
+	if (cells[ARCH_NODELIST] && xstrcmp(cells[ARCH_NODELIST], "(null)"))
+		job->nodes = xstrdup(cells[ARCH_NODELIST]);
+	else
+		job->nodes = xstrdup("(unknown)");
+	job->partition = xstrdup(cells[ARCH_PARTITION]);
+	job->priority = _arch_num(cells, ARCH_PRIORITY);
+	job->qosid = _arch_num(cells, ARCH_QOS);
+	job->qos_req = xstrdup(cells[ARCH_QOS_REQ]);
+	job->req_cpus = _arch_num(cells, ARCH_REQ_CPUS);
+	job->req_mem = _arch_num(cells, ARCH_REQ_MEM);
+	job->requid = cells[ARCH_KILL_REQUID] ?
+		_arch_num(cells, ARCH_KILL_REQUID) : INFINITE;
+	job->restart_cnt = _arch_num(cells, ARCH_RESTART_CNT);
+	job->resvid = _arch_num(cells, ARCH_RESV);
+	if (cells[ARCH_RESV_REQ] && cells[ARCH_RESV_REQ][0])
+		job->resv_req = xstrdup(cells[ARCH_RESV_REQ]);
+	job->segment_size = _arch_num(cells, ARCH_SEGMENT_SIZE);
+	job->start = _arch_num(cells, ARCH_START);
+	job->state = _arch_num(cells, ARCH_STATE);
+	job->state_reason_prev = _arch_num(cells, ARCH_STATE_REASON);
+	job->std_err = xstrdup(cells[ARCH_STDERR]);
+	job->std_in = xstrdup(cells[ARCH_STDIN]);
+	job->std_out = xstrdup(cells[ARCH_STDOUT]);
+	job->submit = _arch_num(cells, ARCH_SUBMIT);
+	job->submit_line = xstrdup(cells[ARCH_SUBMIT_LINE]);
+	job->suspended = _arch_num(cells, ARCH_SUSPENDED);
+	job->system_comment = xstrdup(cells[ARCH_SYSTEM_COMMENT]);
+	job->timelimit = _arch_num(cells, ARCH_TIMELIMIT);
+	job->tres_alloc_str = xstrdup(cells[ARCH_TRES_ALLOC]);
+	job->tres_req_str = xstrdup(cells[ARCH_TRES_REQ]);
+	job->uid = _arch_num(cells, ARCH_UID);
+	job->user = uid_to_string_or_null(job->uid);
+	job->wckey = xstrdup(cells[ARCH_WCKEY] ? cells[ARCH_WCKEY] : "");
+	job->wckeyid = _arch_num(cells, ARCH_WCKEYID);
+	job->work_dir = xstrdup(cells[ARCH_WORK_DIR]);
+
+	if (job->end && (job->start > job->end))
+		job->start = job->end;
+	if (!job->start)
+		job->elapsed = 0;
+	else if (!job->end)
+		job->elapsed = now - job->start;
+	else
+		job->elapsed = job->end - job->start;
+	job->elapsed -= job->suspended;
+	if ((int) job->elapsed < 0)
+		job->elapsed = 0;
+
+	/* Steps are archived separately and not read back here */
+	job->show_full = 1;
+	job->steps = list_create(slurmdb_destroy_step_rec);
+
+	return job;
+}
+
+/* Read the jobs from one columnar job archive file into job_list */
+static int _get_archive_file_jobs(char *file, slurmdb_job_cond_t *job_cond,
+				  list_t *job_list)
+{
+	buf_t *buffer;
+	uint16_t ver, type;
+	time_t buf_time;
+	char *cluster_name = NULL, **col_names = NULL;
+	uint32_t rec_cnt, col_cnt = 0;
+	int col_map[ARCH_COUNT];
+	char *cells[ARCH_COUNT];
+	slurmdb_archive_block_t *block = NULL;
+	arch_filter_t filter = {
+		.cells = cells,
+		.job_cond = job_cond,
+	};
+	int rc = SLURM_ERROR;
+
+	if (!(buffer = create_mmap_buf(file))) {
+		error("Can't read archive file %s: %m", file);
+		return SLURM_ERROR;
+	}
+
+	safe_unpack16(&ver, buffer);
+	if (ver > SLURM_PROTOCOL_VERSION) {
+		error("Archive file %s has an incompatible version %u",
+		      file, ver);
+		goto cleanup;
+	}
+	safe_unpack_time(&buf_time, buffer);
+	safe_unpack16(&type, buffer);
+	safe_unpackstr(&cluster_name, buffer);
+	safe_unpack32(&rec_cnt, buffer);
+
+	if ((type != DBD_GOT_JOBS) || (rec_cnt != SLURMDB_ARCHIVE_COLUMNAR)) {
+		error("%s is not a columnar job archive, see Parameters=archive_columnar in slurmdbd.conf",
+		      file);
+		goto cleanup;
+	}
+
+	if (slurmdb_archive_unpack_header(buffer, &rec_cnt, &col_names,
+					  &col_cnt))
+		goto cleanup;
+	debug("%s: %u jobs of cluster %s", file, rec_cnt, cluster_name);
+
+	for (int i = 0; i < ARCH_COUNT; i++)
+		col_map[i] = slurmdb_archive_col_inx(col_names, col_cnt,
+						     arch_col_names[i]);
+
+	while (!(rc = slurmdb_archive_unpack_block(buffer, col_cnt, &block,
+						   _arch_want_block,
+						   &filter)) && block) {
+		for (uint32_t r = 0; r < block->rows; r++) {
+			for (int i = 0; i < ARCH_COUNT; i++)
+				cells[i] = (col_map[i] < 0) ?
+					NULL : block->cols[col_map[i]][r];
+			if (_arch_want_row(&filter))
+				list_append(job_list,
+					    _arch_job_rec(cells,
+							  cluster_name));
+		}
+		slurmdb_archive_free_block(block);
+		block = NULL;
+	}
+
+cleanup:
+	for (uint32_t i = 0; i < col_cnt; i++)
+		xfree(col_names[i]);
+	xfree(col_names);
+	xfree(cluster_name);
+	FREE_NULL_BUFFER(buffer);
+	return rc;
+
+unpack_error:
+	error("Invalid archive file %s", file);
+	rc = SLURM_ERROR;
+	goto cleanup;
+}
+
+extern list_t *archive_get_jobs(list_t *files, slurmdb_job_cond_t *job_cond)
+{
+	list_t *job_list = list_create(slurmdb_destroy_job_rec);
+	list_itr_t *itr = list_iterator_create(files);
+	char *file;
+
+	while ((file = list_next(itr))) {
+		if (_get_archive_file_jobs(file, job_cond, job_list)) {
+			FREE_NULL_LIST(job_list);
+			break;
+		}
+	}
+	list_iterator_destroy(itr);
+
+	return job_list;
+}
@@ -48,6 +48,7 @@
 #include "src/interfaces/data_parser.h"
 #include "src/interfaces/serializer.h"
 #include "sacct.h"
+#include "archive.h"
 #include <time.h>
 
 /* getopt_long options, integers but not characters */
@@ -67,6 +68,8 @@
 #define OPT_LONG_HELPSTATE 0x113
 #define OPT_LONG_HELPREASON 0x114
 #define OPT_LONG_EXPAND_PATTERNS 0x115
+#define OPT_LONG_STREAM    0x116
+#define OPT_LONG_ARCHIVE   0x117
 
 #define JOB_HASH_SIZE 1000
 
@@ -366,39 +369,15 @@ static void _remove_duplicate_fed_jobs(list_t *jobs)
 	xfree(hash_job);
 }
 
-extern int get_data(void)
+static void _aggregate_steps(list_t *job_list)
 {
 	slurmdb_job_rec_t *job = NULL;
 	slurmdb_step_rec_t *step = NULL;
 	list_itr_t *itr = NULL;
 	list_itr_t *itr_step = NULL;
-	slurmdb_job_cond_t *job_cond = params.job_cond;
 	int cnt;
 
-	if (params.opt_completion) {
-		jobs = slurmdb_jobcomp_jobs_get(job_cond);
-		return SLURM_SUCCESS;
-	} else {
-		jobs = slurmdb_jobs_get(acct_db_conn, job_cond);
-	}
-
-	if (!jobs)
-		return SLURM_ERROR;
-
-	/*
-	 * Remove duplicate federated jobs. The db will remove duplicates for
-	 * one cluster but not when jobs for multiple clusters are requested.
-	 * Remove the current job if there were jobs with the same id submitted
-	 * in the future.
-	 * Else sort the jobs to order the jobs so the last task of arrays don't
-	 * appear to run before any of the other tasks.
-	 */
-	if (params.cluster_name && !(job_cond->flags & JOBCOND_FLAG_DUP))
-		_remove_duplicate_fed_jobs(jobs);
-	else
-		list_sort(jobs, _sort_desc_submit_time);
-
-	itr = list_iterator_create(jobs);
+	itr = list_iterator_create(job_list);
 	while ((job = list_next(itr))) {
 
 		if (!job->steps || !(cnt = list_count(job->steps)))
@@ -424,6 +403,55 @@ extern int get_data(void)
 		list_iterator_destroy(itr_step);
 	}
 	list_iterator_destroy(itr);
+}
+
+/* Print each part of the jobs as it comes in for --stream */
+static int _print_jobs_part(list_t *job_list, void *arg)
+{
+	_aggregate_steps(job_list);
+
+	jobs = job_list;
+	do_list(0, NULL);
+	jobs = NULL;
+
+	return SLURM_SUCCESS;
+}
+
+extern int get_data(void)
+{
+	slurmdb_job_cond_t *job_cond = params.job_cond;
+
+	if (params.opt_completion) {
+		jobs = slurmdb_jobcomp_jobs_get(job_cond);
+		return SLURM_SUCCESS;
+	} else if (params.opt_stream) {
+		if (slurmdb_jobs_get_stream(acct_db_conn, job_cond,
+					    _print_jobs_part, NULL))
+			return SLURM_ERROR;
+		return SLURM_SUCCESS;
+	} else if (params.opt_archive) {
+		jobs = archive_get_jobs(params.opt_archive, job_cond);
+	} else {
+		jobs = slurmdb_jobs_get(acct_db_conn, job_cond);
+	}
+
+	if (!jobs)
+		return SLURM_ERROR;
+
+	/*
+	 * Remove duplicate federated jobs. The db will remove duplicates for
+	 * one cluster but not when jobs for multiple clusters are requested.
+	 * Remove the current job if there were jobs with the same id submitted
+	 * in the future.
+	 * Else sort the jobs to order the jobs so the last task of arrays don't
+	 * appear to run before any of the other tasks.
+	 */
+	if (params.cluster_name && !(job_cond->flags & JOBCOND_FLAG_DUP))
+		_remove_duplicate_fed_jobs(jobs);
+	else
+		list_sort(jobs, _sort_desc_submit_time);
+
+	_aggregate_steps(jobs);
 
 	return SLURM_SUCCESS;
 }
@@ -452,6 +480,7 @@ extern void parse_command_line(int argc, char **argv)
                 {"allusers",       no_argument,       0,    'a'},
                 {"accounts",       required_argument, 0,    'A'},
                 {"allocations",    no_argument,       0,    'X'},
+                {"archive",        required_argument, 0,    OPT_LONG_ARCHIVE},
                 {"array",          no_argument,       0,    OPT_LONG_ARRAY},
                 {"brief",          no_argument,       0,    'b'},
 		{"batch-script",   no_argument,       0,    'B'},
@@ -496,6 +525,7 @@ extern void parse_command_line(int argc, char **argv)
                 {"reason",         required_argument, 0,    'R'},
                 {"state",          required_argument, 0,    's'},
                 {"starttime",      required_argument, 0,    'S'},
+                {"stream",         no_argument,       0,    OPT_LONG_STREAM},
                 {"truncate",       no_argument,       0,    'T'},
                 {"uid",            required_argument, 0,    'u'},
 		{"use-local-uid",  no_argument,       0,    OPT_LONG_LOCAL_UID},
@@ -540,6 +570,11 @@ extern void parse_command_line(int argc, char **argv)
 				job_cond->acct_list = list_create(xfree_ptr);
 			slurm_addto_char_list(job_cond->acct_list, optarg);
 			break;
+		case OPT_LONG_ARCHIVE:
+			if (!params.opt_archive)
+				params.opt_archive = list_create(xfree_ptr);
+			slurm_addto_char_list(params.opt_archive, optarg);
+			break;
 		case OPT_LONG_ARRAY:
 			params.opt_array = true;
 			break;
@@ -771,6 +806,9 @@ extern void parse_command_line(int argc, char **argv)
 		case OPT_LONG_LOCAL_UID:
 			params.use_local_uid = true;
 			break;
+		case OPT_LONG_STREAM:
+			params.opt_stream = true;
+			break;
 		case 'v':
 			/* Handle -vvv thusly...
 			 */
@@ -851,6 +889,12 @@ extern void parse_command_line(int argc, char **argv)
 	    (job_cond->flags & JOBCOND_FLAG_ENV))
 		fatal("Options --batch-script and --env-vars are mutually exclusive");
 
+	if (params.opt_stream && (params.mimetype || params.opt_completion))
+		fatal("Option --stream can't be used with --json, --yaml or --completion");
+
+	if (params.opt_archive && (params.opt_stream || params.opt_completion))
+		fatal("Option --archive can't be used with --stream or --completion");
+
 
 	if (long_output && params.opt_field_list)
 		fatal("Options -o(--format) and -l(--long) are mutually exclusive. Please remove one and retry.");
@@ -1352,6 +1396,7 @@ extern void sacct_fini(void)
 	if (print_fields_itr)
 		list_iterator_destroy(print_fields_itr);
 	FREE_NULL_LIST(print_fields_list);
+	FREE_NULL_LIST(params.opt_archive);
 	FREE_NULL_LIST(jobs);
 	FREE_NULL_LIST(g_qos_list);
 	FREE_NULL_LIST(g_tres_list);
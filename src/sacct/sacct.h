@@ -210,6 +210,7 @@ typedef struct {
 	char *cluster_name;	/* Set if in federated cluster */
 	uint32_t convert_flags;	/* --noconvert */
 	slurmdb_job_cond_t *job_cond;
+	list_t *opt_archive;	/* --archive= */
 	bool opt_array;		/* --array */
 	int opt_completion;	/* --completion */
 	bool expand_patterns;	/* substitute stdin/err/out patterns */
@@ -218,6 +219,7 @@ typedef struct {
 	gid_t opt_gid;		/* running persons gid */
 	bool opt_local;		/* --local */
 	int opt_noheader;	/* can only be cleared */
+	bool opt_stream;	/* --stream */
 	uid_t opt_uid;		/* running persons uid */
 	int units;		/* --units*/
 	bool use_local_uid;	/* --use-local-uid */
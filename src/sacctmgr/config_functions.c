@@ -301,6 +301,33 @@ extern int sacctmgr_list_stats(int argc, char **argv)
 		list_iterator_destroy(itr);
 	}
 
+	if (stats_rec->mult_msg_cnt) {
+		uint64_t rec_rate = 0;
+
+		if (stats_rec->mult_msg_time)
+			rec_rate = (stats_rec->mult_msg_recs * USEC_IN_SEC) /
+				   stats_rec->mult_msg_time;
+
+		printf("\nBatched records (DBD_SEND_MULT_MSG)\n");
+		printf("\tBatches:      %u\n", stats_rec->mult_msg_cnt);
+		printf("\tRecords:      %"PRIu64"\n", stats_rec->mult_msg_recs);
+		printf("\tMax batch:    %u\n", stats_rec->mult_msg_max);
+		printf("\tMean batch:   %"PRIu64"\n",
+		       stats_rec->mult_msg_recs / stats_rec->mult_msg_cnt);
+		printf("\tTotal time:   %"PRIu64"\n", stats_rec->mult_msg_time);
+		printf("\tRecords/sec:  %"PRIu64"\n", rec_rate);
+	}
+
+	if (stats_rec->usage_cache_hits || stats_rec->usage_cache_misses) {
+		printf("\nUsage cache\n");
+		printf("\tHits:         %"PRIu64"\n",
+		       stats_rec->usage_cache_hits);
+		printf("\tMisses:       %"PRIu64"\n",
+		       stats_rec->usage_cache_misses);
+		printf("\tCached rows:  %"PRIu64"\n",
+		       stats_rec->usage_cache_rows);
+	}
+
 	if (argc) {
 		if (!xstrncasecmp(argv[0], "ave_time", 2))
 			sort_by_ave_time = true;
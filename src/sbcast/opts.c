@@ -61,6 +61,9 @@
 #define OPT_LONG_SEND_LIBS 0x103
 #define OPT_LONG_AUTOCOMP  0x104
 #define OPT_LONG_TREE_WIDTH 0x105
+#define OPT_LONG_WINDOW    0x106
+#define OPT_LONG_SWARM     0x107
+#define OPT_LONG_BENCHMARK 0x108
 
 
 /* getopt_long options, integers but not characters */
@@ -188,6 +191,7 @@ extern void parse_command_line(int argc, char **argv)
 	int option_index;
 	static struct option long_options[] = {
 		{"autocomplete", required_argument, 0, OPT_LONG_AUTOCOMP},
+		{"benchmark", no_argument,       0, OPT_LONG_BENCHMARK},
 		{"compress",  optional_argument, 0, 'C'},
 		{"exclude",   required_argument, 0, OPT_LONG_EXCLUDE},
 		{"fanout",    required_argument, 0, 'F'},
@@ -199,9 +203,11 @@ extern void parse_command_line(int argc, char **argv)
 		{"send-libs", optional_argument, 0, OPT_LONG_SEND_LIBS},
 		{"preserve",  no_argument,       0, 'p'},
 		{"size",      required_argument, 0, 's'},
+		{"swarm",     no_argument,       0, OPT_LONG_SWARM},
 		{"timeout",   required_argument, 0, 't'},
 		{"verbose",   no_argument,       0, 'v'},
 		{"version",   no_argument,       0, 'V'},
+		{"window",    required_argument, 0, OPT_LONG_WINDOW},
 		{"help",      no_argument,       0, OPT_LONG_HELP},
 		{"usage",     no_argument,       0, OPT_LONG_USAGE},
 		{NULL,        0,                 0, 0}
@@ -210,14 +216,22 @@ extern void parse_command_line(int argc, char **argv)
 	if ((tmp = conf_get_opt_str(slurm_conf.bcast_parameters,
 				    "Compression="))) {
 		params.compress = parse_compress_type(tmp);
+		params.compress_level = parse_compress_level(tmp);
+		xfree(tmp);
+	}
+
+	if ((tmp = conf_get_opt_str(slurm_conf.bcast_parameters, "Window="))) {
+		params.window = atoi(tmp);
 		xfree(tmp);
 	}
 
 	if (slurm_conf.bcast_exclude)
 		params.exclude = xstrdup(slurm_conf.bcast_exclude);
 
-	if ((env_val = getenv("SBCAST_COMPRESS")))
+	if ((env_val = getenv("SBCAST_COMPRESS"))) {
 		params.compress = parse_compress_type(env_val);
+		params.compress_level = parse_compress_level(env_val);
+	}
 	if ((env_val = getenv("SBCAST_EXCLUDE"))) {
 		xfree(params.exclude);
 		params.exclude = xstrdup(env_val);
@@ -255,6 +269,10 @@ extern void parse_command_line(int argc, char **argv)
 		params.block_size = 8 * 1024 * 1024;
 	if ( ( env_val = getenv("SBCAST_TIMEOUT") ) )
 		params.timeout = (atoi(env_val) * 1000);
+	if (getenv("SBCAST_SWARM"))
+		params.flags |= BCAST_FLAG_SWARM;
+	if ((env_val = getenv("SBCAST_WINDOW")))
+		params.window = atoi(env_val);
 
 	optind = 0;
 	while ((opt_char = getopt_long(argc, argv, "C::fF:j:ps:t:vVw:Z",
@@ -267,6 +285,7 @@ extern void parse_command_line(int argc, char **argv)
 			break;
 		case (int)'C':
 			params.compress = parse_compress_type(optarg);
+			params.compress_level = parse_compress_level(optarg);
 			break;
 		case (int) OPT_LONG_EXCLUDE:
 			xfree(params.exclude);
@@ -311,6 +330,15 @@ extern void parse_command_line(int argc, char **argv)
 		case (int) 'V':
 			print_slurm_version();
 			exit(0);
+		case OPT_LONG_BENCHMARK:
+			params.flags |= BCAST_FLAG_BENCHMARK;
+			break;
+		case OPT_LONG_SWARM:
+			params.flags |= BCAST_FLAG_SWARM;
+			break;
+		case OPT_LONG_WINDOW:
+			params.window = atoi(optarg);
+			break;
 		case (int) 'w':
 			xfree(params.node_list);
 			params.node_list = xstrdup(optarg);
@@ -415,6 +443,7 @@ static void _print_options( void )
 	info("-----------------------------");
 	info("block_size = %u", params.block_size);
 	info("compress   = %u", params.compress);
+	info("compress_level = %d", params.compress_level);
 	info("exclude    = %s", params.exclude);
 	info("force      = %s",
 	     (params.flags & BCAST_FLAG_FORCE) ? "true" : "false");
@@ -423,8 +452,11 @@ static void _print_options( void )
 	     (params.flags & BCAST_FLAG_PRESERVE) ? "true" : "false");
 	info("send_libs  = %s",
 	     (params.flags & BCAST_FLAG_SEND_LIBS) ? "true" : "false");
+	info("swarm      = %s",
+	     (params.flags & BCAST_FLAG_SWARM) ? "true" : "false");
 	info("timeout    = %d", params.timeout);
 	info("verbose    = %d", params.verbose);
+	info("window     = %u", params.window);
 	info("source     = %s", params.src_fname);
 	info("dest       = %s", params.dst_fname);
 	info("-----------------------------");
@@ -440,6 +472,7 @@ static void _help( void )
 {
 	printf ("\
 Usage: sbcast [OPTIONS] SOURCE DEST\n\
+  --benchmark           report the throughput of the transfer\n\
   -C, --compress[=lib]  compress the file being transmitted\n\
   --exclude=<path_list> shared object paths to be excluded\n\
   -f, --force           replace destination file as required\n\
@@ -448,9 +481,11 @@ Usage: sbcast [OPTIONS] SOURCE DEST\n\
   -p, --preserve        preserve modes and times of source file\n\
   --send-libs[=yes|no]  autodetect and broadcast executable's shared objects\n\
   -s, --size=num        block size in bytes (rounded off)\n\
+  --swarm               send each block to one node which relays it\n\
   -t, --timeout=secs    specify message timeout (seconds)\n\
   -v, --verbose         provide detailed event logging\n\
   -V, --version         print version information and exit\n\
+  --window=num          number of blocks to send at once\n\
 \nHelp options:\n\
   --help                show this help message\n\
   --usage               display brief usage message\n");
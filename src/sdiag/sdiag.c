@@ -71,6 +71,7 @@ typedef struct {
 	uint64_t dropped;
 	uint16_t cycle_last;
 	uint16_t cycle_max;
+	uint64_t *latency;
 } rpc_stat_t;
 
 static rpc_stat_t *types = NULL, *users = NULL;
@@ -254,6 +255,56 @@ static int _print_stats(void)
 	if (!buf->rpc_type_size)
 		printf("\tNo RPCs recorded yet.\n");
 
+	if (buf->rpc_type_latency) {
+		printf("\nRemote Procedure Call latency by message type (p50/p99/p999 usec)\n");
+		for (i = 0; i < buf->rpc_type_size; i++) {
+			uint64_t *l = types[i].latency;
+
+			printf("\t%-40s(%5u) total:%"PRIu64"/%"PRIu64"/%"PRIu64" queue:%"PRIu64"/%"PRIu64"/%"PRIu64" lock:%"PRIu64"/%"PRIu64"/%"PRIu64" exec:%"PRIu64"/%"PRIu64"/%"PRIu64"\n",
+			       rpc_num2string(types[i].id), types[i].id,
+			       l[0], l[1], l[2], l[3], l[4], l[5],
+			       l[6], l[7], l[8], l[9], l[10], l[11]);
+		}
+	}
+
+	if (buf->rpc_slow_count) {
+		printf("\nSlowest Remote Procedure Calls (usec)\n");
+		for (i = 0; i < buf->rpc_slow_count; i++) {
+			uint64_t *l = &buf->rpc_slow_latency[
+				i * RPC_LATENCY_PHASE_CNT];
+			char *user = uid_to_string(buf->rpc_slow_uid[i]);
+
+			printf("\t%s %-40s user:%-16s total:%-8"PRIu64" queue:%-8"PRIu64" lock:%-8"PRIu64" exec:%-8"PRIu64" lock_holder:%s\n",
+			       slurm_ctime2(&buf->rpc_slow_time[i]),
+			       rpc_num2string(buf->rpc_slow_type[i]), user,
+			       l[RPC_LATENCY_TOTAL], l[RPC_LATENCY_QUEUE],
+			       l[RPC_LATENCY_LOCK], l[RPC_LATENCY_EXEC],
+			       (buf->rpc_slow_lock_holder[i] &&
+				buf->rpc_slow_lock_holder[i][0] ?
+				buf->rpc_slow_lock_holder[i] : "none"));
+			xfree(user);
+		}
+	}
+
+	if (buf->rpc_lane_count) {
+		printf("\nRemote Procedure Call lanes\n");
+		for (i = 0; i < buf->rpc_lane_count; i++) {
+			uint64_t ave_wait = 0;
+
+			if (buf->rpc_lane_waited[i])
+				ave_wait = buf->rpc_lane_wait_usec[i] /
+					   buf->rpc_lane_waited[i];
+			printf("\t%-8s active:%u/%u waiting:%u/%u admitted:%"PRIu64" waited:%"PRIu64" shed:%"PRIu64" ave_wait:%"PRIu64" max_wait:%"PRIu64"\n",
+			       buf->rpc_lane_name[i], buf->rpc_lane_active[i],
+			       buf->rpc_lane_max_active[i],
+			       buf->rpc_lane_waiting[i],
+			       buf->rpc_lane_max_waiting[i],
+			       buf->rpc_lane_admitted[i],
+			       buf->rpc_lane_waited[i], buf->rpc_lane_shed[i],
+			       ave_wait, buf->rpc_lane_wait_max_usec[i]);
+		}
+	}
+
 	printf("\nRemote Procedure Call statistics by user\n");
 	for (i = 0; i < buf->rpc_user_size; i++) {
 		char *user = uid_to_string(users[i].id);
@@ -360,6 +411,10 @@ static void _sort_rpc(void)
 			types[i].cycle_last = buf->rpc_type_cycle_last[i];
 			types[i].cycle_max = buf->rpc_type_cycle_max[i];
 		}
+		if (buf->rpc_type_latency)
+			types[i].latency = &buf->rpc_type_latency[
+				i * RPC_LATENCY_PHASE_CNT *
+				RPC_LATENCY_PCTL_CNT];
 	}
 
 	users = xcalloc(buf->rpc_user_size, sizeof(rpc_stat_t));
@@ -1919,6 +1919,50 @@ static void _open_ports(void)
 	slurm_mutex_unlock(&listeners.mutex);
 }
 
+/*
+ * Process msg directly and release its lane
+ * IN this_rpc - resolve RPC type
+ * IN msg - message to process (takes ownership)
+ * IN lane - lane from rpc_lane_enter()
+ */
+static void _process_connection(slurmctld_rpc_t *this_rpc, slurm_msg_t *msg,
+				int lane)
+{
+	slurmctld_req(msg, this_rpc);
+	rpc_lane_exit(lane);
+
+	if (!this_rpc->keep_msg) {
+		xassert(!msg->pcon);
+
+		if (msg->conmgr_con)
+			log_flag(NET, "%s: [%s] destroyed connection for incoming RPC msg_type[0x%x]=%s rc=%s",
+				__func__,
+				conmgr_con_get_name(msg->conmgr_con),
+				(uint32_t) msg->msg_type,
+				rpc_num2string(msg->msg_type),
+				slurm_strerror(SLURM_SUCCESS));
+		else if (msg->conn)
+			log_flag(NET, "%s: [fd:%d] destroyed connection for incoming RPC msg_type[0x%x]=%s rc=%s",
+				__func__,
+				conn_g_get_fd(msg->conn),
+				(uint32_t) msg->msg_type,
+				rpc_num2string(msg->msg_type),
+				slurm_strerror(SLURM_SUCCESS));
+
+		FREE_NULL_CONN(msg->conn);
+		FREE_NULL_MSG(msg);
+	}
+}
+
+/* Process msg once rpc_lane_exit() hands its lane a free slot */
+static void _process_parked(slurmctld_rpc_t *this_rpc, slurm_msg_t *msg,
+			    int lane)
+{
+	server_thread_incr();
+	_process_connection(this_rpc, msg, lane);
+	server_thread_decr();
+}
+
 /*
  * Service connection msg
  * IN this_rpc - resolve RPC type
@@ -1926,7 +1970,7 @@ static void _open_ports(void)
  */
 static int _service_connection(slurmctld_rpc_t *this_rpc, slurm_msg_t *msg)
 {
-	int rc = EINVAL;
+	int rc = EINVAL, lane = 0;
 
 	xassert(this_rpc);
 	xassert(msg);
@@ -1945,32 +1989,17 @@ static int _service_connection(slurmctld_rpc_t *this_rpc, slurm_msg_t *msg)
 		rc = slurm_send_rc_msg(msg, rc);
 		FREE_NULL_CONN(msg->conn);
 		FREE_NULL_MSG(msg);
+	} else if ((rc = rpc_lane_enter(this_rpc, msg, _process_parked,
+					&lane)) == EINPROGRESS) {
+		/* parked until its lane has a free slot */
+		rc = SLURM_SUCCESS;
+	} else if (rc) {
+		rc = slurm_send_rc_msg(msg, rc);
+		FREE_NULL_CONN(msg->conn);
+		FREE_NULL_MSG(msg);
 	} else {
 		/* directly process the request */
-		slurmctld_req(msg, this_rpc);
-		rc = SLURM_SUCCESS;
-
-		if (!this_rpc->keep_msg) {
-			xassert(!msg->pcon);
-
-			if (msg->conmgr_con)
-				log_flag(NET, "%s: [%s] destroyed connection for incoming RPC msg_type[0x%x]=%s rc=%s",
-					__func__,
-					conmgr_con_get_name(msg->conmgr_con),
-					(uint32_t) msg->msg_type,
-					rpc_num2string(msg->msg_type),
-					slurm_strerror(rc));
-			else if (msg->conn)
-				log_flag(NET, "%s: [fd:%d] destroyed connection for incoming RPC msg_type[0x%x]=%s rc=%s",
-					__func__,
-					conn_g_get_fd(msg->conn),
-					(uint32_t) msg->msg_type,
-					rpc_num2string(msg->msg_type),
-					slurm_strerror(rc));
-
-			FREE_NULL_CONN(msg->conn);
-			FREE_NULL_MSG(msg);
-		}
+		_process_connection(this_rpc, msg, lane);
 	}
 
 	server_thread_decr();
@@ -42,6 +42,8 @@
 #include <string.h>
 #include <sys/types.h>
 
+#include "src/common/timers.h"
+
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
@@ -53,6 +55,16 @@ static pthread_rwlock_t slurmctld_locks[5] = {
 	PTHREAD_RWLOCK_INITIALIZER,
 };
 
+/*
+ * RPC type of the thread holding each lock for write, NO_VAL when no writer.
+ * Read by threads blocked on the lock without holding it, so only accessed
+ * atomically.
+ */
+static uint32_t lock_writer[5] = { NO_VAL, NO_VAL, NO_VAL, NO_VAL, NO_VAL };
+
+static __thread uint16_t thread_rpc = 0;
+static __thread lock_wait_t thread_wait;
+
 #ifndef NDEBUG
 /*
  * Used to protect against double-locking within a single thread. Calling
@@ -106,35 +118,63 @@ extern bool verify_lock(lock_datatype_t datatype, lock_level_t level)
 }
 #endif
 
+static void _lock(lock_datatype_t datatype, lock_level_t level)
+{
+	struct timeval tv = { 0, 0 };
+
+	if (level == NO_LOCK)
+		return;
+
+	if (level == READ_LOCK) {
+		if (!slurm_rwlock_tryrdlock(&slurmctld_locks[datatype]))
+			return;
+	} else if (!slurm_rwlock_trywrlock(&slurmctld_locks[datatype])) {
+		__atomic_store_n(&lock_writer[datatype], thread_rpc,
+				 __ATOMIC_RELEASE);
+		return;
+	}
+
+	/* Contended, record who is in the way and how long we wait */
+	if (!thread_wait.contended) {
+		thread_wait.contended = true;
+		thread_wait.lock = datatype;
+		thread_wait.holder = __atomic_load_n(&lock_writer[datatype],
+						     __ATOMIC_ACQUIRE);
+	}
+	(void) slurm_delta_tv(&tv);
+
+	if (level == READ_LOCK) {
+		slurm_rwlock_rdlock(&slurmctld_locks[datatype]);
+	} else {
+		slurm_rwlock_wrlock(&slurmctld_locks[datatype]);
+		__atomic_store_n(&lock_writer[datatype], thread_rpc,
+				 __ATOMIC_RELEASE);
+	}
+
+	thread_wait.wait_usec += slurm_delta_tv(&tv);
+}
+
+static void _unlock(lock_datatype_t datatype, lock_level_t level)
+{
+	if (level == NO_LOCK)
+		return;
+
+	if (level == WRITE_LOCK)
+		__atomic_store_n(&lock_writer[datatype], NO_VAL,
+				 __ATOMIC_RELEASE);
+	slurm_rwlock_unlock(&slurmctld_locks[datatype]);
+}
+
 /* lock_slurmctld - Issue the required lock requests in a well defined order */
 extern void lock_slurmctld(slurmctld_lock_t lock_levels)
 {
 	xassert(_store_locks(lock_levels));
 
-	if (lock_levels.conf == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[CONF_LOCK]);
-	else if (lock_levels.conf == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[CONF_LOCK]);
-
-	if (lock_levels.job == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[JOB_LOCK]);
-	else if (lock_levels.job == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[JOB_LOCK]);
-
-	if (lock_levels.node == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[NODE_LOCK]);
-	else if (lock_levels.node == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[NODE_LOCK]);
-
-	if (lock_levels.part == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[PART_LOCK]);
-	else if (lock_levels.part == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[PART_LOCK]);
-
-	if (lock_levels.fed == READ_LOCK)
-		slurm_rwlock_rdlock(&slurmctld_locks[FED_LOCK]);
-	else if (lock_levels.fed == WRITE_LOCK)
-		slurm_rwlock_wrlock(&slurmctld_locks[FED_LOCK]);
+	_lock(CONF_LOCK, lock_levels.conf);
+	_lock(JOB_LOCK, lock_levels.job);
+	_lock(NODE_LOCK, lock_levels.node);
+	_lock(PART_LOCK, lock_levels.part);
+	_lock(FED_LOCK, lock_levels.fed);
 }
 
 /* unlock_slurmctld - Issue the required unlock requests in a well
@@ -143,20 +183,25 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 {
 	xassert(_clear_locks(lock_levels));
 
-	if (lock_levels.fed)
-		slurm_rwlock_unlock(&slurmctld_locks[FED_LOCK]);
+	_unlock(FED_LOCK, lock_levels.fed);
+	_unlock(PART_LOCK, lock_levels.part);
+	_unlock(NODE_LOCK, lock_levels.node);
+	_unlock(JOB_LOCK, lock_levels.job);
+	_unlock(CONF_LOCK, lock_levels.conf);
+}
 
-	if (lock_levels.part)
-		slurm_rwlock_unlock(&slurmctld_locks[PART_LOCK]);
+extern void lock_slurmctld_set_rpc(uint16_t msg_type)
+{
+	thread_rpc = msg_type;
+}
 
-	if (lock_levels.node)
-		slurm_rwlock_unlock(&slurmctld_locks[NODE_LOCK]);
+extern lock_wait_t lock_slurmctld_wait_take(void)
+{
+	lock_wait_t wait = thread_wait;
 
-	if (lock_levels.job)
-		slurm_rwlock_unlock(&slurmctld_locks[JOB_LOCK]);
+	memset(&thread_wait, 0, sizeof(thread_wait));
 
-	if (lock_levels.conf)
-		slurm_rwlock_unlock(&slurmctld_locks[CONF_LOCK]);
+	return wait;
 }
 
 /*
@@ -92,6 +92,7 @@
 #define _SLURMCTLD_LOCKS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /* levels of locking required for each data structure */
 typedef enum {
@@ -121,6 +122,15 @@ typedef enum {
 extern bool verify_lock(lock_datatype_t datatype, lock_level_t level);
 #endif
 
+/* Time the calling thread spent blocked in lock_slurmctld() */
+typedef struct {
+	uint64_t wait_usec;
+	bool contended; /* lock and holder below are set */
+	lock_datatype_t lock; /* first lock found held by another thread */
+	uint32_t holder; /* RPC type of the thread holding lock for write,
+			  * 0 if not an RPC, NO_VAL if held only for read */
+} lock_wait_t;
+
 /* lock_slurmctld - Issue the required lock requests in a well defined order */
 extern void lock_slurmctld (slurmctld_lock_t lock_levels);
 
@@ -130,4 +140,16 @@ extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
 extern int report_locks_set(void);
 
+/*
+ * Set the RPC type being processed by the calling thread, reported as the
+ * holder to threads blocked on locks it holds for write. 0 when done.
+ */
+extern void lock_slurmctld_set_rpc(uint16_t msg_type);
+
+/*
+ * Return the lock wait accumulated by the calling thread since the last call
+ * and reset it.
+ */
+extern lock_wait_t lock_slurmctld_wait_take(void);
+
 #endif
@@ -132,6 +132,35 @@ static uint32_t rpc_user_id[RPC_USER_SIZE] = { 0 };
 static uint32_t rpc_user_cnt[RPC_USER_SIZE] = { 0 };
 static uint64_t rpc_user_time[RPC_USER_SIZE] = { 0 };
 
+/*
+ * Log-linear latency histograms in usec. Values below RPC_HIST_SUB_CNT get
+ * their own bucket, every following power of two range is split into
+ * RPC_HIST_SUB_CNT equal buckets, bounding the error of a reported
+ * percentile to 25%. The last bucket collects everything above ~19 hours.
+ */
+#define RPC_HIST_SUB_BITS 2
+#define RPC_HIST_SUB_CNT (1 << RPC_HIST_SUB_BITS)
+#define RPC_HIST_MAX_BITS 36
+#define RPC_HIST_BUCKETS \
+	((RPC_HIST_MAX_BITS - RPC_HIST_SUB_BITS + 1) * RPC_HIST_SUB_CNT)
+static uint32_t rpc_type_hist[RPC_TYPE_SIZE][RPC_LATENCY_PHASE_CNT]
+			     [RPC_HIST_BUCKETS];
+/* percentiles reported, in tenths of a percent */
+static const uint16_t rpc_hist_pctl[RPC_LATENCY_PCTL_CNT] = { 500, 990, 999 };
+
+/* Slowest RPCs seen since the last reset */
+#define RPC_SLOW_SIZE 10
+typedef struct {
+	time_t time;
+	uint16_t msg_type;
+	uint32_t uid;
+	uint64_t latency[RPC_LATENCY_PHASE_CNT];
+	char lock_holder[64];
+} rpc_slow_t;
+static rpc_slow_t rpc_slow[RPC_SLOW_SIZE];
+static int rpc_slow_cnt = 0;
+static uint64_t rpc_slow_min = 0;
+
 static bool do_post_rpc_node_registration = false;
 
 bool running_configless = false;
@@ -167,8 +196,141 @@ typedef struct {
 	slurm_msg_t *msg;
 } foreach_multi_msg_t;
 
-extern void record_rpc_stats(slurm_msg_t *msg, long delta)
+static int _rpc_hist_bucket(uint64_t usec)
 {
+	int msb, bucket;
+
+	if (usec < RPC_HIST_SUB_CNT)
+		return usec;
+
+	msb = 63 - __builtin_clzll(usec);
+	bucket = ((msb - RPC_HIST_SUB_BITS + 1) << RPC_HIST_SUB_BITS) +
+		 ((usec >> (msb - RPC_HIST_SUB_BITS)) & (RPC_HIST_SUB_CNT - 1));
+
+	return MIN(bucket, RPC_HIST_BUCKETS - 1);
+}
+
+/* Return the largest value that falls into bucket */
+static uint64_t _rpc_hist_value(int bucket)
+{
+	int msb, sub;
+
+	if (bucket < RPC_HIST_SUB_CNT)
+		return bucket;
+
+	msb = (bucket >> RPC_HIST_SUB_BITS) + RPC_HIST_SUB_BITS - 1;
+	sub = bucket & (RPC_HIST_SUB_CNT - 1);
+
+	return (((uint64_t) (RPC_HIST_SUB_CNT + sub + 1)) <<
+		(msb - RPC_HIST_SUB_BITS)) - 1;
+}
+
+/*
+ * Fill latency with the percentiles of RPC type index i.
+ * NOTE: rpc_mutex must be locked
+ */
+static void _rpc_hist_percentiles(int i, uint64_t *latency)
+{
+	for (int p = 0; p < RPC_LATENCY_PHASE_CNT; p++) {
+		uint32_t *hist = rpc_type_hist[i][p];
+		uint64_t seen = 0;
+		int b = 0;
+
+		for (int q = 0; q < RPC_LATENCY_PCTL_CNT; q++) {
+			uint64_t want = (((uint64_t) rpc_type_cnt[i] *
+					  rpc_hist_pctl[q]) + 999) / 1000;
+
+			while ((b < RPC_HIST_BUCKETS) &&
+			       ((seen + hist[b]) < want))
+				seen += hist[b++];
+
+			if (!rpc_type_cnt[i])
+				latency[q] = 0;
+			else
+				latency[q] = _rpc_hist_value(
+					MIN(b, RPC_HIST_BUCKETS - 1));
+		}
+		latency += RPC_LATENCY_PCTL_CNT;
+	}
+}
+
+/*
+ * Remember RPC among the slowest seen.
+ * NOTE: rpc_mutex must be locked
+ */
+static void _record_rpc_slow(slurm_msg_t *msg, uint64_t *latency,
+			     lock_wait_t *wait)
+{
+	static const char *lock_names[] = { "conf", "job", "node", "part",
+					    "fed" };
+	rpc_slow_t *slow;
+	int i;
+
+	if ((rpc_slow_cnt == RPC_SLOW_SIZE) &&
+	    (latency[RPC_LATENCY_TOTAL] <= rpc_slow_min))
+		return;
+
+	if (rpc_slow_cnt < RPC_SLOW_SIZE) {
+		slow = &rpc_slow[rpc_slow_cnt++];
+	} else {
+		slow = &rpc_slow[0];
+		for (i = 1; i < RPC_SLOW_SIZE; i++)
+			if (rpc_slow[i].latency[RPC_LATENCY_TOTAL] <
+			    slow->latency[RPC_LATENCY_TOTAL])
+				slow = &rpc_slow[i];
+	}
+
+	slow->time = time(NULL);
+	slow->msg_type = msg->msg_type;
+	slow->uid = msg->auth_uid;
+	memcpy(slow->latency, latency, sizeof(slow->latency));
+
+	if (!wait->contended)
+		slow->lock_holder[0] = '\0';
+	else if (wait->holder == NO_VAL)
+		snprintf(slow->lock_holder, sizeof(slow->lock_holder),
+			 "%s:readers", lock_names[wait->lock]);
+	else if (!wait->holder)
+		snprintf(slow->lock_holder, sizeof(slow->lock_holder),
+			 "%s:internal", lock_names[wait->lock]);
+	else
+		snprintf(slow->lock_holder, sizeof(slow->lock_holder), "%s:%s",
+			 lock_names[wait->lock], rpc_num2string(wait->holder));
+
+	if (rpc_slow_cnt < RPC_SLOW_SIZE)
+		return;
+
+	rpc_slow_min = rpc_slow[0].latency[RPC_LATENCY_TOTAL];
+	for (i = 1; i < RPC_SLOW_SIZE; i++)
+		rpc_slow_min = MIN(rpc_slow_min,
+				   rpc_slow[i].latency[RPC_LATENCY_TOTAL]);
+}
+
+extern void record_rpc_stats(slurm_msg_t *msg, long delta, long queue_usec)
+{
+	lock_wait_t wait = lock_slurmctld_wait_take();
+	uint64_t latency[RPC_LATENCY_PHASE_CNT];
+
+	latency[RPC_LATENCY_QUEUE] = MAX(queue_usec, 0);
+	if (msg->flags & CTLD_QUEUE_PROCESSING) {
+		/*
+		 * The rpc_queue worker acquires the locks before dequeuing,
+		 * so the wait is part of the time spent queued.
+		 */
+		latency[RPC_LATENCY_LOCK] = MIN(wait.wait_usec,
+						latency[RPC_LATENCY_QUEUE]);
+		latency[RPC_LATENCY_QUEUE] -= latency[RPC_LATENCY_LOCK];
+		latency[RPC_LATENCY_EXEC] = MAX(delta, 0);
+	} else {
+		latency[RPC_LATENCY_LOCK] = MIN(wait.wait_usec,
+						MAX(delta, 0));
+		latency[RPC_LATENCY_EXEC] = MAX(delta, 0) -
+					    latency[RPC_LATENCY_LOCK];
+	}
+	latency[RPC_LATENCY_TOTAL] = latency[RPC_LATENCY_QUEUE] +
+				     latency[RPC_LATENCY_LOCK] +
+				     latency[RPC_LATENCY_EXEC];
+
 	slurm_mutex_lock(&rpc_mutex);
 	for (int i = 0; i < RPC_TYPE_SIZE; i++) {
 		if (rpc_type_id[i] == 0)
@@ -177,6 +339,8 @@ extern void record_rpc_stats(slurm_msg_t *msg, long delta)
 			continue;
 		rpc_type_cnt[i]++;
 		rpc_type_time[i] += delta;
+		for (int p = 0; p < RPC_LATENCY_PHASE_CNT; p++)
+			rpc_type_hist[i][p][_rpc_hist_bucket(latency[p])]++;
 		break;
 	}
 	for (int i = 0; i < RPC_USER_SIZE; i++) {
@@ -188,6 +352,22 @@ extern void record_rpc_stats(slurm_msg_t *msg, long delta)
 		rpc_user_time[i] += delta;
 		break;
 	}
+	_record_rpc_slow(msg, latency, &wait);
+	slurm_mutex_unlock(&rpc_mutex);
+}
+
+extern void get_rpc_latency_stats(scheduling_stats_t *s)
+{
+	slurm_mutex_lock(&rpc_mutex);
+	while ((s->rpc_latency_cnt < RPC_TYPE_SIZE) &&
+	       rpc_type_id[s->rpc_latency_cnt])
+		s->rpc_latency_cnt++;
+	s->rpc_latency = xcalloc(s->rpc_latency_cnt, sizeof(*s->rpc_latency));
+	for (int i = 0; i < s->rpc_latency_cnt; i++) {
+		s->rpc_latency[i].msg_type = rpc_type_id[i];
+		s->rpc_latency[i].cnt = rpc_type_cnt[i];
+		_rpc_hist_percentiles(i, &s->rpc_latency[i].latency[0][0]);
+	}
 	slurm_mutex_unlock(&rpc_mutex);
 }
 
@@ -5566,7 +5746,13 @@ static void _clear_rpc_stats(void)
 	memset(rpc_user_cnt, 0, sizeof(rpc_user_cnt));
 	memset(rpc_user_id, 0, sizeof(rpc_user_id));
 	memset(rpc_user_time, 0, sizeof(rpc_user_time));
+	memset(rpc_type_hist, 0, sizeof(rpc_type_hist));
+	memset(rpc_slow, 0, sizeof(rpc_slow));
+	rpc_slow_cnt = 0;
+	rpc_slow_min = 0;
 	slurm_mutex_unlock(&rpc_mutex);
+
+	rpc_lane_reset_stats();
 }
 
 static void _pack_rpc_stats(buf_t *buffer, uint16_t protocol_version)
@@ -5601,6 +5787,46 @@ static void _pack_rpc_stats(buf_t *buffer, uint16_t protocol_version)
 		pack64_array(rpc_user_time, user_count, buffer);
 
 		agent_pack_pending_rpc_stats(buffer);
+
+		if (protocol_version >= SLURM_26_05_PROTOCOL_VERSION) {
+			uint32_t latency_cnt = rpc_count *
+					       RPC_LATENCY_PHASE_CNT *
+					       RPC_LATENCY_PCTL_CNT;
+			uint64_t *latency = xcalloc(latency_cnt,
+						    sizeof(*latency));
+			char *lock_holder[RPC_SLOW_SIZE];
+			uint16_t slow_type[RPC_SLOW_SIZE];
+			uint32_t slow_uid[RPC_SLOW_SIZE];
+			uint64_t slow_latency[RPC_SLOW_SIZE *
+					      RPC_LATENCY_PHASE_CNT];
+
+			for (int i = 0; i < rpc_count; i++)
+				_rpc_hist_percentiles(
+					i, (latency + (i *
+						       RPC_LATENCY_PHASE_CNT *
+						       RPC_LATENCY_PCTL_CNT)));
+			pack64_array(latency, latency_cnt, buffer);
+			xfree(latency);
+
+			pack32(rpc_slow_cnt, buffer);
+			for (int i = 0; i < rpc_slow_cnt; i++) {
+				pack_time(rpc_slow[i].time, buffer);
+				slow_type[i] = rpc_slow[i].msg_type;
+				slow_uid[i] = rpc_slow[i].uid;
+				memcpy(&slow_latency[i * RPC_LATENCY_PHASE_CNT],
+				       rpc_slow[i].latency,
+				       sizeof(rpc_slow[i].latency));
+				lock_holder[i] = rpc_slow[i].lock_holder;
+			}
+			pack16_array(slow_type, rpc_slow_cnt, buffer);
+			pack32_array(slow_uid, rpc_slow_cnt, buffer);
+			pack64_array(slow_latency,
+				     (rpc_slow_cnt * RPC_LATENCY_PHASE_CNT),
+				     buffer);
+			packstr_array(lock_holder, rpc_slow_cnt, buffer);
+
+			rpc_lane_pack_stats(buffer);
+		}
 	}
 
 	slurm_mutex_unlock(&rpc_mutex);
@@ -5904,9 +6130,12 @@ static int _process_persist_conn(void *arg, persist_msg_t *persist_msg,
 		if (msg.msg_type == ACCOUNTING_UPDATE_MSG) {
 			DEF_TIMERS;
 			START_TIMER;
+			(void) lock_slurmctld_wait_take();
+			lock_slurmctld_set_rpc(msg.msg_type);
 			_slurm_rpc_accounting_update_msg(&msg);
+			lock_slurmctld_set_rpc(0);
 			END_TIMER;
-			record_rpc_stats(&msg, DELTA_TIMER);
+			record_rpc_stats(&msg, DELTA_TIMER, 0);
 		} else {
 			slurm_send_rc_msg(&msg, EINVAL);
 		}
@@ -6513,6 +6742,12 @@ static void _slurm_rpc_dbd_relay(slurm_msg_t *msg)
 	slurm_send_rc_msg(msg, rc);
 }
 
+/*
+ * Rate limiting tokens taken by queries that walk and pack large parts of the
+ * controller state, where most other RPCs take one.
+ */
+#define RL_COST_QUERY 3
+
 slurmctld_rpc_t slurmctld_rpcs[] =
 {
 	{
@@ -6524,9 +6759,12 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_BUILD_INFO,
 		.func = _slurm_rpc_dump_conf,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_JOB_INFO,
 		.func = _slurm_rpc_dump_jobs,
+		.rl_cost = RL_COST_QUERY,
+		.lane = RPC_LANE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6537,9 +6775,12 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_JOB_STATE,
 		.func = _slurm_rpc_job_state,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_JOB_USER_INFO,
 		.func = _slurm_rpc_dump_jobs_user,
+		.rl_cost = RL_COST_QUERY,
+		.lane = RPC_LANE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6550,6 +6791,7 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_JOB_INFO_SINGLE,
 		.func = _slurm_rpc_dump_job_single,
+		.lane = RPC_LANE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6567,18 +6809,25 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_BATCH_SCRIPT,
 		.func = _slurm_rpc_dump_batch_script,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_SHARE_INFO,
 		.func = _slurm_rpc_get_shares,
+		.rl_cost = RL_COST_QUERY,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_PRIORITY_FACTORS,
 		.func = _slurm_rpc_get_priority_factors,
+		.rl_cost = RL_COST_QUERY,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_JOB_END_TIME,
 		.func = _slurm_rpc_end_time,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_FED_INFO,
 		.func = _slurm_rpc_get_fed,
+		.lane = RPC_LANE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.fed = READ_LOCK,
@@ -6586,6 +6835,8 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_NODE_INFO,
 		.func = _slurm_rpc_dump_nodes,
+		.rl_cost = RL_COST_QUERY,
+		.lane = RPC_LANE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6595,9 +6846,12 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_NODE_INFO_SINGLE,
 		.func = _slurm_rpc_dump_node_single,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_PARTITION_INFO,
 		.func = _slurm_rpc_dump_partitions,
+		.rl_cost = RL_COST_QUERY,
+		.lane = RPC_LANE_QUERY,
 		.queue_enabled = true,
 		.locks = {
 			.conf = READ_LOCK,
@@ -6648,6 +6902,8 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_JOB_STEP_INFO,
 		.func = _slurm_rpc_job_step_get_info,
+		.rl_cost = RL_COST_QUERY,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_RESOURCE_LAYOUT,
 		.func = _slurm_rpc_request_resource_layout,
@@ -6759,6 +7015,8 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_RESERVATION_INFO,
 		.func = _slurm_rpc_resv_show,
+		.rl_cost = RL_COST_QUERY,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_NODE_REGISTRATION_STATUS,
 		.func = _slurm_rpc_node_registration_status,
@@ -6780,6 +7038,7 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_BURST_BUFFER_INFO,
 		.func = _slurm_rpc_burst_buffer_info,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_STEP_BY_CONTAINER_ID,
 		.func = _slurm_rpc_step_by_container_id,
@@ -6808,6 +7067,7 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_TRIGGER_GET,
 		.func = _slurm_rpc_trigger_get,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_TRIGGER_CLEAR,
 		.func = _slurm_rpc_trigger_clear,
@@ -6850,15 +7110,18 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_TOPO_INFO,
 		.func = _slurm_rpc_get_topo,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_REBOOT_NODES,
 		.func = _slurm_rpc_reboot_nodes,
 	},{
 		.msg_type = REQUEST_STATS_INFO,
 		.func = _slurm_rpc_dump_stats,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_LICENSE_INFO,
 		.func = _slurm_rpc_dump_licenses,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_KILL_JOB,
 		.max_per_cycle = 256,
@@ -6884,6 +7147,8 @@ slurmctld_rpc_t slurmctld_rpcs[] =
 	},{
 		.msg_type = REQUEST_ASSOC_MGR_INFO,
 		.func = _slurm_rpc_assoc_mgr_info,
+		.rl_cost = RL_COST_QUERY,
+		.lane = RPC_LANE_QUERY,
 	},{
 		.msg_type = REQUEST_PERSIST_INIT,
 		.func = _slurm_rpc_persist_init,
@@ -6995,8 +7260,11 @@ extern void slurmctld_req(slurm_msg_t *msg, slurmctld_rpc_t *this_rpc)
 
 	/* Debug the protocol layer.
 	 */
-	if (!(msg->flags & CTLD_QUEUE_PROCESSING))
+	if (!(msg->flags & CTLD_QUEUE_PROCESSING)) {
 		START_TIMER;
+		/* discard lock waits of whatever this thread did before */
+		(void) lock_slurmctld_wait_take();
+	}
 
 	if (msg->conn) {
 		fd = conn_g_get_fd(msg->conn);
@@ -7041,11 +7309,15 @@ extern void slurmctld_req(slurm_msg_t *msg, slurmctld_rpc_t *this_rpc)
 	if (this_rpc->skip_stale && _is_connection_stale(msg, this_rpc, fd))
 		return;
 
-	(*(this_rpc->func))(msg);
+	if (msg->flags & CTLD_QUEUE_PROCESSING) {
+		(*(this_rpc->func))(msg);
+	} else {
+		lock_slurmctld_set_rpc(msg->msg_type);
+		(*(this_rpc->func))(msg);
+		lock_slurmctld_set_rpc(0);
 
-	if (!(msg->flags & CTLD_QUEUE_PROCESSING)) {
 		END_TIMER;
-		record_rpc_stats(msg, DELTA_TIMER);
+		record_rpc_stats(msg, DELTA_TIMER, 0);
 	}
 }
 
@@ -44,6 +44,16 @@
 #include "src/common/slurm_protocol_api.h"
 
 #include "src/slurmctld/locks.h"
+#include "src/slurmctld/statistics.h"
+
+/* Admission control lanes for RPCs processed directly, see rpc_lane_enter() */
+typedef enum {
+	RPC_LANE_JOB = 0, /* job control, the default */
+	RPC_LANE_DAEMON, /* SlurmUser and root, includes all node traffic */
+	RPC_LANE_ADMIN, /* operators and administrators */
+	RPC_LANE_QUERY, /* read-only queries */
+	RPC_LANE_CNT
+} rpc_lane_t;
 
 typedef struct {
 	uint16_t msg_type;
@@ -67,6 +77,8 @@ typedef struct {
 	bool shutdown;
 	bool keep_msg; /* skip freeing msg and closing connection */
 	bool rl_exempt; /* ignore this rpc for rate limiting */
+	uint16_t rl_cost; /* rate limiting tokens consumed, 0 means 1 */
+	rpc_lane_t lane; /* lane when not sent by a daemon or admin */
 
 	int yield_sleep; /* usec sleep between cycles when busy */
 	int interval; /* usec sleep after cycle if no longer busy */
@@ -106,8 +118,16 @@ extern void slurmctld_req(slurm_msg_t *msg, slurmctld_rpc_t *this_rpc);
 
 /*
  * Update slurmctld stats structure with time spent processing an rpc.
+ * IN msg - processed RPC
+ * IN delta - usec spent in the handler, including lock waits
+ * IN queue_usec - usec the RPC waited in its rpc_queue
+ */
+extern void record_rpc_stats(slurm_msg_t *msg, long delta, long queue_usec);
+
+/*
+ * Fill rpc_latency of s with the latency percentiles of every RPC type
  */
-extern void record_rpc_stats(slurm_msg_t *msg, long delta);
+extern void get_rpc_latency_stats(scheduling_stats_t *s);
 
 /*
  * Update slurmctld stats structure related to a particular rpc_queue
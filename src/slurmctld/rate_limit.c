@@ -46,26 +46,50 @@
 #include "src/slurmctld/slurmctld.h"
 
 /*
- * last_update is scaled by refill_period, and is not the direct unix time
+ * Number of consecutive slots searched for a user before giving up. Bounds
+ * the cost of a lookup when the table is crowded.
+ */
+#define RL_PROBE_MAX 16
+
+/* Attempts at taking over a slot another thread changed meanwhile */
+#define RL_CLAIM_MAX 4
+
+/*
+ * The table is never locked, every field is updated with compare-and-swap.
+ *
+ * key holds the uid owning the slot in the lower 32 bits and a generation in
+ * the upper 32 bits, bumped on every change of owner so that a slot taken
+ * over twice is not mistaken for the one that was looked at.
+ *
+ * The whole token bucket lives in state: the refill period of the last
+ * update (unix time divided by refill_period) in the upper 32 bits and the
+ * remaining tokens in the lower 32 bits. A state of 0 is a full bucket, as
+ * the refill since period 0 always tops it up. Only full buckets are taken
+ * over, so the state is left as is for the new owner.
  */
 typedef struct {
-	time_t last_update;
-	time_t last_logged;
-	uint32_t tokens;
-	uid_t uid;
+	uint64_t key; /* uid 0 for an unused slot, root is never limited */
+	uint32_t last_logged;
+	uint64_t state;
 } user_bucket_t;
 
+#define RL_KEY_UID(key) ((uint32_t) ((key) & 0xffffffff))
+#define RL_KEY_NEXT(key, uid) \
+	((((key) & 0xffffffff00000000ULL) + (1ULL << 32)) | (uint32_t) (uid))
+
 static uint32_t table_size = 8192;
 static user_bucket_t *user_buckets = NULL;
 
 static bool rate_limit_enabled = false;
-static pthread_mutex_t rate_limit_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* 30 tokens max, bucket refills 2 tokens per 1 second */
 static uint32_t bucket_size = 30;
 static int log_freq = 0;
 static uint32_t refill_rate = 2;
 static uint32_t refill_period = 1;
+/* periods an untouched bucket needs to be full again */
+static uint32_t refill_periods_full = 15;
+static time_t last_full_log = 0; /* updated with compare-and-swap */
 
 static uint32_t _set_positive_rl_param(char *key, char *value_str)
 {
@@ -131,8 +155,9 @@ extern void rate_limit_init(void)
 		xfree(tmp_ptr);
 	}
 
-	rate_limit_enabled = true;
+	refill_periods_full = ROUNDUP(bucket_size, refill_rate);
 	user_buckets = xcalloc(table_size, sizeof(user_bucket_t));
+	rate_limit_enabled = true;
 
 	info("RPC rate limiting enabled");
 	info("%s: rl_table_size=%u,rl_bucket_size=%u,rl_refill_rate=%u,rl_refill_period=%u",
@@ -141,10 +166,145 @@ extern void rate_limit_init(void)
 
 extern void rate_limit_shutdown(void)
 {
-	slurm_mutex_lock(&rate_limit_mutex);
+	/* Only called once conmgr has stopped, nothing can be checking */
 	rate_limit_enabled = false;
 	xfree(user_buckets);
-	slurm_mutex_unlock(&rate_limit_mutex);
+}
+
+/* Spread consecutive uids over the table (Fibonacci hashing) */
+static uint32_t _hash_uid(uid_t uid)
+{
+	return ((uint64_t) (((uint32_t) uid) * 2654435761U) * table_size) >>
+	       32;
+}
+
+/* Return true if the bucket would have refilled completely by now */
+static bool _bucket_full(user_bucket_t *bucket, uint32_t now_periods)
+{
+	uint64_t state = __atomic_load_n(&bucket->state, __ATOMIC_RELAXED);
+	uint32_t last_update = state >> 32;
+
+	return ((last_update + refill_periods_full) <= now_periods);
+}
+
+/*
+ * Find or claim the bucket of uid. A slot whose bucket has refilled
+ * completely holds nothing worth keeping, so it is given to uid when no free
+ * slot is left within RL_PROBE_MAX slots.
+ * OUT key - key of the bucket when it was found
+ * RET bucket or NULL if none could be found
+ */
+static user_bucket_t *_find_bucket(uid_t uid, uint32_t now_periods,
+				   uint64_t *key)
+{
+	for (int attempt = 0; attempt < RL_CLAIM_MAX; attempt++) {
+		uint32_t position = _hash_uid(uid);
+		user_bucket_t *victim = NULL;
+		uint64_t victim_key = 0;
+
+		for (int i = 0; (i < RL_PROBE_MAX) && (i < table_size); i++) {
+			user_bucket_t *bucket = &user_buckets[position];
+			uint64_t cur = __atomic_load_n(&bucket->key,
+						       __ATOMIC_ACQUIRE);
+
+			if (RL_KEY_UID(cur) == uid) {
+				*key = cur;
+				return bucket;
+			}
+
+			if (!RL_KEY_UID(cur)) {
+				*key = RL_KEY_NEXT(cur, uid);
+				if (__atomic_compare_exchange_n(
+					    &bucket->key, &cur, *key, false,
+					    __ATOMIC_ACQ_REL,
+					    __ATOMIC_ACQUIRE)) {
+					debug3("%s: new entry for uid %u at position %u",
+					       __func__, uid, position);
+					return bucket;
+				}
+				/* lost the race, cur now holds the winner */
+				if (RL_KEY_UID(cur) == uid) {
+					*key = cur;
+					return bucket;
+				}
+			}
+
+			if (!victim && _bucket_full(bucket, now_periods)) {
+				victim = bucket;
+				victim_key = cur;
+			}
+
+			if (++position == table_size)
+				position = 0;
+		}
+
+		if (!victim)
+			return NULL;
+
+		/* Threads racing for the same uid pick the same victim */
+		*key = RL_KEY_NEXT(victim_key, uid);
+		if (__atomic_compare_exchange_n(&victim->key, &victim_key,
+						*key, false, __ATOMIC_ACQ_REL,
+						__ATOMIC_ACQUIRE)) {
+			debug3("%s: uid %u replaced idle uid %u",
+			       __func__, uid, RL_KEY_UID(victim_key));
+			__atomic_store_n(&victim->last_logged, 0,
+					 __ATOMIC_RELAXED);
+			return victim;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Refill the bucket and take cost tokens from it.
+ * RET true if there were not enough tokens
+ */
+static bool _take_tokens(user_bucket_t *bucket, uint32_t cost,
+			 uint32_t now_periods, uint32_t *tokens_left)
+{
+	uint64_t old = __atomic_load_n(&bucket->state, __ATOMIC_ACQUIRE);
+	uint64_t new;
+	bool exceeded;
+
+	do {
+		uint32_t last_update = old >> 32;
+		uint64_t tokens = old & 0xffffffff;
+
+		if (now_periods > last_update) {
+			tokens += ((uint64_t) (now_periods - last_update)) *
+				  refill_rate;
+			tokens = MIN(tokens, bucket_size);
+			last_update = now_periods;
+		}
+
+		if ((exceeded = (tokens < cost)))
+			*tokens_left = tokens;
+		else
+			*tokens_left = tokens - cost;
+
+		new = (((uint64_t) last_update) << 32) | *tokens_left;
+	} while (!__atomic_compare_exchange_n(&bucket->state, &old, new, false,
+					      __ATOMIC_ACQ_REL,
+					      __ATOMIC_ACQUIRE));
+
+	return exceeded;
+}
+
+/* Give back tokens taken from a bucket that changed owner meanwhile */
+static void _return_tokens(user_bucket_t *bucket, uint32_t cost)
+{
+	uint64_t old = __atomic_load_n(&bucket->state, __ATOMIC_ACQUIRE);
+	uint64_t new;
+
+	do {
+		uint64_t tokens = MIN((old & 0xffffffff) + cost, bucket_size);
+
+		new = (old & 0xffffffff00000000ULL) | tokens;
+	} while (!__atomic_compare_exchange_n(&bucket->state, &old, new, false,
+					      __ATOMIC_ACQ_REL,
+					      __ATOMIC_ACQUIRE));
 }
 
 /*
@@ -154,15 +314,21 @@ extern void rate_limit_shutdown(void)
 extern bool rate_limit_exceeded(slurm_msg_t *msg)
 {
 	slurmctld_rpc_t *this_rpc = NULL;
-	bool exceeded = false;
-	int start_position = 0, position = 0;
-	time_t now;
+	user_bucket_t *bucket;
+	uint32_t cost = 1, tokens_left = 0, now_periods, last_logged;
+	bool exceeded = false, log_exceeded = false;
+	uint64_t key;
+	time_t now, last_log;
 
 	if (!rate_limit_enabled)
 		return false;
 
-	if ((this_rpc = find_rpc(msg->msg_type)) && this_rpc->rl_exempt)
-		return false;
+	if ((this_rpc = find_rpc(msg->msg_type))) {
+		if (this_rpc->rl_exempt)
+			return false;
+		if (this_rpc->rl_cost)
+			cost = MIN(this_rpc->rl_cost, bucket_size);
+	}
 
 	/*
 	 * Exempt SlurmUser / root. Subjecting internal cluster traffic to
@@ -172,70 +338,55 @@ extern bool rate_limit_exceeded(slurm_msg_t *msg)
 	if (validate_slurm_user(msg->auth_uid))
 		return false;
 
-	slurm_mutex_lock(&rate_limit_mutex);
-	/* This can happen if we already executed rate_limit_shutdown */
-	if (!user_buckets) {
-		slurm_mutex_unlock(&rate_limit_mutex);
-		return true;
-	}
 	now = time(NULL);
-
-	/*
-	 * Scan for position. Note that uid 0 indicates an unused slot,
-	 * since root is never subjected to the rate limit.
-	 * Naively hash the uid into the table. If that's not a match, keep
-	 * scanning for the next vacant spot. Wrap around to the front if
-	 * necessary once we hit the end.
-	 */
-	start_position = position = msg->auth_uid % table_size;
-	while ((user_buckets[position].uid) &&
-	       (user_buckets[position].uid != msg->auth_uid)) {
-		position++;
-		if (position == table_size)
-			position = 0;
-		if (position == start_position) {
-			position = table_size;
-			break;
+	now_periods = now / refill_period;
+
+	for (int attempt = 1; ; attempt++) {
+		if (!(bucket = _find_bucket(msg->auth_uid, now_periods,
+					    &key))) {
+			/*
+			 * Avoid the temptation to resize the table... you'd
+			 * need to rehash all the contents which would be
+			 * annoying and slow.
+			 */
+			last_log = __atomic_load_n(&last_full_log,
+						   __ATOMIC_RELAXED);
+			if ((last_log != now) &&
+			    __atomic_compare_exchange_n(&last_full_log,
+							&last_log, now, false,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				error("RPC Rate Limiting: ran out of user table space. User %u will not be limited.",
+				      msg->auth_uid);
+			return false;
 		}
-	}
 
-	if (position == table_size) {
-		/*
-		 * Avoid the temptation to resize the table... you'd need to
-		 * rehash all the contents which would be annoying and slow.
-		 */
-		error("RPC Rate Limiting: ran out of user table space. User will not be limited.");
-	} else if (!user_buckets[position].uid) {
-		user_buckets[position].uid = msg->auth_uid;
-		user_buckets[position].last_update = now / refill_period;
-		user_buckets[position].tokens = bucket_size - 1;
-		debug3("%s: new entry for uid %u", __func__, msg->auth_uid);
-	} else {
-		time_t now_periods = now / refill_period;
-		time_t delta = now_periods - user_buckets[position].last_update;
-		user_buckets[position].last_update = now_periods;
-
-		/* add tokens */
-		if (delta) {
-			user_buckets[position].tokens += (delta * refill_rate);
-			user_buckets[position].tokens =
-				MIN(user_buckets[position].tokens, bucket_size);
-		}
+		exceeded = _take_tokens(bucket, cost, now_periods,
+					&tokens_left);
 
-		if (user_buckets[position].tokens)
-			user_buckets[position].tokens--;
-		else
-			exceeded = true;
+		/* Taken over since it was found, charge the right bucket */
+		if ((__atomic_load_n(&bucket->key, __ATOMIC_ACQUIRE) == key) ||
+		    (attempt >= RL_CLAIM_MAX))
+			break;
+		if (!exceeded)
+			_return_tokens(bucket, cost);
+	}
 
-		debug3("%s: found uid %u at position %d remaining tokens %d%s",
-		       __func__, msg->auth_uid, position,
-		       user_buckets[position].tokens,
-		       (exceeded ? " rate limit exceeded" : ""));
+	if (exceeded && (log_freq != -1)) {
+		last_logged = __atomic_load_n(&bucket->last_logged,
+					      __ATOMIC_RELAXED);
+		log_exceeded = (((last_logged + log_freq) <= now) &&
+				__atomic_compare_exchange_n(
+					&bucket->last_logged, &last_logged,
+					now, false, __ATOMIC_RELAXED,
+					__ATOMIC_RELAXED));
 	}
-	slurm_mutex_unlock(&rate_limit_mutex);
 
-	if (exceeded && (log_freq != -1) &&
-	    ((user_buckets[position].last_logged + log_freq) <= now)) {
+	debug3("%s: uid %u cost %u remaining tokens %u%s",
+	       __func__, msg->auth_uid, cost, tokens_left,
+	       (exceeded ? " rate limit exceeded" : ""));
+
+	if (log_exceeded) {
 		slurm_addr_t *cli_addr = &msg->address;
 
 		if (cli_addr->ss_family == AF_UNSPEC) {
@@ -245,7 +396,6 @@ extern bool rate_limit_exceeded(slurm_msg_t *msg)
 
 		info("RPC rate limit exceeded by uid %u with %s from %pA, telling to back off",
 		     msg->auth_uid, rpc_num2string(msg->msg_type), cli_addr);
-		user_buckets[position].last_logged = now;
 	}
 
 	return exceeded;
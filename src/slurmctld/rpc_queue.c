@@ -46,19 +46,68 @@
 #include "src/common/macros.h"
 #include "src/common/read_config.h"
 #include "src/common/slurm_protocol_defs.h"
+#include "src/common/timers.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
+#include "src/conmgr/conmgr.h"
+
 #include "src/interfaces/conn.h"
 #include "src/interfaces/serializer.h"
 
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/proc_req.h"
+#include "src/slurmctld/rpc_queue.h"
+#include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/state_save.h"
 
 bool enabled = true;
 
+typedef struct {
+	const char *name;
+	uint32_t max_active; /* RPCs processed at once, 0 for no limit */
+	uint32_t max_waiting; /* RPCs parked waiting for max_active */
+	uint32_t active;
+	list_t *parked; /* list of rpc_lane_work_t */
+	uint64_t admitted; /* RPCs processed, whether parked or not */
+	uint64_t waited; /* RPCs that were parked */
+	uint64_t shed;
+	uint64_t wait_usec; /* total time parked */
+	uint64_t wait_max_usec;
+} rpc_lane_state_t;
+
+typedef struct {
+	slurmctld_rpc_t *this_rpc;
+	slurm_msg_t *msg;
+	rpc_lane_func_t func;
+	int lane_index;
+	struct timeval parked;
+} rpc_lane_work_t;
+
+static bool lanes_enabled = false;
+static pthread_mutex_t lanes_mutex = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * Every RPC running in a lane occupies a conmgr worker, so only the query
+ * lane is bounded by default. This keeps floods of queries from taking every
+ * worker away from daemons, admins and job control.
+ */
+static rpc_lane_state_t lanes[RPC_LANE_CNT] = {
+	[RPC_LANE_JOB] = { .name = "job" },
+	[RPC_LANE_DAEMON] = { .name = "daemon" },
+	[RPC_LANE_ADMIN] = { .name = "admin" },
+	[RPC_LANE_QUERY] = {
+		.name = "query",
+		.max_active = 4,
+		.max_waiting = 64,
+	},
+};
+
+typedef struct {
+	slurm_msg_t *msg;
+	struct timeval enqueued;
+} rpc_queue_work_t;
+
 static void *_rpc_queue_worker(void *arg)
 {
 	slurmctld_rpc_t *q = (slurmctld_rpc_t *) arg;
@@ -77,14 +126,16 @@ static void *_rpc_queue_worker(void *arg)
 	 * Acquire on init to simplify the inner loop.
 	 * On rpc_queue_init() this will proceed directly to slurm_cond_wait().
 	 */
+	lock_slurmctld_set_rpc(q->msg_type);
 	lock_slurmctld(q->locks);
+	(void) lock_slurmctld_wait_take();
 
 	/*
 	 * Process as many queued messages as possible in one slurmctld_lock()
 	 * acquisition, then fall back to sleep until additional work is queued.
 	 */
 	while (true) {
-		slurm_msg_t *msg = NULL;
+		rpc_queue_work_t *work = NULL;
 		bool highload = false;
 		long sleep_usec = 0;
 
@@ -94,9 +145,9 @@ static void *_rpc_queue_worker(void *arg)
 		     (processed_usec >= q->max_usec_per_cycle)))
 			highload = true;
 		else
-			msg = list_dequeue(q->work);
+			work = list_dequeue(q->work);
 
-		if (!msg) {
+		if (!work) {
 			unlock_slurmctld(q->locks);
 
 			if (processed && q->post_func)
@@ -163,9 +214,17 @@ static void *_rpc_queue_worker(void *arg)
 			slurm_mutex_unlock(&q->mutex);
 			log_flag(PROTOCOL, "%s(%s): woke up",
 				 __func__, q->msg_name);
+			/*
+			 * Any wait here is reported as the lock wait of the
+			 * first RPC processed in this cycle.
+			 */
 			lock_slurmctld(q->locks);
 		} else {
+			slurm_msg_t *msg = work->msg;
+			long queue_usec = slurm_delta_tv(&work->enqueued);
 			DEF_TIMERS;
+
+			xfree(work);
 			START_TIMER;
 			if (q->max_queued) {
 				slurm_mutex_lock(&q->mutex);
@@ -181,7 +240,7 @@ static void *_rpc_queue_worker(void *arg)
 			msg->conn = NULL;
 
 			END_TIMER;
-			record_rpc_stats(msg, DELTA_TIMER);
+			record_rpc_stats(msg, DELTA_TIMER, queue_usec);
 			FREE_NULL_MSG(msg);
 			processed++;
 			processed_usec += DELTA_TIMER;
@@ -234,20 +293,48 @@ static bool _find_msg_name(const data_t *data, void *needle)
 	return !xstrcasecmp(data_get_string(type), needle);
 }
 
-static void _apply_config(data_t *conf, slurmctld_rpc_t *q)
+static data_t *_find_rpc_settings(data_t *conf, slurmctld_rpc_t *q)
 {
-	data_t *rpc_queue = NULL, *settings = NULL, *field = NULL;
-	int64_t int64_tmp;
+	data_t *rpc_queue = NULL;
 
 	if (!conf || !q)
-		return;
+		return NULL;
 
 	rpc_queue = data_key_get(conf, "rpc_queue");
 	if (data_get_type(rpc_queue) != DATA_TYPE_LIST)
+		return NULL;
+
+	return data_list_find_first(rpc_queue, _find_msg_name,
+				    (void *) q->msg_name);
+}
+
+/* Rate limiting settings apply whether or not the rpc_queue is enabled */
+static void _apply_rl_config(data_t *settings, slurmctld_rpc_t *q)
+{
+	data_t *field = NULL;
+	int64_t int64_tmp;
+
+	if (!settings)
 		return;
 
-	if (!(settings = data_list_find_first(rpc_queue, _find_msg_name,
-					      (void *) q->msg_name)))
+	if ((field = data_key_get(settings, "rl_exempt")))
+		(void) data_get_bool_converted(field, &q->rl_exempt);
+
+	if ((field = data_key_get(settings, "rl_cost"))) {
+		if (data_get_int_converted(field, &int64_tmp) ||
+		    (int64_tmp < 1) || (int64_tmp > UINT16_MAX))
+			fatal("%s: rl_cost for %s is invalid, must be an integer between 1 and %u",
+			      __func__, q->msg_name, UINT16_MAX);
+		q->rl_cost = int64_tmp;
+	}
+}
+
+static void _apply_config(data_t *settings, slurmctld_rpc_t *q)
+{
+	data_t *field = NULL;
+	int64_t int64_tmp;
+
+	if (!settings)
 		return;
 
 	if ((field = data_key_get(settings, "disabled"))) {
@@ -258,9 +345,6 @@ static void _apply_config(data_t *conf, slurmctld_rpc_t *q)
 		}
 	}
 
-	if ((field = data_key_get(settings, "rl_exempt")))
-		(void) data_get_bool_converted(field, &q->rl_exempt);
-
 	if ((field = data_key_get(settings, "hard_drop")))
 		(void) data_get_bool_converted(field, &q->hard_drop);
 
@@ -285,24 +369,89 @@ static void _apply_config(data_t *conf, slurmctld_rpc_t *q)
 			q->interval = int64_tmp;
 }
 
+static bool _find_lane_name(const data_t *data, void *needle)
+{
+	const data_t *name = NULL;
+
+	if (data_get_type(data) != DATA_TYPE_DICT)
+		return false;
+
+	name = data_key_get_const(data, "lane");
+
+	if (data_get_type(name) != DATA_TYPE_STRING)
+		return false;
+
+	return !xstrcasecmp(data_get_string(name), needle);
+}
+
+static void _lanes_init(data_t *conf)
+{
+	data_t *rpc_lanes = NULL;
+
+	if (conf)
+		rpc_lanes = data_key_get(conf, "rpc_lanes");
+	if (rpc_lanes && (data_get_type(rpc_lanes) != DATA_TYPE_LIST))
+		rpc_lanes = NULL;
+
+	for (int i = 0; i < RPC_LANE_CNT; i++) {
+		rpc_lane_state_t *lane = &lanes[i];
+		data_t *settings = NULL, *field = NULL;
+		int64_t int64_tmp;
+
+		lane->parked = list_create(NULL);
+
+		if (rpc_lanes &&
+		    (settings = data_list_find_first(rpc_lanes,
+						     _find_lane_name,
+						     (void *) lane->name))) {
+			if ((field = data_key_get(settings, "max_active")))
+				if (!data_get_int_converted(field, &int64_tmp))
+					lane->max_active = int64_tmp;
+
+			if ((field = data_key_get(settings, "max_waiting")))
+				if (!data_get_int_converted(field, &int64_tmp))
+					lane->max_waiting = int64_tmp;
+		}
+
+		verbose("rpc lane %s: max_active=%u max_waiting=%u",
+			lane->name, lane->max_active, lane->max_waiting);
+	}
+
+	lanes_enabled = true;
+}
+
 extern void rpc_queue_init(void)
 {
 	data_t *conf = NULL;
+	bool lanes = xstrcasestr(slurm_conf.slurmctld_params, "rpc_lanes");
+	bool rl = xstrcasestr(slurm_conf.slurmctld_params, "rl_enable");
 
-	if (!xstrcasestr(slurm_conf.slurmctld_params, "enable_rpc_queue")) {
+	if (!xstrcasestr(slurm_conf.slurmctld_params, "enable_rpc_queue"))
 		enabled = false;
-		return;
-	}
 
-	error("enabled experimental rpc queuing system");
+	if (!enabled && !lanes && !rl)
+		return;
 
 	conf = _load_config();
 
+	if (lanes)
+		_lanes_init(conf);
+
+	if (enabled)
+		error("enabled experimental rpc queuing system");
+
 	for (slurmctld_rpc_t *q = slurmctld_rpcs; q->msg_type; q++) {
+		data_t *settings = NULL;
 		bool was_enabled = q->queue_enabled;
 		q->msg_name = rpc_num2string(q->msg_type);
 
-		_apply_config(conf, q);
+		settings = _find_rpc_settings(conf, q);
+		_apply_rl_config(settings, q);
+
+		if (!enabled)
+			continue;
+
+		_apply_config(settings, q);
 
 		/* config may have disabled this queue, check again */
 		if (!q->queue_enabled) {
@@ -315,7 +464,7 @@ extern void rpc_queue_init(void)
 			continue;
 		}
 
-		q->work = list_create(NULL);
+		q->work = list_create(xfree_ptr);
 		slurm_cond_init(&q->cond, NULL);
 		slurm_mutex_init(&q->mutex);
 		q->shutdown = false;
@@ -330,8 +479,37 @@ extern void rpc_queue_init(void)
 	FREE_NULL_DATA(conf);
 }
 
+/* Tell a parked RPC that was never processed to back off */
+static void _lane_work_free(rpc_lane_work_t *work)
+{
+	(void) slurm_send_rc_msg(work->msg, SLURMCTLD_COMMUNICATIONS_BACKOFF);
+	FREE_NULL_CONN(work->msg->conn);
+	FREE_NULL_MSG(work->msg);
+	xfree(work);
+}
+
 extern void rpc_queue_shutdown(void)
 {
+	if (lanes_enabled) {
+		list_t *parked[RPC_LANE_CNT];
+
+		slurm_mutex_lock(&lanes_mutex);
+		lanes_enabled = false;
+		for (int i = 0; i < RPC_LANE_CNT; i++) {
+			parked[i] = lanes[i].parked;
+			lanes[i].parked = NULL;
+		}
+		slurm_mutex_unlock(&lanes_mutex);
+
+		for (int i = 0; i < RPC_LANE_CNT; i++) {
+			rpc_lane_work_t *work;
+
+			while ((work = list_dequeue(parked[i])))
+				_lane_work_free(work);
+			FREE_NULL_LIST(parked[i]);
+		}
+	}
+
 	if (!enabled)
 		return;
 
@@ -365,6 +543,8 @@ extern bool rpc_queue_enabled(void)
 
 extern int rpc_enqueue(slurmctld_rpc_t *q, slurm_msg_t *msg)
 {
+	rpc_queue_work_t *work = NULL;
+
 	if (!enabled)
 		return ESLURM_NOT_SUPPORTED;
 
@@ -397,7 +577,10 @@ extern int rpc_enqueue(slurmctld_rpc_t *q, slurm_msg_t *msg)
 		slurm_mutex_unlock(&q->mutex);
 	}
 
-	list_enqueue(q->work, msg);
+	work = xmalloc(sizeof(*work));
+	work->msg = msg;
+	(void) slurm_delta_tv(&work->enqueued);
+	list_enqueue(q->work, work);
 
 	slurm_mutex_lock(&q->mutex);
 	slurm_cond_signal(&q->cond);
@@ -405,3 +588,163 @@ extern int rpc_enqueue(slurmctld_rpc_t *q, slurm_msg_t *msg)
 
 	return SLURM_SUCCESS;
 }
+
+static rpc_lane_t _classify(slurmctld_rpc_t *this_rpc, slurm_msg_t *msg)
+{
+	if (validate_slurm_user(msg->auth_uid))
+		return RPC_LANE_DAEMON;
+	if (validate_operator(msg->auth_uid))
+		return RPC_LANE_ADMIN;
+	return this_rpc->lane;
+}
+
+extern int rpc_lane_enter(slurmctld_rpc_t *this_rpc, slurm_msg_t *msg,
+			  rpc_lane_func_t func, int *lane_index)
+{
+	rpc_lane_state_t *lane = NULL;
+	uint32_t active, waiting;
+	uint64_t shed;
+	int rc = SLURM_SUCCESS;
+
+	*lane_index = RPC_LANE_CNT;
+
+	if (!lanes_enabled)
+		return SLURM_SUCCESS;
+
+	*lane_index = _classify(this_rpc, msg);
+	lane = &lanes[*lane_index];
+
+	slurm_mutex_lock(&lanes_mutex);
+	if (!lanes_enabled) {
+		/* shutting down, nothing will be handed a slot */
+		*lane_index = RPC_LANE_CNT;
+	} else if (!lane->max_active || (lane->active < lane->max_active)) {
+		lane->active++;
+		lane->admitted++;
+	} else if (list_count(lane->parked) < lane->max_waiting) {
+		rpc_lane_work_t *work = xmalloc(sizeof(*work));
+
+		work->this_rpc = this_rpc;
+		work->msg = msg;
+		work->func = func;
+		work->lane_index = *lane_index;
+		(void) slurm_delta_tv(&work->parked);
+		list_enqueue(lane->parked, work);
+		rc = EINPROGRESS;
+	} else {
+		lane->shed++;
+		*lane_index = RPC_LANE_CNT;
+		rc = SLURMCTLD_COMMUNICATIONS_BACKOFF;
+	}
+	active = lane->active;
+	waiting = (lane->parked ? list_count(lane->parked) : 0);
+	shed = lane->shed;
+	slurm_mutex_unlock(&lanes_mutex);
+
+	if (rc == EINPROGRESS)
+		log_flag(PROTOCOL, "%s: %s lane busy, parked %s from uid %u (active=%u waiting=%u)",
+			 __func__, lane->name, rpc_num2string(msg->msg_type),
+			 msg->auth_uid, active, waiting);
+	else if (rc)
+		log_flag(PROTOCOL, "%s: %s lane full, telling uid %u to back off %s (active=%u waiting=%u shed=%"PRIu64")",
+			 __func__, lane->name, msg->auth_uid,
+			 rpc_num2string(msg->msg_type), active, waiting, shed);
+
+	return rc;
+}
+
+static void _lane_run(conmgr_callback_args_t conmgr_args, void *arg)
+{
+	rpc_lane_work_t *work = arg;
+
+	if (conmgr_args.status == CONMGR_WORK_STATUS_CANCELLED) {
+		int lane_index = work->lane_index;
+
+		_lane_work_free(work);
+		rpc_lane_exit(lane_index);
+		return;
+	}
+
+	work->func(work->this_rpc, work->msg, work->lane_index);
+	xfree(work);
+}
+
+extern void rpc_lane_exit(int lane_index)
+{
+	rpc_lane_state_t *lane = NULL;
+	rpc_lane_work_t *work = NULL;
+
+	if (lane_index >= RPC_LANE_CNT)
+		return;
+
+	lane = &lanes[lane_index];
+
+	slurm_mutex_lock(&lanes_mutex);
+	if (lanes_enabled && (work = list_dequeue(lane->parked))) {
+		/* hand the slot over, active stays the same */
+		uint64_t wait_usec = slurm_delta_tv(&work->parked);
+
+		lane->admitted++;
+		lane->waited++;
+		lane->wait_usec += wait_usec;
+		lane->wait_max_usec = MAX(lane->wait_max_usec, wait_usec);
+	} else {
+		lane->active--;
+	}
+	slurm_mutex_unlock(&lanes_mutex);
+
+	if (work)
+		conmgr_add_work_fifo(_lane_run, work);
+}
+
+extern void rpc_lane_pack_stats(buf_t *buffer)
+{
+	char *name[RPC_LANE_CNT];
+	uint32_t active[RPC_LANE_CNT], waiting[RPC_LANE_CNT];
+	uint32_t max_active[RPC_LANE_CNT], max_waiting[RPC_LANE_CNT];
+	uint64_t admitted[RPC_LANE_CNT], waited[RPC_LANE_CNT];
+	uint64_t shed[RPC_LANE_CNT], wait_usec[RPC_LANE_CNT];
+	uint64_t wait_max_usec[RPC_LANE_CNT];
+	uint32_t cnt = 0;
+
+	slurm_mutex_lock(&lanes_mutex);
+	if (lanes_enabled)
+		cnt = RPC_LANE_CNT;
+	for (int i = 0; i < cnt; i++) {
+		name[i] = (char *) lanes[i].name;
+		active[i] = lanes[i].active;
+		waiting[i] = list_count(lanes[i].parked);
+		max_active[i] = lanes[i].max_active;
+		max_waiting[i] = lanes[i].max_waiting;
+		admitted[i] = lanes[i].admitted;
+		waited[i] = lanes[i].waited;
+		shed[i] = lanes[i].shed;
+		wait_usec[i] = lanes[i].wait_usec;
+		wait_max_usec[i] = lanes[i].wait_max_usec;
+	}
+	slurm_mutex_unlock(&lanes_mutex);
+
+	packstr_array(name, cnt, buffer);
+	pack32_array(active, cnt, buffer);
+	pack32_array(waiting, cnt, buffer);
+	pack32_array(max_active, cnt, buffer);
+	pack32_array(max_waiting, cnt, buffer);
+	pack64_array(admitted, cnt, buffer);
+	pack64_array(waited, cnt, buffer);
+	pack64_array(shed, cnt, buffer);
+	pack64_array(wait_usec, cnt, buffer);
+	pack64_array(wait_max_usec, cnt, buffer);
+}
+
+extern void rpc_lane_reset_stats(void)
+{
+	slurm_mutex_lock(&lanes_mutex);
+	for (int i = 0; i < RPC_LANE_CNT; i++) {
+		lanes[i].admitted = 0;
+		lanes[i].waited = 0;
+		lanes[i].shed = 0;
+		lanes[i].wait_usec = 0;
+		lanes[i].wait_max_usec = 0;
+	}
+	slurm_mutex_unlock(&lanes_mutex);
+}
@@ -46,4 +46,32 @@ extern bool rpc_queue_enabled(void);
 
 extern int rpc_enqueue(slurmctld_rpc_t *q, slurm_msg_t *msg);
 
+/* Process an RPC admitted by rpc_lane_enter() into lane_index */
+typedef void (*rpc_lane_func_t)(slurmctld_rpc_t *this_rpc, slurm_msg_t *msg,
+				int lane_index);
+
+/*
+ * Admit an RPC that is about to be processed directly into its lane.
+ * While the lane is at max_active and fewer than max_waiting RPCs are already
+ * waiting for it, the RPC is parked instead and func is queued as conmgr work
+ * once rpc_lane_exit() hands it a slot, so no worker is held while waiting.
+ * IN this_rpc - RPC type
+ * IN msg - RPC to be processed, owned by the lane if parked
+ * IN func - function to process msg if parked
+ * OUT lane_index - pass to rpc_lane_exit() once processed
+ * RET SLURM_SUCCESS to process msg now, EINPROGRESS if parked or
+ *	SLURMCTLD_COMMUNICATIONS_BACKOFF if the lane is full
+ */
+extern int rpc_lane_enter(slurmctld_rpc_t *this_rpc, slurm_msg_t *msg,
+			  rpc_lane_func_t func, int *lane_index);
+
+/* Release the lane taken by rpc_lane_enter() */
+extern void rpc_lane_exit(int lane_index);
+
+/* Pack the lane statistics for REQUEST_STATS_INFO */
+extern void rpc_lane_pack_stats(buf_t *buffer);
+
+/* Reset the lane counters for sdiag --reset */
+extern void rpc_lane_reset_stats(void);
+
 #endif
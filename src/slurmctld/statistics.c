@@ -49,6 +49,7 @@
 #include "src/interfaces/select.h"
 
 #include "src/slurmctld/locks.h"
+#include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/statistics.h"
 
 typedef struct foreach_part_gen_stats {
@@ -877,6 +878,7 @@ extern scheduling_stats_t *statistics_get_sched(void)
 	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
 	s->server_thread_count = slurmctld_config.server_thread_count;
 	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+	get_rpc_latency_stats(s);
 
 	return s;
 }
@@ -920,6 +922,7 @@ extern void statistics_free_nodes(nodes_stats_t *s)
 extern void statistics_free_sched(scheduling_stats_t *s)
 {
 	xfree(s->diag_stats);
+	xfree(s->rpc_latency);
 	xfree(s);
 }
 
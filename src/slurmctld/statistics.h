@@ -164,6 +164,13 @@ typedef struct partitions_statistics {
 	list_t *parts;
 } partitions_stats_t;
 
+typedef struct {
+	uint16_t msg_type;
+	uint32_t cnt;
+	/* usec, see RPC_LATENCY_* in slurm.h */
+	uint64_t latency[RPC_LATENCY_PHASE_CNT][RPC_LATENCY_PCTL_CNT];
+} rpc_latency_stats_t;
+
 typedef struct scheduling_statistics {
 	uint32_t agent_count;
 	uint32_t agent_queue_size;
@@ -175,6 +182,8 @@ typedef struct scheduling_statistics {
 	uint32_t bf_try_depth_mean;
 	diag_stats_t *diag_stats;
 	uint64_t last_proc_req_start;
+	rpc_latency_stats_t *rpc_latency;
+	uint32_t rpc_latency_cnt;
 	uint32_t sched_mean_cycle;
 	uint32_t sched_mean_depth_cycle;
 	uint32_t server_thread_count;
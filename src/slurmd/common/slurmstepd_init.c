@@ -58,6 +58,7 @@ extern void pack_slurmd_conf_lite(slurmd_conf_t *conf, buf_t *buffer)
 	pack16(conf->actual_threads, buffer);
 	packstr(conf->cpu_spec_list, buffer);
 	pack16(conf->core_spec_cnt, buffer);
+	packstr(conf->spec_mac_cpus, buffer);
 	pack64(conf->mem_spec_limit, buffer);
 	pack64(conf->conf_memory_size, buffer);
 	pack16(conf->block_map_size, buffer);
@@ -97,6 +98,7 @@ extern int unpack_slurmd_conf_lite_no_alloc(slurmd_conf_t *conf, buf_t *buffer)
 		safe_unpack16(&conf->actual_threads, buffer);
 		safe_unpackstr(&conf->cpu_spec_list, buffer);
 		safe_unpack16(&conf->core_spec_cnt, buffer);
+		safe_unpackstr(&conf->spec_mac_cpus, buffer);
 		safe_unpack64(&conf->mem_spec_limit, buffer);
 		safe_unpack64(&conf->conf_memory_size, buffer);
 		safe_unpack16(&conf->block_map_size, buffer);
@@ -121,6 +123,7 @@ unpack_error:
 	error("unpack_error in unpack_slurmd_conf_lite_no_alloc: %m");
 	xfree(conf->hostname);
 	xfree(conf->cpu_spec_list);
+	xfree(conf->spec_mac_cpus);
 	xfree(conf->conffile);
 	xfree(conf->spooldir);
 	xfree(conf->node_name);
@@ -3570,6 +3570,139 @@ void file_bcast_purge(void)
 	/* destroying list before exit, no need to unlock */
 }
 
+typedef struct {
+	char *node_name;
+	file_bcast_msg_t *req;	/* shared by the relays of a block */
+	int rc;
+	int timeout;
+	pthread_t tid;
+	uint16_t protocol_version;
+} bcast_relay_t;
+
+static void *_file_bcast_relay_thread(void *arg)
+{
+	bcast_relay_t *relay = arg;
+	slurm_msg_t msg;
+
+	slurm_msg_t_init(&msg);
+	slurm_msg_set_r_uid(&msg, slurm_conf.slurmd_user_id);
+	msg.data = relay->req;
+	msg.flags = USE_BCAST_NETWORK;
+	msg.msg_type = REQUEST_FILE_BCAST;
+	msg.protocol_version = relay->protocol_version;
+
+	if (slurm_conf_get_addr(relay->node_name, &msg.address, msg.flags))
+		relay->rc = SLURM_UNKNOWN_FORWARD_ADDR;
+	else if (slurm_send_recv_rc_msg_only_one(&msg, &relay->rc,
+						 relay->timeout))
+		relay->rc = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
+
+	if (relay->rc)
+		error("sbcast: relay of block %u to %s failed: %s",
+		      relay->req->block_no, relay->node_name,
+		      slurm_strerror(relay->rc));
+
+	return NULL;
+}
+
+/*
+ * Relay a FILE_BCAST_SWARM block to the children of this node in the reverse
+ * tree over swarm_nodes rooted at the node sbcast sent the block to. The root
+ * rotates with the block number, so every node relays its share of the
+ * blocks and sbcast sends each block once.
+ * RET relays to pass to _file_bcast_relay_wait(), NULL if none
+ */
+static bcast_relay_t *_file_bcast_relay_start(slurm_msg_t *msg,
+					      int *relay_cnt)
+{
+	file_bcast_msg_t *req = msg->data, *relay_req;
+	bcast_relay_t *relays;
+	hostlist_t *hl;
+	int node_cnt, width, inx, root, rank;
+	int parent, subtree_cnt, depth, max_depth;
+	int *children;
+
+	*relay_cnt = 0;
+	if (!(req->flags & FILE_BCAST_SWARM) || !req->swarm_nodes)
+		return NULL;
+
+	hl = hostlist_create(req->swarm_nodes);
+	node_cnt = hostlist_count(hl);
+	if ((inx = hostlist_find(hl, conf->node_name)) < 0) {
+		error("sbcast: %s not in swarm nodes %s",
+		      conf->node_name, req->swarm_nodes);
+		hostlist_destroy(hl);
+		return NULL;
+	}
+
+	/* reverse_tree has no tree if width is not below the node count */
+	width = MAX(1, MIN(req->swarm_width, node_cnt - 1));
+	root = req->block_no % node_cnt;
+	rank = (inx - root + node_cnt) % node_cnt;
+	reverse_tree_info(rank, node_cnt, width, &parent, &subtree_cnt, &depth,
+			  &max_depth);
+	if (subtree_cnt <= 0) {
+		hostlist_destroy(hl);
+		return NULL;
+	}
+
+	children = xcalloc(width, sizeof(int));
+	if (!(*relay_cnt = reverse_tree_direct_children(rank, node_cnt, width,
+							depth, children))) {
+		xfree(children);
+		hostlist_destroy(hl);
+		return NULL;
+	}
+
+	/* req->fname and a compressed block are changed on this node */
+	relay_req = xmalloc(sizeof(*relay_req));
+	*relay_req = *req;
+	relay_req->fname = xstrdup(req->fname);
+	if (req->compress) {
+		relay_req->block = xmalloc(req->block_len);
+		memcpy(relay_req->block, req->block, req->block_len);
+	}
+
+	relays = xcalloc(*relay_cnt, sizeof(*relays));
+	for (int i = 0; i < *relay_cnt; i++) {
+		relays[i].node_name =
+			hostlist_nth(hl, (children[i] + root) % node_cnt);
+		relays[i].req = relay_req;
+		relays[i].protocol_version = msg->protocol_version;
+		relays[i].timeout = 2 * (max_depth - depth) *
+				    slurm_conf.msg_timeout * MSEC_IN_SEC;
+		slurm_thread_create(&relays[i].tid, _file_bcast_relay_thread,
+				    &relays[i]);
+	}
+
+	xfree(children);
+	hostlist_destroy(hl);
+
+	return relays;
+}
+
+/* Wait for the relays of a block, RET first error of its subtrees */
+static int _file_bcast_relay_wait(bcast_relay_t *relays, int relay_cnt)
+{
+	file_bcast_msg_t *relay_req = relays[0].req;
+	int rc = SLURM_SUCCESS;
+
+	for (int i = 0; i < relay_cnt; i++) {
+		slurm_thread_join(relays[i].tid);
+		if (!rc)
+			rc = relays[i].rc;
+		free(relays[i].node_name);
+	}
+
+	xfree(relay_req->fname);
+	if (relay_req->compress)
+		xfree(relay_req->block);
+	xfree(relay_req);
+	xfree(relays);
+
+	return rc;
+}
+
 static void _rpc_file_bcast(slurm_msg_t *msg)
 {
 	int rc = SLURM_SUCCESS;
@@ -3578,10 +3711,22 @@ static void _rpc_file_bcast(slurm_msg_t *msg)
 	file_bcast_info_t *file_info;
 	file_bcast_msg_t *req = msg->data;
 	file_bcast_info_t key;
+	bcast_relay_t *relays = NULL;
+	int relay_cnt = 0, relay_rc;
 
 	key.uid = msg->auth_uid;
 	key.gid = msg->auth_gid;
 
+	/*
+	 * Blocks relayed by another slurmd are written for the owner of the
+	 * credential, into a transfer its first block already registered.
+	 */
+	if ((req->flags & FILE_BCAST_SWARM) && (req->block_no != 1) &&
+	    _slurm_authorized_user(msg->auth_uid)) {
+		key.uid = req->cred->arg.id->uid;
+		key.gid = req->cred->arg.id->gid;
+	}
+
 	cred_arg = _valid_sbcast_cred(req, key.uid, key.gid,
 				      msg->protocol_version);
 	if (!cred_arg) {
@@ -3592,6 +3737,9 @@ static void _rpc_file_bcast(slurm_msg_t *msg)
 	key.job_id = cred_arg->step_id.job_id;
 	key.step_id = cred_arg->step_id.step_id;
 
+	if (req->block_no != 1)
+		relays = _file_bcast_relay_start(msg, &relay_cnt);
+
 #if 0
 	info("last_block=%u force=%u modes=%o",
 	     req->last_block, req->force, req->modes);
@@ -3688,10 +3836,12 @@ static void _rpc_file_bcast(slurm_msg_t *msg)
 		goto done;
 	}
 
+	/* sbcast may send several blocks at once, write each at its offset */
 	offset = 0;
 	while (req->block_len - offset) {
-		inx = write(file_info->fd, &req->block[offset],
-			    (req->block_len - offset));
+		inx = pwrite(file_info->fd, &req->block[offset],
+			     (req->block_len - offset),
+			     req->block_offset + offset);
 		if (inx == -1) {
 			if ((errno == EINTR) || (errno == EAGAIN))
 				continue;
@@ -3703,24 +3853,44 @@ static void _rpc_file_bcast(slurm_msg_t *msg)
 		}
 		offset += inx;
 	}
+	slurm_rwlock_unlock(&file_bcast_lock);
 
+	/*
+	 * The last block may be written before others still in flight, the
+	 * file is complete once every block up to it has been written.
+	 */
+	slurm_rwlock_wrlock(&file_bcast_lock);
+	if (!(file_info = _bcast_lookup_file(&key))) {
+		slurm_rwlock_unlock(&file_bcast_lock);
+		goto done;
+	}
 	file_info->last_update = time(NULL);
+	file_info->received_blocks++;
+	if (req->flags & FILE_BCAST_LAST_BLOCK) {
+		file_info->last_block_no = req->block_no;
+		file_info->modes = req->modes;
+		file_info->atime = req->atime;
+		file_info->mtime = req->mtime;
+	}
+	if (!file_info->last_block_no ||
+	    (file_info->received_blocks < file_info->last_block_no)) {
+		slurm_rwlock_unlock(&file_bcast_lock);
+		goto done;
+	}
 
-	if ((req->flags & FILE_BCAST_LAST_BLOCK) &&
-	    fchmod(file_info->fd, (req->modes & 0777))) {
+	if (fchmod(file_info->fd, (file_info->modes & 0777))) {
 		error("sbcast: uid:%u can't chmod `%s`: %m",
 		      key.uid, key.fname);
 	}
-	if ((req->flags & FILE_BCAST_LAST_BLOCK) &&
-	    fchown(file_info->fd, key.uid, key.gid)) {
+	if (fchown(file_info->fd, key.uid, key.gid)) {
 		error("sbcast: uid:%u gid:%u can't chown `%s`: %m",
 		      key.uid, key.gid, key.fname);
 	}
-	if ((req->flags & FILE_BCAST_LAST_BLOCK) && req->atime) {
+	if (file_info->atime) {
 		struct timespec time_buf[2];
-		time_buf[0].tv_sec = req->atime;
+		time_buf[0].tv_sec = file_info->atime;
 		time_buf[0].tv_nsec = 0;
-		time_buf[1].tv_sec = req->mtime;
+		time_buf[1].tv_sec = file_info->mtime;
 		time_buf[1].tv_nsec = 0;
 		if (futimens(file_info->fd, time_buf)) {
 			error("sbcast: uid:%u can't futimens `%s`: %m",
@@ -3730,11 +3900,12 @@ static void _rpc_file_bcast(slurm_msg_t *msg)
 
 	slurm_rwlock_unlock(&file_bcast_lock);
 
-	if (req->flags & FILE_BCAST_LAST_BLOCK) {
-		_file_bcast_close_file(&key);
-	}
+	_file_bcast_close_file(&key);
 
 done:
+	if (relays && (relay_rc = _file_bcast_relay_wait(relays, relay_cnt)) &&
+	    !rc)
+		rc = relay_rc;
 	slurm_send_rc_msg(msg, rc);
 }
 
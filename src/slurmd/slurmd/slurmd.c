@@ -52,6 +52,7 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <grp.h>
+#include <poll.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -142,6 +143,8 @@ decl_static_data(usage_txt);
 uint32_t slurm_daemon = IS_SLURMD;
 
 #define MAX_THREADS		256
+/* Max service threads waiting on idle pooled connections */
+#define MAX_KEEPALIVE_THREADS	(MAX_THREADS / 4)
 #define DEF_CONMGR_THREAD_COUNT 6
 #define TIMEOUT_SIGUSR2 5000000
 #define TIMEOUT_RECONFIG 5000000
@@ -177,6 +180,7 @@ typedef struct {
  * count of active threads
  */
 static int             active_threads = 0;
+static int             keepalive_threads = 0; /* idle on pooled conns */
 static pthread_mutex_t active_mutex   = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  active_cond    = PTHREAD_COND_INITIALIZER;
 
@@ -199,6 +203,7 @@ static int	ncpus;			/* number of CPUs on this node */
 static bool original = true;
 static bool under_systemd = false;
 static sig_atomic_t _shutdown = 0;
+static bool _reconfig = false; /* use __atomic builtins */
 static time_t sent_reg_time = (time_t) 0;
 
 /*
@@ -710,10 +715,78 @@ _wait_for_all_threads(int secs)
 	verbose("all threads complete");
 }
 
+/*
+ * Wait for the next RPC on a connection the sender asked to keep open.
+ * IN msg - previous RPC received on the connection
+ * RET next RPC to process or NULL if the connection should be closed
+ */
+static slurm_msg_t *_keepalive_next_msg(slurm_msg_t *msg)
+{
+	struct pollfd pfd = {
+		.fd = conn_g_get_fd(msg->conn),
+		.events = POLLIN,
+	};
+	int idle_time = slurm_conn_pool_idle_time();
+	slurm_msg_t *next_msg = NULL;
+	int rc;
+
+	if (!idle_time)
+		return NULL;
+
+	/* Don't let idle connections tie up the service threads */
+	slurm_mutex_lock(&active_mutex);
+	if (keepalive_threads >= MAX_KEEPALIVE_THREADS) {
+		slurm_mutex_unlock(&active_mutex);
+		log_flag(NET, "%s: [%pA] %d threads already wait on pooled connections, closing",
+			 __func__, &msg->address, keepalive_threads);
+		return NULL;
+	}
+	keepalive_threads++;
+	slurm_mutex_unlock(&active_mutex);
+
+	/* Poll in 1 second steps to notice shutdown or reconfigure */
+	for (int i = 0; i < idle_time; i++) {
+		if (_shutdown || __atomic_load_n(&_reconfig, __ATOMIC_ACQUIRE))
+			break;
+		if ((rc = poll(&pfd, 1, MSEC_IN_SEC)) > 0)
+			break;
+		if ((rc < 0) && (errno != EINTR)) {
+			log_flag(NET, "%s: poll() failed: %m", __func__);
+			break;
+		}
+	}
+
+	slurm_mutex_lock(&active_mutex);
+	keepalive_threads--;
+	slurm_mutex_unlock(&active_mutex);
+
+	if (!(pfd.revents & POLLIN)) {
+		log_flag(NET, "%s: [%pA] closing idle connection",
+			 __func__, &msg->address);
+		return NULL;
+	}
+
+	next_msg = xmalloc(sizeof(*next_msg));
+	slurm_msg_t_init(next_msg);
+	next_msg->address = msg->address;
+
+	if ((rc = slurm_receive_keepalive_msg(msg->conn, &next_msg->address,
+					      next_msg))) {
+		log_flag(NET, "%s: [%pA] connection closed: %s",
+			 __func__, &msg->address, slurm_strerror(rc));
+		next_msg->conn = NULL;
+		slurm_free_msg(next_msg);
+		return NULL;
+	}
+
+	msg->conn = NULL;
+	return next_msg;
+}
+
 static void *_service_msg(void *arg)
 {
 	service_msg_args_t *args = arg;
-	slurm_msg_t *msg = args->msg;
+	slurm_msg_t *msg = args->msg, *next_msg;
 	const slurm_addr_t *addr = &msg->address;
 	conmgr_fd_ref_t *conmgr_con = NULL;
 
@@ -737,6 +810,17 @@ static void *_service_msg(void *arg)
 	CONMGR_CON_UNLINK(msg->conmgr_con);
 	slurmd_req(msg);
 
+	/* Keep servicing RPCs from pooled connections until idle */
+	while (msg->conn && (msg->flags & SLURM_CONN_KEEPALIVE) &&
+	       (next_msg = _keepalive_next_msg(msg))) {
+		slurm_free_msg(msg);
+		msg = next_msg;
+		log_flag(AUDIT_RPCS, "[%pA] msg_type=%s uid=%u protocol=%u on kept alive connection",
+			 &msg->address, rpc_num2string(msg->msg_type),
+			 msg->auth_uid, msg->protocol_version);
+		slurmd_req(msg);
+	}
+
 	conn_g_destroy(msg->conn, true);
 	msg->conn = NULL;
 
@@ -1426,6 +1510,8 @@ static void *_try_to_reconfig(void *ptr)
 		close_skip[skip_index++] = auth_fd;
 
 	conmgr_quiesce(__func__);
+	/* Stop idle pooled connections from holding up the reconfigure */
+	__atomic_store_n(&_reconfig, true, __ATOMIC_RELEASE);
 
 	START_TIMER;
 
@@ -1505,6 +1591,7 @@ rwfail:
 		info("Resuming operation, reconfigure failed.");
 
 		END_TIMER3(__func__, TIMEOUT_RECONFIG);
+		__atomic_store_n(&_reconfig, false, __ATOMIC_RELEASE);
 		conmgr_unquiesce(__func__);
 		return NULL;
 	}
@@ -1647,6 +1734,7 @@ _destroy_conf(void)
 		xfree(conf->conf_server);
 		xfree(conf->conf_cache);
 		xfree(conf->cpu_spec_list);
+		xfree(conf->spec_mac_cpus);
 		xfree(conf->dynamic_conf);
 		xfree(conf->dynamic_feature);
 		xfree(conf->extra);
@@ -3111,6 +3199,8 @@ static int _core_spec_init(void)
 
 	info("Resource spec: Reserved abstract CPU IDs: %s", res_abs_cpus);
 	info("Resource spec: Reserved machine CPU IDs: %s", res_mac_cpus);
+	xfree(conf->spec_mac_cpus);
+	conf->spec_mac_cpus = xstrdup(res_mac_cpus);
 	_resource_spec_fini();
 
 	return SLURM_SUCCESS;
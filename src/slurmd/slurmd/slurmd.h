@@ -92,6 +92,7 @@ typedef struct slurmd_config {
 	uint16_t     threads;           /* thread per core count           */
 	char         *cpu_spec_list;    /* cpu specialization list         */
 	uint16_t     core_spec_cnt;     /* core specialization count       */
+	char         *spec_mac_cpus;    /* machine CPU IDs of spec cores   */
 	uint64_t     mem_spec_limit;    /* memory specialization limit     */
 	uint16_t     cores;             /* core per socket  count          */
 	uint16_t     conf_cpus;         /* conf file logical processors    */
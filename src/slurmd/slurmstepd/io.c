@@ -57,17 +57,22 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <termios.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #include "src/common/cbuf.h"
 #include "src/common/eio.h"
 #include "src/common/fd.h"
+#include "src/common/hostlist.h"
 #include "src/common/io_hdr.h"
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/net.h"
 #include "src/common/read_config.h"
+#include "src/common/reverse_tree.h"
+#include "src/common/slurm_protocol_api.h"
 #include "src/common/write_labelled_message.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
@@ -88,12 +93,26 @@
 
 #define STDIO_FILE_RETRIES 10
 
+/* Max queued messages sent to a client socket with a single writev() */
+#define CLIENT_WRITE_MSGS_MAX 64
+
 struct io_buf {
 	int ref_count;
 	uint32_t length;
 	void *data;
 };
 
+/* I/O forwarding counters of the step, logged when the I/O thread exits */
+static struct {
+	uint64_t client_bytes;	/* written to client sockets */
+	uint64_t client_writes;	/* write calls on client sockets */
+	uint64_t copy_bytes;	/* copied from task buffers into messages */
+	uint64_t copies;	/* messages built from task buffers */
+	uint64_t file_bytes;	/* task output written to local files */
+	uint64_t file_writes;	/* messages written to local files */
+	uint64_t task_bytes;	/* read from task stdout/stderr */
+} io_stats;
+
 static struct io_buf *_alloc_io_buf(void);
 static void _free_io_buf(struct io_buf *buf);
 
@@ -139,6 +158,92 @@ struct client_io_info {
 	bool is_local_file;
 };
 
+static int _client_writev(eio_obj_t *obj, struct client_io_info *client,
+			  void *buf);
+
+/**********************************************************************
+ * I/O tree declarations (LAUNCH_IO_TREE)
+ **********************************************************************/
+/*
+ * A child in the reverse tree asks its parent to relay its stdio through
+ * slurm_forward_data() to this socket, the parent then connects to the port
+ * the child listens on. The spool directory is expanded by slurmd.
+ */
+#define IO_TREE_SOCK_FMT "%s/sock.io.%u.%u"
+
+static bool _tree_notify_readable(eio_obj_t *);
+static int _tree_notify_read(eio_obj_t *, list_t *);
+
+struct io_operations tree_notify_ops = {
+	.readable = &_tree_notify_readable,
+	.handle_read = &_tree_notify_read,
+};
+
+static bool _tree_link_readable(eio_obj_t *);
+static bool _tree_link_writable(eio_obj_t *);
+static int _tree_link_read(eio_obj_t *, list_t *);
+static int _tree_link_write(eio_obj_t *, list_t *);
+
+struct io_operations tree_link_ops = {
+	.readable = &_tree_link_readable,
+	.writable = &_tree_link_writable,
+	.handle_read = &_tree_link_read,
+	.handle_write = &_tree_link_write,
+};
+
+#define TREE_LINK_MAGIC 0x10104
+/* Connection to a child in the reverse tree, carrying its whole subtree */
+struct tree_link_info {
+	int magic;
+	int child;		/* index in io_tree.ranks */
+
+	/* incoming variables */
+	io_hdr_t header;
+	struct io_buf *in_msg;
+	int32_t in_remaining;
+	bool in_eof;
+	int stdout_objs;	/* streams of the subtree not closed yet */
+	int stderr_objs;
+
+	/* outgoing variables, private copies of stdin messages */
+	list_t *msg_queue;
+	struct io_buf *out_msg;
+	int32_t out_remaining;
+	bool out_eof;
+};
+
+/* A child answered by the tree thread, for the I/O thread to relay */
+typedef struct {
+	int child;		/* index in io_tree.ranks */
+	void *conn;		/* NULL if the child is not relayed */
+	io_init_msg_t init;	/* sent by the child when relayed */
+} tree_settled_t;
+
+/* pending, open and stop are protected by step->io_mutex */
+static struct {
+	int child_cnt;		/* direct children relayed by this node */
+	int *ranks;		/* rank of each direct child */
+	int *last;		/* last rank in the subtree of each child */
+	char **names;		/* node name of each direct child */
+	eio_obj_t **links;	/* link to each child once connected */
+	int pending;		/* children neither connected nor given up */
+	int open;		/* links not closed yet */
+	time_t deadline;	/* give up on children not connected by then */
+	eio_obj_t *upstream;	/* client connection towards srun */
+	bool *answered;		/* child answered by the tree thread */
+	int stdin_queued;	/* stdin copies queued on links */
+	char *sock_path;
+	int listen_fd;		/* relay requests forwarded by slurmd */
+	int notify_fd[2];	/* tree thread to I/O thread, see settled */
+	list_t *settled;	/* tree_settled_t for the I/O thread */
+	pthread_t thread;	/* connects and handshakes with children */
+	bool stop;		/* io_tree_wait() gave up on the children */
+} io_tree;
+
+static void _tree_route_stdin(io_hdr_t *header, struct io_buf *msg);
+static void _tree_stdin_sent(void);
+
+
 
 static bool _local_file_writable(eio_obj_t *);
 static int _local_file_write(eio_obj_t *, list_t *);
@@ -217,6 +322,8 @@ static void _route_msg_task_to_client(eio_obj_t *obj);
 static void _free_outgoing_msg(struct io_buf *msg);
 static void _free_incoming_msg(struct io_buf *msg);
 static void _free_all_outgoing_msgs(list_t *msg_queue);
+static void _put_incoming_buf(struct io_buf *msg);
+static void _put_outgoing_buf(struct io_buf *msg);
 static bool _incoming_buf_free(void);
 static bool _outgoing_buf_free(void);
 static int _send_connection_okay_response(void);
@@ -251,6 +358,12 @@ _client_readable(eio_obj_t *obj)
 		return false;
 	}
 
+	/* Stop reading stdin while the relayed copies are not written */
+	if (io_tree.stdin_queued >= STDIO_MAX_FREE_BUF) {
+		debug5("  false, relayed stdin queue full");
+		return false;
+	}
+
 	if (client->in_msg || _incoming_buf_free())
 		return true;
 
@@ -326,7 +439,7 @@ static int _client_read(eio_obj_t *obj, list_t *objs)
 		if (n <= 0) { /* got eof or fatal error */
 			debug5("  got eof or error _client_read header, n=%d", n);
 			client->in_eof = true;
-			list_enqueue(step->free_incoming, client->in_msg);
+			_put_incoming_buf(client->in_msg);
 			client->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
@@ -344,7 +457,7 @@ static int _client_read(eio_obj_t *obj, list_t *objs)
 	if (client->header.type == SLURM_IO_CONNECTION_TEST) {
 		if (client->header.length != 0) {
 			debug5("  error in _client_read: bad connection test");
-			list_enqueue(step->free_incoming, client->in_msg);
+			_put_incoming_buf(client->in_msg);
 			client->in_msg = NULL;
 			return SLURM_ERROR;
 		}
@@ -358,7 +471,7 @@ static int _client_read(eio_obj_t *obj, list_t *objs)
 			 */
 			return SLURM_SUCCESS;
 		}
-		list_enqueue(step->free_incoming, client->in_msg);
+		_put_incoming_buf(client->in_msg);
 		client->in_msg = NULL;
 		return SLURM_SUCCESS;
 	} else if (client->header.length == 0) { /* zero length is an eof message */
@@ -385,7 +498,7 @@ static int _client_read(eio_obj_t *obj, list_t *objs)
 		if (n <= 0) { /* got eof (or unhandled error) */
 			debug5("  got eof on _client_read body");
 			client->in_eof = true;
-			list_enqueue(step->free_incoming, client->in_msg);
+			_put_incoming_buf(client->in_msg);
 			client->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
@@ -416,6 +529,7 @@ static int _client_read(eio_obj_t *obj, list_t *objs)
 				io = (struct task_write_info *)task->in->arg;
 				client->in_msg->ref_count++;
 				list_enqueue(io->msg_queue, client->in_msg);
+				eio_obj_touch(task->in);
 			}
 			debug5("  message ref_count = %d", client->in_msg->ref_count);
 		} else {
@@ -428,9 +542,14 @@ static int _client_read(eio_obj_t *obj, list_t *objs)
 					continue;
 				client->in_msg->ref_count++;
 				list_enqueue(io->msg_queue, client->in_msg);
+				eio_obj_touch(task->in);
 				break;
 			}
 		}
+		if (io_tree.child_cnt && (obj == io_tree.upstream))
+			_tree_route_stdin(&client->header, client->in_msg);
+		if (!client->in_msg->ref_count)
+			_put_incoming_buf(client->in_msg);
 	}
 	client->in_msg = NULL;
 	debug4("Leaving  _client_read");
@@ -472,12 +591,15 @@ static int _client_write(eio_obj_t *obj, list_t *objs)
 	 */
 	buf = client->out_msg->data +
 		(client->out_msg->length - client->out_remaining);
+	if (!obj->conn && !list_is_empty(client->msg_queue))
+		return _client_writev(obj, client, buf);
 again:
 	if (obj->conn) {
 		n = conn_g_send(obj->conn, buf, client->out_remaining);
 	} else {
 		n = write(obj->fd, buf, client->out_remaining);
 	}
+	io_stats.client_writes++;
 	if (n < 0) {
 		if (errno == EINTR) {
 			goto again;
@@ -495,6 +617,7 @@ again:
 		      n, client->out_remaining);
 	} else
 		debug5("Wrote %d bytes to socket", n);
+	io_stats.client_bytes += n;
 	client->out_remaining -= n;
 	if (client->out_remaining > 0)
 		return SLURM_SUCCESS;
@@ -505,6 +628,60 @@ again:
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Send the rest of client->out_msg along with the messages queued behind it
+ * in a single writev(). Messages are shared by all clients, so they are sent
+ * straight from their buffers.
+ */
+static int _client_writev(eio_obj_t *obj, struct client_io_info *client,
+			  void *buf)
+{
+	struct iovec iov[CLIENT_WRITE_MSGS_MAX];
+	struct io_buf *msg;
+	list_itr_t *itr;
+	ssize_t n;
+	int iov_cnt = 1;
+
+	iov[0].iov_base = buf;
+	iov[0].iov_len = client->out_remaining;
+
+	itr = list_iterator_create(client->msg_queue);
+	while ((iov_cnt < CLIENT_WRITE_MSGS_MAX) && (msg = list_next(itr))) {
+		iov[iov_cnt].iov_base = msg->data;
+		iov[iov_cnt++].iov_len = msg->length;
+	}
+	list_iterator_destroy(itr);
+
+again:
+	n = writev(obj->fd, iov, iov_cnt);
+	io_stats.client_writes++;
+	if (n < 0) {
+		if (errno == EINTR) {
+			goto again;
+		} else if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+			debug5("_client_writev returned EAGAIN");
+			return SLURM_SUCCESS;
+		}
+		client->out_eof = true;
+		_free_all_outgoing_msgs(client->msg_queue);
+		return SLURM_SUCCESS;
+	}
+	debug5("Wrote %zd bytes from %d messages to socket", n, iov_cnt);
+	io_stats.client_bytes += n;
+
+	/* Release every message fully written, keep the last partial one */
+	while (client->out_msg && (n >= client->out_remaining)) {
+		n -= client->out_remaining;
+		_free_outgoing_msg(client->out_msg);
+		if ((client->out_msg = list_dequeue(client->msg_queue)))
+			client->out_remaining = client->out_msg->length;
+	}
+	if (client->out_msg)
+		client->out_remaining -= n;
+
+	return SLURM_SUCCESS;
+}
+
 
 static bool
 _local_file_writable(eio_obj_t *obj)
@@ -584,6 +761,8 @@ static int _local_file_write(eio_obj_t *obj, list_t *objs)
 		_free_all_outgoing_msgs(client->msg_queue);
 		return SLURM_ERROR;
 	}
+	io_stats.file_bytes += n;
+	io_stats.file_writes++;
 
 	client->out_remaining -= n;
 	if (client->out_remaining == 0) {
@@ -642,8 +821,7 @@ static int _task_write_error(eio_obj_t *obj, list_t *objs)
 {
 	debug4("Called _task_write_error, closing fd %d", obj->fd);
 
-	close(obj->fd);
-	obj->fd = -1;
+	eio_obj_close_fd(obj);
 
 	return SLURM_SUCCESS;
 }
@@ -668,8 +846,7 @@ static int _task_write(eio_obj_t *obj, list_t *objs)
 			return SLURM_SUCCESS;
 		}
 		if (in->msg->length == 0) { /* eof message */
-			close(obj->fd);
-			obj->fd = -1;
+			eio_obj_close_fd(obj);
 			_free_incoming_msg(in->msg);
 			in->msg = NULL;
 			return SLURM_SUCCESS;
@@ -688,8 +865,7 @@ again:
 		else if (errno == EAGAIN || errno == EWOULDBLOCK)
 			return SLURM_SUCCESS;
 		else {
-			close(obj->fd);
-			obj->fd = -1;
+			eio_obj_close_fd(obj);
 			_free_incoming_msg(in->msg);
 			in->msg = NULL;
 			return SLURM_ERROR;
@@ -781,6 +957,8 @@ again:
 		if (rc <= 0) {  /* got eof */
 			debug5("  got eof on task");
 			out->eof = true;
+		} else {
+			io_stats.task_bytes += rc;
 		}
 	}
 
@@ -1333,6 +1511,7 @@ static int _send_connection_okay_response(void)
 		xassert(client->magic == CLIENT_IO_MAGIC);
 		list_enqueue(client->msg_queue, msg);
 		msg->ref_count++;
+		eio_obj_touch(eio);
 	}
 	list_iterator_destroy(clients);
 
@@ -1389,6 +1568,8 @@ _route_msg_task_to_client(eio_obj_t *obj)
 		msg = _task_build_message(out, out->buf);
 		if (msg == NULL)
 			return;
+		/* Room was made in the cbuf */
+		eio_obj_touch(obj);
 
 		/* Add message to the msg_queue of all clients */
 		clients = list_iterator_create(step->clients);
@@ -1413,6 +1594,7 @@ _route_msg_task_to_client(eio_obj_t *obj)
 			xassert(client->magic == CLIENT_IO_MAGIC);
 			list_enqueue(client->msg_queue, msg);
 			msg->ref_count++;
+			eio_obj_touch(eio);
 		}
 		list_iterator_destroy(clients);
 
@@ -1423,15 +1605,37 @@ _route_msg_task_to_client(eio_obj_t *obj)
 	}
 }
 
+static int _touch_obj(void *x, void *arg)
+{
+	eio_obj_touch(x);
+	return 0;
+}
+
+/* Clients stop reading stdin while no incoming buffer is free */
+static void _put_incoming_buf(struct io_buf *msg)
+{
+	list_enqueue(step->free_incoming, msg);
+	if (list_count(step->free_incoming) == 1)
+		list_for_each(step->clients, _touch_obj, NULL);
+}
+
+/* Tree links stop reading while no outgoing buffer is free */
+static void _put_outgoing_buf(struct io_buf *msg)
+{
+	list_enqueue(step->free_outgoing, msg);
+	if ((list_count(step->free_outgoing) == 1) && io_tree.links) {
+		for (int i = 0; i < io_tree.child_cnt; i++)
+			if (io_tree.links[i])
+				eio_obj_touch(io_tree.links[i]);
+	}
+}
+
 static void _free_incoming_msg(struct io_buf *msg)
 {
 	msg->ref_count--;
 	if (msg->ref_count == 0) {
 		/* Put the message back on the free list */
-		list_enqueue(step->free_incoming, msg);
-
-		/* Kick the event IO engine */
-		eio_signal_wakeup(step->eio);
+		_put_incoming_buf(msg);
 	}
 }
 
@@ -1442,7 +1646,7 @@ static void _free_outgoing_msg(struct io_buf *msg)
 	msg->ref_count--;
 	if (msg->ref_count == 0) {
 		/* Put the message back on the free list */
-		list_enqueue(step->free_outgoing, msg);
+		_put_outgoing_buf(msg);
 
 		/* Try packing messages from tasks' output cbufs */
 		if (step->task == NULL)
@@ -1459,8 +1663,6 @@ static void _free_outgoing_msg(struct io_buf *msg)
 					break;
 			}
 		}
-		/* Kick the event IO engine */
-		eio_signal_wakeup(step->eio);
 	}
 }
 
@@ -1545,6 +1747,872 @@ extern void io_close_local_fds(void)
 	list_iterator_destroy(clients);
 }
 
+/**********************************************************************
+ * I/O tree functions (LAUNCH_IO_TREE)
+ **********************************************************************/
+/* Pack header into msg, followed by header->length bytes of body */
+static void _tree_pack_msg(struct io_buf *msg, io_hdr_t *header, void *body)
+{
+	buf_t *packbuf = create_buf(msg->data, IO_HDR_PACKET_BYTES);
+
+	io_hdr_pack(header, packbuf);
+	/* free packbuf, but not the memory to which it points */
+	packbuf->head = NULL;
+	FREE_NULL_BUFFER(packbuf);
+
+	if (body && header->length)
+		memcpy(msg->data + IO_HDR_PACKET_BYTES, body, header->length);
+	msg->length = IO_HDR_PACKET_BYTES + header->length;
+}
+
+/* Queue a message of the relayed subtree on the connection to srun */
+static void _tree_send_upstream(struct io_buf *msg)
+{
+	struct client_io_info *client = NULL;
+
+	if (io_tree.upstream)
+		client = io_tree.upstream->arg;
+
+	msg->ref_count = 1;
+	if (!client || client->out_eof || !client->msg_queue) {
+		_free_outgoing_msg(msg);
+		return;
+	}
+	list_enqueue(client->msg_queue, msg);
+	eio_obj_touch(io_tree.upstream);
+}
+
+/* Build a message of our own for srun, even if out of free buffers */
+static void _tree_send(io_hdr_type_t type, void *body, uint32_t length)
+{
+	io_hdr_t header = { .type = type, .length = length };
+	struct io_buf *msg;
+
+	if (_outgoing_buf_free())
+		msg = list_dequeue(step->free_outgoing);
+	else
+		msg = _alloc_io_buf();
+	_tree_pack_msg(msg, &header, body);
+	_tree_send_upstream(msg);
+}
+
+/* Tell srun that a node of the subtree is connected through us */
+static void _tree_send_node_init(io_init_msg_t *init)
+{
+	buf_t *buffer = init_buf(IO_NODE_INIT_BYTES);
+
+	io_node_init_pack(init, buffer);
+	_tree_send(SLURM_IO_NODE_INIT, get_buf_data(buffer),
+		   get_buf_offset(buffer));
+	FREE_NULL_BUFFER(buffer);
+}
+
+/* A child is connected or will send its stdio to srun directly */
+static void _tree_child_settled(int child)
+{
+	bool last;
+
+	slurm_mutex_lock(&step->io_mutex);
+	last = !--io_tree.pending;
+	slurm_cond_broadcast(&step->io_cond);
+	slurm_mutex_unlock(&step->io_mutex);
+
+	/*
+	 * srun keeps the step I/O open for an extra stdout stream we announce
+	 * in our init message, until the NODE_INIT of every connected child
+	 * is queued ahead of this eof.
+	 */
+	if (last)
+		_tree_send(SLURM_IO_STDOUT, NULL, 0);
+}
+
+/* Start relaying a child the tree thread did the handshake with */
+static void _tree_link_create(void *conn, int child, io_init_msg_t *init)
+{
+	struct tree_link_info *link;
+	eio_obj_t *obj;
+	int fd = conn_g_get_fd(conn);
+
+	fd_set_nonblocking(fd);
+	net_set_keep_alive(fd);
+
+	link = xmalloc(sizeof(*link));
+	link->magic = TREE_LINK_MAGIC;
+	link->child = child;
+	link->msg_queue = list_create(NULL);
+	link->stdout_objs = init->stdout_objs;
+	link->stderr_objs = init->stderr_objs;
+
+	obj = eio_obj_create(fd, &tree_link_ops, link);
+	obj->conn = conn;
+	io_tree.links[child] = obj;
+	eio_new_obj(step->eio, obj);
+
+	slurm_mutex_lock(&step->io_mutex);
+	io_tree.open++;
+	slurm_mutex_unlock(&step->io_mutex);
+
+	_tree_send_node_init(init);
+	debug("%s: relaying I/O of node rank %u", __func__, init->nodeid);
+}
+
+static bool _tree_notify_readable(eio_obj_t *obj)
+{
+	return (obj->fd >= 0);
+}
+
+/* Relay the children settled by the tree thread, in the order it did */
+static int _tree_notify_read(eio_obj_t *obj, list_t *objs)
+{
+	tree_settled_t *settled;
+	char buf[64];
+	ssize_t n;
+
+	while (((n = read(obj->fd, buf, sizeof(buf))) < 0) && (errno == EINTR))
+		;
+	if (!n) {
+		debug2("%s: all children answered", __func__);
+		eio_obj_close_fd(obj);
+	} else if ((n < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+		error("%s: read: %m", __func__);
+		eio_obj_close_fd(obj);
+	}
+
+	while ((settled = list_dequeue(io_tree.settled))) {
+		if (settled->conn)
+			_tree_link_create(settled->conn, settled->child,
+					  &settled->init);
+		_tree_child_settled(settled->child);
+		xfree(settled);
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/* Hand a child answered by the tree thread over to the I/O thread */
+static void _tree_settle(int child, void *conn, io_init_msg_t *init)
+{
+	tree_settled_t *settled = xmalloc(sizeof(*settled));
+	char c = 0;
+
+	io_tree.answered[child] = true;
+
+	settled->child = child;
+	settled->conn = conn;
+	if (init)
+		settled->init = *init;
+	list_enqueue(io_tree.settled, settled);
+
+	safe_write(io_tree.notify_fd[1], &c, sizeof(c));
+	return;
+rwfail:
+	error("%s: unable to notify the I/O thread: %m", __func__);
+}
+
+static bool _tree_stopping(void)
+{
+	bool stop;
+
+	slurm_mutex_lock(&step->io_mutex);
+	stop = io_tree.stop;
+	slurm_mutex_unlock(&step->io_mutex);
+
+	return stop;
+}
+
+/*
+ * Seconds a child may take to answer: MessageTimeout, but never past the
+ * deadline so that a stuck child cannot hold up the others or io_tree_wait()
+ */
+static int _tree_time_left(void)
+{
+	int left = io_tree.deadline - time(NULL);
+
+	return MAX(MIN(left, (int) slurm_conf.msg_timeout), 1);
+}
+
+/*
+ * Prove to a child that we belong to the step and check its answer.
+ * RET SLURM_SUCCESS with init filled in, or SLURM_ERROR and conn destroyed
+ */
+static int _tree_link_handshake(void *conn, int child, io_init_msg_t *init)
+{
+	srun_info_t *srun = list_peek(step->sruns);
+	io_init_msg_t msg = { 0 };
+	int fd = conn_g_get_fd(conn);
+
+	fd_set_blocking(fd);
+
+	msg.io_key = srun->key;
+	msg.nodeid = step->nodeid;
+	msg.version = srun->protocol_version;
+	if (io_init_msg_write_to_fd(fd, conn, &msg)) {
+		error("%s: unable to send I/O init message to node rank %d",
+		      __func__, io_tree.ranks[child]);
+		conn_g_destroy(conn, true);
+		return SLURM_ERROR;
+	}
+
+	/* io_init_msg_read_from_fd() alone would wait up to 300 seconds */
+	if (wait_fd_readable(fd, _tree_time_left())) {
+		error("%s: no I/O init message from node rank %d",
+		      __func__, io_tree.ranks[child]);
+		conn_g_destroy(conn, true);
+		return SLURM_ERROR;
+	}
+
+	if (io_init_msg_read_from_fd(fd, conn, init) ||
+	    io_init_msg_validate(init, srun->key) ||
+	    (init->nodeid != io_tree.ranks[child])) {
+		error("%s: invalid I/O init message from node rank %d",
+		      __func__, io_tree.ranks[child]);
+		xfree(init->io_key);
+		conn_g_destroy(conn, true);
+		return SLURM_ERROR;
+	}
+	xfree(init->io_key);
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Handle a relay request forwarded by slurmd: sender uid and length followed
+ * by the node rank, port and node name of the child. Connect back to the
+ * child, and close that connection right away if refuse is set so that the
+ * child falls back to srun.
+ * RET false once no more requests are queued on the socket
+ */
+static bool _tree_accept_child(int lfd, bool refuse)
+{
+	uint32_t uid, len, nodeid;
+	uint16_t port;
+	char *data = NULL, *name = NULL;
+	buf_t *buffer = NULL;
+	io_init_msg_t init = { 0 };
+	slurm_addr_t addr;
+	void *conn = NULL;
+	int fd, child = -1;
+
+	if ((fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC)) < 0) {
+		if (errno == EINTR)
+			return true;
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+			error("%s: accept: %m", __func__);
+		return false;
+	}
+
+	if (wait_fd_readable(fd, _tree_time_left())) {
+		error("%s: relay request not received", __func__);
+		goto done;
+	}
+	safe_read(fd, &uid, sizeof(uid));
+	safe_read(fd, &len, sizeof(len));
+	uid = ntohl(uid);
+	len = ntohl(len);
+	if (len > BUF_SIZE) {
+		error("%s: relay request of %u bytes is too long",
+		      __func__, len);
+		goto done;
+	}
+	data = xmalloc(len);
+	safe_read(fd, data, len);
+	close(fd);
+	fd = -1;
+
+	if ((uid != step->uid) && (uid != 0) &&
+	    (uid != slurm_conf.slurm_user_id)) {
+		error("%s: relay request from uid %u rejected", __func__, uid);
+		goto done;
+	}
+
+	buffer = create_buf(data, len);
+	data = NULL;
+	safe_unpack32(&nodeid, buffer);
+	safe_unpack16(&port, buffer);
+	safe_unpackstr(&name, buffer);
+
+	for (int i = 0; i < io_tree.child_cnt; i++) {
+		if (io_tree.ranks[i] == nodeid) {
+			child = i;
+			break;
+		}
+	}
+	if ((child < 0) || io_tree.answered[child]) {
+		error("%s: unexpected relay request from node rank %u",
+		      __func__, nodeid);
+		goto done;
+	}
+
+	/* The io_key is only sent to the node of the step at that rank */
+	if (xstrcmp(name, io_tree.names[child])) {
+		error("%s: relay request for node rank %u from node %s, not %s",
+		      __func__, nodeid, name, io_tree.names[child]);
+		goto done;
+	}
+
+	if (slurm_conf_get_addr(io_tree.names[child], &addr, 0)) {
+		error("%s: unable to resolve address of node %s",
+		      __func__, io_tree.names[child]);
+	} else {
+		slurm_set_port(&addr, port);
+		if (!(conn = slurm_open_msg_conn(&addr, NULL))) {
+			error("%s: unable to connect to node %s: %m",
+			      __func__, io_tree.names[child]);
+		} else if (refuse) {
+			debug("%s: too late to relay I/O of node rank %u",
+			      __func__, nodeid);
+			conn_g_destroy(conn, true);
+			conn = NULL;
+		} else if (_tree_link_handshake(conn, child, &init)) {
+			conn = NULL;
+		}
+	}
+	_tree_settle(child, conn, (conn ? &init : NULL));
+	goto done;
+
+unpack_error:
+	error("%s: malformed relay request", __func__);
+	goto done;
+rwfail:
+	error("%s: unable to read relay request: %m", __func__);
+done:
+	if (fd >= 0)
+		close(fd);
+	xfree(data);
+	xfree(name);
+	FREE_NULL_BUFFER(buffer);
+	return true;
+}
+
+/*
+ * Children not connected by now send their stdio to srun directly. Once
+ * io_tree_wait() gave up, queued requests are left to time out on the child.
+ */
+static void _tree_give_up(int lfd)
+{
+	bool stop;
+
+	while (!(stop = _tree_stopping()) && _tree_accept_child(lfd, true))
+		;
+
+	for (int i = 0; i < io_tree.child_cnt; i++) {
+		if (io_tree.answered[i])
+			continue;
+		if (stop)
+			debug("%s: node rank %d did not ask to relay its I/O before the step I/O ended",
+			      __func__, io_tree.ranks[i]);
+		else
+				error("%s: node rank %d did not ask to relay its I/O within %d seconds",
+			      __func__, io_tree.ranks[i],
+			      REVERSE_TREE_CHILDREN_TIMEOUT);
+		_tree_settle(i, NULL, NULL);
+	}
+}
+
+static bool _tree_all_answered(void)
+{
+	for (int i = 0; i < io_tree.child_cnt; i++) {
+		if (!io_tree.answered[i])
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Answer the relay requests of the children until all of them asked or the
+ * deadline passed. Connecting back and the handshake block, so they are done
+ * here rather than in the I/O thread, each bounded by _tree_time_left().
+ */
+static void *_tree_accept_thr(void *arg)
+{
+	struct pollfd pfd = { .fd = io_tree.listen_fd, .events = POLLIN };
+	time_t now;
+
+	/* Check every second and between children if io_tree_wait() gave up */
+	while (!_tree_stopping() && !_tree_all_answered() &&
+	       ((now = time(NULL)) < io_tree.deadline)) {
+		if (poll(&pfd, 1, MIN(io_tree.deadline - now, 1) * 1000) > 0) {
+			while (!_tree_all_answered() && !_tree_stopping() &&
+			       _tree_accept_child(io_tree.listen_fd, false))
+				;
+		}
+	}
+
+	_tree_give_up(io_tree.listen_fd);
+	close(io_tree.listen_fd);
+	io_tree.listen_fd = -1;
+	/* The I/O thread stops watching the pipe once it is drained */
+	close(io_tree.notify_fd[1]);
+	io_tree.notify_fd[1] = -1;
+
+	return NULL;
+}
+
+/* Track the streams of the subtree still open, to close them on link loss */
+static void _tree_link_count(struct tree_link_info *link)
+{
+	io_init_msg_t init = { 0 };
+	buf_t *buffer;
+
+	if (link->header.type == SLURM_IO_NODE_INIT) {
+		buffer = create_buf(link->in_msg->data + IO_HDR_PACKET_BYTES,
+				    link->header.length);
+		if (!io_node_init_unpack(&init, buffer)) {
+			link->stdout_objs += init.stdout_objs;
+			link->stderr_objs += init.stderr_objs;
+		}
+		/* free the buffer structure, but not the memory it points to */
+		buffer->head = NULL;
+		FREE_NULL_BUFFER(buffer);
+	} else if (link->header.length) {
+		return;
+	} else if (link->header.type == SLURM_IO_STDOUT) {
+		link->stdout_objs--;
+	} else if (link->header.type == SLURM_IO_STDERR) {
+		link->stderr_objs--;
+	}
+}
+
+static void _tree_link_close(eio_obj_t *obj)
+{
+	struct tree_link_info *link = obj->arg;
+	struct io_buf *msg;
+
+	if (link->in_msg) {
+		_put_outgoing_buf(link->in_msg);
+		link->in_msg = NULL;
+	}
+	if (link->out_msg) {
+		_free_io_buf(link->out_msg);
+		link->out_msg = NULL;
+		_tree_stdin_sent();
+	}
+	while ((msg = list_dequeue(link->msg_queue))) {
+		_free_io_buf(msg);
+		_tree_stdin_sent();
+	}
+	link->in_eof = true;
+	link->out_eof = true;
+
+	/* Close the streams srun still expects from the subtree */
+	if ((link->stdout_objs > 0) || (link->stderr_objs > 0))
+		error("%s: lost I/O connection to node rank %d, output of its subtree may be incomplete",
+		      __func__, io_tree.ranks[link->child]);
+	for (; link->stdout_objs > 0; link->stdout_objs--)
+		_tree_send(SLURM_IO_STDOUT, NULL, 0);
+	for (; link->stderr_objs > 0; link->stderr_objs--)
+		_tree_send(SLURM_IO_STDERR, NULL, 0);
+
+	eio_obj_close_fd(obj);
+	conn_g_destroy(obj->conn, false);
+	obj->conn = NULL;
+
+	slurm_mutex_lock(&step->io_mutex);
+	io_tree.open--;
+	slurm_cond_broadcast(&step->io_cond);
+	slurm_mutex_unlock(&step->io_mutex);
+}
+
+static bool _tree_link_readable(eio_obj_t *obj)
+{
+	struct tree_link_info *link = obj->arg;
+
+	xassert(link->magic == TREE_LINK_MAGIC);
+
+	/* The subtree may outlive our own tasks, obj->shutdown is ignored */
+	if (link->in_eof)
+		return false;
+
+	return (link->in_msg || _outgoing_buf_free());
+}
+
+static int _tree_link_read(eio_obj_t *obj, list_t *objs)
+{
+	struct tree_link_info *link = obj->arg;
+	void *buf;
+	int n;
+
+	xassert(link->magic == TREE_LINK_MAGIC);
+
+	if (!link->in_msg) {
+		if (!_outgoing_buf_free())
+			return SLURM_SUCCESS;
+		n = io_hdr_read_fd(obj->fd, obj->conn, &link->header);
+		if (n <= 0) {
+			debug2("%s: eof from node rank %d",
+			       __func__, io_tree.ranks[link->child]);
+			_tree_link_close(obj);
+			return SLURM_SUCCESS;
+		}
+		if (link->header.length > SLURM_IO_MAX_MSG_LEN) {
+			error("%s: message length of %u from node rank %d exceeds maximum of %u",
+			      __func__, link->header.length,
+			      io_tree.ranks[link->child], SLURM_IO_MAX_MSG_LEN);
+			_tree_link_close(obj);
+			return SLURM_SUCCESS;
+		}
+		/* Relayed as is, header included */
+		link->in_msg = list_dequeue(step->free_outgoing);
+		_tree_pack_msg(link->in_msg, &link->header, NULL);
+		link->in_remaining = link->header.length;
+	}
+
+	if (link->in_remaining) {
+		buf = link->in_msg->data +
+			(link->in_msg->length - link->in_remaining);
+	again:
+		if (obj->conn)
+			n = conn_g_recv(obj->conn, buf, link->in_remaining);
+		else
+			n = read(obj->fd, buf, link->in_remaining);
+		if (n < 0) {
+			if (errno == EINTR)
+				goto again;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return SLURM_SUCCESS;
+			debug("%s: read from node rank %d: %m",
+			      __func__, io_tree.ranks[link->child]);
+		}
+		if (n <= 0) {
+			_tree_link_close(obj);
+			return SLURM_SUCCESS;
+		}
+		link->in_remaining -= n;
+		if (link->in_remaining)
+			return SLURM_SUCCESS;
+	}
+
+	_tree_link_count(link);
+	if (link->header.type == SLURM_IO_CONNECTION_TEST)
+		_put_outgoing_buf(link->in_msg);
+	else
+		_tree_send_upstream(link->in_msg);
+	link->in_msg = NULL;
+
+	return SLURM_SUCCESS;
+}
+
+static bool _tree_link_writable(eio_obj_t *obj)
+{
+	struct tree_link_info *link = obj->arg;
+
+	xassert(link->magic == TREE_LINK_MAGIC);
+
+	if (link->out_eof)
+		return false;
+
+	return (link->out_msg || !list_is_empty(link->msg_queue));
+}
+
+static int _tree_link_write(eio_obj_t *obj, list_t *objs)
+{
+	struct tree_link_info *link = obj->arg;
+	void *buf;
+	int n;
+
+	xassert(link->magic == TREE_LINK_MAGIC);
+
+	if (!link->out_msg) {
+		if (!(link->out_msg = list_dequeue(link->msg_queue)))
+			return SLURM_SUCCESS;
+		link->out_remaining = link->out_msg->length;
+	}
+
+	buf = link->out_msg->data +
+		(link->out_msg->length - link->out_remaining);
+again:
+	if (obj->conn)
+		n = conn_g_send(obj->conn, buf, link->out_remaining);
+	else
+		n = write(obj->fd, buf, link->out_remaining);
+	if (n < 0) {
+		if (errno == EINTR)
+			goto again;
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+			return SLURM_SUCCESS;
+		error("%s: write to node rank %d: %m",
+		      __func__, io_tree.ranks[link->child]);
+		_tree_link_close(obj);
+		return SLURM_SUCCESS;
+	}
+
+	link->out_remaining -= n;
+	if (link->out_remaining)
+		return SLURM_SUCCESS;
+
+	_free_io_buf(link->out_msg);
+	link->out_msg = NULL;
+	_tree_stdin_sent();
+
+	return SLURM_SUCCESS;
+}
+
+/* A stdin copy was written to a link or dropped */
+static void _tree_stdin_sent(void)
+{
+	/* Clients stop reading stdin while the queue is full */
+	if (io_tree.stdin_queued-- == STDIO_MAX_FREE_BUF)
+		list_for_each(step->clients, _touch_obj, NULL);
+}
+
+/* Queue a private copy of a stdin message from srun for a child link */
+static void _tree_queue_stdin(int child, io_hdr_t *header, struct io_buf *in)
+{
+	struct tree_link_info *link;
+	struct io_buf *msg;
+
+	if (!io_tree.links[child])
+		return;
+	link = io_tree.links[child]->arg;
+	if (link->out_eof)
+		return;
+
+	msg = _alloc_io_buf();
+	_tree_pack_msg(msg, header, in->data);
+	list_enqueue(link->msg_queue, msg);
+	io_tree.stdin_queued++;
+	eio_obj_touch(io_tree.links[child]);
+}
+
+/* Pass stdin on to the child whose subtree holds the destination task */
+static void _tree_route_stdin(io_hdr_t *header, struct io_buf *msg)
+{
+	uint32_t node;
+
+	if (header->type == SLURM_IO_ALLSTDIN) {
+		for (int i = 0; i < io_tree.child_cnt; i++)
+			_tree_queue_stdin(i, header, msg);
+		return;
+	}
+
+	if (!step->gtid_nodes || (header->gtaskid >= step->ntasks))
+		return;
+	node = step->gtid_nodes[header->gtaskid];
+	for (int i = 0; i < io_tree.child_cnt; i++) {
+		if ((node >= io_tree.ranks[i]) && (node <= io_tree.last[i])) {
+			_tree_queue_stdin(i, header, msg);
+			return;
+		}
+	}
+}
+
+/*
+ * Ask the parent in the reverse tree to relay our stdio: tell it through its
+ * slurmd which port we listen on and wait for it to connect back.
+ * RET connection to the parent, or NULL to connect to srun directly
+ */
+static void *_tree_connect_parent(srun_info_t *srun)
+{
+	char *addr_fmt = NULL, *nodelist = NULL;
+	io_init_msg_t msg = { 0 };
+	struct pollfd pfd;
+	slurm_addr_t addr;
+	uint16_t port = 0;
+	buf_t *buffer;
+	void *conn = NULL;
+	int lfd = -1, fd, rc = SLURM_ERROR;
+
+	if (net_stream_listen(&lfd, &port) < 0) {
+		error("%s: net_stream_listen: %m", __func__);
+		return NULL;
+	}
+
+	buffer = init_buf(0);
+	pack32(step->nodeid, buffer);
+	pack16(port, buffer);
+	packstr(step->node_name, buffer);
+
+	/* Formatted with the spool directory of the parent by its slurmd */
+	addr_fmt = xstrdup_printf(IO_TREE_SOCK_FMT, slurm_conf.slurmd_spooldir,
+				  step->step_id.job_id, step->step_id.step_id);
+	for (int i = 0; i < REVERSE_TREE_PARENT_RETRY; i++) {
+		if (i)
+			sleep(1);
+		nodelist = xstrdup(step_complete.parent_name);
+		rc = slurm_forward_data(&nodelist, addr_fmt,
+					get_buf_offset(buffer),
+					get_buf_data(buffer));
+		xfree(nodelist);
+		if (rc == SLURM_SUCCESS)
+			break;
+	}
+	xfree(addr_fmt);
+	FREE_NULL_BUFFER(buffer);
+	if (rc != SLURM_SUCCESS) {
+		debug("%s: parent %s does not relay I/O: %s",
+		      __func__, step_complete.parent_name, slurm_strerror(rc));
+		goto fail;
+	}
+
+	/*
+	 * The parent connects back as soon as it reads our request, or closes
+	 * the connection right away once past its deadline. Its deadline
+	 * started before the socket we reached existed, so it passes within
+	 * REVERSE_TREE_CHILDREN_TIMEOUT, plus the time the parent may need to
+	 * connect to us.
+	 */
+	pfd.fd = lfd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, (REVERSE_TREE_CHILDREN_TIMEOUT +
+			   slurm_conf.msg_timeout) * 1000) != 1) {
+		error("%s: parent %s did not connect to relay I/O",
+		      __func__, step_complete.parent_name);
+		goto fail;
+	}
+	if (!(conn = slurm_accept_msg_conn(lfd, &addr))) {
+		error("%s: accept: %m", __func__);
+		goto fail;
+	}
+	fd = conn_g_get_fd(conn);
+	fd_set_blocking(fd);
+
+	if (io_init_msg_read_from_fd(fd, conn, &msg) ||
+	    io_init_msg_validate(&msg, srun->key) ||
+	    (msg.nodeid != step_complete.parent_rank)) {
+		debug("%s: no valid I/O relay connection from %pA",
+		      __func__, &addr);
+		goto fail;
+	}
+	if (_send_io_init_msg(fd, conn, srun, true))
+		goto fail;
+
+	debug("%s: I/O relayed by node rank %d (%s)", __func__,
+	      step_complete.parent_rank, step_complete.parent_name);
+	xfree(msg.io_key);
+	close(lfd);
+	return conn;
+
+fail:
+	xfree(msg.io_key);
+	if (conn)
+		conn_g_destroy(conn, true);
+	close(lfd);
+	return NULL;
+}
+
+extern void io_tree_init(void)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	int parent, descendants, depth, max_depth, fd = -1;
+	hostlist_t *hl = NULL;
+	char *spool, *name;
+
+	if (!(step->flags & LAUNCH_IO_TREE) || (step_complete.children <= 0))
+		return;
+	if (step_complete.rank != step->nodeid) {
+		error("%s: tree rank %d is not node rank %u, not relaying I/O",
+		      __func__, step_complete.rank, step->nodeid);
+		return;
+	}
+
+	io_tree.ranks = xcalloc(REVERSE_TREE_WIDTH, sizeof(int));
+	io_tree.child_cnt = reverse_tree_direct_children(
+		step_complete.rank, step->nnodes, REVERSE_TREE_WIDTH,
+		step_complete.depth, io_tree.ranks);
+	if (io_tree.child_cnt <= 0)
+		goto fail;
+	io_tree.last = xcalloc(io_tree.child_cnt, sizeof(int));
+	io_tree.names = xcalloc(io_tree.child_cnt, sizeof(char *));
+	hl = hostlist_create(step->msg->complete_nodelist);
+	for (int i = 0; i < io_tree.child_cnt; i++) {
+		reverse_tree_info(io_tree.ranks[i], step->nnodes,
+				  REVERSE_TREE_WIDTH, &parent, &descendants,
+				  &depth, &max_depth);
+		io_tree.last[i] = io_tree.ranks[i] + descendants;
+		/* Relay requests must come from the node at that rank */
+		if (!(name = hostlist_nth(hl, io_tree.ranks[i]))) {
+			error("%s: no node rank %d in %s", __func__,
+			      io_tree.ranks[i], step->msg->complete_nodelist);
+			goto fail;
+		}
+		io_tree.names[i] = xstrdup(name);
+		free(name);
+	}
+	FREE_NULL_HOSTLIST(hl);
+
+	spool = slurm_conf_expand_slurmd_path(slurm_conf.slurmd_spooldir,
+					      step->node_name,
+					      step->node_name);
+	xstrfmtcat(io_tree.sock_path, IO_TREE_SOCK_FMT, spool,
+		   step->step_id.job_id, step->step_id.step_id);
+	xfree(spool);
+	if (strlen(io_tree.sock_path) >= sizeof(sa.sun_path)) {
+		error("%s: Unix socket path '%s' is too long",
+		      __func__, io_tree.sock_path);
+		goto fail;
+	}
+	strlcpy(sa.sun_path, io_tree.sock_path, sizeof(sa.sun_path));
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+		error("%s: socket: %m", __func__);
+		goto fail;
+	}
+	unlink(sa.sun_path);	/* remove possible old socket */
+	if (bind(fd, (struct sockaddr *) &sa, SUN_LEN(&sa)) < 0) {
+		error("%s: bind %s: %m", __func__, sa.sun_path);
+		goto fail;
+	}
+	/* slurmd connects as the user the child stepd runs as */
+	if (chown(sa.sun_path, step->uid, -1) < 0) {
+		error("%s: chown %s: %m", __func__, sa.sun_path);
+		goto fail;
+	}
+	if (listen(fd, SLURM_DEFAULT_LISTEN_BACKLOG) < 0) {
+		error("%s: listen %s: %m", __func__, sa.sun_path);
+		goto fail;
+	}
+	fd_set_nonblocking(fd);
+
+	if (pipe2(io_tree.notify_fd, O_CLOEXEC) < 0) {
+		error("%s: pipe: %m", __func__);
+		goto fail;
+	}
+	fd_set_nonblocking(io_tree.notify_fd[0]);
+
+	io_tree.listen_fd = fd;
+	io_tree.links = xcalloc(io_tree.child_cnt, sizeof(eio_obj_t *));
+	io_tree.answered = xcalloc(io_tree.child_cnt, sizeof(bool));
+	io_tree.settled = list_create(xfree_ptr);
+	io_tree.pending = io_tree.child_cnt;
+	io_tree.deadline = time(NULL) + REVERSE_TREE_CHILDREN_TIMEOUT;
+	eio_new_initial_obj(step->eio, eio_obj_create(io_tree.notify_fd[0],
+						      &tree_notify_ops, NULL));
+	slurm_thread_create(&io_tree.thread, _tree_accept_thr, NULL);
+	debug("%s: relaying I/O of %d children (%d nodes) on %s", __func__,
+	      io_tree.child_cnt, step_complete.children, io_tree.sock_path);
+	return;
+
+fail:
+	if (fd >= 0) {
+		close(fd);
+		unlink(sa.sun_path);
+	}
+	FREE_NULL_HOSTLIST(hl);
+	for (int i = 0; io_tree.names && (i < io_tree.child_cnt); i++)
+		xfree(io_tree.names[i]);
+	xfree(io_tree.names);
+	xfree(io_tree.ranks);
+	xfree(io_tree.last);
+	xfree(io_tree.sock_path);
+	io_tree.child_cnt = 0;
+}
+
+extern void io_tree_wait(void)
+{
+	if (!io_tree.child_cnt)
+		return;
+
+	slurm_mutex_lock(&step->io_mutex);
+	while (step->io_running && (io_tree.pending || io_tree.open))
+		slurm_cond_wait(&step->io_cond, &step->io_mutex);
+	io_tree.stop = true;
+	slurm_mutex_unlock(&step->io_mutex);
+
+	slurm_thread_join(io_tree.thread);
+	/* Late requests now fail and those children connect to srun */
+	unlink(io_tree.sock_path);
+}
+
 static void *_io_thr(void *ignored)
 {
 	int rc;
@@ -1552,6 +2620,10 @@ static void *_io_thr(void *ignored)
 	debug("IO handler started pid=%lu", (unsigned long) getpid());
 	rc = eio_handle_mainloop(step->eio);
 	debug("IO handler exited, rc=%d", rc);
+	debug("IO stats: read %"PRIu64" bytes from tasks, %"PRIu64" copies of %"PRIu64" bytes into messages, %"PRIu64" bytes in %"PRIu64" writes to clients, %"PRIu64" bytes in %"PRIu64" messages to local files",
+	      io_stats.task_bytes, io_stats.copies, io_stats.copy_bytes,
+	      io_stats.client_bytes, io_stats.client_writes,
+	      io_stats.file_bytes, io_stats.file_writes);
 	slurm_mutex_lock(&step->io_mutex);
 	step->io_running = false;
 	slurm_cond_broadcast(&step->io_cond);
@@ -1631,20 +2703,26 @@ extern int io_initial_client_connect(srun_info_t *srun, int stdout_tasks,
 		debug4("connecting IO back to %pA", &srun->ioaddr);
 	}
 
-	if (!(conn = slurm_open_msg_conn(&srun->ioaddr, srun->tls_cert))) {
+	if ((step->flags & LAUNCH_IO_TREE) &&
+	    (step_complete.parent_rank >= 0) &&
+	    (step_complete.rank == step->nodeid) &&
+	    (conn = _tree_connect_parent(srun))) {
+		sock = conn_g_get_fd(conn);
+	} else if (!(conn = slurm_open_msg_conn(&srun->ioaddr,
+						srun->tls_cert))) {
 		error("connect io: %m");
 		/* XXX retry or silently fail?
 		 *     fail for now.
 		 */
 		return SLURM_ERROR;
-	}
+	} else {
+		sock = conn_g_get_fd(conn);
 
-	sock = conn_g_get_fd(conn);
+		fd_set_blocking(sock);  /* just in case... */
+		_send_io_init_msg(sock, conn, srun, true);
 
-	fd_set_blocking(sock);  /* just in case... */
-	_send_io_init_msg(sock, conn, srun, true);
-
-	debug5("  back from _send_io_init_msg");
+		debug5("  back from _send_io_init_msg");
+	}
 	fd_set_nonblocking(sock);
 
 	/* Now set up the eio object */
@@ -1662,6 +2740,8 @@ extern int io_initial_client_connect(srun_info_t *srun, int stdout_tasks,
 	obj->conn = conn;
 	list_append(step->clients, (void *)obj);
 	eio_new_initial_obj(step->eio, (void *)obj);
+	if (io_tree.child_cnt)
+		io_tree.upstream = obj;
 	debug5("Now handling %d IO Client object(s)",
 	       list_count(step->clients));
 
@@ -1749,6 +2829,10 @@ static int _send_io_init_msg(int sock, void *conn, srun_info_t *srun, bool init)
 	else
 		msg.stderr_objs = list_count(step->stderr_eio_objs);
 
+	/* Released once every child is connected, see _tree_child_settled() */
+	if (init && io_tree.child_cnt)
+		msg.stdout_objs++;
+
 	if (io_init_msg_write_to_fd(sock, conn, &msg) != SLURM_SUCCESS) {
 		error("Couldn't sent slurm_io_init_msg");
 		xfree(msg.io_key);
@@ -1844,6 +2928,7 @@ _send_eof_msg(struct task_read_info *out)
 		/* Send eof message to all clients */
 		list_enqueue(client->msg_queue, msg);
 		msg->ref_count++;
+		eio_obj_touch(eio);
 	}
 	list_iterator_destroy(clients);
 	if (msg->ref_count == 0)
@@ -1899,11 +2984,14 @@ static struct io_buf *_task_build_message(struct task_read_info *out,
 		if (n == 0) {
 			debug5("  partial line in buffer, ignoring");
 			debug4("Leaving  _task_build_message");
-			list_enqueue(step->free_outgoing, msg);
+			_put_outgoing_buf(msg);
 			return NULL;
 		}
 	}
 
+	io_stats.copies++;
+	io_stats.copy_bytes += n;
+
 	header.type = out->type;
 	header.ltaskid = out->ltaskid;
 	header.gtaskid = out->gtaskid;
@@ -77,6 +77,20 @@ extern int io_initial_client_connect(srun_info_t *srun, int stdout_tasks,
  */
 extern int io_client_connect(srun_info_t *srun);
 
+/*
+ * With LAUNCH_IO_TREE, listen for the children of this node in the reverse
+ * tree that want their stdio relayed to srun through us. Their requests are
+ * answered by a thread of their own. Must be called with privileges, before
+ * io_initial_client_connect().
+ */
+extern void io_tree_init(void);
+
+/*
+ * Wait until the I/O relayed for the children of this node is done, before
+ * io_close_all(), and stop answering their requests. Needs privileges.
+ */
+extern void io_tree_wait(void);
+
 /*
  * Open a local file and create and eio object for files written
  * from the slurmstepd, probably with labelled output.
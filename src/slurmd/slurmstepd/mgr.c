@@ -426,6 +426,10 @@ static int _setup_normal_io(void)
 
 	debug2("Entering _setup_normal_io");
 
+	/* Binds a socket in the spool directory, needs privileges */
+	if (!step->batch)
+		io_tree_init();
+
 	/*
 	 * Temporarily drop permissions, initialize task stdio file
 	 * descriptors (which may be connected to files), then
@@ -2687,6 +2691,7 @@ static void _wait_for_all_tasks(void)
 static void _wait_for_io(void)
 {
 	debug("Waiting for IO");
+	io_tree_wait();
 	io_close_all();
 
 	slurm_mutex_lock(&step->io_mutex);
@@ -629,6 +629,7 @@ extern void stepd_cleanup(slurm_msg_t *msg, slurm_addr_t *cli, int rc,
 	xfree(conf->spooldir);
 	xfree(conf->stepd_loc);
 	xfree(conf->cpu_spec_list);
+	xfree(conf->spec_mac_cpus);
 	xfree(conf);
 #endif
 	cleanup = true;
@@ -1131,6 +1132,9 @@ _init_from_slurmd(int sock, char **argv, slurm_addr_t **_cli,
 	    (topology_g_init() != SLURM_SUCCESS))
 		fatal("Couldn't load all plugins");
 
+	if (xstrcasestr(slurm_conf.job_acct_gather_params, "LowJitterPoll"))
+		acct_gather_set_low_jitter(conf->spec_mac_cpus);
+
 	/*
 	 * Receive all secondary conf files from the slurmd.
 	 */
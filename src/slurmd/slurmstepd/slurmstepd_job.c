@@ -273,6 +273,17 @@ extern int stepd_step_rec_create(launch_tasks_request_msg_t *msg,
 	step->task_cnts  = xcalloc(msg->nnodes, sizeof(uint16_t));
 	memcpy(step->task_cnts, msg->tasks_to_launch,
 	       sizeof(uint16_t) * msg->nnodes);
+	if (msg->flags & LAUNCH_IO_TREE) {
+		step->gtid_nodes = xcalloc(msg->ntasks, sizeof(uint32_t));
+		for (i = 0; i < msg->nnodes; i++) {
+			for (int j = 0; j < msg->tasks_to_launch[i]; j++) {
+				uint32_t gtid = msg->global_task_ids[i][j];
+
+				if (gtid < msg->ntasks)
+					step->gtid_nodes[gtid] = i;
+			}
+		}
+	}
 	step->ntasks	= msg->ntasks;
 	memcpy(&step->step_id, &msg->step_id, sizeof(step->step_id));
 
@@ -369,6 +380,7 @@ extern int stepd_step_rec_create(launch_tasks_request_msg_t *msg,
 	}
 
 	step->eio     = eio_handle_create(0);
+	eio_handle_use_epoll(step->eio);
 	step->sruns   = list_create((ListDelF) _srun_info_destructor);
 
 	/*
@@ -560,6 +572,7 @@ extern int batch_stepd_step_rec_create(batch_job_launch_msg_t *msg)
 
 	step->env = slurm_char_array_copy(msg->envc, msg->environment);
 	step->eio     = eio_handle_create(0);
+	eio_handle_use_epoll(step->eio);
 	step->sruns   = list_create((ListDelF) _srun_info_destructor);
 	step->envtp   = xmalloc(sizeof(env_t));
 	step->envtp->jobid = -1;
@@ -689,6 +702,7 @@ extern void stepd_step_rec_destroy(void)
 	xfree(step->node_list);
 	xfree(step->step_alloc_cores);
 	xfree(step->task_cnts);
+	xfree(step->gtid_nodes);
 	xfree(step->tres_bind);
 	xfree(step->tres_freq);
 	xfree(step->user_name);
@@ -151,6 +151,7 @@ typedef struct {
 	uint32_t     **het_job_tids;       /* Task IDs on each node of hetjob */
 	uint32_t      *het_job_tid_offsets;/* map of tasks (by id) to originating hetjob*/
 	uint16_t      *task_cnts;  /* Number of tasks on each node in job   */
+	uint32_t      *gtid_nodes; /* node of each task, for LAUNCH_IO_TREE */
 	uint32_t       cpus_per_task;	/* number of cpus desired per task  */
 	uint32_t       debug;  /* debug level for job slurmd                */
 	uint64_t       job_mem;  /* MB of memory reserved for the job       */
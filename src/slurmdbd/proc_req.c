@@ -38,6 +38,7 @@
 
 #include "config.h"
 
+#include <limits.h>
 #include <signal.h>
 
 #if HAVE_SYS_PRCTL_H
@@ -74,9 +75,13 @@ static bool _validate_slurm_user(slurmdbd_conn_t *dbd_conn);
 static bool _validate_super_user(slurmdbd_conn_t *dbd_conn);
 static bool _validate_operator(slurmdbd_conn_t *dbd_conn);
 static int   _find_rpc_obj_in_list(void *x, void *key);
-static void _process_job_start(slurmdbd_conn_t *slurmdbd_conn,
+static void _process_job_start(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
 			       dbd_job_start_msg_t *job_start_msg,
 			       dbd_id_rc_msg_t *id_rc_msg);
+static int _step_complete(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
+			  persist_msg_t *msg, buf_t **out_buffer);
+static int _step_start(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
+		       persist_msg_t *msg, buf_t **out_buffer);
 
 static char *_internal_rc_to_str(uint32_t rc, slurmdbd_conn_t *dbd_conn,
 				 bool new_line)
@@ -175,6 +180,18 @@ static bool _validate_operator(slurmdbd_conn_t *dbd_conn)
 	return false;
 }
 
+/*
+ * If we are dealing with the slurmctld do the commit (SUCCESS or NOT) after
+ * each RPC since we do transactions for performance reasons.
+ * (don't ever use autocommit with innodb)
+ */
+static bool _commit_after_rpc(slurmdbd_conn_t *dbd_conn, persist_msg_t *msg)
+{
+	return (dbd_conn->pcon->rem_port &&
+		(!slurmdbd_conf->commit_delay ||
+		 (msg->msg_type == DBD_REGISTER_CTLD)));
+}
+
 static void _add_registered_cluster(slurmdbd_conn_t *dbd_conn)
 {
 	list_itr_t *itr;
@@ -1074,6 +1091,39 @@ static int _get_instances(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	return rc;
 }
 
+typedef struct {
+	list_t *held_part;
+	slurmdbd_conn_t *slurmdbd_conn;
+} jobs_part_args_t;
+
+/*
+ * Send the part held back from last time and hold back this one, so the last
+ * part can go out as the DBD_GOT_JOBS reply that ends the stream.
+ */
+static int _send_jobs_part(list_t *job_list, void *arg)
+{
+	jobs_part_args_t *args = arg;
+	persist_conn_t *pcon = args->slurmdbd_conn->pcon;
+	dbd_list_msg_t list_msg = { NULL };
+	buf_t *buffer;
+	int rc = SLURM_SUCCESS;
+
+	if (list_count(args->held_part)) {
+		list_msg.my_list = args->held_part;
+		buffer = init_buf(1024);
+		pack16((uint16_t) DBD_GOT_JOBS_PART, buffer);
+		slurmdbd_pack_list_msg(&list_msg, pcon->version,
+				       DBD_GOT_JOBS_PART, buffer);
+		rc = slurm_persist_send_msg(pcon, buffer);
+		FREE_NULL_BUFFER(buffer);
+		list_flush(args->held_part);
+	}
+
+	list_transfer(args->held_part, job_list);
+
+	return rc;
+}
+
 static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 			  buf_t **out_buffer)
 {
@@ -1117,9 +1167,21 @@ static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 		}
 	}
 
-	list_msg.my_list = jobacct_storage_g_get_jobs_cond(
-		slurmdbd_conn->db_conn, slurmdbd_conn->pcon->auth_uid,
-		job_cond);
+	if ((job_cond->flags & JOBCOND_FLAG_STREAM) &&
+	    (slurmdbd_conn->pcon->version >= SLURM_26_05_PROTOCOL_VERSION)) {
+		jobs_part_args_t args = {
+			.held_part = list_create(slurmdb_destroy_job_rec),
+			.slurmdbd_conn = slurmdbd_conn,
+		};
+
+		errno = jobacct_storage_g_get_jobs_cond_cb(
+			slurmdbd_conn->db_conn, slurmdbd_conn->pcon->auth_uid,
+			job_cond, _send_jobs_part, &args);
+		list_msg.my_list = args.held_part;
+	} else
+		list_msg.my_list = jobacct_storage_g_get_jobs_cond(
+			slurmdbd_conn->db_conn, slurmdbd_conn->pcon->auth_uid,
+			job_cond);
 
 	if (!errno) {
 		if (!list_msg.my_list)
@@ -1520,8 +1582,8 @@ static int _fini_conn(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 
 }
 
-static int _job_complete(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
-			 buf_t **out_buffer)
+static int _job_complete(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
+			 persist_msg_t *msg, buf_t **out_buffer)
 {
 	dbd_job_comp_msg_t *job_comp_msg = msg->data;
 	job_record_t job;
@@ -1569,7 +1631,7 @@ static int _job_complete(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	} else
 		debug2("DBD_JOB_COMPLETE: ID:%u", job_comp_msg->job_id);
 
-	rc = jobacct_storage_g_job_complete(slurmdbd_conn->db_conn, &job);
+	rc = jobacct_storage_g_job_complete(db_conn, &job);
 
 	if (rc && errno == 740) /* meaning data is already there */
 		rc = SLURM_SUCCESS;
@@ -1581,7 +1643,7 @@ static int _job_complete(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 		debug3("DBD_JOB_COMPLETE: cluster not registered");
 		slurmdbd_conn->pcon->rem_port =
 			clusteracct_storage_g_register_disconn_ctld(
-				slurmdbd_conn->db_conn,
+				db_conn,
 				slurmdbd_conn->pcon->rem_host);
 
 		_add_registered_cluster(slurmdbd_conn);
@@ -1593,8 +1655,8 @@ end_it:
 	return SLURM_SUCCESS;
 }
 
-static int _job_start(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
-		      buf_t **out_buffer)
+static int _job_start(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
+		      persist_msg_t *msg, buf_t **out_buffer)
 {
 	dbd_job_start_msg_t *job_start_msg = msg->data;
 	dbd_id_rc_msg_t id_rc_msg;
@@ -1612,7 +1674,7 @@ static int _job_start(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 		return SLURM_ERROR;
 	}
 
-	_process_job_start(slurmdbd_conn, job_start_msg, &id_rc_msg);
+	_process_job_start(slurmdbd_conn, db_conn, job_start_msg, &id_rc_msg);
 
 	*out_buffer = init_buf(1024);
 	pack16((uint16_t) DBD_ID_RC, *out_buffer);
@@ -1669,8 +1731,8 @@ static int _job_heavy(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	return SLURM_SUCCESS;
 }
 
-static int _job_suspend(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
-			buf_t **out_buffer)
+static int _job_suspend(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
+			persist_msg_t *msg, buf_t **out_buffer)
 {
 	dbd_job_suspend_msg_t *job_suspend_msg = msg->data;
 	job_record_t job;
@@ -1704,7 +1766,7 @@ static int _job_suspend(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	job.suspend_time = job_suspend_msg->suspend_time;
 
 	job.details = &details;
-	rc = jobacct_storage_g_job_suspend(slurmdbd_conn->db_conn, &job);
+	rc = jobacct_storage_g_job_suspend(db_conn, &job);
 
 	if (rc && errno == 740) /* meaning data is already there */
 		rc = SLURM_SUCCESS;
@@ -2159,7 +2221,7 @@ end_it:
 	return SLURM_SUCCESS;
 }
 
-static void _process_job_start(slurmdbd_conn_t *slurmdbd_conn,
+static void _process_job_start(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
 			       dbd_job_start_msg_t *job_start_msg,
 			       dbd_id_rc_msg_t *id_rc_msg)
 {
@@ -2246,8 +2308,7 @@ static void _process_job_start(slurmdbd_conn_t *slurmdbd_conn,
 		       job_start_msg->job_id, job_start_msg->name,
 		       job.db_index);
 	}
-	id_rc_msg->return_code = jobacct_storage_g_job_start(
-		slurmdbd_conn->db_conn, &job);
+	id_rc_msg->return_code = jobacct_storage_g_job_start(db_conn, &job);
 	id_rc_msg->job_id = job.job_id;
 	id_rc_msg->flags = job.bit_flags;
 	id_rc_msg->db_index = job.db_index;
@@ -2262,7 +2323,7 @@ static void _process_job_start(slurmdbd_conn_t *slurmdbd_conn,
 		debug3("DBD_JOB_START: cluster not registered");
 		slurmdbd_conn->pcon->rem_port =
 			clusteracct_storage_g_register_disconn_ctld(
-				slurmdbd_conn->db_conn,
+				db_conn,
 				slurmdbd_conn->pcon->rem_host);
 
 		_add_registered_cluster(slurmdbd_conn);
@@ -2765,7 +2826,8 @@ static int _send_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
 	        id_rc_msg = xmalloc(sizeof(dbd_id_rc_msg_t));
 		list_append(list_msg.my_list, id_rc_msg);
 
-		_process_job_start(slurmdbd_conn, job_start_msg, id_rc_msg);
+		_process_job_start(slurmdbd_conn, slurmdbd_conn->db_conn,
+				   job_start_msg, id_rc_msg);
 	}
 	list_iterator_destroy(itr);
 	/* END_TIMER; */
@@ -2781,6 +2843,384 @@ static int _send_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
 	return SLURM_SUCCESS;
 }
 
+static void _add_rpc_stats(uint16_t msg_type, uint32_t uid, uint64_t usecs)
+{
+	slurmdb_rpc_obj_t *rpc_obj;
+
+	slurm_mutex_lock(&rpc_mutex);
+	if (!rpc_stats) {
+		slurm_mutex_unlock(&rpc_mutex);
+		return;
+	}
+
+	if (!(rpc_obj =
+		      list_find_first(rpc_stats->rpc_list,
+				      _find_rpc_obj_in_list, &msg_type))) {
+		rpc_obj = xmalloc(sizeof(slurmdb_rpc_obj_t));
+		rpc_obj->id = msg_type;
+		list_append(rpc_stats->rpc_list, rpc_obj);
+	}
+	rpc_obj->cnt++;
+	rpc_obj->time += usecs;
+
+	if (!(rpc_obj = list_find_first(rpc_stats->user_list,
+					_find_rpc_obj_in_list, &uid))) {
+		rpc_obj = xmalloc(sizeof(slurmdb_rpc_obj_t));
+		rpc_obj->id = uid;
+		list_append(rpc_stats->user_list, rpc_obj);
+	}
+	rpc_obj->cnt++;
+	rpc_obj->time += usecs;
+
+	slurm_mutex_unlock(&rpc_mutex);
+}
+
+/*
+ * Records a mult_msg_workers connection stores before committing them, so a
+ * row another connection waits on is not held for the whole batch.
+ */
+#define MULT_MSG_WORKER_COMMIT 1000
+
+typedef struct {
+	uint32_t job_id;
+	uint32_t key;
+} mult_msg_job_t;
+
+typedef struct {
+	int *cond_cnt;		/* workers still running */
+	pthread_cond_t *cond;
+	void *db_conn;		/* where the records are stored */
+	int fail_inx;		/* record that failed, -1 if none */
+	int first_lost;		/* first record of ours not committed */
+	pthread_mutex_t *lock;
+	persist_msg_t *msgs;	/* all the records of the batch */
+	int *recs;		/* ours, as indexes into msgs */
+	int rec_cnt;
+	buf_t **ret_bufs;	/* reply to each record of the batch */
+	slurmdbd_conn_t *slurmdbd_conn; /* connection of the slurmctld */
+} mult_msg_worker_t;
+
+static int _cmp_mult_msg_job(const void *a, const void *b)
+{
+	const mult_msg_job_t *job_a = a, *job_b = b;
+
+	if (job_a->job_id != job_b->job_id)
+		return (job_a->job_id < job_b->job_id) ? -1 : 1;
+	return 0;
+}
+
+/* RET true if msg is about a single job, whose ID is set in job_id */
+static bool _mult_msg_job_id(persist_msg_t *msg, uint32_t *job_id)
+{
+	switch (msg->msg_type) {
+	case DBD_JOB_COMPLETE:
+		*job_id = ((dbd_job_comp_msg_t *) msg->data)->job_id;
+		return true;
+	case DBD_JOB_START:
+		*job_id = ((dbd_job_start_msg_t *) msg->data)->job_id;
+		return true;
+	case DBD_JOB_SUSPEND:
+		*job_id = ((dbd_job_suspend_msg_t *) msg->data)->job_id;
+		return true;
+	case DBD_STEP_COMPLETE:
+		*job_id = ((dbd_step_comp_msg_t *) msg->data)->step_id.job_id;
+		return true;
+	case DBD_STEP_START:
+		*job_id =
+			((dbd_step_start_msg_t *) msg->data)->step_id.job_id;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Open the database connections of mult_msg_workers the first time */
+static int _get_mult_msg_conns(slurmdbd_conn_t *slurmdbd_conn, int cnt)
+{
+	int fd = conn_g_get_fd(slurmdbd_conn->pcon->conn);
+
+	if (slurmdbd_conn->mult_msg_conn_cnt >= cnt)
+		return SLURM_SUCCESS;
+
+	xrecalloc(slurmdbd_conn->mult_msg_conns, cnt, sizeof(void *));
+	while (slurmdbd_conn->mult_msg_conn_cnt < cnt) {
+		void *db_conn;
+
+		errno = 0;
+		db_conn = acct_storage_g_get_connection(
+			fd, NULL, true, slurmdbd_conn->pcon->cluster_name);
+		if (!db_conn || errno) {
+			error("CONN:%d Unable to open a connection for mult_msg_workers, storing records serially",
+			      fd);
+			acct_storage_g_close_connection(&db_conn);
+			return SLURM_ERROR;
+		}
+		slurmdbd_conn->mult_msg_conns[
+			slurmdbd_conn->mult_msg_conn_cnt++] = db_conn;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Store a job record on the database connection of a mult_msg_workers
+ * thread. Only records _mult_msg_job_id() knows are handed to the workers.
+ */
+static int _proc_mult_msg_job(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
+			      persist_msg_t *msg, buf_t **out_buffer)
+{
+	int rc = SLURM_ERROR;
+	DEF_TIMERS;
+
+	START_TIMER;
+	switch (msg->msg_type) {
+	case DBD_JOB_COMPLETE:
+		rc = _job_complete(slurmdbd_conn, db_conn, msg, out_buffer);
+		break;
+	case DBD_JOB_START:
+		rc = _job_start(slurmdbd_conn, db_conn, msg, out_buffer);
+		break;
+	case DBD_JOB_SUSPEND:
+		rc = _job_suspend(slurmdbd_conn, db_conn, msg, out_buffer);
+		break;
+	case DBD_STEP_COMPLETE:
+		rc = _step_complete(slurmdbd_conn, db_conn, msg, out_buffer);
+		break;
+	case DBD_STEP_START:
+		rc = _step_start(slurmdbd_conn, db_conn, msg, out_buffer);
+		break;
+	default:
+		xassert(false);
+		break;
+	}
+	END_TIMER;
+
+	_add_rpc_stats(msg->msg_type, slurmdbd_conn->pcon->auth_uid,
+		       DELTA_TIMER);
+
+	return rc;
+}
+
+/* Store the records of one worker in order, committing now and then */
+static void _run_mult_msg_worker(mult_msg_worker_t *worker)
+{
+	slurmdbd_conn_t *slurmdbd_conn = worker->slurmdbd_conn;
+	void *db_conn = worker->db_conn;
+	int committed = 0;
+
+	for (int i = 0; i < worker->rec_cnt; i++) {
+		int inx = worker->recs[i];
+		int rc;
+
+		if (db_conn == slurmdbd_conn->db_conn)
+			rc = proc_req(slurmdbd_conn, &worker->msgs[inx],
+				      &worker->ret_bufs[inx]);
+		else
+			rc = _proc_mult_msg_job(slurmdbd_conn, db_conn,
+						&worker->msgs[inx],
+						&worker->ret_bufs[inx]);
+
+		if ((rc != SLURM_SUCCESS) && (rc != SLURM_NO_CHANGE_IN_DATA)) {
+			worker->fail_inx = inx;
+			break;
+		}
+		if (((i + 1) % MULT_MSG_WORKER_COMMIT) &&
+		    ((i + 1) < worker->rec_cnt))
+			continue;
+		if (acct_storage_g_commit(db_conn, 1) != SLURM_SUCCESS)
+			break;
+		committed = i + 1;
+	}
+
+	if (committed < worker->rec_cnt) {
+		acct_storage_g_commit(db_conn, 0);
+		worker->first_lost = worker->recs[committed];
+	} else
+		worker->first_lost = INT_MAX;
+}
+
+static void *_mult_msg_worker(void *arg)
+{
+	mult_msg_worker_t *worker = arg;
+
+	_run_mult_msg_worker(worker);
+
+	slurm_mutex_lock(worker->lock);
+	(*worker->cond_cnt)--;
+	slurm_cond_signal(worker->cond);
+	slurm_mutex_unlock(worker->lock);
+
+	return NULL;
+}
+
+/*
+ * Store the records of a DBD_SEND_MULT_MSG on mult_msg_workers connections.
+ * Records about the same job (or job array or hetjob) go to the same
+ * connection in the order they came in, anything else is stored on the
+ * connection of the slurmctld before them. Every connection commits on its
+ * own, so only the records before the first one that isn't committed
+ * everywhere are acknowledged. The slurmctld resends the rest, which is fine
+ * as storing a job or step record again just updates it.
+ *
+ * RET number of records, or -1 if the records need to be stored serially
+ */
+static int _proc_mult_msg_parallel(slurmdbd_conn_t *slurmdbd_conn,
+				   list_t *req_list, list_t *ret_list)
+{
+	int workers = slurmdbd_conf->mult_msg_workers;
+	int rec_cnt = list_count(req_list), cnt = 0, job_cnt = 0;
+	int cut, running = 0;
+	persist_msg_t *msgs;
+	buf_t **ret_bufs, *req_buf;
+	mult_msg_worker_t *groups;
+	mult_msg_job_t *jobs;
+	list_itr_t *itr;
+	pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+	if (_get_mult_msg_conns(slurmdbd_conn, workers) != SLURM_SUCCESS)
+		return -1;
+
+	msgs = xcalloc(rec_cnt, sizeof(*msgs));
+	ret_bufs = xcalloc(rec_cnt, sizeof(*ret_bufs));
+	jobs = xcalloc(rec_cnt, sizeof(*jobs));
+
+	/* Unpack everything first to know which job each record is about */
+	itr = list_iterator_create(req_list);
+	while ((req_buf = list_next(itr))) {
+		dbd_job_start_msg_t *start;
+
+		if (slurm_persist_conn_process_msg(
+			    slurmdbd_conn->pcon, &msgs[cnt],
+			    get_buf_data(req_buf), size_buf(req_buf),
+			    &ret_bufs[cnt], 0) != SLURM_SUCCESS)
+			break;
+		if (msgs[cnt].msg_type == DBD_JOB_START) {
+			start = msgs[cnt].data;
+			jobs[job_cnt].job_id = start->job_id;
+			if (start->array_job_id)
+				jobs[job_cnt].key = start->array_job_id;
+			else if (start->het_job_id)
+				jobs[job_cnt].key = start->het_job_id;
+			else
+				jobs[job_cnt].key = start->job_id;
+			job_cnt++;
+		}
+		cnt++;
+	}
+	list_iterator_destroy(itr);
+	qsort(jobs, job_cnt, sizeof(*jobs), _cmp_mult_msg_job);
+
+	/* groups[0] is the connection of the slurmctld */
+	groups = xcalloc(workers + 1, sizeof(*groups));
+	for (int g = 0; g <= workers; g++) {
+		groups[g].cond_cnt = &running;
+		groups[g].cond = &cond;
+		groups[g].db_conn = g ? slurmdbd_conn->mult_msg_conns[g - 1] :
+					slurmdbd_conn->db_conn;
+		groups[g].fail_inx = -1;
+		groups[g].first_lost = INT_MAX;
+		groups[g].lock = &lock;
+		groups[g].msgs = msgs;
+		groups[g].ret_bufs = ret_bufs;
+		groups[g].recs = xcalloc(cnt ? cnt : 1, sizeof(int));
+		groups[g].slurmdbd_conn = slurmdbd_conn;
+	}
+
+	for (int i = 0; i < cnt; i++) {
+		mult_msg_job_t key, *job;
+		int g = 0;
+
+		if (_mult_msg_job_id(&msgs[i], &key.job_id)) {
+			job = bsearch(&key, jobs, job_cnt, sizeof(*jobs),
+				      _cmp_mult_msg_job);
+			g = 1 + ((job ? job->key : key.job_id) % workers);
+		}
+		groups[g].recs[groups[g].rec_cnt++] = i;
+	}
+
+	/*
+	 * Store what isn't about a job first, node and cluster records may
+	 * register things the job records need. The workers then leave out
+	 * anything past a record of it that wasn't committed, as that will be
+	 * resent anyway.
+	 */
+	_run_mult_msg_worker(&groups[0]);
+
+	for (int g = 1; g <= workers; g++) {
+		while (groups[g].rec_cnt &&
+		       (groups[g].recs[groups[g].rec_cnt - 1] >=
+			groups[0].first_lost))
+			groups[g].rec_cnt--;
+		if (!groups[g].rec_cnt)
+			continue;
+		slurm_mutex_lock(&lock);
+		running++;
+		slurm_mutex_unlock(&lock);
+		slurm_thread_create_detached(_mult_msg_worker, &groups[g]);
+	}
+
+	slurm_mutex_lock(&lock);
+	while (running)
+		slurm_cond_wait(&cond, &lock);
+	slurm_mutex_unlock(&lock);
+
+	cut = cnt;
+	for (int g = 0; g <= workers; g++)
+		cut = MIN(cut, groups[g].first_lost);
+
+	for (int i = 0; i < cut; i++) {
+		if (ret_bufs[i])
+			list_append(ret_list, ret_bufs[i]);
+		ret_bufs[i] = NULL;
+	}
+	if (cut < cnt) {
+		bool failed = false;
+
+		for (int g = 0; g <= workers; g++)
+			if (groups[g].fail_inx == cut)
+				failed = true;
+		if (failed && ret_bufs[cut]) {
+			/* Same as when storing serially */
+			list_append(ret_list, ret_bufs[cut]);
+			ret_bufs[cut] = NULL;
+		} else {
+			char *comment =
+				"Unable to commit DBD_SEND_MULT_MSG records";
+			error("CONN:%d %s",
+			      conn_g_get_fd(slurmdbd_conn->pcon->conn),
+			      comment);
+			list_append(ret_list,
+				    slurm_persist_make_rc_msg(
+					    slurmdbd_conn->pcon, SLURM_ERROR,
+					    comment, DBD_SEND_MULT_MSG));
+		}
+	} else if ((cnt < rec_cnt) && ret_bufs[cnt]) {
+		/* Reply to the record that couldn't be unpacked */
+		list_append(ret_list, ret_bufs[cnt]);
+		ret_bufs[cnt] = NULL;
+	}
+
+	for (int i = 0; i < rec_cnt; i++) {
+		FREE_NULL_BUFFER(ret_bufs[i]);
+		if (i < cnt)
+			slurmdbd_free_msg(&msgs[i]);
+	}
+	for (int g = 0; g <= workers; g++)
+		xfree(groups[g].recs);
+	xfree(groups);
+	xfree(jobs);
+	xfree(ret_bufs);
+	xfree(msgs);
+	slurm_mutex_destroy(&lock);
+	slurm_cond_destroy(&cond);
+
+	log_flag(PROTOCOL, "%s: acknowledged %d of %d records",
+		 __func__, cut, rec_cnt);
+
+	return (cnt < rec_cnt) ? cnt + 1 : cnt;
+}
+
 static int _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 			  buf_t **out_buffer)
 {
@@ -2789,8 +3229,8 @@ static int _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	char *comment = NULL;
 	list_itr_t *itr = NULL;
 	buf_t *req_buf = NULL, *ret_buf = NULL;
-	int rc = SLURM_SUCCESS;
-	/* DEF_TIMERS; */
+	int rc = SLURM_SUCCESS, rec_cnt = 0;
+	DEF_TIMERS;
 
 	if (!_validate_slurm_user(slurmdbd_conn)) {
 		comment = "DBD_SEND_MULT_MSG message from invalid uid";
@@ -2803,12 +3243,27 @@ static int _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	}
 
 	list_msg.my_list = list_create(slurmdbd_free_buffer);
-	/* START_TIMER; */
+	START_TIMER;
+	/*
+	 * Process all the records in a single transaction. This is what lets
+	 * the storage plugin send them as multi-row statements.
+	 */
+	slurmdbd_conn->in_mult_msg = true;
+	if ((slurmdbd_conf->mult_msg_workers > 1) &&
+	    _commit_after_rpc(slurmdbd_conn, msg) &&
+	    ((rec_cnt = _proc_mult_msg_parallel(slurmdbd_conn,
+						get_msg->my_list,
+						list_msg.my_list)) >= 0)) {
+		slurmdbd_conn->in_mult_msg = false;
+		goto end_it;
+	}
+	rec_cnt = 0;
 	itr = list_iterator_create(get_msg->my_list);
 	while ((req_buf = list_next(itr))) {
 		persist_msg_t sub_msg;
 
 		ret_buf = NULL;
+		rec_cnt++;
 
 		rc = slurm_persist_conn_process_msg(
 			slurmdbd_conn->pcon, &sub_msg,
@@ -2827,8 +3282,37 @@ static int _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 			break;
 	}
 	list_iterator_destroy(itr);
-	/* END_TIMER; */
-	/* info("%d multi took %s", list_count(get_msg->my_list), TIME_STR); */
+	slurmdbd_conn->in_mult_msg = false;
+
+	if (_commit_after_rpc(slurmdbd_conn, msg) &&
+	    (acct_storage_g_commit(slurmdbd_conn->db_conn, 1) !=
+	     SLURM_SUCCESS)) {
+		/*
+		 * Nothing was committed, so don't acknowledge any of the
+		 * records. The slurmctld keeps them queued and resends them.
+		 */
+		comment = "Unable to commit DBD_SEND_MULT_MSG records";
+		error("CONN:%d %s",
+		      conn_g_get_fd(slurmdbd_conn->pcon->conn), comment);
+		list_flush(list_msg.my_list);
+		list_append(list_msg.my_list,
+			    slurm_persist_make_rc_msg(slurmdbd_conn->pcon,
+						      SLURM_ERROR, comment,
+						      DBD_SEND_MULT_MSG));
+	}
+end_it:
+	END_TIMER;
+	debug3("%s: %d records took %s", __func__, rec_cnt, TIME_STR);
+
+	slurm_mutex_lock(&rpc_mutex);
+	if (rpc_stats) {
+		rpc_stats->mult_msg_cnt++;
+		rpc_stats->mult_msg_max = MAX(rpc_stats->mult_msg_max,
+					      rec_cnt);
+		rpc_stats->mult_msg_recs += rec_cnt;
+		rpc_stats->mult_msg_time += DELTA_TIMER;
+	}
+	slurm_mutex_unlock(&rpc_mutex);
 
 	*out_buffer = init_buf(1024);
 	pack16((uint16_t) DBD_GOT_MULT_MSG, *out_buffer);
@@ -2839,8 +3323,8 @@ static int _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	return SLURM_SUCCESS;
 }
 
-static int _step_complete(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
-			  buf_t **out_buffer)
+static int _step_complete(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
+			  persist_msg_t *msg, buf_t **out_buffer)
 {
 	dbd_step_comp_msg_t *step_comp_msg = msg->data;
 	step_record_t step;
@@ -2885,7 +3369,7 @@ static int _step_complete(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	job.details = &details;
 	step.job_ptr = &job;
 
-	rc = jobacct_storage_g_step_complete(slurmdbd_conn->db_conn, &step);
+	rc = jobacct_storage_g_step_complete(db_conn, &step);
 
 	if (rc && errno == 740) /* meaning data is already there */
 		rc = SLURM_SUCCESS;
@@ -2896,7 +3380,7 @@ static int _step_complete(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 		debug3("DBD_STEP_COMPLETE: cluster not registered");
 		slurmdbd_conn->pcon->rem_port =
 			clusteracct_storage_g_register_disconn_ctld(
-				slurmdbd_conn->db_conn,
+				db_conn,
 				slurmdbd_conn->pcon->rem_host);
 
 		_add_registered_cluster(slurmdbd_conn);
@@ -2908,8 +3392,8 @@ end_it:
 	return rc;
 }
 
-static int _step_start(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
-		       buf_t **out_buffer)
+static int _step_start(slurmdbd_conn_t *slurmdbd_conn, void *db_conn,
+		       persist_msg_t *msg, buf_t **out_buffer)
 {
 	dbd_step_start_msg_t *step_start_msg = msg->data;
 	step_record_t step;
@@ -2975,7 +3459,7 @@ static int _step_start(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	step.job_ptr = &job;
 	step.step_layout = &layout;
 
-	rc = jobacct_storage_g_step_start(slurmdbd_conn->db_conn, &step);
+	rc = jobacct_storage_g_step_start(db_conn, &step);
 
 	if (rc && errno == 740) /* meaning data is already there */
 		rc = SLURM_SUCCESS;
@@ -2987,7 +3471,7 @@ static int _step_start(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 		debug3("DBD_STEP_START: cluster not registered");
 		slurmdbd_conn->pcon->rem_port =
 			clusteracct_storage_g_register_disconn_ctld(
-				slurmdbd_conn->db_conn,
+				db_conn,
 				slurmdbd_conn->pcon->rem_host);
 
 		_add_registered_cluster(slurmdbd_conn);
@@ -3031,6 +3515,7 @@ static int _get_stats(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 
 		return rc;
 	}
+	acct_storage_g_get_stats(slurmdbd_conn->db_conn, &rpc_stats);
 	slurmdb_pack_stats_msg(rpc_stats, slurmdbd_conn->pcon->version,
 			       *out_buffer);
 	slurm_mutex_unlock(&rpc_mutex);
@@ -3058,6 +3543,7 @@ static int _clear_stats(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	     slurmdbd_conn->pcon->auth_uid);
 
 	init_dbd_stats();
+	acct_storage_g_clear_stats(slurmdbd_conn->db_conn);
 
 	*out_buffer = slurm_persist_make_rc_msg(slurmdbd_conn->pcon,
 						rc, comment, DBD_CLEAR_STATS);
@@ -3102,7 +3588,6 @@ extern int proc_req(void *conn, persist_msg_t *msg, buf_t **out_buffer)
 	slurmdbd_conn_t *slurmdbd_conn = conn;
 	int rc = SLURM_SUCCESS;
 	char *comment = NULL;
-	slurmdb_rpc_obj_t *rpc_obj;
 	int fd = conn_g_get_fd(slurmdbd_conn->pcon->conn);
 
 	DEF_TIMERS;
@@ -3248,16 +3733,19 @@ extern int proc_req(void *conn, persist_msg_t *msg, buf_t **out_buffer)
 		rc = _fini_conn(slurmdbd_conn, msg, out_buffer);
 		break;
 	case DBD_JOB_COMPLETE:
-		rc = _job_complete(slurmdbd_conn, msg, out_buffer);
+		rc = _job_complete(slurmdbd_conn, slurmdbd_conn->db_conn,
+				   msg, out_buffer);
 		break;
 	case DBD_JOB_START:
-		rc = _job_start(slurmdbd_conn, msg, out_buffer);
+		rc = _job_start(slurmdbd_conn, slurmdbd_conn->db_conn,
+				msg, out_buffer);
 		break;
 	case DBD_JOB_HEAVY:
 		rc = _job_heavy(slurmdbd_conn, msg, out_buffer);
 		break;
 	case DBD_JOB_SUSPEND:
-		rc = _job_suspend(slurmdbd_conn, msg, out_buffer);
+		rc = _job_suspend(slurmdbd_conn, slurmdbd_conn->db_conn,
+				  msg, out_buffer);
 		break;
 	case DBD_MODIFY_ACCOUNTS:
 		rc = _modify_accounts(slurmdbd_conn, msg, out_buffer);
@@ -3344,10 +3832,12 @@ extern int proc_req(void *conn, persist_msg_t *msg, buf_t **out_buffer)
 		rc = _send_mult_msg(slurmdbd_conn, msg, out_buffer);
 		break;
 	case DBD_STEP_COMPLETE:
-		rc = _step_complete(slurmdbd_conn, msg, out_buffer);
+		rc = _step_complete(slurmdbd_conn, slurmdbd_conn->db_conn,
+				    msg, out_buffer);
 		break;
 	case DBD_STEP_START:
-		rc = _step_start(slurmdbd_conn, msg, out_buffer);
+		rc = _step_start(slurmdbd_conn, slurmdbd_conn->db_conn,
+				 msg, out_buffer);
 		break;
 	case DBD_FIX_RUNAWAY_JOB:
 		rc = _fix_runaway_jobs(slurmdbd_conn, msg, out_buffer);
@@ -3374,14 +3864,10 @@ extern int proc_req(void *conn, persist_msg_t *msg, buf_t **out_buffer)
 	if (rc == ESLURM_ACCESS_DENIED)
 		error("CONN:%d Security violation, %s",
 		      fd, slurmdbd_msg_type_2_str(msg->msg_type, 1));
-	else if (slurmdbd_conn->pcon->rem_port &&
-		 (!slurmdbd_conf->commit_delay ||
-		  (msg->msg_type == DBD_REGISTER_CTLD))) {
-		/* If we are dealing with the slurmctld do the
-		   commit (SUCCESS or NOT) afterwards since we
-		   do transactions for performance reasons.
-		   (don't ever use autocommit with innodb)
-		*/
+	else if (!slurmdbd_conn->in_mult_msg &&
+		 (msg->msg_type != DBD_SEND_MULT_MSG) &&
+		 _commit_after_rpc(slurmdbd_conn, msg)) {
+		/* _send_mult_msg() commits its records itself */
 		acct_storage_g_commit(slurmdbd_conn->db_conn, 1);
 	}
 	/*
@@ -3393,33 +3879,8 @@ extern int proc_req(void *conn, persist_msg_t *msg, buf_t **out_buffer)
 
 	END_TIMER;
 
-	slurm_mutex_lock(&rpc_mutex);
-	if (!rpc_stats) {
-		slurm_mutex_unlock(&rpc_mutex);
-		return rc;
-	}
-
-	if (!(rpc_obj =
-		      list_find_first(rpc_stats->rpc_list,
-				      _find_rpc_obj_in_list, &msg->msg_type))) {
-		rpc_obj = xmalloc(sizeof(slurmdb_rpc_obj_t));
-		rpc_obj->id = msg->msg_type;
-		list_append(rpc_stats->rpc_list, rpc_obj);
-	}
-	rpc_obj->cnt++;
-	rpc_obj->time += DELTA_TIMER;
-
-	if (!(rpc_obj = list_find_first(rpc_stats->user_list,
-					_find_rpc_obj_in_list,
-					&slurmdbd_conn->pcon->auth_uid))) {
-		rpc_obj = xmalloc(sizeof(slurmdb_rpc_obj_t));
-		rpc_obj->id = slurmdbd_conn->pcon->auth_uid;
-		list_append(rpc_stats->user_list, rpc_obj);
-	}
-	rpc_obj->cnt++;
-	rpc_obj->time += DELTA_TIMER;
-
-	slurm_mutex_unlock(&rpc_mutex);
+	_add_rpc_stats(msg->msg_type, slurmdbd_conn->pcon->auth_uid,
+		       DELTA_TIMER);
 
 	return rc;
 }
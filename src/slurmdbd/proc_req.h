@@ -48,6 +48,9 @@ typedef struct {
 	persist_conn_t *pcon_send;
 	pthread_mutex_t pcon_send_lock;
 	void *db_conn; /* database connection */
+	bool in_mult_msg; /* processing the records of a DBD_SEND_MULT_MSG */
+	void **mult_msg_conns; /* database connections of mult_msg_workers */
+	int mult_msg_conn_cnt;
 	char *tres_str;
 } slurmdbd_conn_t;
 
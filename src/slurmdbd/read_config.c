@@ -101,6 +101,7 @@ static void _clear_slurmdbd_conf(void)
 		xfree(slurmdbd_conf->default_qos);
 		slurmdbd_conf->flags = 0;
 		xfree(slurmdbd_conf->log_file);
+		slurmdbd_conf->mult_msg_workers = 1;
 		slurmdbd_conf->syslog_debug = LOG_LEVEL_END;
 		xfree(slurmdbd_conf->parameters);
 		xfree(slurmdbd_conf->pid_file);
@@ -111,11 +112,17 @@ static void _clear_slurmdbd_conf(void)
 		slurmdbd_conf->purge_suspend = 0;
 		slurmdbd_conf->purge_txn = 0;
 		slurmdbd_conf->purge_usage = 0;
+		slurmdbd_conf->rollup_workers = 1;
 		xfree(slurmdbd_conf->storage_loc);
 		xfree(slurmdbd_conf->storage_pass_script);
+		xfree(slurmdbd_conf->storage_replica_host);
+		slurmdbd_conf->storage_replica_max_lag =
+			DEFAULT_SLURMDBD_REPLICA_MAX_LAG;
+		slurmdbd_conf->storage_replica_port = 0;
 		xfree(slurmdbd_conf->storage_user);
 		slurmdbd_conf->track_wckey = 0;
 		slurmdbd_conf->track_ctld = 0;
+		slurmdbd_conf->usage_cache_mb = 0;
 	}
 }
 
@@ -188,6 +195,9 @@ extern int read_slurmdbd_conf(void)
 		{"StoragePass", S_P_STRING},
 		{"StoragePassScript", S_P_STRING},
 		{"StoragePort", S_P_UINT16},
+		{"StorageReplicaHost", S_P_STRING},
+		{"StorageReplicaMaxLag", S_P_UINT32},
+		{"StorageReplicaPort", S_P_UINT16},
 		{"StorageType", S_P_STRING},
 		{"StorageUser", S_P_STRING},
 		{"TCPTimeout", S_P_UINT16},
@@ -415,10 +425,52 @@ extern int read_slurmdbd_conf(void)
 
 		s_p_get_string(&slurmdbd_conf->parameters, "Parameters", tbl);
 		if (slurmdbd_conf->parameters) {
+			if (xstrcasestr(slurmdbd_conf->parameters,
+					"archive_columnar"))
+				slurmdbd_conf->flags |=
+					DBD_CONF_FLAG_ARCHIVE_COLUMNAR;
+			if ((temp_str = conf_get_opt_str(
+				     slurmdbd_conf->parameters,
+				     "mult_msg_workers="))) {
+				long tmp_val = strtol(temp_str, NULL, 10);
+				if ((tmp_val >= 1) && (tmp_val <= 64))
+					slurmdbd_conf->mult_msg_workers =
+						tmp_val;
+				else
+					error("Parameters option mult_msg_workers=%ld is invalid, ignored",
+					      tmp_val);
+				xfree(temp_str);
+			}
+			if (xstrcasestr(slurmdbd_conf->parameters,
+					"partition_job_tables"))
+				slurmdbd_conf->flags |=
+					DBD_CONF_FLAG_PARTITION_JOBS;
 			if (xstrcasestr(slurmdbd_conf->parameters,
 					"PreserveCaseUser"))
 				slurmdbd_conf->persist_conn_rc_flags |=
 					PERSIST_FLAG_P_USER_CASE;
+			if ((temp_str = conf_get_opt_str(
+				     slurmdbd_conf->parameters,
+				     "rollup_workers="))) {
+				long tmp_val = strtol(temp_str, NULL, 10);
+				if ((tmp_val >= 1) && (tmp_val <= 64))
+					slurmdbd_conf->rollup_workers = tmp_val;
+				else
+					error("Parameters option rollup_workers=%ld is invalid, ignored",
+					      tmp_val);
+				xfree(temp_str);
+			}
+			if ((temp_str = conf_get_opt_str(
+				     slurmdbd_conf->parameters,
+				     "usage_cache="))) {
+				long tmp_val = strtol(temp_str, NULL, 10);
+				if ((tmp_val >= 0) && (tmp_val <= 1048576))
+					slurmdbd_conf->usage_cache_mb = tmp_val;
+				else
+					error("Parameters option usage_cache=%ld is invalid, ignored",
+					      tmp_val);
+				xfree(temp_str);
+			}
 		}
 
 		s_p_get_string(&slurmdbd_conf->pid_file, "PidFile", tbl);
@@ -609,6 +661,12 @@ extern int read_slurmdbd_conf(void)
 			       "StoragePassScript", tbl);
 		s_p_get_uint16(&slurm_conf.accounting_storage_port,
 		               "StoragePort", tbl);
+		s_p_get_string(&slurmdbd_conf->storage_replica_host,
+			       "StorageReplicaHost", tbl);
+		s_p_get_uint32(&slurmdbd_conf->storage_replica_max_lag,
+			       "StorageReplicaMaxLag", tbl);
+		s_p_get_uint16(&slurmdbd_conf->storage_replica_port,
+			       "StorageReplicaPort", tbl);
 		s_p_get_string(&slurm_conf.accounting_storage_type,
 		               "StorageType", tbl);
 		s_p_get_string(&slurmdbd_conf->storage_user, "StorageUser", tbl);
@@ -695,6 +753,9 @@ extern int read_slurmdbd_conf(void)
 		if (!slurmdbd_conf->storage_loc)
 			slurmdbd_conf->storage_loc =
 				xstrdup(DEFAULT_ACCOUNTING_DB);
+		if (!slurmdbd_conf->storage_replica_port)
+			slurmdbd_conf->storage_replica_port =
+				slurm_conf.accounting_storage_port;
 	} else {
 		if (!slurm_conf.accounting_storage_port)
 			slurm_conf.accounting_storage_port =
@@ -978,6 +1039,15 @@ extern list_t *dump_config(void)
 	add_key_pair(my_list, "StoragePort", "%u",
 		     slurm_conf.accounting_storage_port);
 
+	add_key_pair(my_list, "StorageReplicaHost", "%s",
+		     slurmdbd_conf->storage_replica_host);
+
+	add_key_pair(my_list, "StorageReplicaMaxLag", "%u secs",
+		     slurmdbd_conf->storage_replica_max_lag);
+
+	add_key_pair(my_list, "StorageReplicaPort", "%u",
+		     slurmdbd_conf->storage_replica_port);
+
 	add_key_pair(my_list, "StorageType", "%s",
 		     slurm_conf.accounting_storage_type);
 
@@ -54,6 +54,7 @@
 #define DEFAULT_SLURMDBD_KEEPALIVE_PROBES 3
 #define DEFAULT_SLURMDBD_KEEPALIVE_TIME 30
 #define DEFAULT_SLURMDBD_MAX_PURGE_LIMIT 50000
+#define DEFAULT_SLURMDBD_REPLICA_MAX_LAG 30
 //#define DEFAULT_SLURMDBD_STEP_PURGE	1
 
 /* Define slurmdbd_conf_t flags */
@@ -62,6 +63,8 @@
 #define DBD_CONF_FLAG_DISABLE_COORD_DBD SLURM_BIT(2)
 #define DBD_CONF_FLAG_GET_DBVER SLURM_BIT(3)
 #define DBD_CONF_FLAG_DISABLE_ARCHIVE_COMMANDS SLURM_BIT(4)
+#define DBD_CONF_FLAG_ARCHIVE_COLUMNAR SLURM_BIT(5)
+#define DBD_CONF_FLAG_PARTITION_JOBS SLURM_BIT(6)
 
 /* SlurmDBD configuration parameters */
 typedef struct {
@@ -84,6 +87,8 @@ typedef struct {
 				   * single query so that locks can be
 				   * periodically released */
 	uint32_t	max_time_range;	/* max time range for user queries */
+	uint16_t	mult_msg_workers; /* connections used for the jobs of
+					   * a DBD_SEND_MULT_MSG	*/
 	char *		parameters;	/* parameters to change behavior with
 					 * the slurmdbd directly	*/
 	uint16_t        persist_conn_rc_flags; /* flags to be sent back on any
@@ -103,13 +108,20 @@ typedef struct {
 					 * than this in months or days	*/
 	uint32_t        purge_usage;    /* purge usage data older
 					 * than this in months or days	*/
+	uint16_t	rollup_workers;	/* threads used to roll up the
+					 * hours of a single cluster	*/
 	char *		storage_loc;	/* database name		*/
 	char *storage_pass_script;
+	char *		storage_replica_host; /* read replica for queries */
+	uint32_t	storage_replica_max_lag; /* seconds the replica may
+						  * be behind the primary */
+	uint16_t	storage_replica_port; /* port of the read replica */
 	char *storage_user;
 	uint16_t	syslog_debug;	/* output to both logfile and syslog*/
 	uint16_t        track_wckey;    /* Whether or not to track wckey*/
 	uint16_t        track_ctld;     /* Whether or not track when a
 					 * slurmctld goes down or not   */
+	uint32_t	usage_cache_mb;	/* memory for cached usage rows */
 } slurmdbd_conf_t;
 
 extern pthread_mutex_t conf_mutex;
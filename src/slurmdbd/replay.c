@@ -0,0 +1,273 @@
+/****************************************************************************\
+ *  replay.c - replay queued slurmctld messages into the database
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "src/common/assoc_mgr.h"
+#include "src/common/pack.h"
+#include "src/common/persist_conn.h"
+#include "src/common/slurmdbd_defs.h"
+#include "src/common/slurmdbd_pack.h"
+#include "src/common/timers.h"
+#include "src/common/xstring.h"
+
+#include "src/interfaces/accounting_storage.h"
+
+#include "src/slurmdbd/proc_req.h"
+#include "src/slurmdbd/read_config.h"
+#include "src/slurmdbd/replay.h"
+#include "src/slurmdbd/slurmdbd.h"
+
+/* Same as the slurmdbd agent of the slurmctld writing the file */
+#define DBD_MAGIC 0xDEAD3219
+#define REPLAY_BATCH_RECS 5000
+
+static buf_t *_read_rec(int fd)
+{
+	uint32_t msg_size, magic;
+	buf_t *buffer;
+
+	if (read(fd, &msg_size, sizeof(msg_size)) != sizeof(msg_size))
+		return NULL;
+	if (msg_size > MAX_BUF_SIZE) {
+		error("%s: bad record size %u", __func__, msg_size);
+		return NULL;
+	}
+
+	buffer = init_buf(msg_size);
+	if ((read(fd, get_buf_data(buffer), msg_size) != msg_size) ||
+	    (read(fd, &magic, sizeof(magic)) != sizeof(magic)) ||
+	    (magic != DBD_MAGIC)) {
+		error("%s: truncated or corrupted record", __func__);
+		FREE_NULL_BUFFER(buffer);
+		return NULL;
+	}
+	set_buf_offset(buffer, msg_size);
+
+	return buffer;
+}
+
+/* RET return code of the reply to one record of a batch */
+static int _rec_rc(buf_t *buffer, uint16_t rpc_version)
+{
+	persist_msg_t resp = { 0 };
+	int rc = SLURM_ERROR;
+
+	if (unpack_slurmdbd_msg(&resp, rpc_version, buffer) != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
+	switch (resp.msg_type) {
+	case DBD_ID_RC:
+		rc = ((dbd_id_rc_msg_t *) resp.data)->return_code;
+		slurmdbd_free_id_rc_msg(resp.data);
+		break;
+	case PERSIST_RC:
+		rc = ((persist_rc_msg_t *) resp.data)->rc;
+		slurm_persist_free_rc_msg(resp.data);
+		break;
+	default:
+		slurmdbd_free_msg(&resp);
+		break;
+	}
+
+	return rc;
+}
+
+/*
+ * RET how many records of the batch were acknowledged. Like the slurmctld,
+ * stop at the first reply that isn't a success, which is the record that
+ * failed or couldn't be committed.
+ */
+static int _acked(buf_t *out_buffer, uint16_t rpc_version)
+{
+	dbd_list_msg_t *list_msg = NULL;
+	list_itr_t *itr;
+	buf_t *buffer;
+	uint16_t msg_type;
+	int acked = 0;
+
+	set_buf_offset(out_buffer, 0);
+	safe_unpack16(&msg_type, out_buffer);
+	if ((msg_type != DBD_GOT_MULT_MSG) ||
+	    slurmdbd_unpack_list_msg(&list_msg, rpc_version, DBD_GOT_MULT_MSG,
+				     out_buffer))
+		return 0;
+
+	itr = list_iterator_create(list_msg->my_list);
+	while ((buffer = list_next(itr))) {
+		if (_rec_rc(buffer, rpc_version) != SLURM_SUCCESS)
+			break;
+		acked++;
+	}
+	list_iterator_destroy(itr);
+	slurmdbd_free_list_msg(list_msg);
+
+unpack_error:
+	return acked;
+}
+
+extern int replay_dbd_messages(char *arg)
+{
+	char *cluster = xstrdup(arg), *file, *ver_str = NULL;
+	int fd, rc = SLURM_SUCCESS;
+	uint16_t rpc_version;
+	uint64_t recs = 0, acked = 0, usecs = 0;
+	buf_t *buffer = NULL;
+	persist_conn_t pcon = { 0 };
+	slurmdbd_conn_t dbd_conn = { 0 };
+	assoc_init_args_t assoc_init_arg = {
+		.cache_level = ASSOC_MGR_CACHE_USER | ASSOC_MGR_CACHE_ASSOC |
+			       ASSOC_MGR_CACHE_QOS | ASSOC_MGR_CACHE_TRES |
+			       ASSOC_MGR_CACHE_WCKEY,
+	};
+
+	if (!(file = xstrchr(cluster, ':')) || (file == cluster) ||
+	    !file[1]) {
+		error("-r needs <cluster>:<file>, not %s", arg);
+		xfree(cluster);
+		return SLURM_ERROR;
+	}
+	*file++ = '\0';
+
+	if ((fd = open(file, O_RDONLY)) < 0) {
+		error("Unable to open %s: %m", file);
+		xfree(cluster);
+		return SLURM_ERROR;
+	}
+
+	/* The file starts with the protocol version of its messages */
+	if (!(buffer = _read_rec(fd)))
+		goto bad_file;
+	set_buf_offset(buffer, 0);
+	safe_unpackstr(&ver_str, buffer);
+	FREE_NULL_BUFFER(buffer);
+	if (xstrncmp(ver_str, "VER", 3))
+		goto bad_file;
+	rpc_version = slurm_atoul(ver_str + 3);
+	xfree(ver_str);
+	if (rpc_version < SLURM_MIN_PROTOCOL_VERSION) {
+		error("%s holds messages of protocol version %hu, too old to replay",
+		      file, rpc_version);
+		rc = SLURM_ERROR;
+		goto end_it;
+	}
+
+	registered_clusters = list_create(NULL);
+	dbd_conn.db_conn = acct_storage_g_get_connection(0, NULL, true,
+							 cluster);
+	if (assoc_mgr_init(dbd_conn.db_conn, &assoc_init_arg, errno) ==
+	    SLURM_ERROR) {
+		error("Problem getting cache of data");
+		rc = SLURM_ERROR;
+		goto end_it;
+	}
+
+	/* Act like a registered slurmctld so each batch is committed */
+	pcon.auth_ids_set = true;
+	pcon.auth_uid = slurm_conf.slurm_user_id;
+	pcon.cluster_name = cluster;
+	pcon.flags = PERSIST_FLAG_DBD;
+	pcon.persist_type = PERSIST_TYPE_DBD;
+	pcon.rem_host = "replay";
+	pcon.rem_port = slurmdbd_conf->dbd_port;
+	pcon.version = rpc_version;
+	dbd_conn.pcon = &pcon;
+
+	while (rc == SLURM_SUCCESS) {
+		dbd_list_msg_t list_msg = {
+			.my_list = list_create(slurmdbd_free_buffer),
+		};
+		persist_msg_t msg = {
+			.data = &list_msg,
+			.msg_type = DBD_SEND_MULT_MSG,
+		};
+		buf_t *out_buffer = NULL;
+		int cnt;
+		DEF_TIMERS;
+
+		while ((list_count(list_msg.my_list) < REPLAY_BATCH_RECS) &&
+		       (buffer = _read_rec(fd)))
+			list_append(list_msg.my_list, buffer);
+		if (!(cnt = list_count(list_msg.my_list))) {
+			FREE_NULL_LIST(list_msg.my_list);
+			break;
+		}
+
+		START_TIMER;
+		rc = proc_req(&dbd_conn, &msg, &out_buffer);
+		END_TIMER;
+		usecs += DELTA_TIMER;
+		recs += cnt;
+		if (out_buffer) {
+			int batch_acked = _acked(out_buffer, rpc_version);
+
+			if (batch_acked < cnt)
+				error("Only %d of %d records of batch stored",
+				      batch_acked, cnt);
+			acked += batch_acked;
+		}
+		FREE_NULL_BUFFER(out_buffer);
+		FREE_NULL_LIST(list_msg.my_list);
+	}
+
+	printf("Replayed %"PRIu64" records of cluster %s in %"PRIu64" usec, %"PRIu64" stored\n",
+	       recs, cluster, usecs, acked);
+	if (usecs)
+		printf("%"PRIu64" records/sec with mult_msg_workers=%hu\n",
+		       (acked * USEC_IN_SEC) / usecs,
+		       slurmdbd_conf->mult_msg_workers);
+
+end_it:
+	for (int i = 0; i < dbd_conn.mult_msg_conn_cnt; i++)
+		acct_storage_g_close_connection(&dbd_conn.mult_msg_conns[i]);
+	xfree(dbd_conn.mult_msg_conns);
+	acct_storage_g_close_connection(&dbd_conn.db_conn);
+	FREE_NULL_LIST(registered_clusters);
+	close(fd);
+	xfree(cluster);
+
+	return rc;
+
+unpack_error:
+bad_file:
+	error("%s is not a dbd.messages file", file);
+	FREE_NULL_BUFFER(buffer);
+	xfree(ver_str);
+	rc = SLURM_ERROR;
+	goto end_it;
+}
@@ -175,6 +175,9 @@ static void _connection_fini_callback(void *arg)
 	}
 
 	acct_storage_g_close_connection(&dbd_conn->db_conn);
+	for (int i = 0; i < dbd_conn->mult_msg_conn_cnt; i++)
+		acct_storage_g_close_connection(&dbd_conn->mult_msg_conns[i]);
+	xfree(dbd_conn->mult_msg_conns);
 
 	if (stay_locked)
 		slurm_mutex_unlock(&registered_lock);
@@ -77,6 +77,7 @@
 #include "src/slurmdbd/backup.h"
 #include "src/slurmdbd/proc_req.h"
 #include "src/slurmdbd/read_config.h"
+#include "src/slurmdbd/replay.h"
 #include "src/slurmdbd/rpc_mgr.h"
 
 uint32_t slurm_daemon = IS_SLURMDBD;
@@ -101,6 +102,7 @@ static pthread_t commit_handler_thread = 0; /* thread ID for commit handler */
 static pthread_cond_t rollup_handler_cond = PTHREAD_COND_INITIALIZER;
 static pthread_mutex_t rollup_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool restart_backup = false;
+static char *replay_arg = NULL;		/* replay dbd.messages -r */
 
 /* Local functions */
 static void *_commit_handler(void *no_data);
@@ -232,6 +234,17 @@ int main(int argc, char **argv)
 		exit(1);
 	_parse_commandline(argc, argv);
 
+	if (replay_arg) {
+		become_slurm_user();
+		if ((auth_g_init() != SLURM_SUCCESS) ||
+		    (hash_g_init() != SLURM_SUCCESS) ||
+		    (conn_g_init() != SLURM_SUCCESS) ||
+		    (acct_storage_g_init() != SLURM_SUCCESS))
+			fatal("Unable to initialize plugins for replay");
+		_update_logging(true);
+		exit(replay_dbd_messages(replay_arg) ? 1 : 0);
+	}
+
 	if (slurmdbd_conf->flags & DBD_CONF_FLAG_GET_DBVER) {
 		become_slurm_user();
 		if (acct_storage_g_init() != SLURM_SUCCESS) {
@@ -632,7 +645,7 @@ static void _parse_commandline(int argc, char **argv)
 	char *tmp_char;
 
 	opterr = 0;
-	while ((c = getopt(argc, argv, "Dhn:R::suvV")) != -1)
+	while ((c = getopt(argc, argv, "Dhn:r:R::suvV")) != -1)
 		switch (c) {
 		case 'D':
 			daemonize = 0;
@@ -651,6 +664,10 @@ static void _parse_commandline(int argc, char **argv)
 				new_nice = 0;
 			}
 			break;
+		case 'r':
+			xfree(replay_arg);
+			replay_arg = xstrdup(optarg);
+			break;
 		case 'R':
 			warning("-R is no longer a valid option. lft/rgt logic was removed from Slurm in 23.11.");
 			break;
@@ -684,6 +701,8 @@ static void _usage(char *prog_name)
 		"Print this help message.\n");
 	fprintf(stderr, "  -n value   \t"
 		"Run the daemon at the specified nice value.\n");
+	fprintf(stderr, "  -r cluster:file\t"
+		"Store the messages of a slurmctld dbd.messages file and report the rate, then exit.\n");
 	fprintf(stderr, "  -s         \t"
 		"Change working directory to LogFile dirname or /var/tmp/.\n");
 	fprintf(stderr, "  -v         \t"
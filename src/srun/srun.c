@@ -796,9 +796,11 @@ static void _file_bcast(slurm_opt_t *opt_local, srun_job_t *job)
 	params->block_size = 8 * 1024 * 1024;
 	if (srun_opt->compress) {
 		params->compress = srun_opt->compress;
+		params->compress_level = srun_opt->compress_level;
 	} else if ((tmp = conf_get_opt_str(slurm_conf.bcast_parameters,
 					   "Compression="))) {
 		params->compress = parse_compress_type(tmp);
+		params->compress_level = parse_compress_level(tmp);
 		xfree(tmp);
 	}
 	params->exclude = xstrdup(srun_opt->bcast_exclude);
@@ -828,6 +830,10 @@ static void _file_bcast(slurm_opt_t *opt_local, srun_job_t *job)
 	params->src_fname = xstrdup(opt_local->argv[0]);
 	params->timeout = 0;
 	params->verbose = opt_local->verbose;
+	if ((tmp = conf_get_opt_str(slurm_conf.bcast_parameters, "Window="))) {
+		params->window = atoi(tmp);
+		xfree(tmp);
+	}
 
 	if (bcast_file(params) != SLURM_SUCCESS)
 		fatal("Failed to broadcast '%s'. Step launch aborted.",
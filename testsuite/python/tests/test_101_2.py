@@ -0,0 +1,61 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_accounting()
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module")
+def job_id():
+    job_id = atf.submit_job_sbatch(
+        '--wrap "srun true; srun true; srun true"', fatal=True
+    )
+    atf.wait_for_job_state(job_id, "COMPLETED", fatal=True)
+    assert atf.repeat_command_until(
+        f"sacct -j {job_id} -n -P -o jobid",
+        lambda results: len(
+            re.findall(rf"^{job_id}\.\d+$", results["stdout"], re.MULTILINE)
+        )
+        == 3,
+        timeout=60,
+    ), "All steps should be stored"
+    return job_id
+
+
+def _steps(selection):
+    output = atf.run_command_output(
+        f"sacct -j {selection} -n -P -o jobid", fatal=True
+    )
+    return sorted(output.split())
+
+
+def test_select_one_step(job_id):
+    """Verify sacct -j job.step reports only that step"""
+
+    assert _steps(f"{job_id}.1") == [f"{job_id}.1"]
+
+
+def test_select_several_steps(job_id):
+    """Verify several steps of a job can be selected"""
+
+    assert _steps(f"{job_id}.0,{job_id}.2") == sorted(
+        [f"{job_id}.0", f"{job_id}.2"]
+    )
+    assert _steps(f"{job_id}.2") == [f"{job_id}.2"]
+
+
+def test_select_whole_job(job_id):
+    """Verify sacct -j job still reports the job and all its steps"""
+
+    steps = _steps(f"{job_id}")
+    assert f"{job_id}" in steps
+    for step in range(3):
+        assert f"{job_id}.{step}" in steps
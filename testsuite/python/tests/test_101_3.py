@@ -0,0 +1,73 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+
+# More than one part of the jobs read by slurmdbd for --stream
+array_size = 1100
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_accounting()
+    atf.require_config_parameter(
+        "MaxArraySize",
+        array_size + 1,
+        lambda v: v is not None and int(v) > array_size,
+    )
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module")
+def array_id():
+    array_id = atf.submit_job_sbatch(
+        f"--array=0-{array_size - 1} -o /dev/null --wrap true", fatal=True
+    )
+    assert atf.repeat_command_until(
+        f"sacct -X -n -P -s CD -o jobid -j {array_id}",
+        lambda results: len(results["stdout"].split()) == array_size,
+        timeout=600,
+    ), "All array tasks should complete"
+    return array_id
+
+
+def _jobs(options):
+    return sorted(
+        atf.run_command_output(
+            f"sacct -X -n -P -o jobid,state {options}", fatal=True
+        ).split()
+    )
+
+
+def test_stream(array_id):
+    """Verify sacct --stream gets every job across parts"""
+
+    jobs = _jobs(f"-j {array_id}")
+    assert len(jobs) == array_size
+    assert _jobs(f"--stream -j {array_id}") == jobs
+
+
+def test_stream_duplicates(array_id):
+    """Verify sacct --stream --duplicates gets every record across parts"""
+
+    assert _jobs(f"--stream -D -j {array_id}") == _jobs(f"-D -j {array_id}")
+
+
+def test_stream_index(array_id, sql_statement_repeat):
+    """Verify --stream parts are read in index order without a filesort"""
+
+    if not sql_statement_repeat:
+        pytest.skip("This test needs auto-config to query the database")
+
+    cluster = atf.get_config_parameter("ClusterName")
+    plan = atf.run_command_output(
+        sql_statement_repeat + f' -e "explain select t1.job_db_inx '
+        f"from {cluster}_job_table as t1 "
+        f"where (t1.id_job, t1.time_submit) < ({array_id + array_size}, 0) "
+        f'order by t1.id_job desc, t1.time_submit desc limit 1000"',
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    )
+    assert "filesort" not in plan, "A part should not sort the remaining jobs"
@@ -0,0 +1,45 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+step_count = 20
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_accounting(modify=True)
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+def test_replay_batched_steps():
+    """Verify steps queued while slurmdbd was down are all stored"""
+
+    atf.stop_slurmdbd(quiet=True)
+    try:
+        job_id = atf.submit_job_sbatch(
+            f'--wrap "for i in $(seq {step_count}); do srun true; done"',
+            fatal=True,
+        )
+        atf.wait_for_job_state(job_id, "COMPLETED", fatal=True)
+    finally:
+        atf.start_slurmdbd(quiet=True)
+
+    assert atf.repeat_command_until(
+        f"sacct -j {job_id} -n -P -o jobid",
+        lambda results: len(
+            re.findall(rf"^{job_id}\.\d+$", results["stdout"], re.MULTILINE)
+        )
+        == step_count,
+        timeout=60,
+    ), f"All {step_count} steps should be stored once slurmdbd is back"
+
+    output = atf.run_command_output(
+        "sacctmgr show stats", user=atf.properties["slurm-user"], fatal=True
+    )
+    assert re.search(
+        r"Batched records \(DBD_SEND_MULT_MSG\)", output
+    ), "The records queued during the outage should be sent in batches"
@@ -0,0 +1,55 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import time
+
+hours = 12
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to change rollup_workers in slurmdbd.conf")
+    atf.require_accounting(modify=True)
+    atf.require_config_parameter_includes(
+        "Parameters", "rollup_workers=4", source="slurmdbd"
+    )
+    atf.require_slurm_running()
+
+
+def _rolled_usage():
+    """Roll up the last hours and return the cluster utilization report"""
+
+    end = int(time.time()) // 3600 * 3600
+    start = end - hours * 3600
+    start_str = time.strftime("%Y-%m-%dT%H:%M:%S", time.localtime(start))
+    end_str = time.strftime("%Y-%m-%dT%H:%M:%S", time.localtime(end))
+
+    atf.run_command(
+        f"sacctmgr -i roll {start_str} {end_str}",
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    )
+    return atf.run_command_output(
+        f"sreport -n -P -t seconds cluster utilization start={start_str} "
+        f"end={end_str} format=Allocated,Down,PlannedDown,Idle,Planned,Reported",
+        fatal=True,
+    )
+
+
+def test_parallel_rollup():
+    """Verify rollup_workers rolls up the same usage as a single worker"""
+
+    parallel = _rolled_usage()
+    assert parallel == _rolled_usage(), "Rolling up again should not change usage"
+
+    atf.remove_config_parameter_value(
+        "Parameters", "rollup_workers=4", source="slurmdbd"
+    )
+    atf.stop_slurmdbd(quiet=True)
+    atf.start_slurmdbd(quiet=True)
+
+    assert (
+        _rolled_usage() == parallel
+    ), "Parallel and single worker rollups should store the same usage"
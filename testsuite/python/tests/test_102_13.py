@@ -0,0 +1,153 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import datetime
+import glob
+import os
+import pwd
+import pytest
+import re
+import shutil
+import tempfile
+
+# Jobs old enough to be purged, Tue Jan 1 2008
+period_start_epoch = int(datetime.datetime(2008, 1, 1, 0, 0, 0).timestamp())
+period_start_string = "2008-01-01T00:00:00"
+period_end_string = "2008-02-01T00:00:00"
+job_ids = [65536 + i for i in range(3)]
+
+account = "test_102_13_acct"
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to set Parameters=archive_columnar")
+    atf.require_accounting(modify=True)
+    atf.require_config_parameter_includes(
+        "Parameters", "archive_columnar", source="slurmdbd"
+    )
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module")
+def archive_file():
+    """Load a few old jobs and dump them into a columnar archive"""
+
+    cluster = atf.get_config_parameter("ClusterName")
+    user = atf.properties["test-user"]
+    uid = pwd.getpwnam(user).pw_uid
+
+    atf.run_command(
+        f"sacctmgr -i add account {account} cluster={cluster}",
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    )
+    atf.run_command(
+        f"sacctmgr -i add user {user} account={account} cluster={cluster}",
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    )
+    associd = atf.run_command_output(
+        f"sacctmgr -n -P list assoc users={user} account={account} "
+        f"cluster={cluster} format=id",
+        fatal=True,
+    ).strip()
+
+    sql_path = str(atf.module_tmp_path / "jobs.sql")
+    with open(sql_path, "w") as f:
+        f.write(
+            "insert into job_table (jobid, associd, uid, gid, `partition`, "
+            "blockid, cluster, account, eligible, submit, start, end, "
+            "suspended, name, state, comp_code, priority, req_cpus, "
+            "tres_alloc, nodelist, kill_requid, qos, deleted) values"
+        )
+        rows = []
+        for i, job_id in enumerate(job_ids):
+            start = period_start_epoch + i * 3600
+            rows.append(
+                f" ('{job_id}', '{associd}', '{uid}', '{uid}', 'debug', '', "
+                f"'{cluster}', '{account}', {start}, {start}, {start}, "
+                f"{start + 600}, '0', 'archived{i}', '3', '0', '1', 1, '1=1', "
+                f"'node{i}', '0', '0', '0')"
+            )
+        f.write(",".join(rows) + ";\n")
+
+    atf.run_command(
+        f"sacctmgr -i -n archive load {sql_path}",
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    )
+
+    # slurmdbd writes the archive, so it needs a directory it can reach
+    archive_dir = tempfile.mkdtemp(prefix="test_102_13.")
+    os.chmod(archive_dir, 0o777)
+    atf.run_command(
+        f"sacctmgr -i archive dump Directory={archive_dir} Jobs "
+        f"PurgeJobAfter=1month",
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    )
+
+    files = glob.glob(f"{archive_dir}/{cluster}_job_table_archive_*")
+    assert len(files) == 1, "One job archive should be written"
+    yield files[0]
+
+    shutil.rmtree(archive_dir, ignore_errors=True)
+
+
+def _archived_jobs(options):
+    output = atf.run_command_output(
+        f"sacct -X -n -P -o jobid,jobname,account {options} "
+        f"-S {period_start_string} -E {period_end_string}",
+        fatal=True,
+    )
+    return sorted(re.findall(r"^(\d+)\|", output, re.MULTILINE))
+
+
+def test_purged(archive_file):
+    """Verify the archived jobs were purged from the database"""
+
+    assert _archived_jobs("-a") == []
+
+
+def test_sacct_archive(archive_file):
+    """Verify sacct --archive reads the columnar archive"""
+
+    assert _archived_jobs(f"-a --archive={archive_file}") == sorted(
+        str(job_id) for job_id in job_ids
+    )
+
+
+def test_sacct_archive_job_filter(archive_file):
+    """Verify sacct --archive applies the job id filter"""
+
+    assert _archived_jobs(f"-a --archive={archive_file} -j {job_ids[1]}") == [
+        str(job_ids[1])
+    ]
+
+
+def test_sacct_archive_truncated(archive_file):
+    """Verify sacct --archive rejects a damaged archive without crashing"""
+
+    truncated = str(atf.module_tmp_path / "truncated")
+    with open(archive_file, "rb") as src, open(truncated, "wb") as dst:
+        data = src.read()
+        dst.write(data[: len(data) - 16])
+
+    result = atf.run_command(
+        f"sacct -X -n -P -a --archive={truncated} "
+        f"-S {period_start_string} -E {period_end_string}"
+    )
+    assert result["exit_code"] in (0, 1), "sacct should fail cleanly"
+
+
+def test_archive_load(archive_file):
+    """Verify a columnar archive loads back into the database"""
+
+    atf.run_command(
+        f"sacctmgr -i archive load File={archive_file}",
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    )
+    assert _archived_jobs("-a") == sorted(str(job_id) for job_id in job_ids)
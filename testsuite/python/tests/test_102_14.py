@@ -0,0 +1,65 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+import time
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to set Parameters=partition_job_tables")
+    atf.require_accounting(modify=True)
+    atf.require_config_parameter_includes(
+        "Parameters", "partition_job_tables", source="slurmdbd"
+    )
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module")
+def job_id():
+    job_id = atf.submit_job_sbatch('--wrap "srun true; srun true"', fatal=True)
+    atf.wait_for_job_state(job_id, "COMPLETED", fatal=True)
+    assert atf.repeat_command_until(
+        f"sacct -j {job_id} -n -P -o jobid",
+        lambda results: len(
+            re.findall(rf"^{job_id}\.\d+$", results["stdout"], re.MULTILINE)
+        )
+        == 2,
+        timeout=60,
+    ), "The job and its steps should be stored in the partitioned tables"
+    return job_id
+
+
+def _job_ids(window):
+    output = atf.run_command_output(
+        f"sacct -a -X -n -P -o jobid {window}", fatal=True
+    )
+    return output.split()
+
+
+def test_window_with_job(job_id):
+    """Verify a time window holding the job finds it"""
+
+    start = time.strftime("%Y-%m-%dT%H:%M:%S", time.localtime(time.time() - 3600))
+    assert str(job_id) in _job_ids(f"-S {start} -E now")
+
+
+def test_window_without_job(job_id):
+    """Verify a time window before the job does not find it"""
+
+    assert str(job_id) not in _job_ids("-S 2008-01-01 -E 2008-02-01")
+
+
+def test_steps(job_id):
+    """Verify the steps of the job are read from the partitioned step table"""
+
+    output = atf.run_command_output(
+        f"sacct -j {job_id} -n -P -o jobid,state", fatal=True
+    )
+    for step in range(2):
+        assert re.search(
+            rf"^{job_id}\.{step}\|COMPLETED$", output, re.MULTILINE
+        ), f"Step {step} should be found"
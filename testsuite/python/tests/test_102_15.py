@@ -0,0 +1,61 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+# Each task queues several records, enough to go past MaxDBDMsgs=10000
+task_count = 6000
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to spool the slurmdbd agent queue")
+    atf.require_accounting(modify=True)
+    atf.require_config_parameter("MaxDBDMsgs", "10000")
+    atf.require_config_parameter("MaxArraySize", str(task_count + 1))
+    atf.require_config_parameter_includes(
+        "SlurmctldParameters", "max_dbd_msg_action=spool"
+    )
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+def test_spool_replay():
+    """Verify records spooled while slurmdbd was down are all stored"""
+
+    spool = f"{atf.get_config_parameter('StateSaveLocation')}/dbd.spool"
+
+    atf.stop_slurmdbd(quiet=True)
+    try:
+        job_id = atf.submit_job_sbatch(
+            f"--array=1-{task_count} -o /dev/null --wrap true", fatal=True
+        )
+        assert atf.repeat_command_until(
+            f"squeue -h -j {job_id}",
+            lambda results: results["stdout"] == "",
+            timeout=600,
+        ), "All array tasks should end while slurmdbd is down"
+
+        size = atf.run_command_output(
+            f"stat -c %s {spool}", user=atf.properties["slurm-user"], fatal=True
+        )
+        assert int(size) > 0, "The backlog should have been written to dbd.spool"
+    finally:
+        atf.start_slurmdbd(quiet=True)
+
+    assert atf.repeat_command_until(
+        f"sacct -X -j {job_id} -n -P -o jobid,state",
+        lambda results: len(
+            re.findall(rf"^{job_id}_\d+\|COMPLETED$", results["stdout"], re.M)
+        )
+        == task_count,
+        timeout=600,
+    ), f"All {task_count} array tasks should be stored once slurmdbd is back"
+
+    assert atf.repeat_command_until(
+        "sdiag",
+        lambda results: "DBD Agent queue size: 0" in results["stdout"],
+        timeout=60,
+    ), "The spool should be empty once it has been replayed"
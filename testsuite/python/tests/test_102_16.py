@@ -0,0 +1,76 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to set StorageReplicaHost in slurmdbd.conf")
+    atf.require_accounting(modify=True)
+
+    # The primary is its own replica, so the heartbeat never lags
+    storage_host = atf.get_config_parameter(
+        "StorageHost", "localhost", live=False, quiet=True, source="slurmdbd"
+    )
+    atf.require_config_parameter("StorageReplicaHost", storage_host, source="slurmdbd")
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module")
+def job_id():
+    job_id = atf.submit_job_sbatch('--wrap "srun true"', fatal=True)
+    atf.wait_for_job_state(job_id, "COMPLETED", fatal=True)
+    return job_id
+
+
+def _dbd_log_has(pattern):
+    dbd_log = atf.get_config_parameter(
+        "LogFile", live=False, quiet=True, source="slurmdbd"
+    )
+    return atf.repeat_until(
+        lambda: atf.run_command(
+            f"grep -c '{pattern}' {dbd_log}",
+            user=atf.properties["slurm-user"],
+            quiet=True,
+        ),
+        lambda results: results["exit_code"] == 0,
+        timeout=30,
+    )
+
+
+def _sacct_job(job_id):
+    return atf.repeat_command_until(
+        f"sacct -j {job_id} -n -P -o jobid,state",
+        lambda results: re.search(
+            rf"^{job_id}\.0\|COMPLETED$", results["stdout"], re.MULTILINE
+        ),
+        timeout=60,
+    )
+
+
+def test_replica_queries(job_id):
+    """Verify sacct and sreport are answered with the replica in use"""
+
+    assert _dbd_log_has(
+        "Using read replica"
+    ), "slurmdbd should start using the replica once its lag is known"
+    assert _sacct_job(job_id), "sacct should list the job and its step"
+
+    cluster = atf.get_config_parameter("ClusterName")
+    output = atf.run_command_output(
+        f"sreport -n -P cluster utilization cluster={cluster}", fatal=True
+    )
+    assert cluster in output, "sreport should get the cluster usage"
+
+
+def test_replica_unavailable(job_id):
+    """Verify queries fall back to the primary if the replica is down"""
+
+    # Nothing listens on port 1
+    atf.set_config_parameter("StorageReplicaPort", "1", source="slurmdbd")
+
+    assert _sacct_job(job_id), "sacct should still list the job"
@@ -0,0 +1,65 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+import time
+
+hours = 12
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to set usage_cache in slurmdbd.conf")
+    atf.require_accounting(modify=True)
+    atf.require_config_parameter_includes(
+        "Parameters", "usage_cache=64", source="slurmdbd"
+    )
+    atf.require_slurm_running()
+
+
+def _usage_report():
+    """Return the cluster and account usage of the last hours"""
+
+    end = int(time.time()) // 3600 * 3600
+    start = end - hours * 3600
+    start_str = time.strftime("%Y-%m-%dT%H:%M:%S", time.localtime(start))
+    end_str = time.strftime("%Y-%m-%dT%H:%M:%S", time.localtime(end))
+
+    return atf.run_command_output(
+        f"sreport -n -P -t seconds cluster utilization start={start_str} "
+        f"end={end_str} format=Allocated,Down,PlannedDown,Idle,Planned,Reported",
+        fatal=True,
+    ) + atf.run_command_output(
+        f"sreport -n -P -t seconds cluster accountutilizationbyuser "
+        f"start={start_str} end={end_str}",
+        fatal=True,
+    )
+
+
+def _cache_hits():
+    output = atf.run_command_output(
+        "sacctmgr show stats", user=atf.properties["slurm-user"], fatal=True
+    )
+    match = re.search(r"Usage cache\s+Hits:\s+(\d+)", output)
+    return int(match.group(1)) if match else 0
+
+
+def test_usage_cache():
+    """Verify usage answered from the cache matches the database"""
+
+    cached = _usage_report()
+    hits = _cache_hits()
+    assert _usage_report() == cached, "A cached report should not change"
+    assert _cache_hits() > hits, "The second report should be a cache hit"
+
+    atf.remove_config_parameter_value(
+        "Parameters", "usage_cache=64", source="slurmdbd"
+    )
+    atf.stop_slurmdbd(quiet=True)
+    atf.start_slurmdbd(quiet=True)
+
+    assert (
+        _usage_report() == cached
+    ), "Reports with and without the usage cache should match"
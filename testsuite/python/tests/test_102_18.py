@@ -0,0 +1,107 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import os
+import pytest
+import re
+import shutil
+import tempfile
+
+task_count = 100
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to set mult_msg_workers in slurmdbd.conf")
+    atf.require_accounting(modify=True)
+    atf.require_config_parameter_includes(
+        "Parameters", "mult_msg_workers=4", source="slurmdbd"
+    )
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+def _run_array_without_dbd():
+    """Run a job array while slurmdbd is down so its records are queued"""
+
+    job_id = atf.submit_job_sbatch(
+        f'--array=1-{task_count} -o /dev/null --wrap "srun true"', fatal=True
+    )
+    assert atf.repeat_command_until(
+        f"squeue -h -j {job_id}",
+        lambda results: results["stdout"] == "",
+        timeout=300,
+    ), "All array tasks should end while slurmdbd is down"
+    return job_id
+
+
+def _wait_for_array_stored(job_id):
+    return atf.repeat_command_until(
+        f"sacct -j {job_id} -n -P -o jobid,state",
+        lambda results: len(
+            re.findall(
+                rf"^{job_id}_\d+(\.0)?\|COMPLETED$", results["stdout"], re.MULTILINE
+            )
+        )
+        == 2 * task_count,
+        timeout=120,
+    )
+
+
+def test_parallel_store():
+    """Verify job and step records sent in batches are all stored"""
+
+    atf.stop_slurmdbd(quiet=True)
+    try:
+        job_id = _run_array_without_dbd()
+    finally:
+        atf.start_slurmdbd(quiet=True)
+
+    assert _wait_for_array_stored(
+        job_id
+    ), "Every task and step should be stored by the workers"
+
+
+@pytest.fixture
+def messages_dir():
+    # Has to be writable by the slurm user
+    messages_dir = tempfile.mkdtemp(prefix="test_102_18.")
+    os.chmod(messages_dir, 0o777)
+    yield messages_dir
+    shutil.rmtree(messages_dir, ignore_errors=True)
+
+
+def test_replay(messages_dir):
+    """Verify slurmdbd -r acknowledges exactly the records it stored"""
+
+    state_dir = atf.get_config_parameter("StateSaveLocation")
+    messages = f"{messages_dir}/dbd.messages"
+
+    atf.stop_slurmdbd(quiet=True)
+    try:
+        job_id = _run_array_without_dbd()
+
+        # slurmctld writes what it couldn't send to dbd.messages on shutdown
+        atf.stop_slurmctld(quiet=True)
+        atf.run_command(
+            f"cp {state_dir}/dbd.messages {messages}",
+            user=atf.properties["slurm-user"],
+            fatal=True,
+        )
+    finally:
+        atf.start_slurmdbd(quiet=True)
+        atf.start_slurmctld(quiet=True)
+
+    assert _wait_for_array_stored(job_id), "The queued records should be stored"
+
+    cluster = atf.get_config_parameter("ClusterName")
+    output = atf.run_command_output(
+        f"{atf.properties['slurm-sbin-dir']}/slurmdbd -r {cluster}:{messages}",
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    )
+    match = re.search(r"Replayed (\d+) records .*, (\d+) stored", output)
+    assert match, "slurmdbd -r should report the records it replayed"
+    assert int(match.group(1)) > 0, "dbd.messages should hold records"
+    assert match.group(1) == match.group(2), "Every record should be acknowledged"
@@ -0,0 +1,76 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import time
+
+cluster = "test_roll_cluster"
+hours = 12
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to change rollup_workers in slurmdbd.conf")
+    atf.require_accounting(modify=True)
+    atf.require_config_parameter_includes(
+        "Parameters", "rollup_workers=4", source="slurmdbd"
+    )
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module")
+def new_cluster(sql_statement_repeat):
+    atf.run_command(
+        f"sacctmgr -i add cluster {cluster}",
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    )
+
+    yield sql_statement_repeat
+
+    atf.run_command(
+        f"sacctmgr -i remove cluster {cluster}",
+        user=atf.properties["slurm-user"],
+    )
+
+
+def _query(mysql_command, sql):
+    return atf.run_command_output(
+        mysql_command + f' -Ns -e "{sql}"',
+        user=atf.properties["slurm-user"],
+        fatal=True,
+    ).strip()
+
+
+def test_first_rollup(new_cluster):
+    """Verify the first rollup of a cluster with rollup_workers completes"""
+
+    now_hour = int(time.time()) // 3600 * 3600
+    start = now_hour - hours * 3600
+
+    # A cluster with history but never rolled up yet
+    atf.stop_slurmdbd()
+    _query(
+        new_cluster,
+        f"delete from {cluster}_last_ran_table; "
+        f"insert into {cluster}_event_table "
+        f"(time_start, node_name, cluster_nodes, reason, tres) "
+        f"values ({start}, '', '', '', '1=4')",
+    )
+    atf.start_slurmdbd()
+
+    assert atf.repeat_until(
+        lambda: _query(
+            new_cluster, f"select hourly_rollup from {cluster}_last_ran_table"
+        ),
+        lambda last_ran: last_ran and int(last_ran) >= now_hour,
+        timeout=120,
+    ), "The first rollup should move last_ran up to the current hour"
+
+    rolled = _query(
+        new_cluster,
+        f"select count(distinct time_start) from {cluster}_usage_hour_table "
+        f"where time_start >= {start} and time_start < {now_hour}",
+    )
+    assert int(rolled) == hours, f"All {hours} hours should be rolled up"
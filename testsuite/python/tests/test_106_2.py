@@ -0,0 +1,62 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import os
+import pytest
+
+# 64 blocks of 64k
+file_size_kb = 4096
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module")
+def source():
+    source = f"{atf.module_tmp_path}/source"
+    atf.run_command(
+        f"dd if=/dev/urandom of={source} bs=1k count={file_size_kb}", fatal=True
+    )
+    checksum = atf.run_command_output(f"md5sum < {source}", fatal=True).split()[0]
+    return source, checksum
+
+
+def _bcast(source, sbcast_args, env=""):
+    """Broadcast source in a job and return the checksum of the copy"""
+
+    file, checksum = source
+    dest = f"/tmp/test_106_2.{os.getpid()}"
+    output = atf.run_command_output(
+        f"salloc -N1 -t2 bash -c '{env} sbcast {sbcast_args} {file} {dest} && "
+        f"srun md5sum {dest}; srun rm -f {dest}'",
+        fatal=True,
+    )
+    assert (
+        checksum in output
+    ), f"The file sent with {env} sbcast {sbcast_args} should be identical"
+
+
+@pytest.mark.parametrize(
+    "sbcast_args",
+    [
+        "--size=64k --window=1",
+        "--size=64k --window=8",
+        "--size=64k --window=64",
+        "--size=64k --window=8 --compress=lz4",
+        "--size=64k --window=8 --force --preserve",
+    ],
+)
+def test_window(source, sbcast_args):
+    """Verify files sent with several blocks in flight arrive intact"""
+
+    _bcast(source, sbcast_args)
+
+
+def test_window_env(source):
+    """Verify SBCAST_WINDOW sets the window"""
+
+    _bcast(source, "--size=64k", env="SBCAST_WINDOW=8")
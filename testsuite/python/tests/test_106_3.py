@@ -0,0 +1,80 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import os
+import pytest
+import re
+
+node_count = 3
+
+# 32 blocks of 64k
+file_size_kb = 2048
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_nodes(node_count)
+    atf.require_slurm_running()
+
+    # Every node writes the same path, so they can't share a host
+    hosts = {
+        atf.get_node_parameter(node, "NodeHostName") for node in atf.get_nodes()
+    }
+    if len(hosts) < node_count:
+        pytest.skip(f"This test needs {node_count} nodes on different hosts")
+
+
+@pytest.fixture(scope="module")
+def source():
+    source = f"{atf.module_tmp_path}/source"
+    atf.run_command(
+        f"dd if=/dev/urandom of={source} bs=1k count={file_size_kb}", fatal=True
+    )
+    checksum = atf.run_command_output(f"md5sum < {source}", fatal=True).split()[0]
+    return source, checksum
+
+
+def _bcast(source, sbcast_args):
+    """Broadcast source to every node and return the sbcast output"""
+
+    file, checksum = source
+    dest = f"/tmp/test_106_3.{os.getpid()}"
+    output = atf.run_command_output(
+        f"salloc -N{node_count} -t2 bash -c 'sbcast {sbcast_args} {file} {dest} "
+        f"&& srun md5sum {dest}; srun rm -f {dest}'",
+        fatal=True,
+    )
+    assert (
+        output.count(checksum) == node_count
+    ), f"Every node should get an identical file with sbcast {sbcast_args}"
+    return output
+
+
+@pytest.mark.parametrize(
+    "sbcast_args",
+    [
+        "--size=64k --swarm",
+        "--size=64k --swarm --window=2",
+        "--size=64k --swarm --treewidth=1",
+        "--size=64k --swarm --compress=lz4",
+    ],
+)
+def test_swarm(source, sbcast_args):
+    """Verify blocks relayed between the nodes arrive intact"""
+
+    _bcast(source, sbcast_args)
+
+
+def test_swarm_benchmark(source):
+    """Verify --benchmark reports a swarm transfer"""
+
+    output = _bcast(source, "--size=64k --swarm --benchmark")
+    assert re.search(
+        rf"{file_size_kb * 1024} bytes to {node_count} nodes in [\d.]+ seconds "
+        r"\(swarm, window \d+, block 65536\)",
+        output,
+    ), "--benchmark should report the size, nodes and mode of the transfer"
+    assert re.search(
+        r"MB/s per node, [\d.]+ MB/s aggregate", output
+    ), "--benchmark should report the throughput"
@@ -0,0 +1,66 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import os
+import pytest
+
+# Compressible, 16 blocks of 256k
+file_size_kb = 4096
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module")
+def source():
+    source = f"{atf.module_tmp_path}/source"
+    atf.run_command(
+        f"yes 'test_106_4 compresses this line' | head -c {file_size_kb * 1024} "
+        f"> {source}",
+        fatal=True,
+    )
+    checksum = atf.run_command_output(f"md5sum < {source}", fatal=True).split()[0]
+    return source, checksum
+
+
+def _bcast(source, sbcast_args, env=""):
+    """Broadcast source in a job, check the copy and return the sbcast output"""
+
+    file, checksum = source
+    dest = f"/tmp/test_106_4.{os.getpid()}"
+    result = atf.run_command(
+        f"salloc -N1 -t2 bash -c '{env} sbcast -v {sbcast_args} {file} {dest} "
+        f"&& srun md5sum {dest}; srun rm -f {dest}'",
+        fatal=True,
+    )
+    assert (
+        checksum in result["stdout"]
+    ), f"The file sent with {env} sbcast {sbcast_args} should be identical"
+    return result["stdout"] + result["stderr"]
+
+
+@pytest.mark.parametrize(
+    "sbcast_args",
+    [
+        "--size=256k --compress=zstd",
+        "--size=256k --compress=zstd:1",
+        "--size=256k --compress=zstd:19",
+        "--size=256k --compress=zstd --window=4",
+    ],
+)
+def test_zstd(source, sbcast_args):
+    """Verify files compressed with zstd arrive intact"""
+
+    output = _bcast(source, sbcast_args)
+    if "zstd compression not supported" in output:
+        pytest.skip("Slurm was built without zstd")
+
+
+def test_zstd_env(source):
+    """Verify SBCAST_COMPRESS selects zstd"""
+
+    _bcast(source, "--size=256k", env="SBCAST_COMPRESS=zstd:3")
@@ -0,0 +1,78 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+
+# Setup
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants the rpc_queue enabled")
+    atf.require_config_parameter_includes("SlurmctldParameters", "enable_rpc_queue")
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+def _latency(output):
+    """Return {rpc: [total, queue, lock, exec]} with [p50, p99, p999] each"""
+
+    latency = {}
+    for m in re.finditer(
+        r"^\s+(\S+)\s*\(\s*\d+\) total:(\S+) queue:(\S+) lock:(\S+) exec:(\S+)$",
+        output,
+        re.MULTILINE,
+    ):
+        latency[m.group(1)] = [
+            [int(v) for v in m.group(p).split("/")] for p in range(2, 6)
+        ]
+    return latency
+
+
+def _slowest(output):
+    """Return the [total, queue, lock, exec] of each slowest RPC"""
+
+    return [
+        [int(v) for v in m.groups()]
+        for m in re.finditer(
+            r" total:(\d+)\s+queue:(\d+)\s+lock:(\d+)\s+exec:(\d+)\s+lock_holder:",
+            output,
+        )
+    ]
+
+
+def test_rpc_latency():
+    """Verify sdiag reports ordered percentiles and consistent phases"""
+
+    atf.run_command("sdiag --reset", user=atf.properties["slurm-user"], fatal=True)
+    for _ in range(10):
+        atf.submit_job_sbatch('--wrap "true"', fatal=True)
+        atf.run_command("squeue", fatal=True)
+
+    output = atf.run_command_output("sdiag", fatal=True)
+    latency = _latency(output)
+    assert "REQUEST_JOB_INFO" in latency, "squeue RPCs should be reported"
+    assert (
+        "REQUEST_SUBMIT_BATCH_JOB" in latency
+    ), "Queued sbatch RPCs should be reported"
+    for rpc, phases in latency.items():
+        for p50, p99, p999 in phases:
+            assert p50 <= p99 <= p999, f"Percentiles of {rpc} should be ordered"
+
+    slowest = _slowest(output)
+    assert len(slowest) > 0, "The slowest RPCs should be reported"
+    for total, queue, lock, exec in slowest:
+        assert (
+            total == queue + lock + exec
+        ), "Total latency should be the sum of queue, lock and exec"
+
+
+def test_rpc_latency_reset():
+    """Verify sdiag --reset clears the latency statistics"""
+
+    atf.run_command("sdiag --reset", user=atf.properties["slurm-user"], fatal=True)
+    output = atf.run_command_output("sdiag", fatal=True)
+    assert (
+        "REQUEST_SUBMIT_BATCH_JOB" not in _latency(output)
+    ), "Latency of sbatch RPCs should be cleared by --reset"
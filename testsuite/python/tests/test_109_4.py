@@ -0,0 +1,69 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+query_count = 50
+
+rpc_queue_yaml = f"""rpc_lanes:
+  - lane: query
+    max_active: 1
+    max_waiting: {query_count * 2}
+"""
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants rpc_lanes with a single query slot")
+    atf.require_config_parameter("SlurmctldParameters", "rpc_lanes")
+    atf.require_config_file("rpc_queue.yaml", rpc_queue_yaml)
+    atf.require_slurm_running()
+
+
+def _lanes():
+    """Return the sdiag lane statistics by lane name"""
+
+    output = atf.run_command_output("sdiag", fatal=True)
+    lanes = {}
+    for m in re.finditer(
+        r"^\s+(\w+)\s+active:(\d+)/(\d+) waiting:(\d+)/(\d+) admitted:(\d+) waited:(\d+) shed:(\d+) ave_wait:(\d+) max_wait:(\d+)$",
+        output,
+        re.MULTILINE,
+    ):
+        lanes[m.group(1)] = {
+            "max_active": int(m.group(3)),
+            "max_waiting": int(m.group(5)),
+            "admitted": int(m.group(6)),
+            "waited": int(m.group(7)),
+            "shed": int(m.group(8)),
+            "max_wait": int(m.group(10)),
+        }
+    return lanes
+
+
+def test_lane_config():
+    """Verify sdiag reports every lane with the configured limits"""
+
+    lanes = _lanes()
+    assert set(lanes) == {"job", "daemon", "admin", "query"}
+    assert lanes["query"]["max_active"] == 1
+    assert lanes["query"]["max_waiting"] == query_count * 2
+
+
+def test_parked_queries():
+    """Verify queries waiting for the query lane are processed, not shed"""
+
+    atf.run_command("sdiag --reset", user=atf.properties["slurm-user"], fatal=True)
+    atf.run_command(
+        f"for i in $(seq {query_count}); do squeue >/dev/null & done; wait",
+        user=atf.properties["test-user"],
+        fatal=True,
+    )
+
+    query = _lanes()["query"]
+    assert query["admitted"] >= query_count, "Every query should be admitted"
+    assert query["shed"] == 0, "No query should be told to back off"
+    if query["waited"]:
+        assert query["max_wait"] > 0, "Waiting queries should report a wait"
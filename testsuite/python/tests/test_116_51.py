@@ -0,0 +1,77 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+node_count = 4
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("needs to stop and resume a slurmd")
+    atf.require_config_parameter_includes("CommunicationParameters", "adaptive_fwd")
+    atf.require_config_parameter("TreeWidth", 2)
+    atf.require_config_parameter("SlurmdTimeout", 10)
+    atf.require_config_parameter_includes("DebugFlags", "Route")
+    atf.require_nodes(node_count)
+    atf.require_slurm_running()
+
+
+def run_on_all_nodes():
+    """Run a step on every node and return the node names it printed"""
+    output = atf.run_job_output(f"-N{node_count} -t1 printenv SLURMD_NODENAME")
+    return sorted(output.split())
+
+
+def test_adaptive_fwd_fanout():
+    """Verify a step spanning a multi level forwarding tree reaches every node"""
+
+    assert run_on_all_nodes() == sorted(
+        atf.get_nodes().keys()
+    ), "Every node should run one task"
+
+
+def suspect_contacts(node):
+    """Count the times slurmctld routed around node as a suspect"""
+    log_file = atf.get_config_parameter("SlurmctldLogFile")
+    log = atf.run_command_output(f"cat {log_file}", user="root", quiet=True)
+    return len(
+        [
+            l
+            for l in re.findall(r"contacting suspect nodes (\S+) directly", log)
+            if node in atf.node_range_to_list(l)
+        ]
+    )
+
+
+def test_adaptive_fwd_suspect_node_recovers():
+    """Verify a node that stopped answering is routed around, then reached"""
+
+    node = sorted(atf.get_nodes().keys())[1]
+    contacts = suspect_contacts(node)
+    slurmd = f"{atf.properties['slurm-sbin-dir']}/slurmd -N {node}"
+
+    # Stop the slurmd so the forwarding tree records it as suspect
+    atf.run_command(f"pkill -STOP -f '{slurmd}'", user="root", fatal=True)
+    try:
+        assert atf.wait_for_node_state(
+            node, "NOT_RESPONDING", timeout=60
+        ), f"Node {node} should stop responding"
+    finally:
+        atf.run_command(f"pkill -CONT -f '{slurmd}'", user="root", fatal=True)
+
+    # A suspect node is contacted directly, it must still be reached
+    atf.run_command(f"scontrol update nodename={node} state=resume", user="root")
+    assert atf.wait_for_node_state(
+        node, "NOT_RESPONDING", timeout=60, reverse=True
+    ), f"Node {node} should respond again"
+    assert (
+        suspect_contacts(node) > contacts
+    ), f"slurmctld should contact suspect node {node} directly, not through a subtree"
+    atf.wait_for_node_state(node, "IDLE", timeout=60, fatal=True)
+
+    assert run_on_all_nodes() == sorted(
+        atf.get_nodes().keys()
+    ), "Every node should run one task"
@@ -0,0 +1,73 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+node_count = 2
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("needs to restart slurmds")
+    atf.require_config_parameter_includes(
+        "CommunicationParameters", "conn_pool_idle_time=30"
+    )
+    atf.require_nodes(node_count)
+    atf.require_slurm_running()
+
+
+def run_jobs(count):
+    """Launch a few jobs, each one sends several RPCs to every slurmd"""
+    for i in range(count):
+        output = atf.run_job_output(f"-N{node_count} -t1 echo pooled{i}", fatal=True)
+        assert (
+            output.count(f"pooled{i}") == node_count
+        ), f"Job {i} should print from every node"
+
+
+def receive_errors():
+    """Count the receive errors slurmctld logged"""
+    log_file = atf.get_config_parameter("SlurmctldLogFile")
+    log = atf.run_command_output(f"cat {log_file}", user="root", quiet=True)
+    return len(re.findall(r"error: _?\w*receive_msgs: .* failed", log))
+
+
+def test_conn_pool_reuse():
+    """Verify RPCs to slurmd keep working over pooled connections"""
+
+    run_jobs(10)
+
+
+def test_conn_pool_reconfigure():
+    """Verify idle pooled connections don't hold up a slurmd reconfigure"""
+
+    run_jobs(2)
+    atf.run_command("scontrol reconfigure", user=atf.properties["slurm-user"], fatal=True)
+    for node in atf.get_nodes():
+        atf.wait_for_node_state(node, "IDLE", timeout=30, fatal=True)
+    run_jobs(2)
+
+
+def test_conn_pool_peer_restart():
+    """Verify a pooled connection closed by a restarted slurmd is replaced"""
+
+    run_jobs(2)
+    errors = receive_errors()
+
+    # Only restart the slurmds, slurmctld keeps its pooled connections
+    for node in atf.get_nodes():
+        atf.run_command(f"pkill -f 'slurmd -N {node}'", user="root")
+    for node in atf.get_nodes():
+        atf.repeat_command_until(
+            f"pgrep -f 'slurmd -N {node}'",
+            lambda results: results["exit_code"] != 0,
+            fatal=True,
+        )
+    atf.start_slurmctld(quiet=True, also_slurmds=True)
+
+    run_jobs(2)
+    assert (
+        receive_errors() == errors
+    ), "Stale pooled connections should be retried without logging errors"
@@ -0,0 +1,88 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+task_count = 4
+line_count = 5000
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to set SlurmdDebug")
+    atf.require_config_parameter("SlurmdDebug", "debug")
+    atf.require_nodes(1, [("CPUs", task_count)])
+    atf.require_slurm_running()
+
+
+def print_lines_cmd():
+    """Each task prints line_count numbered lines as fast as it can"""
+    return f"bash -c 'for i in $(seq {line_count}); do echo task$SLURM_PROCID-line$i-end; done'"
+
+
+def check_lines(output, label):
+    lines = output.splitlines()
+    assert (
+        len(lines) == task_count * line_count
+    ), f"All {task_count * line_count} lines should be written"
+    for task in range(task_count):
+        prefix = rf"{task}: " if label else ""
+        found = [
+            l for l in lines if re.fullmatch(rf"{prefix}task{task}-line\d+-end", l)
+        ]
+        assert len(found) == line_count, f"Lines of task {task} should be whole"
+        numbers = [int(re.search(r"line(\d+)", l).group(1)) for l in found]
+        assert numbers == list(
+            range(1, line_count + 1)
+        ), f"Lines of task {task} should be in order"
+
+
+@pytest.mark.parametrize("label", [False, True])
+def test_stdout_to_srun(label):
+    """Verify heavy task output relayed to srun arrives whole and in order"""
+
+    label_opt = "--label" if label else ""
+    output = atf.run_command_output(
+        f"srun -n{task_count} -t1 {label_opt} {print_lines_cmd()}", fatal=True
+    )
+    check_lines(output, label)
+
+
+def test_labelled_output_file(tmp_path):
+    """Verify labelled output written by slurmstepd to a file is whole"""
+
+    out_file = tmp_path / "out.txt"
+    atf.run_command(
+        f"srun -n{task_count} -t1 --label -o {out_file} {print_lines_cmd()}",
+        fatal=True,
+    )
+    with open(out_file) as f:
+        check_lines(f.read(), True)
+
+
+def test_io_stats():
+    """Verify slurmstepd logs its I/O counters when the I/O thread exits"""
+
+    output = atf.run_command_output(
+        f"srun -N1 -n{task_count} -t1 {print_lines_cmd()}", fatal=True
+    )
+    assert len(output.splitlines()) == task_count * line_count
+
+    log_file = atf.get_config_parameter("SlurmdLogFile")
+    log = ""
+    for node in atf.get_nodes(quiet=True):
+        log += atf.run_command_output(
+            f"cat {log_file.replace('%n', node)}", user="root", quiet=True
+        )
+    stats = re.findall(
+        r"IO stats: read (\d+) bytes from tasks, .* (\d+) bytes in (\d+) writes to clients",
+        log,
+    )
+    assert stats, "slurmstepd should log its I/O counters"
+    # Other steps of the job also log them, the busiest one is ours
+    read, written, writes = max(tuple(int(v) for v in s) for s in stats)
+    assert read >= len(output), "All the output should be counted as read"
+    assert written >= read, "All the output should be counted as written"
+    assert writes < task_count * line_count, "Writes to srun should be batched"
@@ -0,0 +1,76 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import logging
+
+task_count = 4
+line_count = 5000
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to change CommunicationParameters")
+    atf.require_nodes(1, [("CPUs", task_count)])
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module", params=["epoll", "eio_use_poll"])
+def eio_mode(request):
+    if request.param == "eio_use_poll":
+        comm_params = atf.get_config_parameter("CommunicationParameters", live=False)
+        logging.info("Setting CommunicationParameters to include eio_use_poll")
+        atf.set_config_parameter(
+            "CommunicationParameters",
+            ",".join(filter(None, [comm_params, "eio_use_poll"])),
+            restart=True,
+        )
+    return request.param
+
+
+@pytest.fixture(scope="module")
+def input_file(tmp_path_factory):
+    path = tmp_path_factory.mktemp("eio") / "input.txt"
+    path.write_text("".join(f"line{i}-end\n" for i in range(1, line_count + 1)))
+    return path
+
+
+def expected_lines(tasks=1):
+    return [f"line{i}-end" for i in range(1, line_count + 1)] * tasks
+
+
+def test_stdout(eio_mode):
+    """Verify heavy output of all tasks reaches srun"""
+
+    output = atf.run_command_output(
+        f"srun -n{task_count} -t1 seq {line_count}", fatal=True
+    )
+    assert sorted(output.splitlines(), key=int) == sorted(
+        [str(i) for i in range(1, line_count + 1)] * task_count, key=int
+    ), "All the output of all the tasks should be received"
+
+
+def test_stdin_pipe(eio_mode, input_file):
+    """Verify stdin read by srun from a pipe reaches the task and back"""
+
+    output = atf.run_command_output(
+        f"cat {input_file} | srun -n1 -t1 cat", fatal=True
+    )
+    assert (
+        output.splitlines() == expected_lines()
+    ), "The task should echo all its stdin in order"
+
+
+def test_stdin_file(eio_mode, input_file):
+    """Verify stdin read by srun from a regular file reaches every task"""
+
+    output = atf.run_command_output(
+        f"srun -n{task_count} -t1 -i {input_file} --label cat", fatal=True
+    )
+    lines = output.splitlines()
+    for task in range(task_count):
+        found = [l.split(": ", 1)[1] for l in lines if l.startswith(f"{task}: ")]
+        assert (
+            found == expected_lines()
+        ), f"Task {task} should echo the whole file in order"
@@ -0,0 +1,98 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+node_count = 3
+line_count = 2000
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to set LaunchParameters=srun_io_tree")
+    atf.require_config_parameter_includes("LaunchParameters", "srun_io_tree")
+    atf.require_nodes(node_count)
+    atf.require_slurm_running()
+
+
+def task_lines(output, task):
+    return [
+        l.split(": ", 1)[1] for l in output.splitlines() if l.startswith(f"{task}: ")
+    ]
+
+
+def test_output():
+    """Verify the output of relayed nodes reaches srun whole and in order"""
+
+    output = atf.run_command_output(
+        f"srun -N{node_count} -n{2 * node_count} -t1 -l seq {line_count}",
+        fatal=True,
+    )
+    for task in range(2 * node_count):
+        assert task_lines(output, task) == [
+            str(i) for i in range(1, line_count + 1)
+        ], f"Task {task} should send all its output in order"
+
+
+def test_stdin_all():
+    """Verify stdin is copied down the tree to every task"""
+
+    output = atf.run_command_output(
+        f"seq {line_count} | srun -N{node_count} -n{node_count} -t1 -l -i all cat",
+        fatal=True,
+    )
+    for task in range(node_count):
+        assert task_lines(output, task) == [
+            str(i) for i in range(1, line_count + 1)
+        ], f"Task {task} should echo all its stdin"
+
+
+def test_stdin_one_task():
+    """Verify stdin for a single task is only routed to its node"""
+
+    task = node_count - 1
+    output = atf.run_command_output(
+        f"seq {line_count} | srun -N{node_count} -n{node_count} -t1 -l -i {task} cat",
+        fatal=True,
+    )
+    assert task_lines(output, task) == [
+        str(i) for i in range(1, line_count + 1)
+    ], f"Task {task} should echo all the stdin"
+    for other in range(task):
+        assert not task_lines(output, other), f"Task {other} should get no stdin"
+
+
+def test_lost_link(tmp_path):
+    """Verify the other nodes keep their output when a relayed node is lost"""
+
+    out_file = tmp_path / "out.txt"
+    job_script = tmp_path / "job.sh"
+    atf.make_bash_script(
+        job_script,
+        f"srun -N{node_count} -n{node_count} -l bash -c "
+        f"'echo start; echo $PPID > {tmp_path}/tmp.$SLURM_NODEID; "
+        f"mv {tmp_path}/tmp.$SLURM_NODEID {tmp_path}/stepd.$SLURM_NODEID; "
+        f"sleep 15; echo end'",
+    )
+    job_id = atf.submit_job_sbatch(
+        f"-N{node_count} -t2 -o {out_file} {job_script}", fatal=True
+    )
+
+    # Rank 1 is a child of rank 0 in the reverse tree
+    stepd_file = tmp_path / "stepd.1"
+    atf.wait_for_file(stepd_file, fatal=True)
+    stepd_pid = int(stepd_file.read_text())
+    atf.run_command(f"kill -9 {stepd_pid}", user="root", fatal=True)
+
+    atf.wait_for_job_state(job_id, "DONE", timeout=180, fatal=True)
+    output = out_file.read_text()
+    for task in range(node_count):
+        assert re.search(
+            rf"^{task}: start$", output, re.MULTILINE
+        ), f"Task {task} output before the link loss should be received"
+    for task in [0, 2]:
+        assert re.search(
+            rf"^{task}: end$", output, re.MULTILINE
+        ), f"Task {task} output after the link loss should be received"
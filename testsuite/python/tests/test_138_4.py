@@ -0,0 +1,54 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import time
+
+refill_period = 5
+
+rpc_queue_yaml = """rpc_queue:
+  - type: REQUEST_JOB_INFO
+    rl_cost: 10
+"""
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants rate limiting with a custom rl_cost")
+    atf.require_config_parameter(
+        "SlurmctldParameters",
+        f"rl_enable,rl_bucket_size=10,rl_refill_rate=10,rl_refill_period={refill_period}",
+    )
+    atf.require_config_file("rpc_queue.yaml", rpc_queue_yaml)
+    atf.require_slurm_running()
+
+
+def _rate_limited(command):
+    """Run command as the test user and return True if it was rate limited"""
+
+    result = atf.run_command(f"{command} -v", user=atf.properties["test-user"])
+    assert result["exit_code"] == 0, f"{command} should eventually succeed"
+    return "RPC rate limited" in result["stderr"]
+
+
+def test_default_cost():
+    """Verify node queries take their default cost of 3 tokens"""
+
+    time.sleep(refill_period + 1)
+    for _ in range(3):
+        assert not _rate_limited(
+            "scontrol show node"
+        ), "Three node queries should fit in a bucket of 10 tokens"
+
+
+def test_rl_cost_without_rpc_queue():
+    """Verify rl_cost from rpc_queue.yaml applies without enable_rpc_queue"""
+
+    time.sleep(refill_period + 1)
+    assert not _rate_limited(
+        "scontrol show job"
+    ), "The first job query should take the whole bucket"
+    assert _rate_limited(
+        "scontrol show job"
+    ), "The second job query should be rate limited"
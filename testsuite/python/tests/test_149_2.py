@@ -0,0 +1,109 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import logging
+import os
+import re
+import shutil
+import tempfile
+
+
+spool_file = "influxdb.spool"
+
+
+# Setup
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to change acct_gather.conf")
+    atf.require_influxdb()
+    atf.require_slurm_running()
+
+
+@pytest.fixture(scope="module")
+def spool_dir():
+    path = tempfile.mkdtemp(prefix="influxdb_spool_")
+    os.chmod(path, 0o777)
+    yield path
+    shutil.rmtree(path, ignore_errors=True)
+
+
+def _influxdb_has_job(jobid):
+    output = atf.request_influxdb(
+        f"select job,max(value) from \"RSS\" where job = '{jobid}' AND time > now() - 1h"
+    )
+    return re.search(rf"\b{jobid}\b", output) is not None
+
+
+def _run_profiled_job(use_memory_program):
+    return atf.submit_job_srun(
+        f"--acctg-freq=1 --profile=task -t 1 {use_memory_program} 50 4",
+        fatal=True,
+    )
+
+
+def test_compress(use_memory_program):
+    """Test ProfileInfluxDBCompress=yes"""
+
+    atf.set_config_parameter(
+        "ProfileInfluxDBCompress", "yes", source="acct_gather", restart=True
+    )
+
+    jobid = _run_profiled_job(use_memory_program)
+    assert atf.repeat_until(
+        lambda: _influxdb_has_job(jobid), lambda found: found, timeout=30
+    ), f"influxdb should have the gzip data from job {jobid}"
+
+
+def test_spool(use_memory_program, spool_dir):
+    """Test ProfileInfluxDBSpoolDir keeps the data while influxdb is unreachable"""
+
+    host = atf.get_config_parameter(
+        "ProfileInfluxDBHost", live=False, source="acct_gather"
+    )
+    path = os.path.join(spool_dir, spool_file)
+
+    atf.set_config_parameter(
+        "ProfileInfluxDBSpoolDir", spool_dir, source="acct_gather", restart=True
+    )
+    atf.set_config_parameter(
+        "ProfileInfluxDBHost",
+        f"{atf.properties['influxdb_host']}:1",
+        source="acct_gather",
+        restart=True,
+    )
+
+    spooled_job = _run_profiled_job(use_memory_program)
+    assert os.path.isfile(path), f"{path} should exist while influxdb is down"
+    with open(path) as f:
+        assert (
+            re.search(rf"job={spooled_job}\b", f.read()) is not None
+        ), f"{path} should have the data from job {spooled_job}"
+    assert not _influxdb_has_job(
+        spooled_job
+    ), f"influxdb shouldn't have data from job {spooled_job} yet"
+
+    logging.info("Making influxdb reachable again")
+    atf.set_config_parameter(
+        "ProfileInfluxDBHost", host, source="acct_gather", restart=True
+    )
+
+    jobid = _run_profiled_job(use_memory_program)
+    assert atf.repeat_until(
+        lambda: _influxdb_has_job(jobid), lambda found: found, timeout=30
+    ), f"influxdb should have data from job {jobid}"
+    assert atf.repeat_until(
+        lambda: _influxdb_has_job(spooled_job), lambda found: found, timeout=30
+    ), f"influxdb should have the spooled data from job {spooled_job}"
+
+    # The spool is rewritten from its start, without a hole in front
+    with open(path, "rb") as f:
+        data = f.read()
+    assert b"\0" not in data, f"{path} shouldn't have a hole after being flushed"
+    assert (
+        re.search(rf"job={spooled_job}\b".encode(), data) is None
+    ), f"{path} shouldn't keep the data sent from job {spooled_job}"
+    assert (
+        os.path.getsize(f"{path}.sending") == 0
+    ), "Everything moved out of the spool to send should have been sent"
@@ -0,0 +1,97 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import os
+import shutil
+import tempfile
+
+
+parent_dir = tempfile.mkdtemp(prefix="hdf5_profile_")
+profile_dir = os.path.join(parent_dir, "hdf5")
+
+
+# Setup
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to change acct_gather.conf")
+    atf.require_tool("sh5util")
+    os.chmod(parent_dir, 0o755)
+    atf.require_config_parameter("JobAcctGatherType", "jobacct_gather/linux")
+    atf.require_config_parameter("AcctGatherProfileType", "acct_gather_profile/hdf5")
+    atf.require_config_parameter("ProfileHDF5Dir", profile_dir, source="acct_gather")
+    atf.require_config_parameter("ProfileHDF5ChunkSize", "4", source="acct_gather")
+    atf.require_config_parameter("ProfileHDF5Compress", "6", source="acct_gather")
+    atf.require_slurm_running()
+    yield
+    shutil.rmtree(parent_dir, ignore_errors=True)
+
+
+def _profile_job(layout):
+    atf.set_config_parameter(
+        "ProfileHDF5Layout", layout, source="acct_gather", restart=True
+    )
+    job_id = atf.submit_job_srun(
+        "--acctg-freq=1 --profile=task -n2 -t1 sleep 6", fatal=True
+    )
+    atf.wait_for_job_state(job_id, "COMPLETED", fatal=True)
+    return job_id
+
+
+def _extract(job_id, h5_file, csv_file, parallel=1):
+    atf.run_command(
+        f"sh5util -j {job_id} -E -l Node:TimeSeries -s Task --parallel={parallel} -i {h5_file} -o {csv_file}",
+        fatal=True,
+    )
+    with open(csv_file) as f:
+        return f.read().splitlines()
+
+
+@pytest.mark.parametrize("layout", ["Row", "Columnar"])
+def test_layout(layout, tmp_path):
+    """Test ProfileHDF5Layout node-step files can be merged and extracted"""
+
+    job_id = _profile_job(layout)
+    h5_file = tmp_path / f"job_{job_id}.h5"
+
+    atf.run_command(f"sh5util -j {job_id} -S -o {h5_file}", fatal=True)
+    assert h5_file.exists(), f"sh5util should merge the files of job {job_id}"
+
+    output = atf.run_command_output(
+        f"sh5util -j {job_id} -L -l Node:TimeSeries -s Task -i {h5_file}", fatal=True
+    )
+    assert "RSS" in output, "The Task series should list its RSS item"
+
+    lines = _extract(job_id, h5_file, tmp_path / "serial.csv")
+    assert len(lines) > 2, "The Task series should have several samples"
+    assert "RSS" in lines[0], "The extracted header should name the data items"
+
+    rss_file = tmp_path / "rss.csv"
+    atf.run_command(
+        f"sh5util -j {job_id} -I -s Task -d RSS -i {h5_file} -o {rss_file}",
+        fatal=True,
+    )
+    assert rss_file.stat().st_size > 0, "The RSS item should be extracted"
+
+
+def test_parallel(tmp_path):
+    """Test sh5util --parallel gives the same results as a serial run"""
+
+    job_id = _profile_job("Columnar")
+    serial_file = tmp_path / "serial.h5"
+    parallel_file = tmp_path / "parallel.h5"
+
+    atf.run_command(f"sh5util -j {job_id} -S -o {serial_file}", fatal=True)
+    atf.run_command(
+        f"sh5util -j {job_id} -S --parallel=4 -o {parallel_file}", fatal=True
+    )
+    assert parallel_file.exists(), "sh5util --parallel should merge the files"
+
+    serial = _extract(job_id, serial_file, tmp_path / "serial.csv")
+    parallel = _extract(job_id, parallel_file, tmp_path / "parallel.csv", 4)
+
+    assert len(serial) > 2, "The Task series should have several samples"
+    assert sorted(parallel) == sorted(
+        serial
+    ), "Parallel merge and extraction should match the serial ones"
@@ -0,0 +1,59 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+# Each of the processes of the step touches this much memory
+mem_mb = 64
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to set JobAcctGatherParams=NoProcScan")
+    atf.require_config_parameter("ProctrackType", "proctrack/cgroup")
+    atf.require_config_parameter("JobAcctGatherType", "jobacct_gather/cgroup")
+    atf.require_config_parameter_includes("JobAcctGatherParams", "NoProcScan")
+    atf.require_config_parameter("JobAcctGatherFrequency", "task=1")
+    atf.require_accounting()
+    atf.require_nodes(1)
+    atf.require_slurm_running()
+
+
+def _to_mb(value):
+    match = re.match(r"([\d.]+)([KMGT]?)", value)
+    assert match, f"Unexpected size {value}"
+    scale = {"": 1 / (1024 * 1024), "K": 1 / 1024, "M": 1, "G": 1024, "T": 1024**2}
+    return float(match.group(1)) * scale[match.group(2)]
+
+
+def test_no_proc_scan():
+    """Verify usage of the processes a task spawns comes from the cgroup"""
+
+    # The task forks workers that each hold mem_mb and use some CPU
+    job_id = atf.submit_job_sbatch(
+        "-N1 -n1 -t2 --wrap \"srun bash -c 'for i in 1 2 3; do "
+        f"dd if=/dev/zero of=/dev/null bs={mem_mb}M count=100 & done; "
+        "sleep 3; wait'\"",
+        fatal=True,
+    )
+    atf.wait_for_job_state(job_id, "COMPLETED", fatal=True)
+
+    assert atf.repeat_command_until(
+        f"sacct -j {job_id}.0 -n -P -o MaxRSS,TotalCPU",
+        lambda results: re.search(r"^\S+\|\S+$", results["stdout"], re.MULTILINE),
+        timeout=30,
+    ), "The step should be stored with its usage"
+    max_rss, total_cpu = (
+        atf.run_command_output(
+            f"sacct -j {job_id}.0 -n -P -o MaxRSS,TotalCPU", fatal=True
+        )
+        .splitlines()[0]
+        .split("|")
+    )
+
+    assert (
+        _to_mb(max_rss) >= mem_mb
+    ), "MaxRSS should include the memory of the processes the task forked"
+    assert re.search(r"[1-9]", total_cpu), "TotalCPU should not be zero"
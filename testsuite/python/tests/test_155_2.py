@@ -0,0 +1,50 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+import re
+
+step_count = 4
+
+
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_auto_config("wants to set JobAcctGatherParams=LowJitterPoll")
+    atf.require_config_parameter_includes("JobAcctGatherParams", "LowJitterPoll")
+    atf.require_config_parameter("JobAcctGatherFrequency", "task=2")
+    atf.require_accounting()
+    atf.require_nodes(1, [("CPUs", step_count)])
+    atf.require_slurm_running()
+
+
+def test_low_jitter_poll():
+    """Verify concurrent steps still gather usage with aligned polling"""
+
+    job_id = atf.submit_job_sbatch(
+        f'-N1 -n{step_count} -t2 --wrap "'
+        f"for i in $(seq {step_count}); do "
+        "srun -n1 --exact bash -c 'dd if=/dev/zero of=/dev/null bs=16M count=400; "
+        'sleep 5\' & done; wait"',
+        fatal=True,
+    )
+    atf.wait_for_job_state(job_id, "RUNNING", fatal=True)
+
+    assert atf.repeat_command_until(
+        f"sstat -j {job_id} -n -P -a -o JobID,AveCPU",
+        lambda results: len(
+            re.findall(rf"^{job_id}\.\d+\|", results["stdout"], re.MULTILINE)
+        )
+        == step_count,
+        timeout=30,
+    ), "sstat should report every running step"
+
+    atf.wait_for_job_state(job_id, "COMPLETED", fatal=True)
+    assert atf.repeat_command_until(
+        f"sacct -j {job_id} -n -P -o JobID,MaxRSS",
+        lambda results: len(
+            re.findall(rf"^{job_id}\.\d+\|\d", results["stdout"], re.MULTILINE)
+        )
+        == step_count,
+        timeout=30,
+    ), "Every step should be stored with its memory usage"